@@ -10,6 +10,7 @@ SET(LCB_UTILS_SRC
     src/ringbuffer.c)
 
 SET(LCB_UTILS_CXXSRC
+    src/logging-async.cc
     src/strcodecs/base64.cc)
 
 # lcbio
@@ -49,7 +50,9 @@ SET(LCB_CORE_CXXSRC
     src/bucketconfig/bc_static.cc
     src/bucketconfig/confmon.cc
     src/utilities.cc
+    src/coalesce.cc
     src/collections.cc
+    src/compqueue.cc
     src/connspec.cc
     src/crypto.cc
     src/dns-srv.cc
@@ -58,10 +61,14 @@ SET(LCB_CORE_CXXSRC
     src/getconfig.cc
     src/nodeinfo.cc
     src/handler.cc
+    src/hedge.cc
     src/hostlist.cc
     src/http/http.cc
     src/http/http_io.cc
+    src/http/inflate.cc
+    src/http/selector.cc
     src/lcbht/lcbht.cc
+    src/mutation_state.cc
     src/newconfig.cc
     src/n1ql/n1ql.cc
     src/n1ql/ixmgmt.cc
@@ -77,6 +84,7 @@ SET(LCB_CORE_CXXSRC
     src/operations/remove.cc
     src/operations/stats.cc
     src/operations/store.cc
+    src/operations/bulk.cc
     src/operations/subdoc.cc
     src/operations/touch.cc
     src/operations/ping.cc
@@ -63,6 +63,12 @@ extern "C" {
 
     typedef struct cbsasl_conn_st cbsasl_conn_t;
 
+    /**
+     * Salted passwords derived during SCRAM-SHA authentication, which may be
+     * shared by the connections authenticating with the same credentials.
+     */
+    typedef struct cbsasl_salted_cache_st cbsasl_salted_cache_t;
+
     typedef struct {
         void *context;
         int (*username)(void *context, int id, const char **result, unsigned int *len);
@@ -95,6 +101,7 @@ extern "C" {
         unsigned char *saltedpassword; // for SCRAM-SHA authentication
         unsigned int saltedpasslen; // length of the salted password field
         char *auth_message; // for SCRAM-SHA authentication
+        cbsasl_salted_cache_t *salted_cache; // for SCRAM-SHA authentication (not owned, may be NULL)
     };
 
     struct cbsasl_server_conn_t {
@@ -207,6 +214,20 @@ extern "C" {
         CBSASL_CONFIG = 1
     } cbsasl_prop_t;
 
+    /**
+     * Creates an empty cache of salted passwords. Set it as the
+     * `salted_cache` of client connections to skip the key derivation when
+     * they authenticate with the same credentials.
+     */
+    CBSASL_PUBLIC_API
+    cbsasl_salted_cache_t *cbsasl_salted_cache_new(void);
+
+    /**
+     * Wipes and frees the cache. It must no longer be used by any connection.
+     */
+    CBSASL_PUBLIC_API
+    void cbsasl_salted_cache_free(cbsasl_salted_cache_t *cache);
+
     CBSASL_PUBLIC_API
     cbsasl_error_t cbsasl_getprop(cbsasl_conn_t *conn,
                                   cbsasl_prop_t propnum,
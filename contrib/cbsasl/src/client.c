@@ -276,8 +276,8 @@ cbsasl_error_t cbsasl_client_step(cbsasl_conn_t *conn, const char *serverin, uns
                     return SASL_BADPARAM;
                 }
                 // ok, now we can compute the client proof
-                ret = generate_salted_password(conn->c.client.auth_mech, pass, salt, saltlen, itcount, saltedpassword,
-                                               &saltedpasslen);
+                ret = generate_salted_password(conn->c.client.salted_cache, conn->c.client.auth_mech, pass, salt,
+                                               saltlen, itcount, saltedpassword, &saltedpasslen);
                 if (ret != SASL_OK) {
                     return ret;
                 }
@@ -256,9 +256,121 @@ cbsasl_error_t parse_server_challenge(const char *serverin, unsigned int serveri
  * As the salted password is binary and may contain the binary zero, we
  * don't put a binary zero at the end of the buffer.
  */
-cbsasl_error_t generate_salted_password(cbsasl_auth_mechanism_t auth_mech, const cbsasl_secret_t *passwd,
-                                        const char *salt, unsigned int saltlen, unsigned int itcount,
-                                        unsigned char *outbuffer, unsigned int *outlength)
+/**
+ * Salted passwords are expensive to derive (`itcount` rounds of HMAC), yet the
+ * server hands out the same salt and iteration count for a given user on every
+ * connection. The cache remembers the most recent derivations, so that
+ * reconnects (and the many connections opened at bootstrap) only pay this cost
+ * once per instance.
+ *
+ * The password itself is never stored, only its SHA-256 digest. The salted
+ * passwords are still password-equivalent, so they are wiped when the cache is
+ * freed.
+ */
+#define SALTED_PASSWORD_CACHE_SIZE 16
+
+struct salted_password_entry {
+    cbsasl_auth_mechanism_t auth_mech;
+    unsigned int itcount;
+    unsigned char passwd_digest[CBSASL_SHA256_DIGEST_SIZE];
+    char salt[256];
+    unsigned int saltlen;
+    unsigned char salted[CBSASL_SHA512_DIGEST_SIZE];
+    unsigned int saltedlen;
+    bool used;
+};
+
+struct cbsasl_salted_cache_st {
+    salted_password_entry entries[SALTED_PASSWORD_CACHE_SIZE];
+    size_t next;
+};
+
+CBSASL_PUBLIC_API
+cbsasl_salted_cache_t *cbsasl_salted_cache_new(void)
+{
+    return static_cast<cbsasl_salted_cache_t *>(calloc(1, sizeof(cbsasl_salted_cache_t)));
+}
+
+CBSASL_PUBLIC_API
+void cbsasl_salted_cache_free(cbsasl_salted_cache_t *cache)
+{
+    if (cache == NULL) {
+        return;
+    }
+#ifndef LCB_NO_SSL
+    OPENSSL_cleanse(cache, sizeof(*cache));
+#else
+    volatile unsigned char *p = reinterpret_cast<volatile unsigned char *>(cache);
+    for (size_t ii = 0; ii < sizeof(*cache); ii++) {
+        p[ii] = 0;
+    }
+#endif
+    free(cache);
+}
+
+#ifdef HAVE_PKCS5_PBKDF2_HMAC
+static salted_password_entry *salted_password_cache_find(cbsasl_salted_cache_t *cache,
+                                                         cbsasl_auth_mechanism_t auth_mech,
+                                                         const unsigned char *digest, const char *salt,
+                                                         unsigned int saltlen, unsigned int itcount)
+{
+    for (auto &entry : cache->entries) {
+        if (entry.used && entry.auth_mech == auth_mech && entry.itcount == itcount && entry.saltlen == saltlen &&
+            memcmp(entry.salt, salt, saltlen) == 0 && memcmp(entry.passwd_digest, digest, sizeof(entry.passwd_digest)) == 0) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+static bool salted_password_cache_lookup(cbsasl_salted_cache_t *cache, cbsasl_auth_mechanism_t auth_mech,
+                                         const cbsasl_secret_t *passwd, const char *salt, int saltlen,
+                                         unsigned int itcount, unsigned char *outbuffer, unsigned int *outlength)
+{
+    unsigned char digest[CBSASL_SHA256_DIGEST_SIZE];
+    SHA256(passwd->data, passwd->len, digest);
+
+    const salted_password_entry *entry = salted_password_cache_find(cache, auth_mech, digest, salt, saltlen, itcount);
+    OPENSSL_cleanse(digest, sizeof(digest));
+    if (entry == nullptr) {
+        return false;
+    }
+    memcpy(outbuffer, entry->salted, entry->saltedlen);
+    *outlength = entry->saltedlen;
+    return true;
+}
+
+static void salted_password_cache_store(cbsasl_salted_cache_t *cache, cbsasl_auth_mechanism_t auth_mech,
+                                        const cbsasl_secret_t *passwd, const char *salt, int saltlen,
+                                        unsigned int itcount, const unsigned char *salted, unsigned int saltedlen)
+{
+    if (saltlen < 0 || (size_t)saltlen > sizeof(cache->entries[0].salt) ||
+        saltedlen > sizeof(cache->entries[0].salted)) {
+        return;
+    }
+    unsigned char digest[CBSASL_SHA256_DIGEST_SIZE];
+    SHA256(passwd->data, passwd->len, digest);
+
+    salted_password_entry *entry = salted_password_cache_find(cache, auth_mech, digest, salt, saltlen, itcount);
+    if (entry == nullptr) {
+        entry = &cache->entries[cache->next];
+        cache->next = (cache->next + 1) % SALTED_PASSWORD_CACHE_SIZE;
+    }
+    entry->auth_mech = auth_mech;
+    entry->itcount = itcount;
+    memcpy(entry->passwd_digest, digest, sizeof(digest));
+    OPENSSL_cleanse(digest, sizeof(digest));
+    memcpy(entry->salt, salt, saltlen);
+    entry->saltlen = saltlen;
+    memcpy(entry->salted, salted, saltedlen);
+    entry->saltedlen = saltedlen;
+    entry->used = true;
+}
+#endif
+
+cbsasl_error_t generate_salted_password(cbsasl_salted_cache_t *cache, cbsasl_auth_mechanism_t auth_mech,
+                                        const cbsasl_secret_t *passwd, const char *salt, unsigned int saltlen,
+                                        unsigned int itcount, unsigned char *outbuffer, unsigned int *outlength)
 {
     // decode the salt from Base64
     char decodedsalt[256];
@@ -269,6 +381,10 @@ cbsasl_error_t generate_salted_password(cbsasl_auth_mechanism_t auth_mech, const
     }
 
 #ifdef HAVE_PKCS5_PBKDF2_HMAC
+    if (cache && salted_password_cache_lookup(cache, auth_mech, passwd, decodedsalt, decsaltlen, itcount, outbuffer,
+                                              outlength)) {
+        return SASL_OK;
+    }
     switch (auth_mech) {
         case SASL_AUTH_MECH_SCRAM_SHA1:
             PKCS5_PBKDF2_HMAC((const char *)passwd->data, passwd->len, (const unsigned char *)decodedsalt,
@@ -288,8 +404,12 @@ cbsasl_error_t generate_salted_password(cbsasl_auth_mechanism_t auth_mech, const
         default:
             return SASL_BADPARAM;
     }
+    if (cache) {
+        salted_password_cache_store(cache, auth_mech, passwd, decodedsalt, decsaltlen, itcount, outbuffer, *outlength);
+    }
     return SASL_OK;
 #else
+    (void)cache;
     (void)auth_mech;
     (void)passwd;
     (void)salt;
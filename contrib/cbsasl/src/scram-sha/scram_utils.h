@@ -59,10 +59,14 @@ cbsasl_error_t parse_server_challenge(const char *serverin, unsigned int serveri
 
 /**
  * Generates the salted password.
+ *
+ * If 'cache' is not NULL, the result is cached per (mechanism, password, salt,
+ * iteration count), so subsequent calls with the same parameters skip the key
+ * derivation.
  */
-cbsasl_error_t generate_salted_password(cbsasl_auth_mechanism_t auth_mech, const cbsasl_secret_t *passwd,
-                                        const char *salt, unsigned int saltlen, unsigned int itcount,
-                                        unsigned char *outbuffer, unsigned int *outlength);
+cbsasl_error_t generate_salted_password(cbsasl_salted_cache_t *cache, cbsasl_auth_mechanism_t auth_mech,
+                                        const cbsasl_secret_t *passwd, const char *salt, unsigned int saltlen,
+                                        unsigned int itcount, unsigned char *outbuffer, unsigned int *outlength);
 
 /**
  * Computes the client proof. It is computed as:
@@ -61,6 +61,14 @@
  *
  * @committed
  *
+ * @subsection LCB_LOGASYNC
+ *
+ * Write the console logger's messages from a background thread, so that
+ * logging does not wait for the output (see @ref LCB_CNTL_CONLOGGER_ASYNC).
+ * Only used together with `LCB_LOGLEVEL`
+ *
+ * @volatile
+ *
  * @subsection LCB_SSL_MODE
  *
  * Specify the _mode_ to use for SSL. Mode can either be `0` (for no SSL),
@@ -212,6 +212,11 @@ struct lcb_cntl_rdballocfactory {
  * object. Currently the use and API of this object is considered internal
  * and its API and header files are in `src/rdb`.
  *
+ * The factory is NULL unless one was set, in which case the library's own
+ * allocator is used: it sizes reads to the responses of each server, and
+ * shares a cache of buffers between connections (see
+ * LCB_CNTL_READ_BUFFER_CACHE_SIZE).
+ *
  * Mode|Arg
  * ----|---
  * Set, Get | `lcb_cntl_rdballocfactory*`
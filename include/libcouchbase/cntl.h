@@ -283,8 +283,9 @@ typedef enum {
 /**
  * @brief Polling grace interval for lcb_durability_poll()
  *
- * This is the time the client will wait between repeated probes to
- * a given server.
+ * This is the longest time the client will wait between repeated probes to
+ * a given server. Probes are initially sent more often, and are spaced out
+ * up to this interval while the keys' state does not change.
  *
  * @cntl_arg_both{lcb_U32*}
  * @committed
@@ -1326,11 +1327,468 @@ typedef enum {
  */
 #define LCB_CNTL_ENABLE_OP_METRICS 0x67
 
+/**
+ * @brief Number of nodes to bootstrap from concurrently
+ *
+ * When greater than one, the initial CCCP bootstrap opens connections to up to
+ * this many nodes at once (with each connection started
+ * @ref LCB_CNTL_BOOTSTRAP_RACE_DELAY after the previous one), and uses the
+ * first configuration received. The remaining connections are cancelled.
+ * This avoids waiting @ref LCB_CNTL_CONFIG_NODE_TIMEOUT for each unreachable
+ * node in the bootstrap list. The default is `1` (try nodes one at a time).
+ *
+ * Use `bootstrap_race_width` in the connection string.
+ *
+ * @cntl_arg_both{lcb_U32*}
+ * @volatile
+ */
+#define LCB_CNTL_BOOTSTRAP_RACE_WIDTH 0x68
+
+/**
+ * @brief Delay before starting the next concurrent bootstrap connection
+ *
+ * See @ref LCB_CNTL_BOOTSTRAP_RACE_WIDTH. A failed connection attempt starts
+ * the next one immediately, without waiting for this delay.
+ *
+ * Use `bootstrap_race_delay` in the connection string.
+ *
+ * @cntl_arg_both{lcb_U32*}
+ * @volatile
+ */
+#define LCB_CNTL_BOOTSTRAP_RACE_DELAY 0x69
+
+/**
+ * @brief Open KV connections eagerly
+ *
+ * By default a connection to a data node is opened (and negotiated) when the
+ * first operation is scheduled for it. When this setting is enabled, the
+ * library connects to every data node as soon as a cluster configuration is
+ * applied, so that the first operations do not pay the connection setup
+ * latency. Negotiation for all nodes proceeds in parallel.
+ *
+ * Use `kv_prewarm` in the connection string.
+ *
+ * @cntl_arg_both{int* (as boolean)}
+ * @volatile
+ */
+#define LCB_CNTL_KV_PREWARM 0x6a
+
+/**
+ * @brief Request compressed HTTP responses
+ *
+ * When enabled, query, analytics and search requests advertise
+ * `Accept-Encoding: gzip, deflate`, and compressed responses are inflated
+ * incrementally as they arrive from the network. This trades a little CPU for
+ * a (typically much) smaller amount of data on the wire for large result sets.
+ *
+ * Setting this to true returns @ref LCB_ERR_SDK_FEATURE_UNAVAILABLE if the
+ * library was built without zlib.
+ *
+ * Use `http_compression` in the connection string.
+ *
+ * @cntl_arg_both{int* (as boolean)}
+ * @volatile
+ */
+#define LCB_CNTL_HTTP_COMPRESSION 0x6b
+
+/**
+ * @brief High-water mark of undelivered data for query, analytics, search and view handles
+ *
+ * Response data which cannot be passed to the application yet (because it
+ * paused row delivery, e.g. with lcb_query_pause(), or because data kept while
+ * it was paused is still being delivered) is kept by the library. Reading
+ * from the network pauses automatically as soon as this many bytes are kept,
+ * and resumes once they were delivered. A value of `0` (the default) stops
+ * reading whenever any data is waiting. Larger values trade memory for a
+ * faster restart once delivery is resumed.
+ *
+ * Use `http_stream_hwm` in the connection string.
+ *
+ * @cntl_arg_both{lcb_U32*}
+ * @volatile
+ */
+#define LCB_CNTL_HTTP_STREAM_HWM 0x6c
+
+/**
+ * @brief Maximum number of entries in the prepared statement cache
+ *
+ * When a query is executed with lcb_cmdquery_adhoc() set to false, the
+ * prepared statement is kept in a per-instance cache. Once the cache holds
+ * this many statements, the least recently used one is evicted. The default
+ * is 5000.
+ *
+ * Use `query_cache_max_entries` in the connection string.
+ *
+ * @cntl_arg_both{lcb_U32*}
+ * @volatile
+ */
+#define LCB_CNTL_QUERY_CACHE_MAX_ENTRIES 0x6d
+
+/**
+ * @brief Memory budget, in bytes, of the prepared statement cache
+ *
+ * Least recently used statements are evicted while the cache (statements and
+ * prepared plans) is larger than this. The default is `0` (no limit other than
+ * @ref LCB_CNTL_QUERY_CACHE_MAX_ENTRIES).
+ *
+ * Use `query_cache_max_bytes` in the connection string.
+ *
+ * @cntl_arg_both{lcb_U32*}
+ * @volatile
+ */
+#define LCB_CNTL_QUERY_CACHE_MAX_BYTES 0x6e
+
+/**
+ * Statistics for the prepared statement cache
+ * @see LCB_CNTL_QUERY_CACHE_STATS
+ * @volatile
+ */
+typedef struct {
+    /** Number of statements in the cache */
+    lcb_SIZE entries;
+    /** Approximate memory used by the cache */
+    lcb_SIZE bytes;
+    /** Number of queries which used a cached statement */
+    lcb_U64 hits;
+    /** Number of queries which had to prepare the statement */
+    lcb_U64 misses;
+    /** Number of statements evicted because of the cache limits */
+    lcb_U64 evictions;
+} lcb_QUERY_CACHE_STATS;
+
+/**
+ * @brief Get the statistics of the prepared statement cache
+ *
+ * @cntl_arg_getonly{lcb_QUERY_CACHE_STATS*}
+ * @volatile
+ */
+#define LCB_CNTL_QUERY_CACHE_STATS 0x6f
+
+/**
+ * @brief File to persist the prepared statement cache in
+ *
+ * When set, the prepared statements stored in the file (if it exists) are
+ * added to the cache, and the cache is written back to the file when the
+ * instance is destroyed. This allows short-lived processes to skip the
+ * `PREPARE` round trip for statements which were already prepared by a
+ * previous process. Statements which are no longer valid on the cluster are
+ * transparently prepared again.
+ *
+ * Setting this returns @ref LCB_ERR_PROTOCOL_ERROR if the file exists but
+ * could not be parsed.
+ *
+ * Use `query_cache` in the connection string.
+ *
+ * @cntl_arg_both{`const char**`, `const char*`}
+ * @volatile
+ */
+#define LCB_CNTL_QUERY_CACHE_FILE 0x70
+
+/**
+ * @brief Write the prepared statement cache to a file now
+ *
+ * The file can be loaded with @ref LCB_CNTL_QUERY_CACHE_FILE. The argument is
+ * the path of the file, or NULL to write the file set with
+ * @ref LCB_CNTL_QUERY_CACHE_FILE. The file is replaced atomically.
+ *
+ * @cntl_arg_setonly{`const char*`}
+ * @volatile
+ */
+#define LCB_CNTL_QUERY_CACHE_SAVE 0x71
+
+/**
+ * How a node is chosen for query, analytics, search and view requests
+ * @see LCB_CNTL_HTTP_ENDPOINT_SELECTION
+ */
+typedef enum {
+    /** Pick a node providing the service at random */
+    LCB_HTTP_ENDPOINT_RANDOM = 0x00,
+    /**
+     * Pick two nodes at random, and use the one with the lower product of
+     * requests in flight and recent response time
+     */
+    LCB_HTTP_ENDPOINT_LEAST_LOADED = 0x01
+} lcb_HTTP_ENDPOINT_SELECTION;
+
+/**
+ * @brief Node selection policy for query, analytics, search and view requests
+ *
+ * With @ref LCB_HTTP_ENDPOINT_LEAST_LOADED (the default), the library keeps
+ * track of the requests in flight and the response time of each node, and
+ * avoids sending requests to nodes which are slower or busier than the others.
+ * The statistics are included in the report generated by lcb_diag().
+ *
+ * This does not apply to queries which were explicitly sent to a specific
+ * node.
+ *
+ * Use `http_endpoint_selection` in the connection string (e.g.
+ * "http_endpoint_selection=random" or "http_endpoint_selection=least_loaded")
+ *
+ * @cntl_arg_both{lcb_HTTP_ENDPOINT_SELECTION*}
+ * @volatile
+ */
+#define LCB_CNTL_HTTP_ENDPOINT_SELECTION 0x72
+
+/**
+ * Connection pool limits for one HTTP service
+ * @see LCB_CNTL_HTTP_POOL_OPTIONS
+ */
+typedef struct {
+    /**
+     * The service (an lcb_HTTP_TYPE): one of `LCB_HTTP_TYPE_QUERY`,
+     * `LCB_HTTP_TYPE_SEARCH`, `LCB_HTTP_TYPE_ANALYTICS` or `LCB_HTTP_TYPE_VIEW`
+     */
+    int type;
+    /**
+     * Number of connections to open to each node as soon as the cluster
+     * configuration is received, and to keep open while idle
+     */
+    lcb_U32 min_idle;
+    /**
+     * Maximum number of connections to each node. Once reached, requests wait
+     * for a connection to become available. 0 means no limit
+     */
+    lcb_U32 max_per_host;
+} lcb_HTTP_POOL_OPTIONS;
+
+/**
+ * @brief Connection pool limits for a single HTTP service
+ *
+ * The `type` field of the argument selects the service, the other fields are
+ * read or written. Connections are only kept open if pooling is enabled
+ * (see @ref LCB_CNTL_HTTP_POOLSIZE).
+ *
+ * @cntl_arg_both{lcb_HTTP_POOL_OPTIONS*}
+ * @volatile
+ */
+#define LCB_CNTL_HTTP_POOL_OPTIONS 0x73
+
+/**
+ * @brief Statistics of the HTTP connection pool
+ *
+ * @see LCB_CNTL_HTTP_POOL_STATS
+ * @volatile
+ */
+typedef struct {
+    /** Number of connections requested (one for each HTTP request attempt) */
+    lcb_U64 requests;
+    /** Requests which were given an idle pooled connection */
+    lcb_U64 reused;
+    /** Connections opened, including those opened in advance */
+    lcb_U64 created;
+    /** Requests for which no connection could be established */
+    lcb_U64 failed;
+    /** Total time requests waited for a connection, in microseconds */
+    lcb_U64 wait_total_us;
+    /** Longest time a request waited for a connection, in microseconds */
+    lcb_U64 wait_max_us;
+} lcb_HTTP_POOL_STATS;
+
+/**
+ * @brief Get the statistics of the HTTP connection pool
+ *
+ * @cntl_arg_getonly{lcb_HTTP_POOL_STATS*}
+ * @volatile
+ */
+#define LCB_CNTL_HTTP_POOL_STATS 0x74
+
+/**
+ * @brief Connections to open in advance for query, analytics, search and views
+ *
+ * Sets the `min_idle` field of @ref LCB_CNTL_HTTP_POOL_OPTIONS for all of
+ * these services. Getting returns the value for the query service.
+ *
+ * Use `http_pool_min_idle` in the connection string
+ *
+ * @cntl_arg_both{lcb_U32*}
+ * @volatile
+ */
+#define LCB_CNTL_HTTP_POOL_MIN_IDLE 0x75
+
+/**
+ * @brief Maximum connections to a node for query, analytics, search and views
+ *
+ * Sets the `max_per_host` field of @ref LCB_CNTL_HTTP_POOL_OPTIONS for all of
+ * these services. Getting returns the value for the query service.
+ *
+ * Use `http_pool_max_per_host` in the connection string
+ *
+ * @cntl_arg_both{lcb_U32*}
+ * @volatile
+ */
+#define LCB_CNTL_HTTP_POOL_MAX_PER_HOST 0x76
+
+/**
+ * @brief Time to wait for the active node before a hedged get reads a replica
+ *
+ * See lcb_cmdget_hedge(). If set to `0`, the delay follows the 95th
+ * percentile of the recent get response times.
+ *
+ * Use `kv_hedge_delay` in the connection string
+ *
+ * @cntl_arg_both{lcb_U32* (microseconds)}
+ * @default 0
+ * @volatile
+ */
+#define LCB_CNTL_KV_HEDGE_DELAY 0x77
+
+/**
+ * @brief Statistics of hedged gets
+ *
+ * @see LCB_CNTL_KV_HEDGE_STATS
+ * @volatile
+ */
+typedef struct {
+    /** Replica reads sent because the active node did not respond in time */
+    lcb_U64 issued;
+    /** Hedged gets for which the replica responded first */
+    lcb_U64 won;
+    /** Current hedge delay, in microseconds */
+    lcb_U32 delay_us;
+} lcb_KV_HEDGE_STATS;
+
+/**
+ * @brief Get the statistics of hedged gets
+ *
+ * @cntl_arg_getonly{lcb_KV_HEDGE_STATS*}
+ * @volatile
+ */
+#define LCB_CNTL_KV_HEDGE_STATS 0x78
+
+/**
+ * @brief Coalesce concurrent gets for the same key
+ *
+ * If enabled, a get for a document which is already being fetched is not
+ * sent to the server. It is attached to the pending get instead, and its
+ * callback is invoked with the same response, right after the callback of
+ * the pending get. This reduces the number of requests for frequently read
+ * ("hot") keys.
+ *
+ * Only plain gets are coalesced: gets which lock the document, change its
+ * expiry or are hedged (see lcb_cmdget_hedge()) are always sent.
+ *
+ * Use `kv_coalesce_gets` in the connection string
+ *
+ * @cntl_arg_both{int* (as boolean)}
+ * @default false
+ * @volatile
+ */
+#define LCB_CNTL_KV_COALESCE_GETS 0x79
+
+/**
+ * @brief Statistics of coalesced gets
+ *
+ * The hit rate is `coalesced / (issued + coalesced)`.
+ *
+ * @see LCB_CNTL_KV_COALESCE_STATS
+ * @volatile
+ */
+typedef struct {
+    /** Gets sent to the server while coalescing was enabled */
+    lcb_U64 issued;
+    /** Gets which were attached to a pending get */
+    lcb_U64 coalesced;
+    /** Gets currently in flight which others may be attached to */
+    lcb_U32 inflight;
+} lcb_KV_COALESCE_STATS;
+
+/**
+ * @brief Get the statistics of coalesced gets
+ *
+ * @cntl_arg_getonly{lcb_KV_COALESCE_STATS*}
+ * @volatile
+ */
+#define LCB_CNTL_KV_COALESCE_STATS 0x7a
+
+/**
+ * @brief Write console log messages from a background thread
+ *
+ * Messages are formatted when they are logged, and queued for a background
+ * thread which writes them to the console logger's file (see
+ * @ref LCB_CNTL_CONLOGGER_FP). Logging then never waits for I/O. If the
+ * queue is full, messages are dropped, and the number of dropped messages
+ * is reported with the next message written. Queued messages are written
+ * when an instance is destroyed, and at exit.
+ *
+ * Like the other console logger settings, this applies to all instances.
+ * It can also be enabled by setting `LCB_LOGASYNC` in the environment.
+ *
+ * Use `console_log_async` in the connection string
+ *
+ * @cntl_arg_both{int* (as boolean)}
+ * @default false
+ * @volatile
+ */
+#define LCB_CNTL_CONLOGGER_ASYNC 0x7b
+
+/**
+ * @brief Responses received for a memcached opcode
+ *
+ * Set #opcode before calling lcb_cntl(). Responses are counted for every
+ * opcode; their latencies are only recorded while timings are enabled
+ * (see lcb_enable_timings()).
+ *
+ * @see LCB_CNTL_KV_OPCODE_STATS
+ * @volatile
+ */
+typedef struct {
+    /** The opcode (input) */
+    lcb_U8 opcode;
+    /** Responses received, including requests which failed without a response */
+    lcb_U64 responses;
+    /**
+     * Latencies of the responses, or NULL if none were recorded. This is owned
+     * by the instance, and only valid until timings are disabled. Use with
+     * lcb_histogram_read() (see <libcouchbase/utils.h>)
+     */
+    const struct lcb_histogram_st *timings;
+} lcb_KV_OPCODE_STATS;
+
+/**
+ * @brief Get the number and latencies of the responses for an opcode
+ *
+ * @cntl_arg_getonly{lcb_KV_OPCODE_STATS*}
+ * @volatile
+ */
+#define LCB_CNTL_KV_OPCODE_STATS 0x7c
+
+/**
+ * @brief Maximum size of the read buffer cache
+ *
+ * Read buffers which are no longer needed are kept for reuse by any of the
+ * instance's connections, up to this number of bytes. Buffers are sized to
+ * the responses each server sends, so small-value workloads keep small
+ * buffers.
+ *
+ * Use `read_buffer_cache_size` in the connection string
+ *
+ * @cntl_arg_both{lcb_U32*}
+ * @default 4194304 (4MB)
+ * @volatile
+ */
+#define LCB_CNTL_READ_BUFFER_CACHE_SIZE 0x7d
+
+/**
+ * @brief CPU time spent establishing KV sessions
+ *
+ * Covers the TLS handshake, SASL authentication and feature negotiation of
+ * every new KV connection. Only the CPU time of the thread running the event
+ * loop is counted, not the time spent waiting for the server. Sessions are
+ * only recorded while timings are enabled (see lcb_enable_timings()).
+ *
+ * The histogram is owned by the instance, and only valid until timings are
+ * disabled. Use with lcb_histogram_read() (see <libcouchbase/utils.h>)
+ *
+ * @cntl_arg_getonly{const lcb_HISTOGRAM**}
+ * @volatile
+ */
+#define LCB_CNTL_SESSION_TIMINGS 0x7e
+
 /**
  * This is not a command, but rather an indicator of the last item.
  * @internal
  */
-#define LCB_CNTL__MAX 0x68
+#define LCB_CNTL__MAX 0x7f
 /**@}*/
 
 #ifdef __cplusplus
@@ -417,6 +417,38 @@ typedef struct {
 
 LIBCOUCHBASE_API int lcb_mutation_token_is_valid(const lcb_MUTATION_TOKEN *token);
 
+/**
+ * @ingroup lcb-mutation-tokens
+ * @uncommitted
+ *
+ * The latest known mutation of each vBucket, for one or more buckets. Pass it
+ * to lcb_cmdquery_mutation_state() to make a query reflect these mutations.
+ *
+ * Only the highest sequence number is kept for each vBucket, so tokens may be
+ * added as often as mutations complete, and states may be merged (e.g. those
+ * of several instances).
+ */
+typedef struct lcb_MUTATION_STATE_ lcb_MUTATION_STATE;
+
+LIBCOUCHBASE_API lcb_STATUS lcb_mutation_state_create(lcb_MUTATION_STATE **state);
+LIBCOUCHBASE_API lcb_STATUS lcb_mutation_state_destroy(lcb_MUTATION_STATE *state);
+/**
+ * Add the token of a mutation
+ * @param state the state
+ * @param bucket the name of the bucket (or keyspace) of the mutation
+ * @param bucket_len length of the name
+ * @param token the mutation token
+ */
+LIBCOUCHBASE_API lcb_STATUS lcb_mutation_state_add(lcb_MUTATION_STATE *state, const char *bucket, size_t bucket_len,
+                                                   const lcb_MUTATION_TOKEN *token);
+/**
+ * Add the latest mutation token of each vBucket received by the instance
+ * @return LCB_ERR_DOCUMENT_NOT_FOUND if the instance has not received any
+ */
+LIBCOUCHBASE_API lcb_STATUS lcb_mutation_state_add_instance(lcb_MUTATION_STATE *state, lcb_INSTANCE *instance);
+/** Add all the mutations of @p other to @p state */
+LIBCOUCHBASE_API lcb_STATUS lcb_mutation_state_merge(lcb_MUTATION_STATE *state, const lcb_MUTATION_STATE *other);
+
 /**
  * @brief Response flags.
  * These provide additional 'meta' information about the response
@@ -449,7 +481,11 @@ typedef enum {
     LCB_RESP_F_SDSINGLE = 0x10,
 
     /**The response has extra error information as value (see SDK-RFC-28). */
-    LCB_RESP_F_ERRINFO = 0x20
+    LCB_RESP_F_ERRINFO = 0x20,
+
+    /**The response to a hedged get was received from a replica, rather than
+     * from the active node (see lcb_cmdget_hedge()) */
+    LCB_RESP_F_REPLICA = 0x40
 } lcb_RESPFLAGS;
 
 /**
@@ -694,6 +730,14 @@ LIBCOUCHBASE_API lcb_STATUS lcb_respget_flags(const lcb_RESPGET *resp, uint32_t
 LIBCOUCHBASE_API lcb_STATUS lcb_respget_key(const lcb_RESPGET *resp, const char **key, size_t *key_len);
 LIBCOUCHBASE_API lcb_STATUS lcb_respget_value(const lcb_RESPGET *resp, const char **value, size_t *value_len);
 
+/**
+ * @volatile
+ *
+ * @return non-zero if the response to a hedged get was received from a
+ * replica (and so may not reflect the latest mutation of the document)
+ */
+LIBCOUCHBASE_API int lcb_respget_is_replica(const lcb_RESPGET *resp);
+
 typedef struct lcb_CMDGET_ lcb_CMDGET;
 
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdget_create(lcb_CMDGET **cmd);
@@ -706,6 +750,25 @@ LIBCOUCHBASE_API lcb_STATUS lcb_cmdget_expiry(lcb_CMDGET *cmd, uint32_t expirati
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdget_locktime(lcb_CMDGET *cmd, uint32_t duration);
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdget_timeout(lcb_CMDGET *cmd, uint32_t timeout);
 
+/**
+ * @volatile
+ *
+ * @brief Race a replica read if the active node is slow to respond
+ *
+ * If no response is received from the active node within the hedge delay
+ * (see @ref LCB_CNTL_KV_HEDGE_DELAY), the document is also requested from a
+ * replica. The first successful response is passed to the callback, and
+ * lcb_respget_is_replica() tells where it came from. The other response is
+ * ignored. If the bucket has no replicas, this is a plain get.
+ *
+ * Hedging cannot be combined with lcb_cmdget_expiry() or
+ * lcb_cmdget_locktime().
+ *
+ * @param cmd the command
+ * @param enable non-zero to hedge the get
+ */
+LIBCOUCHBASE_API lcb_STATUS lcb_cmdget_hedge(lcb_CMDGET *cmd, int enable);
+
 LIBCOUCHBASE_API lcb_STATUS lcb_get(lcb_INSTANCE *instance, void *cookie, const lcb_CMDGET *cmd);
 /**@}*/
 
@@ -1315,6 +1378,85 @@ LIBCOUCHBASE_API lcb_STATUS lcb_cmdtouch_timeout(lcb_CMDTOUCH *cmd, uint32_t tim
 LIBCOUCHBASE_API lcb_STATUS lcb_touch(lcb_INSTANCE *instance, void *cookie, const lcb_CMDTOUCH *cmd);
 
 /**@} (Group: Touch) */
+
+/**
+ * @ingroup lcb-kv-api
+ * @defgroup lcb-bulk Bulk Operations
+ * @brief Schedule the same operation for many keys in one call
+ *
+ * @details
+ * A bulk operation takes a command which serves as a template (collection,
+ * timeout, expiry, and so on, but not the key or value), and arrays of keys
+ * and values. It is equivalent to scheduling the command once for each key,
+ * but validates the command and resolves its collection once, maps all the
+ * keys in one pass, and builds the packets of each server together.
+ *
+ * The response for each key is passed to the usual callback for the
+ * operation (e.g. @ref LCB_CALLBACK_GET), with the cookie of the bulk
+ * operation. Once all keys have completed, the optional @ref
+ * lcb_BULK_CALLBACK is invoked with the status of each key.
+ *
+ * Either all keys are scheduled, or (if an error is returned) none are.
+ *
+ * @addtogroup lcb-bulk
+ * @{
+ */
+
+/**
+ * @volatile
+ *
+ * @brief Callback invoked once all the keys of a bulk operation completed
+ * @param instance the instance
+ * @param cookie the cookie of the bulk operation
+ * @param statuses the status of each key, in the order they were passed
+ * @param nitems number of keys
+ */
+typedef void (*lcb_BULK_CALLBACK)(lcb_INSTANCE *instance, void *cookie, const lcb_STATUS *statuses, size_t nitems);
+
+/**
+ * @volatile
+ *
+ * @brief Get several documents
+ *
+ * The key of the command is ignored. Hedged gets are not supported, and gets
+ * are not coalesced (see @ref LCB_CNTL_KV_COALESCE_GETS).
+ *
+ * @param instance the instance
+ * @param cookie passed to the callbacks
+ * @param cmd the template command
+ * @param keys the keys
+ * @param keys_len the length of each key
+ * @param nitems number of keys
+ * @param callback invoked once all the keys completed. May be NULL
+ */
+LIBCOUCHBASE_API lcb_STATUS lcb_get_multi(lcb_INSTANCE *instance, void *cookie, const lcb_CMDGET *cmd,
+                                          const char *const *keys, const size_t *keys_len, size_t nitems,
+                                          lcb_BULK_CALLBACK callback);
+
+/**
+ * @volatile
+ *
+ * @brief Store several documents
+ *
+ * The key and value of the command are ignored. Durability polling (see
+ * lcb_cmdstore_durability_observe()) is not supported.
+ *
+ * @param instance the instance
+ * @param cookie passed to the callbacks
+ * @param cmd the template command
+ * @param keys the keys
+ * @param keys_len the length of each key
+ * @param values the values
+ * @param values_len the length of each value
+ * @param nitems number of keys
+ * @param callback invoked once all the keys completed. May be NULL
+ */
+LIBCOUCHBASE_API lcb_STATUS lcb_store_multi(lcb_INSTANCE *instance, void *cookie, const lcb_CMDSTORE *cmd,
+                                            const char *const *keys, const size_t *keys_len,
+                                            const char *const *values, const size_t *values_len, size_t nitems,
+                                            lcb_BULK_CALLBACK callback);
+
+/**@} (Group: Bulk) */
 /**@} (Group: KV API) */
 
 /**
@@ -1821,6 +1963,116 @@ LIBCOUCHBASE_API
 int lcb_is_waiting(lcb_INSTANCE *instance);
 /**@} (Group: Wait) */
 
+/**
+ * @ingroup lcb-public-api
+ * @defgroup lcb-completion-queue Completion Queue
+ * @brief Poll for completed operations instead of receiving callbacks
+ *
+ * @details
+ * Once the completion queue is enabled, the responses of key/value
+ * operations are not passed to the callbacks of their type. Instead, each
+ * response is appended to a ring of fixed-size @ref lcb_COMPLETION entries,
+ * which the application drains with lcb_completion_queue_poll(), e.g. after
+ * lcb_tick_nowait() or lcb_wait().
+ *
+ * The following types of responses are queued: @ref LCB_CALLBACK_GET,
+ * @ref LCB_CALLBACK_GETREPLICA, @ref LCB_CALLBACK_STORE,
+ * @ref LCB_CALLBACK_REMOVE, @ref LCB_CALLBACK_TOUCH, @ref LCB_CALLBACK_UNLOCK,
+ * @ref LCB_CALLBACK_COUNTER and @ref LCB_CALLBACK_EXISTS. Other responses
+ * (e.g. sub-document or HTTP) still go to their callbacks. So do stores which
+ * poll for durability (lcb_cmdstore_durability_observe()): they are passed to
+ * the store callback which was installed when the queue was enabled, as their
+ * durability result does not fit in an entry.
+ *
+ * @code{.c}
+ * lcb_completion_queue_enable(instance, 1024);
+ * // schedule operations
+ * lcb_wait(instance, LCB_WAIT_DEFAULT);
+ * lcb_COMPLETION entries[64];
+ * size_t n;
+ * while ((n = lcb_completion_queue_poll(instance, entries, 64))) {
+ *     for (size_t ii = 0; ii < n; ii++) {
+ *         resume(entries[ii].cookie, &entries[ii]);
+ *         lcb_completion_release(&entries[ii]);
+ *     }
+ * }
+ * @endcode
+ *
+ * @addtogroup lcb-completion-queue
+ * @{
+ */
+
+/**
+ * @volatile
+ * @brief A completed key/value operation
+ *
+ * The value of a get is not copied out of the buffer it was received in:
+ * the entry holds a reference to that buffer, which is owned by the
+ * application from the moment the entry is polled, and must be returned with
+ * lcb_completion_release().
+ */
+typedef struct {
+    lcb_CALLBACK_TYPE type; /**< Type of the operation */
+    lcb_STATUS rc;          /**< Status of the operation */
+    lcb_U16 rflags;         /**< Response flags, see ::lcb_RESPFLAGS */
+    void *cookie;           /**< Cookie of the operation */
+    uint64_t cas;           /**< CAS of the document, if any */
+    /** Value of a get, or NULL */
+    const void *value;
+    /** Length of the value */
+    size_t nvalue;
+    /** Flags of the document, for gets */
+    uint32_t flags;
+    /** Datatype of the value, see ::lcb_VALUEFLAGS */
+    uint8_t datatype;
+    /** Current value of a counter */
+    uint64_t counter;
+    /** @private Holds the memory of the value */
+    void *buffer;
+    /** @private Non-zero if #buffer was allocated for this entry */
+    int allocated;
+} lcb_COMPLETION;
+
+/**
+ * @volatile
+ * @brief Deliver the responses of key/value operations to the completion queue
+ *
+ * The queue takes the place of the callbacks of the queued response types
+ * (installing a callback for one of them afterwards delivers that type to the
+ * callback again).
+ *
+ * @param instance the instance
+ * @param capacity initial number of entries of the ring. The ring grows if it
+ *        is full, so that no completion is lost; the capacity only avoids
+ *        doing so. Pass 0 to disable the queue: the callbacks installed
+ *        before it was enabled are restored, later responses go to them,
+ *        and entries already queued may still be polled.
+ */
+LIBCOUCHBASE_API
+lcb_STATUS lcb_completion_queue_enable(lcb_INSTANCE *instance, size_t capacity);
+
+/**
+ * @volatile
+ * @brief Take the oldest completed operations out of the queue
+ * @param instance the instance
+ * @param[out] entries receives the entries, in the order the operations completed
+ * @param max maximum number of entries to take
+ * @return the number of entries taken
+ */
+LIBCOUCHBASE_API
+size_t lcb_completion_queue_poll(lcb_INSTANCE *instance, lcb_COMPLETION *entries, size_t max);
+
+/**
+ * @volatile
+ * @brief Release the memory held by an entry
+ *
+ * The value of the entry may not be accessed afterwards. This may be called
+ * after the instance was destroyed.
+ */
+LIBCOUCHBASE_API
+void lcb_completion_release(lcb_COMPLETION *entry);
+/**@} (Group: Completion Queue) */
+
 /**
  * @ingroup lcb-public-api
  * @defgroup lcb-sched Advanced Scheduling
@@ -2150,6 +2402,21 @@ lcb_STATUS lcb_cntl(lcb_INSTANCE *instance, int mode, int cmd, void *arg);
  * |@ref LCB_CNTL_TCP_KEEPALIVE              | `"tcp_keepalive"`         | Boolean           |
  * |@ref LCB_CNTL_CONFIG_POLL_INTERVAL       | `"config_poll_interval"`  | Timeval           |
  * |@ref LCB_CNTL_IP6POLICY                  | `"ipv6"`                  | String ("disabled", "only", "allow") |
+ * |@ref LCB_CNTL_BOOTSTRAP_RACE_WIDTH       | `"bootstrap_race_width"`  | Number (Positive) |
+ * |@ref LCB_CNTL_BOOTSTRAP_RACE_DELAY       | `"bootstrap_race_delay"`  | Timeval           |
+ * |@ref LCB_CNTL_KV_PREWARM                 | `"kv_prewarm"`            | Boolean           |
+ * |@ref LCB_CNTL_HTTP_COMPRESSION           | `"http_compression"`      | Boolean           |
+ * |@ref LCB_CNTL_HTTP_STREAM_HWM            | `"http_stream_hwm"`       | Number (Positive) |
+ * |@ref LCB_CNTL_QUERY_CACHE_MAX_ENTRIES    | `"query_cache_max_entries"` | Number (Positive) |
+ * |@ref LCB_CNTL_QUERY_CACHE_MAX_BYTES      | `"query_cache_max_bytes"` | Number (Positive) |
+ * |@ref LCB_CNTL_QUERY_CACHE_FILE           | `"query_cache"`           | Path              |
+ * |@ref LCB_CNTL_HTTP_ENDPOINT_SELECTION    | `"http_endpoint_selection"` | String ("random", "least_loaded") |
+ * |@ref LCB_CNTL_HTTP_POOL_MIN_IDLE         | `"http_pool_min_idle"`    | Number (Positive) |
+ * |@ref LCB_CNTL_HTTP_POOL_MAX_PER_HOST     | `"http_pool_max_per_host"` | Number (Positive) |
+ * |@ref LCB_CNTL_KV_HEDGE_DELAY             | `"kv_hedge_delay"`        | Timeval           |
+ * |@ref LCB_CNTL_KV_COALESCE_GETS           | `"kv_coalesce_gets"`      | Boolean           |
+ * |@ref LCB_CNTL_CONLOGGER_ASYNC            | `"console_log_async"`     | Boolean           |
+ * |@ref LCB_CNTL_READ_BUFFER_CACHE_SIZE     | `"read_buffer_cache_size"` | Number (Positive) |
  *
  * @committed - Note, the actual API call is considered committed and will
  * not disappear, however the existence of the various string settings are
@@ -2575,6 +2842,22 @@ LIBCOUCHBASE_API lcb_STATUS lcb_analytics(lcb_INSTANCE *instance, void *cookie,
  */
 LIBCOUCHBASE_API lcb_STATUS lcb_analytics_cancel(lcb_INSTANCE *instance, lcb_ANALYTICS_HANDLE *handle);
 
+/**
+ * Stop delivering rows for an analytics query. See lcb_query_pause()
+ * @param instance the instance
+ * @param handle the handle of the query
+ * @return LCB_SUCCESS, or LCB_ERR_INVALID_ARGUMENT if the handle is NULL
+ */
+LIBCOUCHBASE_API lcb_STATUS lcb_analytics_pause(lcb_INSTANCE *instance, lcb_ANALYTICS_HANDLE *handle);
+
+/**
+ * Resume delivering rows for an analytics query. See lcb_query_resume()
+ * @param instance the instance
+ * @param handle the handle of the query
+ * @return LCB_SUCCESS, or LCB_ERR_INVALID_ARGUMENT if the handle is NULL
+ */
+LIBCOUCHBASE_API lcb_STATUS lcb_analytics_resume(lcb_INSTANCE *instance, lcb_ANALYTICS_HANDLE *handle);
+
 /** @} */
 
 /**
@@ -2675,6 +2958,20 @@ LIBCOUCHBASE_API lcb_STATUS lcb_search(lcb_INSTANCE *instance, void *cookie, con
  * @return LCB_SUCCESS if successful, otherwise an error.
  */
 LIBCOUCHBASE_API lcb_STATUS lcb_search_cancel(lcb_INSTANCE *instance, lcb_SEARCH_HANDLE *handle);
+/**
+ * Stop delivering rows for a full-text query. See lcb_query_pause()
+ * @param instance the instance
+ * @param handle the handle to the search.  See @ref lcb_cmdsearch_handle.
+ * @return LCB_SUCCESS, or LCB_ERR_INVALID_ARGUMENT if the handle is NULL
+ */
+LIBCOUCHBASE_API lcb_STATUS lcb_search_pause(lcb_INSTANCE *instance, lcb_SEARCH_HANDLE *handle);
+/**
+ * Resume delivering rows for a full-text query. See lcb_query_resume()
+ * @param instance the instance
+ * @param handle the handle to the search.  See @ref lcb_cmdsearch_handle.
+ * @return LCB_SUCCESS, or LCB_ERR_INVALID_ARGUMENT if the handle is NULL
+ */
+LIBCOUCHBASE_API lcb_STATUS lcb_search_resume(lcb_INSTANCE *instance, lcb_SEARCH_HANDLE *handle);
 /** @} */
 
 /**
@@ -2989,6 +3286,16 @@ LIBCOUCHBASE_API lcb_STATUS lcb_cmdquery_consistency_token_for_keyspace(lcb_CMDQ
                                                                         size_t keyspace_len,
                                                                         const lcb_MUTATION_TOKEN *token);
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdquery_consistency_tokens(lcb_CMDQUERY *cmd, lcb_INSTANCE *instance);
+/**
+ * @uncommitted
+ *
+ * Indicate that the query should reflect all the mutations of @p state. They
+ * are added to the consistency tokens already set on the command.
+ *
+ * @param cmd the command
+ * @param state the mutation state
+ */
+LIBCOUCHBASE_API lcb_STATUS lcb_cmdquery_mutation_state(lcb_CMDQUERY *cmd, const lcb_MUTATION_STATE *state);
 /**
  * Set a query option
  * @param cmd the command
@@ -3042,6 +3349,36 @@ LIBCOUCHBASE_API lcb_STATUS lcb_query(lcb_INSTANCE *instance, void *cookie, cons
  * @endcode
  */
 LIBCOUCHBASE_API lcb_STATUS lcb_query_cancel(lcb_INSTANCE *instance, lcb_QUERY_HANDLE *handle);
+
+/**
+ * @brief Stop delivering rows for a query
+ *
+ * Once paused, the library stops reading the response from the network (see
+ * @ref LCB_CNTL_HTTP_STREAM_HWM), and rows are not passed to the callback until
+ * lcb_query_resume() is called. This allows a slow consumer to apply back
+ * pressure instead of buffering the whole result set in memory. Rows which are
+ * contained in the network buffer being processed at the time of the call may
+ * still be delivered.
+ *
+ * Note that the query timeout still applies while the handle is paused.
+ *
+ * @param instance the instance
+ * @param handle the handle of the query
+ * @return LCB_SUCCESS, or LCB_ERR_INVALID_ARGUMENT if the handle is NULL
+ */
+LIBCOUCHBASE_API lcb_STATUS lcb_query_pause(lcb_INSTANCE *instance, lcb_QUERY_HANDLE *handle);
+
+/**
+ * @brief Resume delivering rows for a query paused with lcb_query_pause()
+ *
+ * Rows received while the query was paused are delivered asynchronously,
+ * from the event loop.
+ *
+ * @param instance the instance
+ * @param handle the handle of the query
+ * @return LCB_SUCCESS, or LCB_ERR_INVALID_ARGUMENT if the handle is NULL
+ */
+LIBCOUCHBASE_API lcb_STATUS lcb_query_resume(lcb_INSTANCE *instance, lcb_QUERY_HANDLE *handle);
 /** @} */
 
 /**
@@ -3102,6 +3439,10 @@ LIBCOUCHBASE_API lcb_STATUS lcb_cmdview_handle(lcb_CMDVIEW *cmd, lcb_VIEW_HANDLE
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdview_timeout(lcb_CMDVIEW *cmd, uint32_t timeout);
 LIBCOUCHBASE_API lcb_STATUS lcb_view(lcb_INSTANCE *instance, void *cookie, const lcb_CMDVIEW *cmd);
 LIBCOUCHBASE_API lcb_STATUS lcb_view_cancel(lcb_INSTANCE *instance, lcb_VIEW_HANDLE *handle);
+/** Stop delivering rows for a view query. See lcb_query_pause() */
+LIBCOUCHBASE_API lcb_STATUS lcb_view_pause(lcb_INSTANCE *instance, lcb_VIEW_HANDLE *handle);
+/** Resume delivering rows for a view query. See lcb_query_resume() */
+LIBCOUCHBASE_API lcb_STATUS lcb_view_resume(lcb_INSTANCE *instance, lcb_VIEW_HANDLE *handle);
 /** @} */
 
 /* @ingroup lcb-public-api
@@ -62,6 +62,18 @@ typedef struct lcb_SERVERMETRICS_st {
 
     /** Number of NOT_MY_VBUCKET replies received */
     lcb_SIZE packets_nmv;
+
+    /**
+     * Number of reads which received data on this server. Divide by
+     * packets_read for the number of reads per response
+     */
+    lcb_SIZE reads;
+
+    /**
+     * Number of bytes copied after they were read, to make responses which
+     * spanned several read buffers contiguous
+     */
+    lcb_SIZE bytes_consolidated;
 } lcb_SERVERMETRICS;
 
 typedef struct lcb_METRICS_st {
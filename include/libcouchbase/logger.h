@@ -140,6 +140,19 @@ LIBCOUCHBASE_API lcb_STATUS lcb_logger_destroy(lcb_LOGGER *logger);
  */
 LIBCOUCHBASE_API lcb_STATUS lcb_logger_callback(lcb_LOGGER *logger, lcb_LOGGER_CALLBACK callback);
 
+/**
+ * Set the minimum severity of the messages passed to the callback.
+ *
+ * Messages with a lower severity are discarded by the library before they
+ * are formatted, which is much cheaper than discarding them in the callback.
+ * The default is #LCB_LOG_TRACE (all messages are passed).
+ *
+ * @param logger
+ * @param severity
+ * @return LCB_SUCCESS if no error occurred
+ */
+LIBCOUCHBASE_API lcb_STATUS lcb_logger_minlevel(lcb_LOGGER *logger, lcb_LOG_SEVERITY severity);
+
 /**
  * Retrieve opaque pointer specified during creation.
  *
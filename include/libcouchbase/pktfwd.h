@@ -37,6 +37,12 @@ typedef struct rdb_ROPESEG *lcb_BACKBUF;
  * This structure is passed to the lcb_pktfwd3() function.
  */
 typedef struct {
+    /**
+     * Set to `1` if the application can handle a response spread over several
+     * buffers (see lcb_PKTFWDRESP::nitems). This avoids copying responses
+     * which were received in more than one read. With `0`, the response is
+     * always delivered in a single buffer.
+     */
     int version;
     /**This structure should be initialized to a packet. The packet may be
      * in the form of a contiguous buffer to be copied (lcb_VALBUF::vtype should
@@ -105,8 +111,13 @@ typedef struct {
      * lifespan of their associated elements in the #iovs field. */
     lcb_BACKBUF *bufs;
 
-    /** The number of items in the #iovs and #bufs array. Currently this is
-     * always `1` but may change in the future.*/
+    /** The number of items in the #iovs and #bufs array. This is always `1`
+     * unless the packet was forwarded with lcb_CMDPKTFWD::version set to `1`,
+     * in which case the response may be split over several buffers, in order.
+     *
+     * An application (e.g. a proxy) may hold a reference to each buffer with
+     * lcb_backbuf_ref() and pass the #iovs directly to `writev()`, without
+     * copying the response.*/
     unsigned nitems;
 } lcb_PKTFWDRESP;
 
@@ -117,6 +117,14 @@ typedef struct {
     int servers[4];
 } lcbvb_VBUCKET;
 
+/**
+ * @volatile
+ * Number of `int16_t` slots occupied by each vBucket in lcbvb_CONFIG::vbroutes.
+ * The first slot is the master index, followed by the replica indexes. Unused
+ * slots contain -1.
+ */
+#define LCBVB_ROUTE_STRIDE 4
+
 /**@volatile*/
 typedef struct {
     lcb_U32 index;
@@ -171,6 +179,8 @@ typedef struct lcbvb_CONFIG_st {
     int *randbuf;               /* Used for random server selection */
     uint64_t caps;              /**< Bucket capabilities */
     uint64_t ccaps;             /**< Cluster capabilities */
+    int16_t *vbroutes;          /**< Flattened copy of vbuckets (nvb * LCBVB_ROUTE_STRIDE), cache line aligned */
+    void *vbroutes_alloc_;      /* allocated block backing vbroutes */
 } lcbvb_CONFIG;
 
 #define LCBVB_BUCKET_NAME(cfg) (cfg)->bname
@@ -241,6 +251,43 @@ int lcbvb_load_json_ex(lcbvb_CONFIG *vbc, const char *data, const char *source,
 LIBCOUCHBASE_API
 char *lcbvb_save_json(lcbvb_CONFIG *vbc);
 
+/**
+ * @volatile
+ * @brief Serialize the current config as a binary snapshot.
+ *
+ * The snapshot is a versioned, position-independent block which contains the
+ * server list, services, vBucket maps and ketama continuum. It can be loaded
+ * back (or mapped from a file) with lcbvb_load_binary() without any parsing.
+ * The snapshot is only valid on hosts with the same byte order.
+ *
+ * @param vbc the configuration
+ * @param[out] out the snapshot buffer, which should be freed using free()
+ * @param[out] nout the size of the snapshot
+ * @return 0 on success, -1 on allocation failure
+ */
+LIBCOUCHBASE_API
+int lcbvb_save_binary(lcbvb_CONFIG *vbc, char **out, size_t *nout);
+
+/**
+ * @volatile
+ * @brief Load a snapshot created by lcbvb_save_binary()
+ * @param vbc a new configuration object returned by lcbvb_create()
+ * @param data the snapshot data
+ * @param ndata the size of the snapshot
+ * @return 0 on success, nonzero if the snapshot is invalid or was created by
+ *  an incompatible version. In this case the error string is set.
+ */
+LIBCOUCHBASE_API
+int lcbvb_load_binary(lcbvb_CONFIG *vbc, const void *data, size_t ndata);
+
+/**
+ * @volatile
+ * @brief Check whether the buffer begins with a binary snapshot header
+ * @return nonzero if the data looks like a binary snapshot
+ */
+LIBCOUCHBASE_API
+int lcbvb_is_binary(const void *data, size_t ndata);
+
 /**
  * @committed
  * @brief Return a string indicating why parsing the configuration failed
@@ -307,6 +354,22 @@ int lcbvb_vbreplica(lcbvb_CONFIG *cfg, int vbid, unsigned ix);
  */
 #define lcbvb_vbserver(cfg, vbid, ix) ((ix == 0) ? lcbvb_vbmaster(cfg, vbid) : lcbvb_vbreplica(cfg, vbid, ix - 1))
 
+/**
+ * @volatile
+ *
+ * Rebuild the flattened routing table (lcbvb_CONFIG::vbroutes) from the
+ * lcbvb_CONFIG::vbuckets map. The table is built automatically when a config
+ * is loaded or generated, and is kept in sync by lcbvb_nmv_remap_ex(). The
+ * `vbuckets` array remains authoritative (lcbvb_vbmaster() and lcbvb_vbreplica()
+ * read from it), so this only needs to be called for the copy in `vbroutes` to
+ * reflect direct modifications of that array.
+ *
+ * @param cfg the configuration
+ * @return 0 on success, -1 if the table could not be allocated
+ */
+LIBCOUCHBASE_API
+int lcbvb_update_routes(lcbvb_CONFIG *cfg);
+
 /**
  * uncommitted
  * Equivalent to
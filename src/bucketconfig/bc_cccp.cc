@@ -30,13 +30,16 @@
 #include <lcbio/ssl.h>
 #include "ctx-log-inl.h"
 
+#include <algorithm>
 #include <cstring>
+#include <vector>
 
 #define LOGFMT CTX_LOGFMT
 #define LOGID(p) CTX_LOGID(p->ioctx)
 #define LOGARGS(cccp, lvl) cccp->parent->settings, "cccp", LCB_LOG_##lvl, __FILE__, __LINE__
 
 struct CccpCookie;
+struct CccpRacer;
 
 using namespace lcb::clconfig;
 
@@ -52,6 +55,22 @@ struct CccpProvider : public Provider {
      */
     void stop_current_request(bool is_clean);
     lcb_STATUS schedule_next_request(lcb_STATUS err, bool can_rollover);
+
+    /**
+     * Whether the bootstrap should race connections to several nodes at
+     * once. This only applies while no configuration has been received yet,
+     * since afterwards the request is issued over existing data connections.
+     */
+    bool should_race() const
+    {
+        return settings().bootstrap_race_width > 1 && instance && !LCBT_VBCONFIG(instance);
+    }
+    lcb_STATUS start_race(lcb_STATUS err, bool can_rollover);
+    bool add_racer(bool can_rollover);
+    void on_race_stagger();
+    void stop_race();
+    void race_failed(CccpRacer *racer, lcb_STATUS err);
+    void race_succeeded(CccpRacer *racer, const std::string &host, const std::string &json);
     lcb_STATUS mcio_error(lcb_STATUS err);
     void on_timeout()
     {
@@ -86,7 +105,7 @@ struct CccpProvider : public Provider {
     // Whether there is a pending CCCP config request.
     bool has_pending_request() const
     {
-        return creq != nullptr || cmdcookie != nullptr || ioctx != nullptr;
+        return creq != nullptr || cmdcookie != nullptr || ioctx != nullptr || !racers.empty();
     }
 
     lcb::Hostlist *nodes;
@@ -96,6 +115,41 @@ struct CccpProvider : public Provider {
     lcb::io::ConnectionRequest *creq{};
     lcbio_CTX *ioctx;
     CccpCookie *cmdcookie;
+
+    /** Concurrent bootstrap attempts, see bootstrap_race_width */
+    std::vector<CccpRacer *> racers;
+    lcb::io::Timer<CccpProvider, &CccpProvider::on_race_stagger> race_timer;
+};
+
+/**
+ * A single connection attempt which is part of a bootstrap race. Each racer
+ * owns its own connection and performs the full negotiation and
+ * GET_CLUSTER_CONFIG sequence against one node.
+ */
+struct CccpRacer {
+    CccpRacer(CccpProvider *parent_, const lcb_host_t &host_)
+        : parent(parent_), host(host_), timer(parent_->parent->iot, this)
+    {
+    }
+
+    ~CccpRacer()
+    {
+        lcb::io::ConnectionRequest::cancel(&creq);
+        timer.release();
+    }
+
+    void start();
+    void close(bool is_clean);
+    void on_timeout()
+    {
+        parent->race_failed(this, LCB_ERR_TIMEOUT);
+    }
+
+    CccpProvider *parent;
+    lcb_host_t host;
+    lcb::io::ConnectionRequest *creq{};
+    lcbio_CTX *ioctx{};
+    lcb::io::Timer<CccpRacer, &CccpRacer::on_timeout> timer;
 };
 
 struct CccpCookie {
@@ -147,10 +201,16 @@ void CccpProvider::stop_current_request(bool is_clean)
         lcbio_ctx_close(ioctx, pooled_close_cb, &is_clean);
         ioctx = nullptr;
     }
+
+    stop_race();
 }
 
 lcb_STATUS CccpProvider::schedule_next_request(lcb_STATUS err, bool can_rollover)
 {
+    if (should_race()) {
+        return start_race(err, can_rollover);
+    }
+
     lcb_host_t *next_host = nodes->next(can_rollover);
     if (!next_host) {
         timer.cancel();
@@ -181,6 +241,104 @@ lcb_STATUS CccpProvider::schedule_next_request(lcb_STATUS err, bool can_rollover
     return LCB_SUCCESS;
 }
 
+lcb_STATUS CccpProvider::start_race(lcb_STATUS err, bool can_rollover)
+{
+    if (!add_racer(can_rollover)) {
+        timer.cancel();
+        parent->provider_failed(this, err);
+        return err;
+    }
+    race_timer.rearm(settings().bootstrap_race_delay);
+    return LCB_SUCCESS;
+}
+
+bool CccpProvider::add_racer(bool can_rollover)
+{
+    lcb_host_t *next_host = nodes->next(can_rollover);
+    if (!next_host) {
+        return false;
+    }
+    lcb_log(LOGARGS(this, INFO), "Racing connection to node " LCB_HOST_FMT " for CCCP configuration (%u/%u)",
+            LCB_HOST_ARG(this->parent->settings, next_host), (unsigned)racers.size() + 1,
+            (unsigned)settings().bootstrap_race_width);
+    auto *racer = new CccpRacer(this, *next_host);
+    racers.push_back(racer);
+    racer->start();
+    return true;
+}
+
+void CccpProvider::on_race_stagger()
+{
+    if (racers.size() < settings().bootstrap_race_width && add_racer(false)) {
+        race_timer.rearm(settings().bootstrap_race_delay);
+    }
+}
+
+void CccpProvider::stop_race()
+{
+    race_timer.cancel();
+    for (auto *racer : racers) {
+        racer->close(false);
+        delete racer;
+    }
+    racers.clear();
+}
+
+void CccpProvider::race_failed(CccpRacer *racer, lcb_STATUS err)
+{
+    lcb_log(LOGARGS(this, ERR), "Could not get configuration from " LCB_HOST_FMT ": %s",
+            LCB_HOST_ARG(this->parent->settings, &racer->host), lcb_strerror_short(err));
+
+    racers.erase(std::find(racers.begin(), racers.end(), racer));
+    racer->close(err == LCB_ERR_UNSUPPORTED_OPERATION);
+    delete racer;
+
+    if (err == LCB_ERR_PROTOCOL_ERROR && LCBT_SETTING(instance, conntype) == LCB_TYPE_CLUSTER) {
+        lcb_log(LOGARGS(this, WARN), "Failed to bootstrap using CCCP");
+        stop_race();
+        parent->provider_failed(this, err);
+        return;
+    }
+
+    /* Don't wait for the stagger delay; a failed attempt frees up a slot
+     * for the next node right away */
+    if (add_racer(false)) {
+        return;
+    }
+    if (racers.empty()) {
+        race_timer.cancel();
+        parent->provider_failed(this, err);
+    }
+}
+
+void CccpProvider::race_succeeded(CccpRacer *racer, const std::string &host, const std::string &json)
+{
+    racers.erase(std::find(racers.begin(), racers.end(), racer));
+    racer->close(true);
+    delete racer;
+
+    lcb_log(LOGARGS(this, DEBUG), "Adopting configuration from %s, cancelling %u other attempt(s)", host.c_str(),
+            (unsigned)racers.size());
+
+    // Remember the remaining attempts in case the configuration is unusable
+    std::vector<CccpRacer *> pending;
+    pending.swap(racers);
+    race_timer.cancel();
+
+    if (update(host.c_str(), json.c_str()) == LCB_SUCCESS) {
+        for (auto *other : pending) {
+            other->close(false);
+            delete other;
+        }
+        return;
+    }
+
+    racers.swap(pending);
+    if (!add_racer(false) && racers.empty()) {
+        parent->provider_failed(this, LCB_ERR_PROTOCOL_ERROR);
+    }
+}
+
 lcb_STATUS CccpProvider::mcio_error(lcb_STATUS err)
 {
     if (err != LCB_ERR_UNSUPPORTED_OPERATION) {
@@ -335,6 +493,7 @@ CccpProvider::~CccpProvider()
     }
     delete nodes;
     timer.release();
+    race_timer.release();
 }
 
 void CccpProvider::configure_nodes(const lcb::Hostlist &nodes_)
@@ -378,77 +537,158 @@ static void io_read_handler(lcbio_CTX *ioctx, unsigned)
     reinterpret_cast<CccpProvider *>(lcbio_ctx_data(ioctx))->on_io_read();
 }
 
-void CccpProvider::on_io_read()
+/**
+ * Read the GET_CLUSTER_CONFIG response from the connection.
+ * @return false if more data is required (the context has been rescheduled),
+ *  true otherwise, in which case @p err contains the result and @p json the
+ *  configuration body.
+ */
+static bool read_config_response(CccpProvider *cccp, lcbio_CTX *ctx, lcb_STATUS &err, std::string &json)
 {
     unsigned required;
-
-#define return_error(e)                                                                                                \
-    resp.release(ioctx);                                                                                               \
-    mcio_error(e);                                                                                                     \
-    return
-
     lcb::MemcachedResponse resp;
-    if (!resp.load(ioctx, &required)) {
-        lcbio_ctx_rwant(ioctx, required);
-        lcbio_ctx_schedule(ioctx);
-        return;
+    if (!resp.load(ctx, &required)) {
+        lcbio_ctx_rwant(ctx, required);
+        lcbio_ctx_schedule(ctx);
+        return false;
     }
 
+    err = LCB_SUCCESS;
     if (resp.status() != PROTOCOL_BINARY_RESPONSE_SUCCESS) {
         std::string value{};
         if (resp.vallen()) {
             value.assign(resp.value(), resp.vallen());
         }
-        lcb_log(LOGARGS(this, WARN), LOGFMT "CCCP Packet responded with 0x%02x; nkey=%d, cmd=0x%x, seq=0x%x, value=%s",
-                LOGID(this), resp.status(), resp.keylen(), resp.opcode(), resp.opaque(), value.c_str());
-
-        if (settings().bucket == nullptr) {
-            switch (resp.status()) {
-                case PROTOCOL_BINARY_RESPONSE_NO_BUCKET:
-                    return_error(LCB_ERR_UNSUPPORTED_OPERATION);
-            }
-        }
+        lcb_log(LOGARGS(cccp, WARN), LOGFMT "CCCP Packet responded with 0x%02x; nkey=%d, cmd=0x%x, seq=0x%x, value=%s",
+                CTX_LOGID(ctx), resp.status(), resp.keylen(), resp.opcode(), resp.opaque(), value.c_str());
 
         switch (resp.status()) {
+            case PROTOCOL_BINARY_RESPONSE_NO_BUCKET:
+                err = cccp->settings().bucket == nullptr ? LCB_ERR_UNSUPPORTED_OPERATION : LCB_ERR_PROTOCOL_ERROR;
+                break;
             case PROTOCOL_BINARY_RESPONSE_NOT_SUPPORTED:
             case PROTOCOL_BINARY_RESPONSE_UNKNOWN_COMMAND:
-                return_error(LCB_ERR_UNSUPPORTED_OPERATION);
+                err = LCB_ERR_UNSUPPORTED_OPERATION;
+                break;
             default:
-                return_error(LCB_ERR_PROTOCOL_ERROR);
+                err = LCB_ERR_PROTOCOL_ERROR;
+                break;
         }
+    } else if (!resp.bodylen()) {
+        err = LCB_ERR_PROTOCOL_ERROR;
+    } else {
+        json.assign(resp.value(), resp.vallen());
     }
+    resp.release(ctx);
+    return true;
+}
+
+static void send_config_request(lcbio_CTX *ctx)
+{
+    lcb::MemcachedRequest req(PROTOCOL_BINARY_CMD_GET_CLUSTER_CONFIG);
+    req.opaque(0xF00D);
+    lcbio_ctx_put(ctx, req.data(), req.size());
+    lcbio_ctx_rwant(ctx, 24);
+    lcbio_ctx_schedule(ctx);
+}
 
-    if (!resp.bodylen()) {
-        return_error(LCB_ERR_PROTOCOL_ERROR);
+void CccpProvider::on_io_read()
+{
+    lcb_STATUS err;
+    std::string jsonstr;
+    if (!read_config_response(this, ioctx, err, jsonstr)) {
+        return;
+    }
+    if (err != LCB_SUCCESS) {
+        mcio_error(err);
+        return;
     }
 
-    std::string jsonstr(resp.value(), resp.vallen());
     std::string hoststr(lcbio_get_host(lcbio_ctx_sock(ioctx))->host);
-
-    resp.release(ioctx);
     stop_current_request(true);
 
-    lcb_STATUS err = update(hoststr.c_str(), jsonstr.c_str());
+    err = update(hoststr.c_str(), jsonstr.c_str());
 
     if (err == LCB_SUCCESS) {
         timer.cancel();
     } else {
         schedule_next_request(LCB_ERR_PROTOCOL_ERROR, false);
     }
-
-#undef return_error
 }
 
 void CccpProvider::request_config()
 {
-    lcb::MemcachedRequest req(PROTOCOL_BINARY_CMD_GET_CLUSTER_CONFIG);
-    req.opaque(0xF00D);
-    lcbio_ctx_put(ioctx, req.data(), req.size());
-    lcbio_ctx_rwant(ioctx, 24);
-    lcbio_ctx_schedule(ioctx);
+    send_config_request(ioctx);
     timer.rearm(settings().config_node_timeout);
 }
 
+static void racer_error_handler(lcbio_CTX *ctx, lcb_STATUS err)
+{
+    auto *racer = reinterpret_cast<CccpRacer *>(lcbio_ctx_data(ctx));
+    racer->parent->race_failed(racer, err);
+}
+
+static void racer_read_handler(lcbio_CTX *ctx, unsigned)
+{
+    auto *racer = reinterpret_cast<CccpRacer *>(lcbio_ctx_data(ctx));
+    lcb_STATUS err;
+    std::string jsonstr;
+    if (!read_config_response(racer->parent, ctx, err, jsonstr)) {
+        return;
+    }
+    if (err != LCB_SUCCESS) {
+        racer->parent->race_failed(racer, err);
+        return;
+    }
+    std::string hoststr(lcbio_get_host(lcbio_ctx_sock(ctx))->host);
+    racer->parent->race_succeeded(racer, hoststr, jsonstr);
+}
+
+static void racer_connected(lcbio_SOCKET *sock, void *data, lcb_STATUS err, lcbio_OSERR)
+{
+    auto *racer = reinterpret_cast<CccpRacer *>(data);
+    lcb_settings *settings = racer->parent->parent->settings;
+    racer->creq = nullptr;
+
+    if (err != LCB_SUCCESS) {
+        if (sock) {
+            lcb::io::Pool::discard(sock);
+        }
+        racer->parent->race_failed(racer, err);
+        return;
+    }
+
+    if (lcbio_protoctx_get(sock, LCBIO_PROTOCTX_SESSINFO) == nullptr) {
+        racer->creq = lcb::SessionRequest::start(sock, settings, settings->config_node_timeout, racer_connected, racer);
+        return;
+    }
+
+    lcbio_CTXPROCS ioprocs{};
+    ioprocs.cb_err = racer_error_handler;
+    ioprocs.cb_read = racer_read_handler;
+    racer->ioctx = lcbio_ctx_new(sock, racer, &ioprocs);
+    racer->ioctx->subsys = "bc_cccp";
+    sock->service = LCBIO_SERVICE_CFG;
+    send_config_request(racer->ioctx);
+}
+
+void CccpRacer::start()
+{
+    lcb_U32 tmo = parent->settings().config_node_timeout;
+    timer.rearm(tmo);
+    creq = parent->instance->memd_sockpool->get(host, tmo, racer_connected, this);
+}
+
+void CccpRacer::close(bool is_clean)
+{
+    timer.cancel();
+    lcb::io::ConnectionRequest::cancel(&creq);
+    if (ioctx) {
+        lcbio_ctx_close(ioctx, pooled_close_cb, &is_clean);
+        ioctx = nullptr;
+    }
+}
+
 void CccpProvider::dump(FILE *fp) const
 {
     if (!enabled) {
@@ -463,6 +703,8 @@ void CccpProvider::dump(FILE *fp) const
         lcbio_ctx_dump(ioctx, fp);
     } else if (creq) {
         fprintf(fp, "CCCP Is connecting\n");
+    } else if (!racers.empty()) {
+        fprintf(fp, "CCCP Is racing %u connections\n", (unsigned)racers.size());
     } else {
         fprintf(fp, "CCCP does not have a dedicated connection\n");
     }
@@ -477,7 +719,7 @@ void CccpProvider::dump(FILE *fp) const
 
 CccpProvider::CccpProvider(Confmon *mon)
     : Provider(mon, CLCONFIG_CCCP), nodes(new lcb::Hostlist()), config(nullptr), timer(mon->iot, this),
-      instance(nullptr), ioctx(nullptr), cmdcookie(nullptr)
+      instance(nullptr), ioctx(nullptr), cmdcookie(nullptr), race_timer(mon->iot, this)
 {
 }
 
@@ -22,6 +22,11 @@
 #include <fstream>
 #include <istream>
 #include <cstring>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #define CONFIG_CACHE_MAGIC "{{{fb85b563d0a8f65fa8d3d58f1b3a0708}}}"
 
@@ -60,24 +65,76 @@ struct FileProvider : Provider, Listener {
     lcb::io::Timer<FileProvider, &FileProvider::reload_cache> timer;
 };
 
-FileProvider::Status FileProvider::load_cache()
+namespace
 {
-    if (filename.empty()) {
-        return CACHE_ERROR;
+/**
+ * Read-only view of the cache file contents. Where possible the file is
+ * mapped into memory, so that binary snapshots are loaded without copying.
+ */
+class CacheFileData
+{
+  public:
+    CacheFileData() = default;
+    CacheFileData(const CacheFileData &) = delete;
+    CacheFileData &operator=(const CacheFileData &) = delete;
+
+    ~CacheFileData()
+    {
+#ifndef _WIN32
+        if (mapped_ != nullptr) {
+            munmap(mapped_, size_);
+        }
+#endif
     }
 
-    std::ifstream ifs(filename.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+    bool load(const std::string &filename, size_t fsize)
+    {
+        size_ = fsize;
+#ifndef _WIN32
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd != -1) {
+            void *addr = mmap(nullptr, fsize, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (addr != MAP_FAILED) {
+                mapped_ = addr;
+                return true;
+            }
+        }
+#endif
+        std::ifstream ifs(filename.c_str(), std::ios::in | std::ios::binary);
+        buf_.resize(fsize);
+        ifs.read(&buf_[0], fsize);
+        return ifs.good();
+    }
 
-    if (!ifs.is_open() || !ifs.good()) {
-        int save_errno = last_errno = errno;
-        lcb_log(LOGARGS(this, ERROR), LOGFMT "Couldn't open for reading: %s", LOGID(this), strerror(save_errno));
+    const char *data() const
+    {
+        return mapped_ ? static_cast<const char *>(mapped_) : &buf_[0];
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+  private:
+    void *mapped_{nullptr};
+    size_t size_{0};
+    std::vector<char> buf_{};
+};
+} // namespace
+
+FileProvider::Status FileProvider::load_cache()
+{
+    if (filename.empty()) {
         return CACHE_ERROR;
     }
 
     struct stat st {
     };
     if (stat(filename.c_str(), &st)) {
-        last_errno = errno;
+        int save_errno = last_errno = errno;
+        lcb_log(LOGARGS(this, ERROR), LOGFMT "Couldn't open for reading: %s", LOGID(this), strerror(save_errno));
         return CACHE_ERROR;
     }
 
@@ -86,23 +143,18 @@ FileProvider::Status FileProvider::load_cache()
         return NO_CHANGES;
     }
 
-    size_t fsize = ifs.tellg();
+    auto fsize = static_cast<size_t>(st.st_size);
     if (!fsize) {
         lcb_log(LOGARGS(this, WARN), LOGFMT "File '%s' is empty", LOGID(this), filename.c_str());
         return CACHE_ERROR;
     }
-    ifs.seekg(0, std::ios::beg);
-    std::vector<char> buf(fsize);
-    ifs.read(&buf[0], fsize);
-    buf.push_back(0); // NUL termination
 
-    char *end = std::strstr(&buf[0], CONFIG_CACHE_MAGIC);
-    if (end == nullptr) {
-        lcb_log(LOGARGS(this, ERROR), LOGFMT "Couldn't find magic", LOGID(this));
-        maybe_remove_file();
+    CacheFileData contents;
+    if (!contents.load(filename, fsize)) {
+        int save_errno = last_errno = errno;
+        lcb_log(LOGARGS(this, ERROR), LOGFMT "Couldn't read file: %s", LOGID(this), strerror(save_errno));
         return CACHE_ERROR;
     }
-    *end = '\0'; // Stop parsing at MAGIC
 
     lcbvb_CONFIG *vbc = lcbvb_create();
     if (vbc == nullptr) {
@@ -111,11 +163,30 @@ FileProvider::Status FileProvider::load_cache()
 
     Status status = CACHE_ERROR;
 
-    if (lcbvb_load_json(vbc, &buf[0]) != 0) {
-        lcb_log(LOGARGS(this, ERROR), LOGFMT "Couldn't parse configuration", LOGID(this));
-        lcb_log_badconfig(LOGARGS(this, ERROR), vbc, &buf[0]);
-        maybe_remove_file();
-        goto GT_DONE;
+    if (lcbvb_is_binary(contents.data(), contents.size())) {
+        if (lcbvb_load_binary(vbc, contents.data(), contents.size()) != 0) {
+            lcb_log(LOGARGS(this, ERROR), LOGFMT "Couldn't load binary snapshot: %s", LOGID(this),
+                    lcbvb_get_error(vbc));
+            maybe_remove_file();
+            goto GT_DONE;
+        }
+    } else {
+        /* Legacy format: JSON followed by the magic string */
+        std::string json(contents.data(), contents.size());
+        size_t end = json.find(CONFIG_CACHE_MAGIC);
+        if (end == std::string::npos) {
+            lcb_log(LOGARGS(this, ERROR), LOGFMT "Couldn't find magic", LOGID(this));
+            maybe_remove_file();
+            goto GT_DONE;
+        }
+        json.resize(end); // Stop parsing at MAGIC
+
+        if (lcbvb_load_json(vbc, json.c_str()) != 0) {
+            lcb_log(LOGARGS(this, ERROR), LOGFMT "Couldn't parse configuration", LOGID(this));
+            lcb_log_badconfig(LOGARGS(this, ERROR), vbc, json.c_str());
+            maybe_remove_file();
+            goto GT_DONE;
+        }
     }
 
     if (lcbvb_get_distmode(vbc) != LCBVB_DIST_VBUCKET) {
@@ -128,15 +199,24 @@ FileProvider::Status FileProvider::load_cache()
         goto GT_DONE;
     }
 
-    if (strcmp(vbc->bname, settings().bucket) != 0) {
+    if (vbc->bname == nullptr || strcmp(vbc->bname, settings().bucket) != 0) {
         lcb_log(LOGARGS(this, ERROR), LOGFMT "Bucket name in file is different from the one requested", LOGID(this));
         goto GT_DONE;
     }
 
+    if (config && lcbvb_get_revision(vbc) > -1 && lcbvb_get_revision(vbc) < lcbvb_get_revision(config->vbc)) {
+        lcb_log(LOGARGS(this, DEBUG), LOGFMT "Cached revision %d is older than current revision %d", LOGID(this),
+                lcbvb_get_revision(vbc), lcbvb_get_revision(config->vbc));
+        last_mtime = st.st_mtime;
+        status = NO_CHANGES;
+        goto GT_DONE;
+    }
+
     if (config) {
         config->decref();
     }
 
+    lcb_log(LOGARGS(this, DEBUG), LOGFMT "Loaded configuration revision %d", LOGID(this), lcbvb_get_revision(vbc));
     config = ConfigInfo::create(vbc, CLCONFIG_FILE, filename);
     last_mtime = st.st_mtime;
 
@@ -156,17 +236,70 @@ void FileProvider::write_cache(lcbvb_CONFIG *cfg)
         return;
     }
 
-    std::ofstream ofs(filename.c_str(), std::ios::trunc);
+    char *snapshot = nullptr;
+    size_t nsnapshot = 0;
+    if (lcbvb_save_binary(cfg, &snapshot, &nsnapshot) != 0) {
+        lcb_log(LOGARGS(this, ERROR), LOGFMT "Couldn't serialize configuration: %s", LOGID(this), lcbvb_get_error(cfg));
+        return;
+    }
+
+#ifndef _WIN32
+    /* Other processes may have the file mapped (see CacheFileData), and
+     * truncating it under them would fault their reads. Write a new file and
+     * move it over the old one instead, so that readers keep the old inode */
+    std::string tmpname = filename + ".XXXXXX";
+    int fd = mkstemp(&tmpname[0]);
+    if (fd == -1) {
+        int save_errno = last_errno = errno;
+        lcb_log(LOGARGS(this, ERROR), LOGFMT "Couldn't create temporary file: %s", LOGID(this), strerror(save_errno));
+        free(snapshot);
+        return;
+    }
+    struct stat st {
+    };
+    fchmod(fd, stat(filename.c_str(), &st) == 0 ? (st.st_mode & 0777) : 0644);
+
+    lcb_log(LOGARGS(this, INFO), LOGFMT "Writing configuration revision %d to file", LOGID(this),
+            lcbvb_get_revision(cfg));
+    const char *pos = snapshot;
+    size_t remaining = nsnapshot;
+    while (remaining) {
+        ssize_t nw = write(fd, pos, remaining);
+        if (nw == -1 && errno == EINTR) {
+            continue;
+        }
+        if (nw <= 0) {
+            break;
+        }
+        pos += nw;
+        remaining -= nw;
+    }
+    int save_errno = errno;
+    if (close(fd) != 0 && remaining == 0) {
+        save_errno = errno;
+        remaining = nsnapshot;
+    }
+    if (remaining != 0) {
+        last_errno = save_errno;
+        lcb_log(LOGARGS(this, ERROR), LOGFMT "Couldn't write file: %s", LOGID(this), strerror(save_errno));
+        remove(tmpname.c_str());
+    } else if (rename(tmpname.c_str(), filename.c_str()) != 0) {
+        save_errno = last_errno = errno;
+        lcb_log(LOGARGS(this, ERROR), LOGFMT "Couldn't replace file: %s", LOGID(this), strerror(save_errno));
+        remove(tmpname.c_str());
+    }
+#else
+    std::ofstream ofs(filename.c_str(), std::ios::trunc | std::ios::binary);
     if (ofs.good()) {
-        lcb_log(LOGARGS(this, INFO), LOGFMT "Writing configuration to file", LOGID(this));
-        char *json = lcbvb_save_json(cfg);
-        ofs << json;
-        ofs << CONFIG_CACHE_MAGIC;
-        free(json);
+        lcb_log(LOGARGS(this, INFO), LOGFMT "Writing configuration revision %d to file", LOGID(this),
+                lcbvb_get_revision(cfg));
+        ofs.write(snapshot, nsnapshot);
     } else {
         int save_errno = errno;
         lcb_log(LOGARGS(this, ERROR), LOGFMT "Couldn't open file for writing: %s", LOGID(this), strerror(save_errno));
     }
+#endif
+    free(snapshot);
 }
 
 ConfigInfo *FileProvider::get_cached()
@@ -157,6 +157,7 @@ LIBCOUCHBASE_API lcb_STATUS lcb_cmdanalytics_scope_qualifier(lcb_CMDANALYTICS *c
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdanalytics_reset(lcb_CMDANALYTICS *cmd)
 {
     cmd->root.clear();
+    cmd->params.clear();
     cmd->scope_name.clear();
     cmd->scope_qualifier.clear();
     return LCB_SUCCESS;
@@ -186,7 +187,12 @@ LIBCOUCHBASE_API lcb_STATUS lcb_cmdanalytics_callback(lcb_CMDANALYTICS *cmd, lcb
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdanalytics_encoded_payload(lcb_CMDANALYTICS *cmd, const char **payload,
                                                              size_t *payload_len)
 {
-    cmd->query = Json::FastWriter().write(cmd->root);
+    cmd->query.clear();
+    lcb::jsparse::Writer writer(cmd->query);
+    writer.begin_object();
+    writer.members(cmd->root);
+    writer.params(cmd->params);
+    writer.end_object();
     *payload = cmd->query.c_str();
     *payload_len = cmd->query.size();
     return LCB_SUCCESS;
@@ -205,6 +211,7 @@ LIBCOUCHBASE_API lcb_STATUS lcb_cmdanalytics_payload(lcb_CMDANALYTICS *cmd, cons
         return LCB_ERR_INVALID_ARGUMENT;
     }
     cmd->root = value;
+    cmd->params.clear();
     return LCB_SUCCESS;
 }
 
@@ -251,7 +258,12 @@ LIBCOUCHBASE_API lcb_STATUS lcb_cmdanalytics_option(lcb_CMDANALYTICS *cmd, const
     if (!Json::Reader().parse(value, value + value_len, jsonVal)) {
         return LCB_ERR_INVALID_ARGUMENT;
     }
-    cmd->root[std::string(name, name_len)] = jsonVal;
+    std::string key(name, name_len);
+    cmd->root[key] = jsonVal;
+    cmd->params.remove_named(key);
+    if (key == "args") {
+        cmd->params.positional.clear();
+    }
     return LCB_SUCCESS;
 }
 
@@ -266,18 +278,32 @@ LIBCOUCHBASE_API lcb_STATUS lcb_cmdanalytics_statement(lcb_CMDANALYTICS *cmd, co
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdanalytics_named_param(lcb_CMDANALYTICS *cmd, const char *name, size_t name_len,
                                                          const char *value, size_t value_len)
 {
-    return lcb_cmdanalytics_option(cmd, name, name_len, value, value_len);
+    fix_strlen(name, name_len);
+    fix_strlen(value, value_len);
+    std::string key(name, name_len);
+    if (!cmd->params.set_named(key, value, value_len)) {
+        return LCB_ERR_INVALID_ARGUMENT;
+    }
+    cmd->root.removeMember(key);
+    return LCB_SUCCESS;
 }
 
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdanalytics_positional_param(lcb_CMDANALYTICS *cmd, const char *value,
                                                               size_t value_len)
 {
     fix_strlen(value, value_len);
-    Json::Value jval;
-    if (!Json::Reader().parse(value, value + value_len, jval)) {
+    if (cmd->root.isMember("args")) {
+        // "args" was given as an option (or in the payload), append to it
+        Json::Value jval;
+        if (!Json::Reader().parse(value, value + value_len, jval)) {
+            return LCB_ERR_INVALID_ARGUMENT;
+        }
+        cmd->root["args"].append(jval);
+        return LCB_SUCCESS;
+    }
+    if (!cmd->params.add_positional(value, value_len)) {
         return LCB_ERR_INVALID_ARGUMENT;
     }
-    cmd->root["args"].append(jval);
     return LCB_SUCCESS;
 }
 
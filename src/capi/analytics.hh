@@ -23,6 +23,7 @@
 #include <string>
 
 #include "contrib/lcb-jsoncpp/lcb-jsoncpp.h"
+#include "jsparse/writer.h"
 
 struct lcb_INGEST_PARAM_ {
     lcb_INGEST_METHOD method;
@@ -101,6 +102,8 @@ struct lcb_CMDANALYTICS_ {
 
     Json::Value root{Json::objectValue};
     std::string query{};
+    /** Named and positional parameters, kept out of #root */
+    lcb::jsparse::EncodedParams params{};
     lcb_ANALYTICS_CALLBACK callback{nullptr};
     lcb_ANALYTICS_HANDLE **handle{nullptr};
     lcb_INGEST_OPTIONS *ingest{nullptr};
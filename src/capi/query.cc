@@ -18,10 +18,8 @@
 #include <cstring>
 
 #include <libcouchbase/couchbase.h>
-#include <libcouchbase/vbucket.h>
 
 #include "query.hh"
-#include "../mutation_token.hh"
 
 LIBCOUCHBASE_API lcb_STATUS lcb_respquery_status(const lcb_RESPQUERY *resp)
 {
@@ -113,6 +111,7 @@ LIBCOUCHBASE_API lcb_STATUS lcb_cmdquery_reset(lcb_CMDQUERY *cmd)
     cmd->pspan = nullptr;
 
     cmd->root = Json::Value();
+    cmd->params.clear();
     cmd->scope_name.clear();
     cmd->scope_qualifier.clear();
     cmd->query = "";
@@ -140,7 +139,16 @@ LIBCOUCHBASE_API lcb_STATUS lcb_cmdquery_callback(lcb_CMDQUERY *cmd, lcb_QUERY_C
 
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdquery_encoded_payload(lcb_CMDQUERY *cmd, const char **payload, size_t *payload_len)
 {
-    cmd->query = Json::FastWriter().write(cmd->root);
+    cmd->query.clear();
+    lcb::jsparse::Writer writer(cmd->query);
+    writer.begin_object();
+    writer.members(cmd->root);
+    writer.params(cmd->params);
+    if (!cmd->scan_vectors.empty()) {
+        writer.key("scan_vectors", 12);
+        cmd->scan_vectors.encode(writer.buffer());
+    }
+    writer.end_object();
     *payload = cmd->query.c_str();
     *payload_len = cmd->query.size();
     return LCB_SUCCESS;
@@ -153,6 +161,8 @@ LIBCOUCHBASE_API lcb_STATUS lcb_cmdquery_payload(lcb_CMDQUERY *cmd, const char *
         return LCB_ERR_INVALID_ARGUMENT;
     }
     cmd->root = value;
+    cmd->params.clear();
+    cmd->scan_vectors.clear();
     return LCB_SUCCESS;
 }
 
@@ -165,17 +175,31 @@ LIBCOUCHBASE_API lcb_STATUS lcb_cmdquery_statement(lcb_CMDQUERY *cmd, const char
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdquery_named_param(lcb_CMDQUERY *cmd, const char *name, size_t name_len,
                                                      const char *value, size_t value_len)
 {
+    fix_strlen(name, name_len);
+    fix_strlen(value, value_len);
     std::string key = "$" + std::string(name, name_len);
-    return lcb_cmdquery_option(cmd, key.c_str(), key.size(), value, value_len);
+    if (!cmd->params.set_named(key, value, value_len)) {
+        return LCB_ERR_INVALID_ARGUMENT;
+    }
+    cmd->root.removeMember(key);
+    return LCB_SUCCESS;
 }
 
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdquery_positional_param(lcb_CMDQUERY *cmd, const char *value, size_t value_len)
 {
-    fix_strlen(value, value_len) Json::Value jval;
-    if (!Json::Reader().parse(value, value + value_len, jval)) {
+    fix_strlen(value, value_len);
+    if (cmd->root.isMember("args")) {
+        // "args" was given as an option (or in the payload), append to it
+        Json::Value jval;
+        if (!Json::Reader().parse(value, value + value_len, jval)) {
+            return LCB_ERR_INVALID_ARGUMENT;
+        }
+        cmd->root["args"].append(jval);
+        return LCB_SUCCESS;
+    }
+    if (!cmd->params.add_positional(value, value_len)) {
         return LCB_ERR_INVALID_ARGUMENT;
     }
-    cmd->root["args"].append(jval);
     return LCB_SUCCESS;
 }
 
@@ -277,17 +301,6 @@ LIBCOUCHBASE_API lcb_STATUS lcb_cmdquery_consistency(lcb_CMDQUERY *cmd, lcb_QUER
     return LCB_SUCCESS;
 }
 
-static void encode_mutation_token(Json::Value &sparse, const lcb_MUTATION_TOKEN *sv)
-{
-    char buf[64] = {0};
-    sprintf(buf, "%u", sv->vbid_);
-    Json::Value &cur_sv = sparse[buf];
-
-    cur_sv[0] = static_cast<Json::UInt64>(sv->seqno_);
-    sprintf(buf, "%llu", (unsigned long long)sv->uuid_);
-    cur_sv[1] = buf;
-}
-
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdquery_consistency_token_for_keyspace(lcb_CMDQUERY *cmd, const char *keyspace,
                                                                         size_t keyspace_len,
                                                                         const lcb_MUTATION_TOKEN *token)
@@ -297,45 +310,29 @@ LIBCOUCHBASE_API lcb_STATUS lcb_cmdquery_consistency_token_for_keyspace(lcb_CMDQ
     }
 
     cmd->root["scan_consistency"] = "at_plus";
-    encode_mutation_token(cmd->root["scan_vectors"][std::string(keyspace, keyspace_len)], token);
+    cmd->root.removeMember("scan_vectors");
+    cmd->scan_vectors.add(keyspace, keyspace_len, *token);
     return LCB_SUCCESS;
 }
 
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdquery_consistency_tokens(lcb_CMDQUERY *cmd, lcb_INSTANCE *instance)
 {
-    lcbvb_CONFIG *vbc;
-    lcb_STATUS rc = lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_VBCONFIG, &vbc);
+    lcb_MUTATION_STATE state;
+    lcb_STATUS rc = lcb_mutation_state_add_instance(&state, instance);
     if (rc != LCB_SUCCESS) {
         return rc;
     }
+    return lcb_cmdquery_mutation_state(cmd, &state);
+}
 
-    const char *bucketname;
-    rc = lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_BUCKETNAME, &bucketname);
-    if (rc != LCB_SUCCESS) {
-        return rc;
-    }
-
-    Json::Value *sv_json = nullptr;
-
-    size_t vbmax = vbc->nvb;
-    for (size_t ii = 0; ii < vbmax; ++ii) {
-        lcb_KEYBUF kb;
-        kb.type = LCB_KV_VBID;
-        kb.vbid = ii;
-        const lcb_MUTATION_TOKEN *mt = lcb_get_mutation_token(instance, &kb, &rc);
-        if (rc == LCB_SUCCESS && mt != nullptr) {
-            if (sv_json == nullptr) {
-                sv_json = &cmd->root["scan_vectors"][bucketname];
-                cmd->root["scan_consistency"] = "at_plus";
-            }
-            encode_mutation_token(*sv_json, mt);
-        }
-    }
-
-    if (!sv_json) {
+LIBCOUCHBASE_API lcb_STATUS lcb_cmdquery_mutation_state(lcb_CMDQUERY *cmd, const lcb_MUTATION_STATE *state)
+{
+    if (state->empty()) {
         return LCB_ERR_DOCUMENT_NOT_FOUND;
     }
-
+    cmd->root["scan_consistency"] = "at_plus";
+    cmd->root.removeMember("scan_vectors");
+    cmd->scan_vectors.merge(*state);
     return LCB_SUCCESS;
 }
 
@@ -355,7 +352,14 @@ LIBCOUCHBASE_API lcb_STATUS lcb_cmdquery_option(lcb_CMDQUERY *cmd, const char *n
         return LCB_ERR_INVALID_ARGUMENT;
     }
 
-    cmd->root[std::string(name, name_len)] = jsonValue;
+    std::string key(name, name_len);
+    cmd->root[key] = jsonValue;
+    cmd->params.remove_named(key);
+    if (key == "args") {
+        cmd->params.positional.clear();
+    } else if (key == "scan_vectors") {
+        cmd->scan_vectors.clear();
+    }
     return LCB_SUCCESS;
 }
 
@@ -22,6 +22,8 @@
 #include <cstdint>
 
 #include "contrib/lcb-jsoncpp/lcb-jsoncpp.h"
+#include "jsparse/writer.h"
+#include "mutation_state.h"
 
 /**
  * @private
@@ -94,6 +96,10 @@ struct lcb_CMDQUERY_ {
      * `application/x-www-form-urlencoded`)
      */
     std::string query{};
+    /** Named and positional parameters, kept out of #root */
+    lcb::jsparse::EncodedParams params{};
+    /** Mutations to wait for (`scan_vectors`), kept out of #root */
+    lcb::MutationState scan_vectors{};
     std::string scope_qualifier{};
     std::string scope_name{};
 
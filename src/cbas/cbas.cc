@@ -17,6 +17,7 @@
 
 #include <libcouchbase/couchbase.h>
 #include <jsparse/parser.h>
+#include <jsparse/writer.h>
 #include "internal.h"
 #include "auth-priv.h"
 #include "http/http.h"
@@ -58,6 +59,8 @@ typedef struct lcb_ANALYTICS_HANDLE_ : lcb::jsparse::Parser::Actions {
     {
         return json;
     }
+    /** Query parameters, which are not part of ::json */
+    lcb::jsparse::EncodedParams params;
 
     /** String of the original statement. Cached here to avoid jsoncpp lookups */
     std::string statement;
@@ -69,6 +72,9 @@ typedef struct lcb_ANALYTICS_HANDLE_ : lcb::jsparse::Parser::Actions {
     /** Whether we're retrying this */
     bool was_retried;
 
+    /** Whether row delivery was paused by the application */
+    bool paused{false};
+
     /** Non-empty if this is deferred query check/fetch */
     std::string deferred_handle{};
 
@@ -99,7 +105,12 @@ typedef struct lcb_ANALYTICS_HANDLE_ : lcb::jsparse::Parser::Actions {
 
     lcb_STATUS issue_htreq()
     {
-        std::string s = Json::FastWriter().write(json);
+        std::string s;
+        lcb::jsparse::Writer writer(s);
+        writer.begin_object();
+        writer.members(json);
+        writer.params(params);
+        writer.end_object();
         return issue_htreq(s);
     }
 
@@ -425,6 +436,9 @@ lcb_STATUS ANALYTICSREQ::issue_htreq(const std::string &body)
     lcb_cmdhttp_destroy(htcmd);
     if (rc == LCB_SUCCESS) {
         htreq->set_callback(chunk_callback);
+        if (paused) {
+            htreq->pause_delivery();
+        }
     }
     return rc;
 }
@@ -466,7 +480,7 @@ static void doc_callback(lcb_INSTANCE *, int, const lcb_RESPBASE *rb)
 
     q->ref();
 
-    q->n_awaiting_response--;
+    q->complete(dreq);
     dreq->ready = 1;
 
     q->check();
@@ -569,8 +583,9 @@ lcb_ANALYTICS_HANDLE_::lcb_ANALYTICS_HANDLE_(lcb_INSTANCE *obj, void *user_cooki
         *cmd->handle = this;
     }
 
-    std::string encoded = Json::FastWriter().write(cmd->root);
-    if (!parse_json(encoded.c_str(), encoded.size(), json)) {
+    json = cmd->root;
+    params = cmd->params;
+    if (!json.isObject() && !json.isNull()) {
         lasterr = LCB_ERR_INVALID_ARGUMENT;
         return;
     }
@@ -624,9 +639,11 @@ lcb_ANALYTICS_HANDLE_::lcb_ANALYTICS_HANDLE_(lcb_INSTANCE *obj, void *user_cooki
         client_context_id = ccid.asString();
     }
 
-    Json::Value tmp = json;
-    tmp.removeMember("statement");
-    query_params = Json::FastWriter().write(cmd->root);
+    lcb::jsparse::Writer writer(query_params);
+    writer.begin_object();
+    writer.members(cmd->root);
+    writer.params(cmd->params);
+    writer.end_object();
 
     if (instance->settings->tracer) {
         char id[20] = {0};
@@ -729,6 +746,34 @@ LIBCOUCHBASE_API lcb_STATUS lcb_analytics_cancel(lcb_INSTANCE *, lcb_ANALYTICS_H
         if (handle->docq) {
             handle->docq->cancel();
         }
+        // the handle is destroyed once the next chunk arrives
+        if (handle->htreq) {
+            handle->htreq->resume_delivery();
+        }
+    }
+    return LCB_SUCCESS;
+}
+
+LIBCOUCHBASE_API lcb_STATUS lcb_analytics_pause(lcb_INSTANCE *, lcb_ANALYTICS_HANDLE *handle)
+{
+    if (handle == nullptr) {
+        return LCB_ERR_INVALID_ARGUMENT;
+    }
+    handle->paused = true;
+    if (handle->htreq) {
+        handle->htreq->pause_delivery();
+    }
+    return LCB_SUCCESS;
+}
+
+LIBCOUCHBASE_API lcb_STATUS lcb_analytics_resume(lcb_INSTANCE *, lcb_ANALYTICS_HANDLE *handle)
+{
+    if (handle == nullptr) {
+        return LCB_ERR_INVALID_ARGUMENT;
+    }
+    handle->paused = false;
+    if (handle->htreq) {
+        handle->htreq->resume_delivery();
     }
     return LCB_SUCCESS;
 }
@@ -41,6 +41,8 @@ struct lcb_SEARCH_HANDLE_ : lcb::jsparse::Parser::Actions {
     lcbtrace_SPAN *span;
     std::string index_name;
     std::string error_message;
+    /** Whether row delivery was paused by the application */
+    bool paused{false};
 
     void invoke_row(lcb_RESPSEARCH *resp);
     void invoke_last();
@@ -219,6 +221,9 @@ lcb_SEARCH_HANDLE_::lcb_SEARCH_HANDLE_(lcb_INSTANCE *instance_, const void *cook
     lcb_cmdhttp_destroy(htcmd);
     if (lasterr == LCB_SUCCESS) {
         htreq->set_callback(chunk_callback);
+        if (paused) {
+            htreq->pause_delivery();
+        }
         if (cmd->handle) {
             *cmd->handle = reinterpret_cast<lcb_SEARCH_HANDLE_ *>(this);
         }
@@ -271,5 +276,33 @@ LIBCOUCHBASE_API lcb_STATUS lcb_search(lcb_INSTANCE *instance, void *cookie, con
 LIBCOUCHBASE_API lcb_STATUS lcb_search_cancel(lcb_INSTANCE * /* instance */, lcb_SEARCH_HANDLE *handle)
 {
     handle->callback = nullptr;
+    // the handle is destroyed once the next chunk arrives
+    if (handle->htreq) {
+        handle->htreq->resume_delivery();
+    }
+    return LCB_SUCCESS;
+}
+
+LIBCOUCHBASE_API lcb_STATUS lcb_search_pause(lcb_INSTANCE * /* instance */, lcb_SEARCH_HANDLE *handle)
+{
+    if (handle == nullptr) {
+        return LCB_ERR_INVALID_ARGUMENT;
+    }
+    handle->paused = true;
+    if (handle->htreq) {
+        handle->htreq->pause_delivery();
+    }
+    return LCB_SUCCESS;
+}
+
+LIBCOUCHBASE_API lcb_STATUS lcb_search_resume(lcb_INSTANCE * /* instance */, lcb_SEARCH_HANDLE *handle)
+{
+    if (handle == nullptr) {
+        return LCB_ERR_INVALID_ARGUMENT;
+    }
+    handle->paused = false;
+    if (handle->htreq) {
+        handle->htreq->resume_delivery();
+    }
     return LCB_SUCCESS;
 }
@@ -17,6 +17,11 @@
 
 #include "internal.h"
 #include "bucketconfig/clconfig.h"
+#include "http/http.h"
+#include "http/inflate.h"
+#include "hedge.h"
+#include "coalesce.h"
+#include "kvdispatch.h"
 #include "contrib/lcb-jsoncpp/lcb-jsoncpp.h"
 #include <lcbio/iotable.h>
 #include <mcserver/negotiate.h>
@@ -134,6 +139,10 @@ static std::uint32_t *get_timeout_field(lcb_INSTANCE *instance, int cmd)
             return &settings->persistence_timeout_floor;
         case LCB_CNTL_OP_METRICS_FLUSH_INTERVAL:
             return &settings->op_metrics_flush_interval;
+        case LCB_CNTL_BOOTSTRAP_RACE_DELAY:
+            return &settings->bootstrap_race_delay;
+        case LCB_CNTL_KV_HEDGE_DELAY:
+            return &settings->kv_hedge_delay;
         default:
             return nullptr;
     }
@@ -232,6 +241,8 @@ HANDLER(readj_ts_wait_handler){RETURN_GET_SET(int, LCBT_SETTING(instance, readj_
 
 HANDLER(kv_hg_handler){RETURN_GET_ONLY(lcb_HISTOGRAM *, instance->kv_timings)}
 
+HANDLER(session_hg_handler){RETURN_GET_ONLY(lcb_HISTOGRAM *, LCBT_SETTING(instance, session_timings))}
+
 HANDLER(read_chunk_size_handler){RETURN_GET_SET(std::uint32_t, LCBT_SETTING(instance, read_chunk_size))}
 
 HANDLER(select_bucket_handler){RETURN_GET_SET(int, LCBT_SETTING(instance, select_bucket))}
@@ -529,12 +540,33 @@ HANDLER(console_log_handler)
 
     logger = (struct lcb_CONSOLELOGGER *)lcb_console_logger;
     level = LCB_LOG_ERROR - level;
-    logger->minlevel = (lcb_LOG_SEVERITY)level;
+    logger->base.minlevel = (lcb_LOG_SEVERITY)level;
     LCBT_SETTING(instance, logger) = &logger->base;
     (void)cmd;
     return LCB_SUCCESS;
 }
 
+HANDLER(console_async_handler)
+{
+    auto *logger = (struct lcb_CONSOLELOGGER *)lcb_console_logger;
+    if (mode == LCB_CNTL_GET) {
+        *(int *)arg = logger->async;
+    } else if (mode == LCB_CNTL_SET) {
+        if (*(int *)arg && !logger->async) {
+            if (lcb_asynclog_start() != 0) {
+                return LCB_ERR_SDK_INTERNAL;
+            }
+            logger->async = 1;
+        } else if (!*(int *)arg && logger->async) {
+            logger->async = 0;
+            lcb_asynclog_flush();
+        }
+    }
+    (void)cmd;
+    (void)instance;
+    return LCB_SUCCESS;
+}
+
 HANDLER(console_fp_handler)
 {
     auto *logger = (struct lcb_CONSOLELOGGER *)lcb_console_logger;
@@ -743,6 +775,195 @@ HANDLER(unordered_execution_handler)
     RETURN_GET_SET(int, LCBT_SETTING(instance, enable_unordered_execution))
 }
 
+HANDLER(kv_prewarm_handler){RETURN_GET_SET(int, LCBT_SETTING(instance, kv_prewarm))}
+
+HANDLER(http_compression_handler)
+{
+    if (mode == LCB_CNTL_SET && *reinterpret_cast<int *>(arg) && !lcb::http::Inflater::supported()) {
+        return LCB_ERR_SDK_FEATURE_UNAVAILABLE;
+    }
+    RETURN_GET_SET(int, LCBT_SETTING(instance, http_compression))
+}
+
+HANDLER(http_stream_hwm_handler){RETURN_GET_SET(std::uint32_t, LCBT_SETTING(instance, http_stream_hwm))}
+
+HANDLER(query_cache_max_entries_handler)
+{
+    if (mode == LCB_CNTL_SET && *reinterpret_cast<std::uint32_t *>(arg) < 1) {
+        return LCB_ERR_CONTROL_INVALID_ARGUMENT;
+    }
+    RETURN_GET_SET(std::uint32_t, LCBT_SETTING(instance, query_cache_max_entries))
+}
+
+HANDLER(query_cache_max_bytes_handler){RETURN_GET_SET(std::uint32_t, LCBT_SETTING(instance, query_cache_max_bytes))}
+
+HANDLER(query_cache_stats_handler)
+{
+    if (mode != LCB_CNTL_GET) {
+        return LCB_ERR_CONTROL_UNSUPPORTED_MODE;
+    }
+    lcb_n1qlcache_stats(instance->n1ql_cache, reinterpret_cast<lcb_QUERY_CACHE_STATS *>(arg));
+    (void)cmd;
+    return LCB_SUCCESS;
+}
+
+HANDLER(query_cache_file_handler)
+{
+    if (mode == LCB_CNTL_SET) {
+        return lcb_n1qlcache_set_file(instance->n1ql_cache, reinterpret_cast<const char *>(arg));
+    }
+    *(const char **)arg = lcb_n1qlcache_get_file(instance->n1ql_cache);
+    (void)cmd;
+    return LCB_SUCCESS;
+}
+
+HANDLER(query_cache_save_handler)
+{
+    if (mode != LCB_CNTL_SET) {
+        return LCB_ERR_CONTROL_UNSUPPORTED_MODE;
+    }
+    (void)cmd;
+    return lcb_n1qlcache_save(instance->n1ql_cache, reinterpret_cast<const char *>(arg));
+}
+
+HANDLER(http_endpoint_selection_handler)
+{
+    if (mode == LCB_CNTL_SET) {
+        auto val = *reinterpret_cast<lcb_HTTP_ENDPOINT_SELECTION *>(arg);
+        if (val != LCB_HTTP_ENDPOINT_RANDOM && val != LCB_HTTP_ENDPOINT_LEAST_LOADED) {
+            return LCB_ERR_CONTROL_INVALID_ARGUMENT;
+        }
+    }
+    RETURN_GET_SET(lcb_HTTP_ENDPOINT_SELECTION, LCBT_SETTING(instance, http_endpoint_selection))
+}
+
+/* Services sharing the http_pool_min_idle and http_pool_max_per_host settings */
+static const lcbio_SERVICE http_pool_services[] = {LCBIO_SERVICE_N1QL, LCBIO_SERVICE_FTS, LCBIO_SERVICE_ANALYTICS,
+                                                   LCBIO_SERVICE_VIEW};
+
+HANDLER(http_pool_options_handler)
+{
+    auto *opts = reinterpret_cast<lcb_HTTP_POOL_OPTIONS *>(arg);
+    lcbio_SERVICE svc = lcb::http::httype2service(opts->type);
+    if (svc == LCBIO_SERVICE_MGMT || svc == LCBIO_SERVICE_EVENTING) {
+        return LCB_ERR_CONTROL_INVALID_ARGUMENT;
+    }
+    lcb::io::Pool::ServiceOptions &svcopts = instance->http_sockpool->get_service_options(svc);
+    if (mode == LCB_CNTL_SET) {
+        svcopts.minidle = opts->min_idle;
+        svcopts.maxhost = opts->max_per_host;
+        lcb::http::warmup_pool(instance);
+    } else {
+        opts->min_idle = svcopts.minidle;
+        opts->max_per_host = svcopts.maxhost;
+    }
+    (void)cmd;
+    return LCB_SUCCESS;
+}
+
+HANDLER(http_pool_stats_handler)
+{
+    if (mode != LCB_CNTL_GET) {
+        return LCB_ERR_CONTROL_UNSUPPORTED_MODE;
+    }
+    const lcb::io::Pool::Stats &stats = instance->http_sockpool->get_stats();
+    auto *out = reinterpret_cast<lcb_HTTP_POOL_STATS *>(arg);
+    out->requests = stats.requests;
+    out->reused = stats.reused;
+    out->created = stats.created;
+    out->failed = stats.failed;
+    out->wait_total_us = LCB_NS2US(stats.wait_total);
+    out->wait_max_us = LCB_NS2US(stats.wait_max);
+    (void)cmd;
+    return LCB_SUCCESS;
+}
+
+HANDLER(kv_hedge_stats_handler)
+{
+    if (mode != LCB_CNTL_GET) {
+        return LCB_ERR_CONTROL_UNSUPPORTED_MODE;
+    }
+    const lcb::HedgeTracker *tracker = instance->kv_hedge;
+    auto *out = reinterpret_cast<lcb_KV_HEDGE_STATS *>(arg);
+    out->issued = tracker->issued;
+    out->won = tracker->won;
+    out->delay_us = tracker->delay(LCBT_SETTING(instance, kv_hedge_delay));
+    (void)cmd;
+    return LCB_SUCCESS;
+}
+
+HANDLER(kv_coalesce_gets_handler){RETURN_GET_SET(int, LCBT_SETTING(instance, kv_coalesce_gets))}
+
+HANDLER(kv_coalesce_stats_handler)
+{
+    if (mode != LCB_CNTL_GET) {
+        return LCB_ERR_CONTROL_UNSUPPORTED_MODE;
+    }
+    const lcb::GetCoalescer *coalescer = instance->kv_coalesce;
+    auto *out = reinterpret_cast<lcb_KV_COALESCE_STATS *>(arg);
+    out->issued = coalescer->issued;
+    out->coalesced = coalescer->coalesced;
+    out->inflight = static_cast<lcb_U32>(coalescer->size());
+    (void)cmd;
+    return LCB_SUCCESS;
+}
+
+HANDLER(kv_opcode_stats_handler)
+{
+    if (mode != LCB_CNTL_GET) {
+        return LCB_ERR_CONTROL_UNSUPPORTED_MODE;
+    }
+    auto *out = reinterpret_cast<lcb_KV_OPCODE_STATS *>(arg);
+    const lcb::KvDispatch::Entry &entry = instance->kv_dispatch->entry(out->opcode);
+    out->responses = entry.count;
+    out->timings = entry.timings;
+    (void)cmd;
+    return LCB_SUCCESS;
+}
+
+HANDLER(read_buffer_cache_size_handler)
+{
+    rdb_SEGCACHE *cache = LCBT_SETTING(instance, read_buffer_cache);
+    if (mode == LCB_CNTL_SET) {
+        rdb_segcache_set_limit(cache, *reinterpret_cast<lcb_U32 *>(arg));
+    } else {
+        *reinterpret_cast<lcb_U32 *>(arg) = rdb_segcache_get_limit(cache);
+    }
+    (void)cmd;
+    return LCB_SUCCESS;
+}
+
+HANDLER(http_pool_limits_handler)
+{
+    lcbio_MGR *pool = instance->http_sockpool;
+    if (mode == LCB_CNTL_GET) {
+        lcb::io::Pool::ServiceOptions &svcopts = pool->get_service_options(LCBIO_SERVICE_N1QL);
+        *reinterpret_cast<std::uint32_t *>(arg) =
+            cmd == LCB_CNTL_HTTP_POOL_MIN_IDLE ? svcopts.minidle : svcopts.maxhost;
+        return LCB_SUCCESS;
+    }
+    std::uint32_t val = *reinterpret_cast<std::uint32_t *>(arg);
+    for (lcbio_SERVICE svc : http_pool_services) {
+        if (cmd == LCB_CNTL_HTTP_POOL_MIN_IDLE) {
+            pool->get_service_options(svc).minidle = val;
+        } else {
+            pool->get_service_options(svc).maxhost = val;
+        }
+    }
+    if (cmd == LCB_CNTL_HTTP_POOL_MIN_IDLE) {
+        lcb::http::warmup_pool(instance);
+    }
+    return LCB_SUCCESS;
+}
+
+HANDLER(bootstrap_race_width_handler)
+{
+    if (mode == LCB_CNTL_SET && *reinterpret_cast<std::uint32_t *>(arg) < 1) {
+        return LCB_ERR_CONTROL_INVALID_ARGUMENT;
+    }
+    RETURN_GET_SET(std::uint32_t, LCBT_SETTING(instance, bootstrap_race_width))
+}
+
 /* clang-format off */
 static ctl_handler handlers[] = {
     timeout_common,                       /* LCB_CNTL_OP_TIMEOUT */
@@ -849,6 +1070,29 @@ static ctl_handler handlers[] = {
     enable_errmap_handler,                /* LCB_CNTL_ENABLE_ERRMAP */
     op_metrics_flush_interval_handler,    /* LCB_CNTL_OP_METRICS_FLUSH_INTERVAL */
     enable_op_metrics_handler,            /* LCB_CNTL_ENABLE_OP_METRICS */
+    bootstrap_race_width_handler,         /* LCB_CNTL_BOOTSTRAP_RACE_WIDTH */
+    timeout_common,                       /* LCB_CNTL_BOOTSTRAP_RACE_DELAY */
+    kv_prewarm_handler,                   /* LCB_CNTL_KV_PREWARM */
+    http_compression_handler,             /* LCB_CNTL_HTTP_COMPRESSION */
+    http_stream_hwm_handler,              /* LCB_CNTL_HTTP_STREAM_HWM */
+    query_cache_max_entries_handler,      /* LCB_CNTL_QUERY_CACHE_MAX_ENTRIES */
+    query_cache_max_bytes_handler,        /* LCB_CNTL_QUERY_CACHE_MAX_BYTES */
+    query_cache_stats_handler,            /* LCB_CNTL_QUERY_CACHE_STATS */
+    query_cache_file_handler,             /* LCB_CNTL_QUERY_CACHE_FILE */
+    query_cache_save_handler,             /* LCB_CNTL_QUERY_CACHE_SAVE */
+    http_endpoint_selection_handler,      /* LCB_CNTL_HTTP_ENDPOINT_SELECTION */
+    http_pool_options_handler,            /* LCB_CNTL_HTTP_POOL_OPTIONS */
+    http_pool_stats_handler,              /* LCB_CNTL_HTTP_POOL_STATS */
+    http_pool_limits_handler,             /* LCB_CNTL_HTTP_POOL_MIN_IDLE */
+    http_pool_limits_handler,             /* LCB_CNTL_HTTP_POOL_MAX_PER_HOST */
+    timeout_common,                       /* LCB_CNTL_KV_HEDGE_DELAY */
+    kv_hedge_stats_handler,               /* LCB_CNTL_KV_HEDGE_STATS */
+    kv_coalesce_gets_handler,             /* LCB_CNTL_KV_COALESCE_GETS */
+    kv_coalesce_stats_handler,            /* LCB_CNTL_KV_COALESCE_STATS */
+    console_async_handler,                /* LCB_CNTL_CONLOGGER_ASYNC */
+    kv_opcode_stats_handler,              /* LCB_CNTL_KV_OPCODE_STATS */
+    read_buffer_cache_size_handler,       /* LCB_CNTL_READ_BUFFER_CACHE_SIZE */
+    session_hg_handler,                   /* LCB_CNTL_SESSION_TIMINGS */
     nullptr
 };
 /* clang-format on */
@@ -1014,6 +1258,17 @@ static lcb_STATUS convert_ipv6(const char *arg, u_STRCONVERT *u)
     return LCB_SUCCESS;
 }
 
+static lcb_STATUS convert_endpoint_selection(const char *arg, u_STRCONVERT *u)
+{
+    static const STR_u32MAP optmap[] = {
+        {"random", LCB_HTTP_ENDPOINT_RANDOM},
+        {"least_loaded", LCB_HTTP_ENDPOINT_LEAST_LOADED},
+        {nullptr},
+    };
+    DO_CONVERT_STR2NUM(arg, optmap, u->i);
+    return LCB_SUCCESS;
+}
+
 static cntl_OPCODESTRS stropcode_map[] = {
     {"operation_timeout", LCB_CNTL_OP_TIMEOUT, convert_timevalue},
     {"timeout", LCB_CNTL_OP_TIMEOUT, convert_timevalue},
@@ -1085,6 +1340,21 @@ static cntl_OPCODESTRS stropcode_map[] = {
     {"enable_errmap", LCB_CNTL_ENABLE_ERRMAP, convert_intbool},
     {"operation_metrics_flush_interval", LCB_CNTL_OP_METRICS_FLUSH_INTERVAL, convert_timevalue},
     {"enable_operation_metrics", LCB_CNTL_ENABLE_OP_METRICS, convert_intbool},
+    {"bootstrap_race_width", LCB_CNTL_BOOTSTRAP_RACE_WIDTH, convert_u32},
+    {"bootstrap_race_delay", LCB_CNTL_BOOTSTRAP_RACE_DELAY, convert_timevalue},
+    {"kv_prewarm", LCB_CNTL_KV_PREWARM, convert_intbool},
+    {"http_compression", LCB_CNTL_HTTP_COMPRESSION, convert_intbool},
+    {"http_stream_hwm", LCB_CNTL_HTTP_STREAM_HWM, convert_u32},
+    {"query_cache_max_entries", LCB_CNTL_QUERY_CACHE_MAX_ENTRIES, convert_u32},
+    {"query_cache_max_bytes", LCB_CNTL_QUERY_CACHE_MAX_BYTES, convert_u32},
+    {"query_cache", LCB_CNTL_QUERY_CACHE_FILE, convert_passthru},
+    {"http_endpoint_selection", LCB_CNTL_HTTP_ENDPOINT_SELECTION, convert_endpoint_selection},
+    {"http_pool_min_idle", LCB_CNTL_HTTP_POOL_MIN_IDLE, convert_u32},
+    {"http_pool_max_per_host", LCB_CNTL_HTTP_POOL_MAX_PER_HOST, convert_u32},
+    {"kv_hedge_delay", LCB_CNTL_KV_HEDGE_DELAY, convert_timevalue},
+    {"kv_coalesce_gets", LCB_CNTL_KV_COALESCE_GETS, convert_intbool},
+    {"console_log_async", LCB_CNTL_CONLOGGER_ASYNC, convert_intbool},
+    {"read_buffer_cache_size", LCB_CNTL_READ_BUFFER_CACHE_SIZE, convert_u32},
     {nullptr, -1}};
 
 #define CNTL_NUM_HANDLERS (sizeof(handlers) / sizeof(handlers[0]))
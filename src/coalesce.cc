@@ -0,0 +1,83 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "coalesce.h"
+
+using namespace lcb;
+
+std::string GetCoalescer::make_key(uint32_t cid, const void *key, size_t nkey)
+{
+    std::string out(reinterpret_cast<const char *>(&cid), sizeof(cid));
+    out.append(static_cast<const char *>(key), nkey);
+    return out;
+}
+
+GetCoalescer::Flight *GetCoalescer::find(const std::string &key) const
+{
+    auto it = flights_.find(key);
+    if (it == flights_.end()) {
+        return nullptr;
+    }
+    return it->second;
+}
+
+void GetCoalescer::add(Flight *flight)
+{
+    flights_[flight->key] = flight;
+}
+
+void GetCoalescer::remove(Flight *flight)
+{
+    auto it = flights_.find(flight->key);
+    if (it != flights_.end() && it->second == flight) {
+        flights_.erase(it);
+    }
+    for (auto ii = scheduled_.begin(); ii != scheduled_.end();) {
+        if (ii->first == flight) {
+            ii = scheduled_.erase(ii);
+        } else {
+            ++ii;
+        }
+    }
+}
+
+void GetCoalescer::join(Flight *flight, const void *cookie, bool scheduled)
+{
+    flight->waiters.push_back(cookie);
+    if (scheduled) {
+        scheduled_.emplace_back(flight, cookie);
+    }
+    coalesced++;
+}
+
+void GetCoalescer::commit()
+{
+    scheduled_.clear();
+}
+
+void GetCoalescer::rollback()
+{
+    /* every get attached within the context is at the tail of its flight */
+    for (auto ii = scheduled_.rbegin(); ii != scheduled_.rend(); ++ii) {
+        std::vector<const void *> &waiters = ii->first->waiters;
+        if (!waiters.empty() && waiters.back() == ii->second) {
+            waiters.pop_back();
+            coalesced--;
+        }
+    }
+    scheduled_.clear();
+}
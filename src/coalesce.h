@@ -0,0 +1,97 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LCB_COALESCE_H
+#define LCB_COALESCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace lcb
+{
+
+/**
+ * Keeps track of the gets which are in flight while get coalescing is
+ * enabled (see LCB_CNTL_KV_COALESCE_GETS).
+ *
+ * A get for a key which is already being fetched is not sent to the server,
+ * but is attached to the pending request, and receives a copy of its
+ * response.
+ */
+class GetCoalescer
+{
+  public:
+    /** A get which was sent to the server, and the gets attached to it */
+    struct Flight {
+        Flight() : deadline(0) {}
+
+        std::string key;
+        /** Cookies of the attached gets, in the order they were scheduled */
+        std::vector<const void *> waiters;
+        /** Deadline of the request, gets with an earlier deadline are not attached */
+        uint64_t deadline;
+    };
+
+    GetCoalescer() : issued(0), coalesced(0) {}
+
+    /** Build the lookup key for a document in a collection */
+    static std::string make_key(uint32_t cid, const void *key, size_t nkey);
+
+    /** @return the get in flight for the key, or nullptr */
+    Flight *find(const std::string &key) const;
+
+    /** Register a get which was sent to the server. Replaces any previous get for the key */
+    void add(Flight *flight);
+
+    /** Unregister a get once it has completed (or failed) */
+    void remove(Flight *flight);
+
+    /**
+     * Attach a get to the request in flight. If @p scheduled is set, the get was
+     * issued within lcb_sched_enter(), and is only kept once commit() is called.
+     */
+    void join(Flight *flight, const void *cookie, bool scheduled);
+
+    /** Keep the gets attached within the current scheduling context */
+    void commit();
+
+    /** Detach the gets attached within the current scheduling context */
+    void rollback();
+
+    size_t size() const
+    {
+        return flights_.size();
+    }
+
+    /** Gets sent to the server while coalescing */
+    uint64_t issued;
+    /** Gets which were attached to another get */
+    uint64_t coalesced;
+
+  private:
+    std::unordered_map<std::string, Flight *> flights_;
+    /** Gets attached since lcb_sched_enter(), in the order they were scheduled */
+    std::vector<std::pair<Flight *, const void *>> scheduled_;
+};
+
+} // namespace lcb
+
+#endif /* LCB_COALESCE_H */
@@ -0,0 +1,207 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "internal.h"
+#include "compqueue.h"
+#include "rdb/rope.h"
+
+using namespace lcb;
+
+static size_t round_capacity(size_t capacity)
+{
+    size_t ret = 1;
+    while (ret < capacity) {
+        ret <<= 1;
+    }
+    return ret;
+}
+
+CompletionQueue::CompletionQueue(size_t capacity)
+    : enabled(false), grown(0), saved(), ring_(round_capacity(capacity)), head_(0), count_(0)
+{
+}
+
+CompletionQueue::~CompletionQueue()
+{
+    lcb_COMPLETION entry;
+    while (poll(&entry, 1)) {
+        lcb_completion_release(&entry);
+    }
+}
+
+void CompletionQueue::reserve(size_t capacity)
+{
+    if (capacity <= ring_.size()) {
+        return;
+    }
+    std::vector<lcb_COMPLETION> ring(round_capacity(capacity));
+    size_t count = poll(ring.data(), count_);
+    ring_.swap(ring);
+    head_ = 0;
+    count_ = count;
+}
+
+void CompletionQueue::push(const lcb_COMPLETION &entry)
+{
+    if (count_ == ring_.size()) {
+        reserve(ring_.size() * 2);
+        grown++;
+    }
+    ring_[(head_ + count_) & (ring_.size() - 1)] = entry;
+    count_++;
+}
+
+size_t CompletionQueue::poll(lcb_COMPLETION *entries, size_t max)
+{
+    size_t n = max < count_ ? max : count_;
+    for (size_t ii = 0; ii < n; ii++) {
+        entries[ii] = ring_[head_];
+        head_ = (head_ + 1) & (ring_.size() - 1);
+    }
+    count_ -= n;
+    return n;
+}
+
+/**
+ * Take ownership of the value of a get: pin the read buffer it sits in, or
+ * copy it if it is not in that buffer (e.g. it was inflated)
+ */
+static void take_value(lcb_COMPLETION *entry, const void *value, size_t nvalue, void *bufh)
+{
+    entry->nvalue = nvalue;
+    if (nvalue == 0) {
+        return;
+    }
+    auto *seg = static_cast<rdb_ROPESEG *>(bufh);
+    const char *p = static_cast<const char *>(value);
+    if (seg && p >= seg->root && p + nvalue <= seg->root + seg->nalloc) {
+        rdb_seg_ref(seg);
+        entry->value = value;
+        entry->buffer = seg;
+    } else {
+        void *copy = malloc(nvalue);
+        memcpy(copy, value, nvalue);
+        entry->value = copy;
+        entry->buffer = copy;
+        entry->allocated = 1;
+    }
+}
+
+static void completion_callback(lcb_INSTANCE *instance, int cbtype, const lcb_RESPBASE *resp)
+{
+    lcb_COMPLETION entry{};
+    entry.type = static_cast<lcb_CALLBACK_TYPE>(cbtype);
+    entry.rc = resp->ctx.rc;
+    entry.rflags = resp->rflags;
+    entry.cookie = resp->cookie;
+    entry.cas = resp->ctx.cas;
+
+    switch (cbtype) {
+        case LCB_CALLBACK_GET: {
+            const auto *get = reinterpret_cast<const lcb_RESPGET *>(resp);
+            take_value(&entry, get->value, get->nvalue, get->bufh);
+            entry.flags = get->itmflags;
+            entry.datatype = get->datatype;
+            break;
+        }
+        case LCB_CALLBACK_GETREPLICA: {
+            const auto *get = reinterpret_cast<const lcb_RESPGETREPLICA *>(resp);
+            take_value(&entry, get->value, get->nvalue, get->bufh);
+            entry.flags = get->itmflags;
+            entry.datatype = get->datatype;
+            break;
+        }
+        case LCB_CALLBACK_STORE:
+            if (reinterpret_cast<const lcb_RESPSTORE *>(resp)->dur_resp) {
+                /* the result of durability polling does not fit in an entry */
+                lcb_RESPCALLBACK callback = instance->completions->saved[cbtype];
+                if (callback == nullptr) {
+                    callback = lcb_find_callback(instance, LCB_CALLBACK_DEFAULT);
+                }
+                callback(instance, cbtype, resp);
+                return;
+            }
+            break;
+        case LCB_CALLBACK_COUNTER:
+            entry.counter = reinterpret_cast<const lcb_RESPCOUNTER *>(resp)->value;
+            break;
+        default:
+            break;
+    }
+    instance->completions->push(entry);
+}
+
+static const lcb_CALLBACK_TYPE queued_types[] = {
+    LCB_CALLBACK_GET,    LCB_CALLBACK_GETREPLICA, LCB_CALLBACK_STORE,   LCB_CALLBACK_REMOVE,
+    LCB_CALLBACK_TOUCH,  LCB_CALLBACK_UNLOCK,     LCB_CALLBACK_COUNTER, LCB_CALLBACK_EXISTS,
+};
+
+LIBCOUCHBASE_API
+lcb_STATUS lcb_completion_queue_enable(lcb_INSTANCE *instance, size_t capacity)
+{
+    if (capacity == 0) {
+        if (instance->completions && instance->completions->enabled) {
+            for (lcb_CALLBACK_TYPE cbtype : queued_types) {
+                if (instance->callbacks.v3callbacks[cbtype] == completion_callback) {
+                    instance->callbacks.v3callbacks[cbtype] = instance->completions->saved[cbtype];
+                }
+            }
+            instance->completions->enabled = false;
+        }
+        return LCB_SUCCESS;
+    }
+
+    if (instance->completions == nullptr) {
+        instance->completions = new CompletionQueue(capacity);
+    } else {
+        instance->completions->reserve(capacity);
+    }
+    for (lcb_CALLBACK_TYPE cbtype : queued_types) {
+        lcb_RESPCALLBACK &callback = instance->callbacks.v3callbacks[cbtype];
+        if (callback != completion_callback) {
+            instance->completions->saved[cbtype] = callback;
+            callback = completion_callback;
+        }
+    }
+    instance->completions->enabled = true;
+    return LCB_SUCCESS;
+}
+
+LIBCOUCHBASE_API
+size_t lcb_completion_queue_poll(lcb_INSTANCE *instance, lcb_COMPLETION *entries, size_t max)
+{
+    if (instance->completions == nullptr) {
+        return 0;
+    }
+    return instance->completions->poll(entries, max);
+}
+
+LIBCOUCHBASE_API
+void lcb_completion_release(lcb_COMPLETION *entry)
+{
+    if (entry->buffer == nullptr) {
+        return;
+    }
+    if (entry->allocated) {
+        free(entry->buffer);
+    } else {
+        rdb_seg_unref(static_cast<rdb_ROPESEG *>(entry->buffer));
+    }
+    entry->buffer = nullptr;
+    entry->value = nullptr;
+    entry->nvalue = 0;
+}
@@ -0,0 +1,78 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LCB_COMPQUEUE_H
+#define LCB_COMPQUEUE_H
+
+#include <libcouchbase/couchbase.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lcb
+{
+
+/**
+ * Ring of the operations which completed while the completion queue is
+ * enabled (see lcb_completion_queue_enable()), in the order they completed.
+ *
+ * The ring holds a power of two number of entries. It is doubled when it is
+ * full, rather than dropping (or blocking on) completions.
+ */
+class CompletionQueue
+{
+  public:
+    explicit CompletionQueue(size_t capacity);
+
+    /** Releases the entries which were not polled */
+    ~CompletionQueue();
+
+    /** Append an entry, which is owned by the queue until it is polled */
+    void push(const lcb_COMPLETION &entry);
+
+    /** Move up to `max` of the oldest entries to `entries` */
+    size_t poll(lcb_COMPLETION *entries, size_t max);
+
+    /** Make room for at least `capacity` entries */
+    void reserve(size_t capacity);
+
+    size_t size() const
+    {
+        return count_;
+    }
+
+    size_t capacity() const
+    {
+        return ring_.size();
+    }
+
+    /** Whether responses are currently delivered to the queue */
+    bool enabled;
+    /** Number of times the ring was grown because it was full */
+    uint64_t grown;
+    /** Callbacks the queue took the place of, restored when it is disabled */
+    lcb_RESPCALLBACK saved[LCB_CALLBACK__MAX];
+
+  private:
+    std::vector<lcb_COMPLETION> ring_;
+    size_t head_;
+    size_t count_;
+};
+
+} // namespace lcb
+
+#endif /* LCB_COMPQUEUE_H */
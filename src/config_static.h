@@ -167,6 +167,15 @@ extern hrtime_t gethrtime(void);
 #endif
 #endif
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+/** CPU time consumed by the calling thread, in nanoseconds */
+extern hrtime_t gethrcputime(void);
+#ifdef __cplusplus
+}
+#endif
+
 #if defined(EWOULDBLOCK) && defined(EAGAIN) && EWOULDBLOCK != EAGAIN
 #define USE_EAGAIN 1
 #endif
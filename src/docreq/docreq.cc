@@ -19,19 +19,27 @@
 #include "internal.h"
 #include "sllist-inl.h"
 
+#include <algorithm>
+
 using namespace lcb::docreq;
 
 static void docreq_handler(void *arg);
 static void invoke_pending(Queue *);
+static void docq_poke(Queue *);
 
-#define MAX_PENDING_DOCREQ 10
+#define MAX_PENDING_DOCREQ 128
 #define MIN_SCHED_SIZE 5
-#define DOCQ_DELAY_US 200000
+#define DOCQ_WINDOW_INITIAL 10
+#define DOCQ_WINDOW_MIN 2
+/* Response times within twice the lowest observed (plus this) are considered
+ * uncongested */
+#define DOCQ_LATENCY_SLACK_US 1000
 
 Queue::Queue(lcb_INSTANCE *instance_)
     : instance(instance_), parent(nullptr), timer(lcbio_timer_new(instance->iotable, this, docreq_handler)),
       cb_ready(nullptr), cb_throttle(nullptr), n_awaiting_schedule(0), n_awaiting_response(0),
-      max_pending_response(MAX_PENDING_DOCREQ), min_batch_size(MIN_SCHED_SIZE), cancelled(false), refcount(1)
+      max_pending_response(MAX_PENDING_DOCREQ), min_batch_size(MIN_SCHED_SIZE), cancelled(false), refcount(1),
+      window(DOCQ_WINDOW_INITIAL), latency_us(0), min_latency_us(0), n_window_responses(0)
 {
 
     memset(&pending_gets, 0, sizeof pending_gets);
@@ -55,84 +63,144 @@ void Queue::unref()
 void Queue::cancel()
 {
     cancelled = true;
+    docq_poke(this);
 }
 
-/* Calling this function ensures that the request will be scheduled in due
- * time. This may be done at the next event loop iteration, or after a delay
- * depending on how many items are actually found within the queue. */
+/* Calling this function ensures that pending requests will be scheduled at the
+ * next event loop iteration, so that all the rows received in the meantime
+ * are sent as a single batch. If nothing can be sent right now, the next
+ * response will poke the queue again. */
 static void docq_poke(Queue *q)
 {
-    if (q->n_awaiting_response < q->max_pending_response) {
-        if (q->n_awaiting_schedule > q->min_batch_size) {
-            lcbio_async_signal(q->timer);
-            q->cb_throttle(q, 0);
-        }
+    if (q->n_awaiting_schedule == 0 || lcbio_timer_armed(q->timer)) {
+        return;
     }
-
-    if (!lcbio_timer_armed(q->timer)) {
-        lcbio_timer_rearm(q->timer, DOCQ_DELAY_US);
+    if (q->cancelled || q->n_awaiting_response < q->max_pending_response) {
+        lcbio_async_signal(q->timer);
     }
 }
 
 void Queue::add(DocRequest *req)
 {
-    sllist_append(&pending_gets, &req->slnode);
+    sllist_append(&pending_gets, &req->pending_node);
+    sllist_append(&cb_queue, &req->slnode);
     n_awaiting_schedule++;
     req->parent = this;
     req->ready = 0;
+    req->server = -1;
     ref();
     docq_poke(this);
 }
 
-static void docreq_handler(void *arg)
+/* Returns the index of the server the document will be fetched from, or -1
+ * if it is not known */
+static int map_server(Queue *q, const DocRequest *req)
+{
+    lcbvb_CONFIG *config = LCBT_VBCONFIG(q->instance);
+    if (config == nullptr || req->docid.iov_len == 0) {
+        return -1;
+    }
+    int vbid, srvix = -1;
+    lcbvb_map_key(config, req->docid.iov_base, req->docid.iov_len, &vbid, &srvix);
+    if (srvix >= 0 && static_cast<size_t>(srvix) >= q->server_pending.size()) {
+        q->server_pending.resize(srvix + 1);
+    }
+    return srvix;
+}
+
+void Queue::schedule()
 {
-    auto *q = reinterpret_cast<Queue *>(arg);
     sllist_iterator iter;
-    lcb_INSTANCE *instance = q->instance;
+    bool blocked = false;
+    hrtime_t now = gethrtime();
 
     lcb_sched_enter(instance);
-    SLLIST_ITERFOR(&q->pending_gets, &iter)
+    SLLIST_ITERFOR(&pending_gets, &iter)
     {
-        DocRequest *cont = SLLIST_ITEM(iter.cur, DocRequest, slnode);
+        DocRequest *cont = SLLIST_ITEM(iter.cur, DocRequest, pending_node);
 
-        if (q->n_awaiting_response > q->max_pending_response) {
-            lcbio_timer_rearm(q->timer, DOCQ_DELAY_US);
-            q->cb_throttle(q, 1);
+        if (!cancelled && n_awaiting_response >= max_pending_response) {
+            blocked = true;
             break;
         }
 
-        q->n_awaiting_schedule--;
+        int server = cancelled ? -1 : map_server(this, cont);
+        if (server >= 0 && server_pending[server] >= window) {
+            /* Leave it for later, but keep going for the other servers */
+            blocked = true;
+            continue;
+        }
+
+        n_awaiting_schedule--;
+        sllist_iter_remove(&pending_gets, &iter);
 
-        if (q->cancelled) {
+        if (cancelled) {
             cont->docresp.ctx.rc = LCB_ERR_SDK_INTERNAL;
             cont->ready = 1;
 
         } else {
             lcb_STATUS rc;
-            rc = q->cb_schedule(q, cont);
+            rc = cb_schedule(this, cont);
             if (rc != LCB_SUCCESS) {
                 cont->docresp.ctx.rc = rc;
                 cont->ready = 1;
             } else {
-                q->n_awaiting_response++;
+                cont->server = server;
+                cont->start = now;
+                n_awaiting_response++;
+                if (server >= 0) {
+                    server_pending[server]++;
+                }
             }
         }
-        sllist_iter_remove(&q->pending_gets, &iter);
-        sllist_append(&q->cb_queue, &cont->slnode);
     }
 
     lcb_sched_leave(instance);
     lcb_sched_flush(instance);
 
-    if (q->n_awaiting_schedule < q->min_batch_size) {
-        q->cb_throttle(q, 0);
+    if (blocked) {
+        cb_throttle(this, 1);
+    } else if (n_awaiting_schedule < min_batch_size) {
+        cb_throttle(this, 0);
     }
 
-    /* Ensure we're called again */
-    docq_poke(q);
-
     /* Flush out any bad responses */
-    invoke_pending(q);
+    invoke_pending(this);
+}
+
+void Queue::complete(DocRequest *req)
+{
+    n_awaiting_response--;
+    if (req->server >= 0 && static_cast<size_t>(req->server) < server_pending.size() &&
+        server_pending[req->server]) {
+        server_pending[req->server]--;
+    }
+
+    uint64_t sample = LCB_NS2US(gethrtime() - req->start);
+    if (min_latency_us == 0 || sample < min_latency_us) {
+        min_latency_us = sample ? sample : 1;
+    }
+    latency_us = latency_us ? (latency_us * 7 + sample) / 8 : sample;
+
+    /* Adjust the window at most once per window's worth of responses */
+    if (++n_window_responses < window) {
+        return;
+    }
+    n_window_responses = 0;
+    uint64_t target = min_latency_us * 2 + DOCQ_LATENCY_SLACK_US;
+    if (latency_us <= target) {
+        if (window < max_pending_response) {
+            window++;
+        }
+    } else if (latency_us > target * 2) {
+        window = std::max<unsigned>(DOCQ_WINDOW_MIN, window - window / 4);
+    }
+}
+
+static void docreq_handler(void *arg)
+{
+    auto *q = reinterpret_cast<Queue *>(arg);
+    q->schedule();
 }
 
 /* Invokes the callback on all requests which are ready, until a request which
@@ -26,6 +26,7 @@
 #include <lcbio/lcbio.h>
 #include "sllist.h"
 #include "internalstructs.h"
+#include <vector>
 
 namespace lcb
 {
@@ -46,6 +47,19 @@ struct Queue {
     }
     void cancel();
     void check();
+
+    /**
+     * Schedule as many pending requests as the windows allow. Requests are
+     * issued in a single scheduling context, so that each server receives
+     * its share as one batch. This is normally invoked from the queue's timer.
+     */
+    void schedule();
+
+    /**
+     * Must be called by the operation callback when the response for a
+     * scheduled request arrives (before calling check())
+     */
+    void complete(DocRequest *);
     bool has_pending() const
     {
         return n_awaiting_response || n_awaiting_schedule;
@@ -76,28 +90,48 @@ struct Queue {
      * sent as a batch*/
     sllist_root pending_gets{};
 
-    /**This queue holds the requests which were already passed to lcb_get3().
-     * It is popped when the callback arrives (and is popped in order!) */
+    /**This queue holds all requests, in the order they were added. It is
+     * popped (in order!) as the responses arrive */
     sllist_root cb_queue{};
 
     unsigned n_awaiting_schedule;
     unsigned n_awaiting_response;
 
+    /** Maximum number of requests in flight, across all servers */
     unsigned max_pending_response;
     unsigned min_batch_size;
     unsigned cancelled;
     unsigned refcount;
+
+    /**
+     * Maximum number of requests in flight to a single server. This grows
+     * while the response times stay close to the lowest observed, and
+     * shrinks when they increase (i.e. the server is getting saturated)
+     */
+    unsigned window;
+    /** Number of requests in flight, by server index */
+    std::vector<unsigned> server_pending;
+    /** Smoothed response time, and the lowest observed (microseconds) */
+    uint64_t latency_us;
+    uint64_t min_latency_us;
+    /** Responses received since the window was last increased */
+    unsigned n_window_responses;
 };
 
 struct DocRequest {
     /* Callback. Must be first */
     lcb_RESPCALLBACK callback;
     sllist_node slnode;
+    /* Node in the pending_gets list */
+    sllist_node pending_node;
     Queue *parent;
     lcb_RESPGET_ docresp;
     /* To be filled in by the subclass */
     lcb_IOV docid;
     unsigned ready;
+    /* Set by the queue when the request is scheduled */
+    int server;
+    hrtime_t start;
 };
 
 } // namespace docreq
@@ -19,6 +19,7 @@
 #include "settings.h"
 #include <libcouchbase/couchbase.h>
 #include <libcouchbase/utils.h>
+#include <time.h>
 
 #ifndef HAVE_GETHRTIME
 
@@ -98,6 +99,32 @@ hrtime_t gethrtime(void)
 }
 #endif /* HAVE_GETHRTIME */
 
+hrtime_t gethrcputime(void)
+{
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    ULARGE_INTEGER k, u;
+    if (!GetThreadTimes(GetCurrentThread(), &created, &exited, &kernel, &user)) {
+        return 0;
+    }
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+    /* in units of 100ns */
+    return (k.QuadPart + u.QuadPart) * 100;
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+    struct timespec tm;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &tm) == -1) {
+        return 0;
+    }
+    return (((hrtime_t)tm.tv_sec) * 1000000000) + (hrtime_t)tm.tv_nsec;
+#else
+    /* the CPU time of the whole process */
+    return (hrtime_t)((double)clock() * (1.0e9 / CLOCKS_PER_SEC));
+#endif
+}
+
 /* Symbol usable so other subsystems can get the same idea of time the library
  * has. This will also allow us to stop shipping the 'gethrtime' file around.
  */
@@ -21,9 +21,13 @@
 #include "mc/compress.h"
 #include "trace.h"
 #include "collections.h"
+#include "hedge.h"
+#include "kvdispatch.h"
 
 #define LOGARGS(obj, lvl) (obj)->settings, "handler", LCB_LOG_##lvl, __FILE__, __LINE__
 
+using lcb::KvDispatch;
+using lcb::KvHandler;
 using lcb::MemcachedResponse;
 
 template <typename T>
@@ -447,7 +451,15 @@ static void H_get(mc_PIPELINE *pipeline, mc_PACKET *request, MemcachedResponse *
     LCBTRACE_KV_FINISH(pipeline, request, resp, response);
     TRACE_GET_END(o, request, response, &resp);
     record_kv_op_latency("get", o, request);
-    invoke_callback(request, o, &resp, LCB_CALLBACK_GET);
+    if (o->kv_hedge && (resp.ctx.rc == LCB_SUCCESS || resp.ctx.rc == LCB_ERR_DOCUMENT_NOT_FOUND)) {
+        o->kv_hedge->sample(gethrtime() - MCREQ_PKT_RDATA(request)->start);
+    }
+    if (request->flags & MCREQ_F_REQEXT) {
+        /* hedged or coalesced get, see lcb_cmdget_hedge() and LCB_CNTL_KV_COALESCE_GETS */
+        request->u_rdata.exdata->procs->handler(pipeline, request, resp.ctx.rc, &resp);
+    } else {
+        invoke_callback(request, o, &resp, LCB_CALLBACK_GET);
+    }
     free(freeptr);
 }
 
@@ -507,30 +519,6 @@ static void H_getreplica(mc_PIPELINE *pipeline, mc_PACKET *request, MemcachedRes
     free(freeptr);
 }
 
-static int lcb_sdresult_next(const lcb_RESPSUBDOC *resp, lcb_SDENTRY *ent, size_t *iter);
-
-static void lcb_sdresult_parse(lcb_RESPSUBDOC *resp, lcb_CALLBACK_TYPE type)
-{
-    std::vector<lcb_SDENTRY> results;
-    size_t iter = 0, oix = 0;
-    lcb_SDENTRY ent;
-    results.resize(resp->nres);
-
-    while (lcb_sdresult_next(resp, &ent, &iter)) {
-        size_t index = oix++;
-        if (type == LCB_CALLBACK_SDMUTATE) {
-            index = ent.index;
-        }
-        results[index] = ent;
-    }
-    if (resp->nres) {
-        resp->res = (lcb_SDENTRY *)calloc(resp->nres, sizeof(lcb_SDENTRY));
-        for (size_t ii = 0; ii < resp->nres; ii++) {
-            resp->res[ii] = results[ii];
-        }
-    }
-}
-
 static void H_subdoc(mc_PIPELINE *pipeline, mc_PACKET *request, MemcachedResponse *response, lcb_STATUS immerr)
 {
     lcb_INSTANCE *o = get_instance(pipeline);
@@ -538,7 +526,6 @@ static void H_subdoc(mc_PIPELINE *pipeline, mc_PACKET *request, MemcachedRespons
     lcb_CALLBACK_TYPE cbtype;
     init_resp(o, pipeline, response, request, immerr, &w.resp);
     w.resp.rflags |= LCB_RESP_F_FINAL;
-    w.resp.res = nullptr;
 
     /* For mutations, add the mutation token */
     switch (response->opcode()) {
@@ -561,7 +548,6 @@ static void H_subdoc(mc_PIPELINE *pipeline, mc_PACKET *request, MemcachedRespons
         if (w.resp.ctx.rc == LCB_SUCCESS) {
             w.resp.responses = response;
             w.resp.nres = MCREQ_PKT_RDATA(request)->nsubreq;
-            lcb_sdresult_parse(&w.resp, cbtype);
         } else {
             handle_error_info(response, &w);
         }
@@ -570,7 +556,6 @@ static void H_subdoc(mc_PIPELINE *pipeline, mc_PACKET *request, MemcachedRespons
         w.resp.rflags |= LCB_RESP_F_SDSINGLE;
         if (w.resp.ctx.rc == LCB_SUCCESS || LCB_ERROR_IS_SUBDOC(w.resp.ctx.rc)) {
             w.resp.responses = response;
-            lcb_sdresult_parse(&w.resp, cbtype);
         } else {
             handle_error_info(response, &w);
         }
@@ -581,7 +566,7 @@ static void H_subdoc(mc_PIPELINE *pipeline, mc_PACKET *request, MemcachedRespons
         record_kv_op_latency("mutate_in", o, request);
     }
     invoke_callback(request, o, &w.resp, cbtype);
-    free(w.resp.res);
+    lcb_sdresult_release(&w.resp);
 }
 
 static int sdlookup_next(const MemcachedResponse *response, lcb_SDENTRY *ent, size_t *iter)
@@ -590,7 +575,7 @@ static int sdlookup_next(const MemcachedResponse *response, lcb_SDENTRY *ent, si
     uint16_t rc;
     uint32_t vlen;
 
-    if (*iter == response->vallen()) {
+    if (*iter + 6 > response->vallen()) {
         return 0;
     }
 
@@ -602,6 +587,9 @@ static int sdlookup_next(const MemcachedResponse *response, lcb_SDENTRY *ent, si
 
     rc = ntohs(rc);
     vlen = ntohl(vlen);
+    if (vlen > response->vallen() - *iter - 6) {
+        return 0;
+    }
 
     ent->status = lcb_map_error(nullptr, rc);
     ent->nvalue = vlen;
@@ -665,8 +653,7 @@ static int sdmutate_next(const MemcachedResponse *response, lcb_SDENTRY *ent, si
 #undef ADVANCE_BUF
 }
 
-static int lcb_sdresult_next(const lcb_RESPSUBDOC *resp, lcb_SDENTRY *ent, size_t *iter)
-
+int lcb_sdresult_next(const lcb_RESPSUBDOC *resp, lcb_SDENTRY *ent, size_t *iter)
 {
     size_t iter_s = 0;
     const auto *response = reinterpret_cast<const MemcachedResponse *>(resp->responses);
@@ -698,6 +685,86 @@ static int lcb_sdresult_next(const lcb_RESPSUBDOC *resp, lcb_SDENTRY *ent, size_
     }
 }
 
+/**
+ * Record where the result of each spec starts (plus one, so that zero means
+ * that the server did not return anything for it)
+ */
+static void sdresult_index(lcb_RESPSUBDOC *resp, bool is_lookup)
+{
+    uint32_t *offsets = resp->offsets_inline;
+    if (resp->nres > LCB_SDRESULT_INLINE) {
+        offsets = resp->offsets = (uint32_t *)calloc(resp->nres, sizeof(uint32_t));
+    } else {
+        memset(offsets, 0, sizeof(resp->offsets_inline));
+    }
+
+    lcb_SDENTRY ent;
+    size_t begin = 0, iter = 0, seq = 0;
+    while (lcb_sdresult_next(resp, &ent, &iter)) {
+        size_t index = is_lookup ? seq++ : ent.index;
+        if (index < resp->nres) {
+            offsets[index] = static_cast<uint32_t>(begin + 1);
+        }
+        begin = iter;
+    }
+    resp->indexed = 1;
+}
+
+int lcb_sdresult_get(const lcb_RESPSUBDOC *cresp, size_t index, lcb_SDENTRY *ent)
+{
+    auto *resp = const_cast<lcb_RESPSUBDOC *>(cresp);
+    const auto *response = reinterpret_cast<const MemcachedResponse *>(resp->responses);
+    if (index >= resp->nres || response == nullptr) {
+        return 0;
+    }
+    bool is_lookup = response->opcode() == PROTOCOL_BINARY_CMD_SUBDOC_MULTI_LOOKUP;
+
+    if (!resp->indexed) {
+        // Results read in order (the usual case) are decoded as the cursor moves forward
+        while (index >= resp->cursor_low) {
+            size_t iter = resp->cursor;
+            if (!lcb_sdresult_next(resp, ent, &iter)) {
+                break;
+            }
+            size_t found = is_lookup ? resp->cursor_low : ent->index;
+            if (found == index) {
+                ent->index = static_cast<lcb_U8>(index);
+                return 1;
+            } else if (found > index) {
+                // mutation results are only returned for some of the specs
+                break;
+            }
+            resp->cursor = iter;
+            resp->cursor_low = found + 1;
+        }
+        if (index < resp->cursor_low) {
+            // moving backwards, so look up all the offsets once
+            sdresult_index(resp, is_lookup);
+        }
+    }
+
+    size_t offset = 0;
+    if (resp->indexed) {
+        offset = (resp->offsets ? resp->offsets : resp->offsets_inline)[index];
+    }
+    if (offset) {
+        size_t iter = offset - 1;
+        lcb_sdresult_next(resp, ent, &iter);
+    } else {
+        ent->status = LCB_SUCCESS;
+        ent->value = nullptr;
+        ent->nvalue = 0;
+    }
+    ent->index = static_cast<lcb_U8>(index);
+    return 1;
+}
+
+void lcb_sdresult_release(lcb_RESPSUBDOC *resp)
+{
+    free(resp->offsets);
+    resp->offsets = nullptr;
+}
+
 static void H_delete(mc_PIPELINE *pipeline, mc_PACKET *packet, MemcachedResponse *response, lcb_STATUS immerr)
 {
     lcb_INSTANCE *root = get_instance(pipeline);
@@ -1020,9 +1087,9 @@ static void H_select_bucket(mc_PIPELINE *pipeline, mc_PACKET *request, Memcached
     }
 }
 
-static void record_metrics(mc_PIPELINE *pipeline, mc_PACKET *req, MemcachedResponse *)
+static void record_metrics(lcb_INSTANCE *instance, mc_PACKET *req, KvDispatch::Entry &entry)
 {
-    lcb_INSTANCE *instance = get_instance(pipeline);
+    entry.count++;
     if (
 #ifdef HAVE_DTRACE
         1
@@ -1033,7 +1100,9 @@ static void record_metrics(mc_PIPELINE *pipeline, mc_PACKET *req, MemcachedRespo
         MCREQ_PKT_RDATA(req)->dispatch = gethrtime();
     }
     if (instance->kv_timings) {
-        lcb_histogram_record(instance->kv_timings, MCREQ_PKT_RDATA(req)->dispatch - MCREQ_PKT_RDATA(req)->start);
+        hrtime_t duration = MCREQ_PKT_RDATA(req)->dispatch - MCREQ_PKT_RDATA(req)->start;
+        lcb_histogram_record(instance->kv_timings, duration);
+        instance->kv_dispatch->record(entry, duration);
     }
 }
 
@@ -1046,96 +1115,87 @@ static void dispatch_ufwd_error(mc_PIPELINE *pipeline, mc_PACKET *req, lcb_STATU
     instance->callbacks.pktfwd(instance, MCREQ_PKT_COOKIE(req), immerr, &resp);
 }
 
+lcb::KvDispatch::KvDispatch() : entries_()
+{
+    static const struct {
+        uint8_t opcode;
+        KvHandler handler;
+    } builtin[] = {
+        {PROTOCOL_BINARY_CMD_GET, H_get},
+        {PROTOCOL_BINARY_CMD_GAT, H_get},
+        {PROTOCOL_BINARY_CMD_GET_LOCKED, H_get},
+        {PROTOCOL_BINARY_CMD_ADD, H_store},
+        {PROTOCOL_BINARY_CMD_REPLACE, H_store},
+        {PROTOCOL_BINARY_CMD_SET, H_store},
+        {PROTOCOL_BINARY_CMD_APPEND, H_store},
+        {PROTOCOL_BINARY_CMD_PREPEND, H_store},
+        {PROTOCOL_BINARY_CMD_INCREMENT, H_arithmetic},
+        {PROTOCOL_BINARY_CMD_DECREMENT, H_arithmetic},
+        {PROTOCOL_BINARY_CMD_SUBDOC_GET, H_subdoc},
+        {PROTOCOL_BINARY_CMD_SUBDOC_EXISTS, H_subdoc},
+        {PROTOCOL_BINARY_CMD_SUBDOC_ARRAY_ADD_UNIQUE, H_subdoc},
+        {PROTOCOL_BINARY_CMD_SUBDOC_ARRAY_PUSH_FIRST, H_subdoc},
+        {PROTOCOL_BINARY_CMD_SUBDOC_ARRAY_PUSH_LAST, H_subdoc},
+        {PROTOCOL_BINARY_CMD_SUBDOC_ARRAY_INSERT, H_subdoc},
+        {PROTOCOL_BINARY_CMD_SUBDOC_DICT_ADD, H_subdoc},
+        {PROTOCOL_BINARY_CMD_SUBDOC_DICT_UPSERT, H_subdoc},
+        {PROTOCOL_BINARY_CMD_SUBDOC_REPLACE, H_subdoc},
+        {PROTOCOL_BINARY_CMD_SUBDOC_DELETE, H_subdoc},
+        {PROTOCOL_BINARY_CMD_SUBDOC_COUNTER, H_subdoc},
+        {PROTOCOL_BINARY_CMD_SUBDOC_GET_COUNT, H_subdoc},
+        {PROTOCOL_BINARY_CMD_SUBDOC_MULTI_LOOKUP, H_subdoc},
+        {PROTOCOL_BINARY_CMD_SUBDOC_MULTI_MUTATION, H_subdoc},
+        {PROTOCOL_BINARY_CMD_OBSERVE, H_observe},
+        {PROTOCOL_BINARY_CMD_GET_REPLICA, H_getreplica},
+        {PROTOCOL_BINARY_CMD_UNLOCK_KEY, H_unlock},
+        {PROTOCOL_BINARY_CMD_DELETE, H_delete},
+        {PROTOCOL_BINARY_CMD_TOUCH, H_touch},
+        {PROTOCOL_BINARY_CMD_OBSERVE_SEQNO, H_observe_seqno},
+        {PROTOCOL_BINARY_CMD_STAT, H_stats},
+        {PROTOCOL_BINARY_CMD_NOOP, H_noop},
+        {PROTOCOL_BINARY_CMD_GET_CLUSTER_CONFIG, H_config},
+        {PROTOCOL_BINARY_CMD_SELECT_BUCKET, H_select_bucket},
+        {PROTOCOL_BINARY_CMD_COLLECTIONS_GET_MANIFEST, H_collections_get_manifest},
+        {PROTOCOL_BINARY_CMD_COLLECTIONS_GET_CID, H_collections_get_cid},
+        {PROTOCOL_BINARY_CMD_GET_META, H_exists},
+    };
+    for (const auto &ent : builtin) {
+        entries_[ent.opcode].handler = ent.handler;
+    }
+}
+
+lcb::KvDispatch::~KvDispatch()
+{
+    clear_timings();
+}
+
+void lcb::KvDispatch::clear_timings()
+{
+    for (auto &ent : entries_) {
+        if (ent.timings != nullptr) {
+            lcb_histogram_destroy(ent.timings);
+            ent.timings = nullptr;
+        }
+    }
+}
+
 int mcreq_dispatch_response(mc_PIPELINE *pipeline, mc_PACKET *req, MemcachedResponse *res, lcb_STATUS immerr)
 {
-    record_metrics(pipeline, req, res);
+    lcb_INSTANCE *instance = get_instance(pipeline);
+    KvDispatch::Entry &entry = instance->kv_dispatch->entry(res->opcode());
+    record_metrics(instance, req, entry);
 
     if (req->flags & MCREQ_F_UFWD) {
         dispatch_ufwd_error(pipeline, req, immerr);
         return 0;
     }
 
-#define INVOKE_OP(handler)                                                                                             \
-    handler(pipeline, req, res, immerr);                                                                               \
-    return 0;                                                                                                          \
-    break
-
-    switch (res->opcode()) {
-        case PROTOCOL_BINARY_CMD_GET:
-        case PROTOCOL_BINARY_CMD_GAT:
-        case PROTOCOL_BINARY_CMD_GET_LOCKED:
-            INVOKE_OP(H_get);
-
-        case PROTOCOL_BINARY_CMD_ADD:
-        case PROTOCOL_BINARY_CMD_REPLACE:
-        case PROTOCOL_BINARY_CMD_SET:
-        case PROTOCOL_BINARY_CMD_APPEND:
-        case PROTOCOL_BINARY_CMD_PREPEND:
-            INVOKE_OP(H_store);
-
-        case PROTOCOL_BINARY_CMD_INCREMENT:
-        case PROTOCOL_BINARY_CMD_DECREMENT:
-            INVOKE_OP(H_arithmetic);
-
-        case PROTOCOL_BINARY_CMD_SUBDOC_GET:
-        case PROTOCOL_BINARY_CMD_SUBDOC_EXISTS:
-        case PROTOCOL_BINARY_CMD_SUBDOC_ARRAY_ADD_UNIQUE:
-        case PROTOCOL_BINARY_CMD_SUBDOC_ARRAY_PUSH_FIRST:
-        case PROTOCOL_BINARY_CMD_SUBDOC_ARRAY_PUSH_LAST:
-        case PROTOCOL_BINARY_CMD_SUBDOC_ARRAY_INSERT:
-        case PROTOCOL_BINARY_CMD_SUBDOC_DICT_ADD:
-        case PROTOCOL_BINARY_CMD_SUBDOC_DICT_UPSERT:
-        case PROTOCOL_BINARY_CMD_SUBDOC_REPLACE:
-        case PROTOCOL_BINARY_CMD_SUBDOC_DELETE:
-        case PROTOCOL_BINARY_CMD_SUBDOC_COUNTER:
-        case PROTOCOL_BINARY_CMD_SUBDOC_GET_COUNT:
-        case PROTOCOL_BINARY_CMD_SUBDOC_MULTI_LOOKUP:
-        case PROTOCOL_BINARY_CMD_SUBDOC_MULTI_MUTATION:
-            INVOKE_OP(H_subdoc);
-
-        case PROTOCOL_BINARY_CMD_OBSERVE:
-            INVOKE_OP(H_observe);
-
-        case PROTOCOL_BINARY_CMD_GET_REPLICA:
-            INVOKE_OP(H_getreplica);
-
-        case PROTOCOL_BINARY_CMD_UNLOCK_KEY:
-            INVOKE_OP(H_unlock);
-
-        case PROTOCOL_BINARY_CMD_DELETE:
-            INVOKE_OP(H_delete);
-
-        case PROTOCOL_BINARY_CMD_TOUCH:
-            INVOKE_OP(H_touch);
-
-        case PROTOCOL_BINARY_CMD_OBSERVE_SEQNO:
-            INVOKE_OP(H_observe_seqno);
-
-        case PROTOCOL_BINARY_CMD_STAT:
-            INVOKE_OP(H_stats);
-
-        case PROTOCOL_BINARY_CMD_NOOP:
-            INVOKE_OP(H_noop);
-
-        case PROTOCOL_BINARY_CMD_GET_CLUSTER_CONFIG:
-            INVOKE_OP(H_config);
-
-        case PROTOCOL_BINARY_CMD_SELECT_BUCKET:
-            INVOKE_OP(H_select_bucket);
-
-        case PROTOCOL_BINARY_CMD_COLLECTIONS_GET_MANIFEST:
-            INVOKE_OP(H_collections_get_manifest);
-
-        case PROTOCOL_BINARY_CMD_COLLECTIONS_GET_CID:
-            INVOKE_OP(H_collections_get_cid);
-
-        case PROTOCOL_BINARY_CMD_GET_META:
-            INVOKE_OP(H_exists);
-
-        default:
-            fprintf(stderr, "COUCHBASE: Received unknown opcode=0x%x\n", res->opcode());
-            return -1;
+    if (entry.handler == nullptr) {
+        fprintf(stderr, "COUCHBASE: Received unknown opcode=0x%x\n", res->opcode());
+        return -1;
     }
+    entry.handler(pipeline, req, res, immerr);
+    return 0;
 }
 
 const lcb_MUTATION_TOKEN *lcb_resp_get_mutation_token(int cbtype, const lcb_RESPBASE *rb)
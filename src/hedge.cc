@@ -0,0 +1,72 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+
+#include "config.h"
+#include "hedge.h"
+#include "settings.h"
+
+#include <algorithm>
+
+using namespace lcb;
+
+const size_t HedgeTracker::NSAMPLES;
+
+namespace
+{
+/** Minimum number of samples before the percentile is used */
+const size_t MIN_SAMPLES = 16;
+/** The percentile is recomputed after this many new samples */
+const unsigned UPDATE_INTERVAL = 32;
+/** Delay used until enough samples are known */
+const uint32_t INITIAL_DELAY_US = LCB_MS2US(10);
+/** Lower bound for the computed delay */
+const uint32_t MIN_DELAY_US = 500;
+} // namespace
+
+void HedgeTracker::sample(uint64_t elapsed)
+{
+    uint64_t us = LCB_NS2US(elapsed);
+    samples_[next_] = us > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(us);
+    next_ = (next_ + 1) % NSAMPLES;
+    if (nsamples_ < NSAMPLES) {
+        nsamples_++;
+    }
+    if (++since_update_ >= UPDATE_INTERVAL || nsamples_ == MIN_SAMPLES) {
+        update();
+    }
+}
+
+void HedgeTracker::update()
+{
+    since_update_ = 0;
+    scratch_.assign(samples_.begin(), samples_.begin() + nsamples_);
+    auto nth = scratch_.begin() + (nsamples_ * 95) / 100;
+    std::nth_element(scratch_.begin(), nth, scratch_.end());
+    p95_us_ = *nth;
+}
+
+uint32_t HedgeTracker::delay(uint32_t configured) const
+{
+    if (configured) {
+        return configured;
+    }
+    if (nsamples_ < MIN_SAMPLES) {
+        return INITIAL_DELAY_US;
+    }
+    return std::max(p95_us_, MIN_DELAY_US);
+}
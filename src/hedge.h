@@ -0,0 +1,81 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+
+#ifndef LCB_HEDGE_H
+#define LCB_HEDGE_H
+
+#include <libcouchbase/couchbase.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lcb
+{
+
+/**
+ * Keeps track of recent KV get response times, and of the replica reads sent
+ * by hedged gets (see lcb_cmdget_hedge()).
+ *
+ * If no hedge delay is configured, the replica read is sent once the get has
+ * taken longer than the 95th percentile of the recent response times, so that
+ * only the slowest few percent of the gets are duplicated.
+ */
+class HedgeTracker
+{
+  public:
+    /** Number of response times kept */
+    static const size_t NSAMPLES = 256;
+
+    HedgeTracker() : issued(0), won(0), samples_(NSAMPLES), nsamples_(0), next_(0), since_update_(0), p95_us_(0)
+    {
+    }
+
+    /** Record the response time (in nanoseconds) of a get */
+    void sample(uint64_t elapsed);
+
+    /**
+     * @param configured the hedge delay set by the user (microseconds), or 0
+     * @return the time (in microseconds) after which a replica read is sent
+     */
+    uint32_t delay(uint32_t configured) const;
+
+    /** @return 95th percentile of the recent response times, in microseconds */
+    uint32_t percentile() const
+    {
+        return p95_us_;
+    }
+
+    /** Replica reads sent */
+    uint64_t issued;
+    /** Hedged gets answered by the replica */
+    uint64_t won;
+
+  private:
+    void update();
+
+    std::vector<uint32_t> samples_;
+    std::vector<uint32_t> scratch_;
+    size_t nsamples_;
+    size_t next_;
+    unsigned since_update_;
+    uint32_t p95_us_;
+};
+
+} // namespace lcb
+
+#endif /* LCB_HEDGE_H */
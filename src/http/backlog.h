@@ -0,0 +1,140 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LCB_HTTP_BACKLOG_H
+#define LCB_HTTP_BACKLOG_H
+
+#include <cstddef>
+#include <string>
+
+namespace lcb
+{
+namespace http
+{
+
+/**
+ * Body data of a streaming response which was received but not yet passed to
+ * the callback, either because the application paused delivery, or because
+ * data kept while it was paused is still being flushed.
+ *
+ * The backlog decides when the socket may be read from: reading stops
+ * automatically as soon as the undelivered data reaches the high-water mark,
+ * and restarts once it was drained below it. The memory held by a request is
+ * therefore bounded by the high-water mark plus one network read, however
+ * slowly the application consumes the rows.
+ *
+ * @code{.cpp}
+ * if (backlog.must_queue()) {
+ *     backlog.append(buf, nbuf);
+ * } else {
+ *     deliver(buf, nbuf);
+ * }
+ * lcbio_ctx_rwant(ctx, backlog.wants_read());
+ * @endcode
+ */
+class StreamBacklog
+{
+  public:
+    explicit StreamBacklog(size_t hwm = 0) : hwm_(hwm) {}
+
+    /** Stop passing data to the callback (see must_queue()) */
+    void pause()
+    {
+        paused_ = true;
+    }
+
+    /** Allow passing data to the callback again, once the backlog is flushed */
+    void resume()
+    {
+        paused_ = false;
+    }
+
+    bool paused() const
+    {
+        return paused_;
+    }
+
+    /**
+     * @return whether new data must be appended rather than passed to the
+     * callback, so that it is delivered in order
+     */
+    bool must_queue() const
+    {
+        return paused_ || !data_.empty();
+    }
+
+    /** @return whether more data may be read from the network */
+    bool wants_read() const
+    {
+        if (!paused_ && data_.empty()) {
+            return true;
+        }
+        return data_.size() < hwm_;
+    }
+
+    void append(const char *buf, size_t nbuf)
+    {
+        data_.append(buf, nbuf);
+        if (data_.size() > peak_) {
+            peak_ = data_.size();
+        }
+    }
+
+    const char *data() const
+    {
+        return data_.c_str();
+    }
+
+    size_t size() const
+    {
+        return data_.size();
+    }
+
+    bool empty() const
+    {
+        return data_.empty();
+    }
+
+    /** Drop the first `n` bytes, once they were passed to the callback */
+    void consume(size_t n)
+    {
+        data_.erase(0, n);
+    }
+
+    /** Drop all the data (e.g. when the request is retried) */
+    void clear()
+    {
+        data_.clear();
+    }
+
+    /** @return the largest amount of data which was kept at any time */
+    size_t peak() const
+    {
+        return peak_;
+    }
+
+  private:
+    std::string data_;
+    size_t hwm_;
+    size_t peak_{0};
+    bool paused_{false};
+};
+
+} // namespace http
+} // namespace lcb
+
+#endif /* LCB_HTTP_BACKLOG_H */
@@ -25,6 +25,8 @@
 #include <lcbht/lcbht.h>
 #include "contrib/http_parser/http_parser.h"
 #include "http.h"
+#include "inflate.h"
+#include "backlog.h"
 #include <string>
 #include <vector>
 #include <set>
@@ -60,6 +62,29 @@ struct Request {
     /** Resume previously paused IO */
     void resume();
 
+    /**
+     * Stop passing response data to the callback. This is only meaningful for
+     * streaming requests. Data received while delivery is paused is kept
+     * until resume_delivery() is called; reading from the network stops as
+     * soon as the `http_stream_hwm` setting is reached (see StreamBacklog).
+     *
+     * Note that data which was already being passed to the callback at the
+     * time of the call (i.e. the current network chunk) is still delivered.
+     */
+    void pause_delivery();
+
+    /**
+     * Resume passing response data to the callback. Any data received while
+     * delivery was paused is passed to the callback asynchronously.
+     */
+    void resume_delivery();
+
+    /**
+     * @return whether the socket should be read from, considering both pause()
+     * and pause_delivery()
+     */
+    bool wants_read() const;
+
     /** Cancel and finish this request, suppressing callbacks */
     void cancel();
 
@@ -175,9 +200,27 @@ struct Request {
      */
     void close_io();
 
+    /**
+     * Parse response data read from the network, passing the body to the
+     * callback (or the backlog) as it arrives
+     * @return the parser state (lcb::htparse::Parser::S_*)
+     */
+    unsigned handle_parse_chunked(const char *buf, unsigned nbuf);
+
     // Helper functions for parsing response data from network
-    inline unsigned handle_parse_chunked(const char *buf, unsigned nbuf);
     inline void assign_response_headers(const lcb::htparse::Response &);
+    inline void deliver_body(const char *buf, unsigned nbuf);
+    inline void invoke_chunk(const char *buf, unsigned nbuf);
+
+    /** Passes data received while delivery was paused to the callback */
+    void flush_backlog();
+    inline bool inflate_body(const char *buf, unsigned nbuf);
+
+    /**
+     * Whether the response for this request may be compressed, i.e. if the
+     * `Accept-Encoding` header should be sent.
+     */
+    bool accepts_compression() const;
 
     /**
      * Called when a redirect has happened. pending_redirect must not be empty.
@@ -209,6 +252,21 @@ struct Request {
      **/
     void finish_or_retry(lcb_STATUS rc);
 
+    /**
+     * Account this request to the endpoint it was sent to (see
+     * EndpointSelector). Called once the request has been submitted.
+     */
+    void track_endpoint();
+
+    /** Record the response time, once the response headers are received */
+    void endpoint_responded();
+
+    /**
+     * Remove this request from the endpoint's requests in flight.
+     * @param failed whether the request failed on this endpoint
+     */
+    void release_endpoint(bool failed);
+
     /**
      * Change the callback for this request. This is used to indicate that
      * a custom internal callback is used, rather than the one installed via
@@ -333,13 +391,46 @@ struct Request {
     /** HTTP Protocol parser */
     lcb::htparse::Parser *parser;
 
+    /** Decoder for the body, if the current response is compressed */
+    Inflater *inflater;
+
+    /** Response data received while delivery was paused */
+    StreamBacklog backlog;
+
+    /**
+     * Set if the response was complete while data was still kept in
+     * ::backlog. The final callback is invoked once it has been flushed.
+     */
+    bool backlog_done;
+
+    lcb::io::Timer< Request, &Request::flush_backlog > flush_timer;
+
     /** overrides default timeout if nonzero */
     const uint32_t user_timeout;
 
     hrtime_t start; /**< Start time */
     lcbio_SERVICE service;
+
+    /** `host:port` the request is accounted to, if any. See track_endpoint() */
+    std::string tracked_endpoint;
+    /** Time the request was sent to ::tracked_endpoint */
+    hrtime_t tracked_start;
+    /** Whether the response time was already recorded for ::tracked_endpoint */
+    bool tracked_responded;
 };
 
+/**
+ * @return the socket service type for requests of this type, or
+ * LCBIO_SERVICE_MGMT for types without a dedicated service
+ */
+lcbio_SERVICE httype2service(unsigned httype);
+
+/**
+ * Open the connections configured with the `minidle` pool option for each
+ * node of the current cluster configuration (see lcb::io::Pool::warmup())
+ */
+void warmup_pool(lcb_INSTANCE *instance);
+
 } // namespace http
 } // namespace lcb
 
@@ -19,6 +19,7 @@
 #include "bucketconfig/clconfig.h"
 #include "http/http.h"
 #include "http/http-priv.h"
+#include "http/selector.h"
 #include "auth-priv.h"
 #include "trace.h"
 #include "strcodecs/strcodecs.h"
@@ -201,6 +202,24 @@ void Request::decref()
     delete this;
 }
 
+static lcbvb_SVCTYPE httype2svctype(unsigned httype)
+{
+    switch (httype) {
+        case LCB_HTTP_TYPE_VIEW:
+            return LCBVB_SVCTYPE_VIEWS;
+        case LCB_HTTP_TYPE_QUERY:
+            return LCBVB_SVCTYPE_QUERY;
+        case LCB_HTTP_TYPE_SEARCH:
+            return LCBVB_SVCTYPE_SEARCH;
+        case LCB_HTTP_TYPE_ANALYTICS:
+            return LCBVB_SVCTYPE_ANALYTICS;
+        case LCB_HTTP_TYPE_EVENTING:
+            return LCBVB_SVCTYPE_EVENTING;
+        default:
+            return LCBVB_SVCTYPE__MAX;
+    }
+}
+
 void Request::finish_or_retry(lcb_STATUS rc)
 {
     if (rc == LCB_ERR_TIMEOUT) {
@@ -221,6 +240,9 @@ void Request::finish_or_retry(lcb_STATUS rc)
         return;
     }
 
+    // Account the failure before choosing the next node
+    release_endpoint(true);
+
     // See if we can find an API node.
     const char *nextnode = get_api_node();
     if (!nextnode) {
@@ -311,6 +333,8 @@ void Request::finish(lcb_STATUS error)
         maybe_refresh_config(error);
     }
 
+    release_endpoint(error != LCB_SUCCESS || (parser && parser->get_cur_response().status >= 500));
+
     /* And this one too */
     if ((status & CBINVOKED) == 0) {
         lcb_RESPHTTP resp{};
@@ -367,6 +391,7 @@ lcb_STATUS Request::submit()
 
     // Stop any pending socket/request
     close_io();
+    release_endpoint(false);
 
     if (host.size() > sizeof reqhost.host || port.size() > sizeof reqhost.port) {
         decref();
@@ -421,14 +446,58 @@ lcb_STATUS Request::submit()
         } else {
             parser = new lcb::htparse::Parser(instance->settings);
         }
+        delete inflater;
+        inflater = nullptr;
+        backlog.clear();
+        backlog_done = false;
         response_headers.clear();
         response_headers_clist.clear();
+        track_endpoint();
         TRACE_HTTP_BEGIN(this);
     }
 
     return rc;
 }
 
+void Request::track_endpoint()
+{
+    const lcbvb_SVCTYPE svc = httype2svctype(reqtype);
+    if (svc == LCBVB_SVCTYPE__MAX || instance->http_selector == nullptr) {
+        return;
+    }
+    if (ipv6) {
+        tracked_endpoint = "[" + host + "]:" + port;
+    } else {
+        tracked_endpoint = host + ":" + port;
+    }
+    tracked_responded = false;
+    tracked_start = instance->http_selector->start(svc, tracked_endpoint);
+}
+
+void Request::endpoint_responded()
+{
+    if (tracked_endpoint.empty() || tracked_responded) {
+        return;
+    }
+    tracked_responded = true;
+    instance->http_selector->sample(httype2svctype(reqtype), tracked_endpoint, gethrtime() - tracked_start);
+}
+
+void Request::release_endpoint(bool failed)
+{
+    if (tracked_endpoint.empty()) {
+        return;
+    }
+    const lcbvb_SVCTYPE svc = httype2svctype(reqtype);
+    if (failed && !tracked_responded) {
+        // Count the time until failure (e.g. connection refused, timeout),
+        // so that the node is less likely to be chosen
+        instance->http_selector->sample(svc, tracked_endpoint, gethrtime() - tracked_start);
+    }
+    instance->http_selector->finish(svc, tracked_endpoint, failed, tracked_start);
+    tracked_endpoint.clear();
+}
+
 void Request::assign_from_urlfield(http_parser_url_fields field, std::string &target)
 {
     target = url.substr(url_info.field_data[field].off, url_info.field_data[field].len);
@@ -524,24 +593,6 @@ void Request::redirect()
     }
 }
 
-static lcbvb_SVCTYPE httype2svctype(unsigned httype)
-{
-    switch (httype) {
-        case LCB_HTTP_TYPE_VIEW:
-            return LCBVB_SVCTYPE_VIEWS;
-        case LCB_HTTP_TYPE_QUERY:
-            return LCBVB_SVCTYPE_QUERY;
-        case LCB_HTTP_TYPE_SEARCH:
-            return LCBVB_SVCTYPE_SEARCH;
-        case LCB_HTTP_TYPE_ANALYTICS:
-            return LCBVB_SVCTYPE_ANALYTICS;
-        case LCB_HTTP_TYPE_EVENTING:
-            return LCBVB_SVCTYPE_EVENTING;
-        default:
-            return LCBVB_SVCTYPE__MAX;
-    }
-}
-
 const char *Request::get_api_node(lcb_STATUS &rc)
 {
     if (!is_data_request()) {
@@ -564,7 +615,7 @@ const char *Request::get_api_node(lcb_STATUS &rc)
     }
     used_nodes.resize(LCBVB_NSERVERS(vbc));
 
-    int ix = lcbvb_get_randhost_ex(vbc, svc, mode, &used_nodes[0]);
+    int ix = instance->http_selector->select(vbc, svc, mode, &used_nodes[0]);
     if (ix < 0) {
         rc = LCB_ERR_UNSUPPORTED_OPERATION;
         return nullptr;
@@ -667,6 +718,9 @@ lcb_STATUS Request::setup_inputs(const lcb_CMDHTTP *cmd)
     }
 
     add_header("Accept", "application/json");
+    if (accepts_compression()) {
+        add_header("Accept-Encoding", "gzip, deflate");
+    }
     if (!username.empty()) {
         char auth[256];
         std::string upassbuf;
@@ -691,10 +745,12 @@ lcb_STATUS Request::setup_inputs(const lcb_CMDHTTP *cmd)
 
 Request::Request(lcb_INSTANCE *instance_, const void *cookie, const lcb_CMDHTTP *cmd)
     : instance(instance_), body(cmd->body, cmd->body + cmd->nbody), method(cmd->method),
-      chunked(cmd->cmdflags & LCB_CMDHTTP_F_STREAM), paused(false), command_cookie(cookie), refcount(1), redircount(0),
-      passed_data(false), last_vbcrev(-1), reqtype(cmd->type), status(ONGOING),
+      chunked(cmd->cmdflags & LCB_CMDHTTP_F_STREAM), paused(false), command_cookie(cookie),
+      refcount(1), redircount(0), passed_data(false), last_vbcrev(-1), reqtype(cmd->type), status(ONGOING),
       callback(lcb_find_callback(instance, LCB_CALLBACK_HTTP)), io(instance->iotable), ioctx(nullptr), timer(nullptr),
-      parser(nullptr), user_timeout(cmd->cmdflags & LCB_CMDHTTP_F_CASTMO ? cmd->cas : 0)
+      parser(nullptr), inflater(nullptr), backlog(LCBT_SETTING(instance_, http_stream_hwm)), backlog_done(false),
+      flush_timer(instance_->iotable, this),
+      user_timeout(cmd->cmdflags & LCB_CMDHTTP_F_CASTMO ? cmd->cas : 0), tracked_start(0), tracked_responded(false)
 {
     memset(&creq, 0, sizeof creq);
 }
@@ -704,6 +760,7 @@ Request::~Request()
     close_io();
 
     delete parser;
+    delete inflater;
 
     if (timer) {
         lcbio_timer_destroy(timer);
@@ -711,6 +768,21 @@ Request::~Request()
     }
 }
 
+bool Request::accepts_compression() const
+{
+    if (!LCBT_SETTING(instance, http_compression)) {
+        return false;
+    }
+    switch (reqtype) {
+        case LCB_HTTP_TYPE_QUERY:
+        case LCB_HTTP_TYPE_ANALYTICS:
+        case LCB_HTTP_TYPE_SEARCH:
+            return true;
+        default:
+            return false;
+    }
+}
+
 uint32_t Request::timeout() const
 {
     if (user_timeout) {
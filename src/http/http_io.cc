@@ -21,6 +21,7 @@
 #include "http.h"
 #include "ctx-log-inl.h"
 #include <lcbio/ssl.h>
+#include <algorithm>
 
 #define LOGFMT CTX_LOGFMT
 #define LOGID(req) CTX_LOGID(req->ioctx)
@@ -41,6 +42,49 @@ void Request::assign_response_headers(const lcb::htparse::Response &resp)
     response_headers_clist.push_back(nullptr);
 }
 
+void Request::invoke_chunk(const char *buf, unsigned nbuf)
+{
+    lcb_RESPHTTP htresp{};
+    init_resp(&htresp);
+    htresp.ctx.body = buf;
+    htresp.ctx.body_len = nbuf;
+    htresp.ctx.rc = LCB_SUCCESS;
+    passed_data = true;
+    callback(instance, LCB_CALLBACK_HTTP, (const lcb_RESPBASE *)&htresp);
+}
+
+void Request::deliver_body(const char *buf, unsigned nbuf)
+{
+    if (!chunked) {
+        parser->get_cur_response().body.append(buf, nbuf);
+    } else if (backlog.must_queue()) {
+        // Either paused, or older data is still waiting to be flushed
+        backlog.append(buf, nbuf);
+        passed_data = true;
+    } else {
+        invoke_chunk(buf, nbuf);
+    }
+}
+
+bool Request::inflate_body(const char *buf, unsigned nbuf)
+{
+    const char *out = nullptr;
+    int nout;
+
+    inflater->input(buf, nbuf);
+    while ((nout = inflater->next(&out)) > 0) {
+        deliver_body(out, nout);
+        if (!is_ongoing()) {
+            return true;
+        }
+    }
+    if (nout < 0) {
+        lcb_log(LOGARGS(this, ERR), LOGFMT "Failed to decompress HTTP response body", LOGID(this));
+        return false;
+    }
+    return true;
+}
+
 unsigned Request::handle_parse_chunked(const char *buf, unsigned nbuf)
 {
     unsigned parse_state, diff;
@@ -58,6 +102,7 @@ unsigned Request::handle_parse_chunked(const char *buf, unsigned nbuf)
         /* Got headers now for the first time */
         if (diff & Parser::S_HEADER) {
             assign_response_headers(res);
+            endpoint_responded();
             if (res.status >= 300 && res.status <= 400) {
                 const char *redir = res.get_header_value("Location");
                 if (redir != nullptr) {
@@ -65,6 +110,9 @@ unsigned Request::handle_parse_chunked(const char *buf, unsigned nbuf)
                     return Parser::S_DONE;
                 }
             }
+            if (accepts_compression()) {
+                inflater = Inflater::create(res.get_header_value("Content-Encoding"));
+            }
         }
 
         if (parse_state & Parser::S_ERROR) {
@@ -73,17 +121,10 @@ unsigned Request::handle_parse_chunked(const char *buf, unsigned nbuf)
         }
 
         if (nbody) {
-            if (chunked) {
-                lcb_RESPHTTP htresp{};
-                init_resp(&htresp);
-                htresp.ctx.body = rbody;
-                htresp.ctx.body_len = nbody;
-                htresp.ctx.rc = LCB_SUCCESS;
-                passed_data = true;
-                callback(instance, LCB_CALLBACK_HTTP, (const lcb_RESPBASE *)&htresp);
-
-            } else {
-                res.body.append(rbody, nbody);
+            if (inflater == nullptr) {
+                deliver_body(rbody, nbody);
+            } else if (!inflate_body(rbody, nbody)) {
+                return parse_state | Parser::S_ERROR;
             }
         }
 
@@ -92,6 +133,21 @@ unsigned Request::handle_parse_chunked(const char *buf, unsigned nbuf)
     } while ((parse_state & Parser::S_DONE) == 0 && is_ongoing() && nbuf);
 
     if ((parse_state & Parser::S_DONE) && is_ongoing()) {
+        if (inflater) {
+            if (!inflater->done()) {
+                lcb_log(LOGARGS(this, ERR), LOGFMT "Compressed HTTP response body is truncated", LOGID(this));
+                return parse_state | Parser::S_ERROR;
+            }
+            lcb_log(LOGARGS(this, DEBUG), LOGFMT "Inflated %llu bytes of response body into %llu bytes in %.3fms",
+                    LOGID(this), (unsigned long long)inflater->bytes_in(), (unsigned long long)inflater->bytes_out(),
+                    inflater->elapsed() / 1e6);
+        }
+        if (!backlog.empty()) {
+            // The final callback is invoked by flush_backlog()
+            backlog_done = true;
+            return parse_state;
+        }
+
         lcb_RESPHTTP resp{};
         if (chunked) {
             buf = nullptr;
@@ -162,7 +218,7 @@ static void io_read(lcbio_CTX *ctx, unsigned nr)
         req->finish(LCB_SUCCESS);
     } else {
         // Pending
-        lcbio_ctx_rwant(ctx, req->paused ? 0 : 1);
+        lcbio_ctx_rwant(ctx, req->wants_read());
         lcbio_ctx_schedule(ctx);
     }
 
@@ -190,10 +246,70 @@ void Request::resume()
         return;
     }
     paused = false;
-    lcbio_ctx_rwant(ioctx, 1);
+    lcbio_ctx_rwant(ioctx, wants_read());
     lcbio_ctx_schedule(ioctx);
 }
 
+bool Request::wants_read() const
+{
+    if (paused || backlog_done) {
+        return false;
+    }
+    return backlog.wants_read();
+}
+
+void Request::pause_delivery()
+{
+    if (backlog.paused()) {
+        return;
+    }
+    backlog.pause();
+    if (ioctx && !wants_read()) {
+        lcbio_ctx_rwant(ioctx, 0);
+        lcbio_ctx_schedule(ioctx);
+    }
+}
+
+void Request::resume_delivery()
+{
+    if (!backlog.paused()) {
+        return;
+    }
+    backlog.resume();
+    if (!backlog.empty()) {
+        flush_timer.signal();
+    } else if (ioctx && wants_read()) {
+        lcbio_ctx_rwant(ioctx, 1);
+        lcbio_ctx_schedule(ioctx);
+    }
+}
+
+void Request::flush_backlog()
+{
+    // Deliver in pieces, so that pausing again from within the callback takes
+    // effect without having to wait for the whole backlog to be processed
+    static const size_t piece_size = 16384;
+    size_t offset = 0;
+
+    incref();
+    while (offset < backlog.size() && !backlog.paused() && is_ongoing()) {
+        unsigned npiece = static_cast<unsigned>(std::min(piece_size, backlog.size() - offset));
+        invoke_chunk(backlog.data() + offset, npiece);
+        offset += npiece;
+    }
+    backlog.consume(offset);
+
+    if (is_ongoing()) {
+        if (backlog.empty() && backlog_done) {
+            finish(LCB_SUCCESS);
+        } else if (ioctx) {
+            lcbio_ctx_rwant(ioctx, wants_read());
+            lcbio_ctx_schedule(ioctx);
+        }
+    }
+    decref();
+}
+
 static void io_error(lcbio_CTX *ctx, lcb_STATUS err)
 {
     auto *req = reinterpret_cast<Request *>(lcbio_ctx_data(ctx));
@@ -206,6 +322,66 @@ static void request_timed_out(void *arg)
     (reinterpret_cast<Request *>(arg))->finish(LCB_ERR_TIMEOUT);
 }
 
+lcbio_SERVICE lcb::http::httype2service(unsigned httype)
+{
+    switch (httype) {
+        case LCB_HTTP_TYPE_QUERY:
+            return LCBIO_SERVICE_N1QL;
+        case LCB_HTTP_TYPE_VIEW:
+            return LCBIO_SERVICE_VIEW;
+        case LCB_HTTP_TYPE_SEARCH:
+            return LCBIO_SERVICE_FTS;
+        case LCB_HTTP_TYPE_ANALYTICS:
+            return LCBIO_SERVICE_ANALYTICS;
+        case LCB_HTTP_TYPE_EVENTING:
+            return LCBIO_SERVICE_EVENTING;
+        default:
+            return LCBIO_SERVICE_MGMT;
+    }
+}
+
+void lcb::http::warmup_pool(lcb_INSTANCE *instance)
+{
+    static const struct {
+        lcbvb_SVCTYPE type;
+        lcbio_SERVICE service;
+    } services[] = {
+        {LCBVB_SVCTYPE_QUERY, LCBIO_SERVICE_N1QL},
+        {LCBVB_SVCTYPE_SEARCH, LCBIO_SERVICE_FTS},
+        {LCBVB_SVCTYPE_ANALYTICS, LCBIO_SERVICE_ANALYTICS},
+        {LCBVB_SVCTYPE_VIEWS, LCBIO_SERVICE_VIEW},
+    };
+
+    lcbio_MGR *pool = instance->http_sockpool;
+    lcbvb_CONFIG *vbc = LCBT_VBCONFIG(instance);
+    if (vbc == nullptr || pool->get_options().maxidle == 0) {
+        // Connections are not reused if pooling is disabled
+        return;
+    }
+
+    const lcbvb_SVCMODE mode = LCBT_SETTING_SVCMODE(instance);
+    for (const auto &svc : services) {
+        if (pool->get_service_options(svc.service).minidle == 0) {
+            continue;
+        }
+        for (unsigned ii = 0; ii < LCBVB_NSERVERS(vbc); ii++) {
+            unsigned port = lcbvb_get_port(vbc, ii, svc.type, mode);
+            const char *hostname = lcbvb_get_hostname(vbc, ii);
+            if (port == 0 || hostname == nullptr) {
+                continue;
+            }
+            lcb_host_t host{};
+            if (strlen(hostname) >= sizeof(host.host)) {
+                continue;
+            }
+            strcpy(host.host, hostname);
+            snprintf(host.port, sizeof(host.port), "%u", port);
+            host.ipv6 = strchr(hostname, ':') != nullptr;
+            pool->warmup(host, LCBT_SETTING(instance, config_node_timeout), svc.service);
+        }
+    }
+}
+
 static void on_connected(lcbio_SOCKET *sock, void *arg, lcb_STATUS err, lcbio_OSERR syserr)
 {
     auto *req = reinterpret_cast<Request *>(arg);
@@ -224,32 +400,13 @@ static void on_connected(lcbio_SOCKET *sock, void *arg, lcb_STATUS err, lcbio_OS
     procs.cb_err = io_error;
     procs.cb_read = io_read;
     req->ioctx = lcbio_ctx_new(sock, arg, &procs);
-    switch (req->reqtype) {
-        case LCB_HTTP_TYPE_QUERY:
-            sock->service = LCBIO_SERVICE_N1QL;
-            break;
-        case LCB_HTTP_TYPE_VIEW:
-            sock->service = LCBIO_SERVICE_VIEW;
-            break;
-        case LCB_HTTP_TYPE_SEARCH:
-            sock->service = LCBIO_SERVICE_FTS;
-            break;
-        case LCB_HTTP_TYPE_ANALYTICS:
-            sock->service = LCBIO_SERVICE_ANALYTICS;
-            break;
-        case LCB_HTTP_TYPE_EVENTING:
-            sock->service = LCBIO_SERVICE_EVENTING;
-            break;
-        default:
-            sock->service = LCBIO_SERVICE_MGMT;
-            break;
-    }
+    sock->service = httype2service(req->reqtype);
     req->ioctx->subsys = "mgmt/capi";
     lcbio_ctx_put(req->ioctx, &req->preamble[0], req->preamble.size());
     if (!req->body.empty()) {
         lcbio_ctx_put(req->ioctx, &req->body[0], req->body.size());
     }
-    lcbio_ctx_rwant(req->ioctx, 1);
+    lcbio_ctx_rwant(req->ioctx, req->wants_read());
     lcbio_ctx_schedule(req->ioctx);
     (void)syserr;
 }
@@ -258,7 +415,7 @@ lcb_STATUS Request::start_io(lcb_host_t &dest)
 {
     lcbio_MGR *pool = instance->http_sockpool;
 
-    creq = pool->get(dest, timeout(), on_connected, this);
+    creq = pool->get(dest, timeout(), on_connected, this, httype2service(reqtype));
     if (!creq) {
         return LCB_ERR_CONNECT_ERROR;
     }
@@ -0,0 +1,144 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+#include "inflate.h"
+
+#include <cstring>
+
+#ifdef LCB_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+using namespace lcb::http;
+
+const size_t Inflater::BUFFER_SIZE;
+
+#ifdef LCB_HAVE_ZLIB
+struct Inflater::Stream {
+    z_stream zs;
+};
+
+bool Inflater::supported()
+{
+    return true;
+}
+
+Inflater *Inflater::create(const char *encoding)
+{
+    if (encoding == nullptr) {
+        return nullptr;
+    }
+    if (strcasecmp(encoding, "gzip") != 0 && strcasecmp(encoding, "x-gzip") != 0 &&
+        strcasecmp(encoding, "deflate") != 0) {
+        return nullptr;
+    }
+
+    auto *inflater = new Inflater();
+    // 32 enables automatic detection of both the zlib (deflate) and gzip headers
+    if (inflateInit2(&inflater->stream_->zs, 15 + 32) != Z_OK) {
+        delete inflater;
+        return nullptr;
+    }
+    return inflater;
+}
+
+Inflater::Inflater()
+    : stream_(new Stream()), buffer_(new char[BUFFER_SIZE]), done_(false), pending_(false), bytes_in_(0), bytes_out_(0),
+      elapsed_(0)
+{
+    memset(&stream_->zs, 0, sizeof(stream_->zs));
+}
+
+Inflater::~Inflater()
+{
+    inflateEnd(&stream_->zs);
+    delete stream_;
+    delete[] buffer_;
+}
+
+void Inflater::input(const char *buf, size_t nbuf)
+{
+    stream_->zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(buf));
+    stream_->zs.avail_in = static_cast<uInt>(nbuf);
+    bytes_in_ += nbuf;
+}
+
+int Inflater::next(const char **out)
+{
+    z_stream &zs = stream_->zs;
+    if (done_) {
+        // Anything after the end of the stream is ignored
+        zs.avail_in = 0;
+        return 0;
+    }
+    if (zs.avail_in == 0 && !pending_) {
+        return 0;
+    }
+
+    hrtime_t begin = gethrtime();
+    zs.next_out = reinterpret_cast<Bytef *>(buffer_);
+    zs.avail_out = BUFFER_SIZE;
+    int rc = inflate(&zs, Z_NO_FLUSH);
+    elapsed_ += gethrtime() - begin;
+
+    if (rc == Z_STREAM_END) {
+        done_ = true;
+    } else if (rc != Z_OK && rc != Z_BUF_ERROR) {
+        return -1;
+    }
+
+    size_t nout = BUFFER_SIZE - zs.avail_out;
+    bytes_out_ += nout;
+    *out = buffer_;
+    // a full buffer means zlib may still hold output, even without more input
+    pending_ = zs.avail_out == 0;
+    if (nout == 0 && !done_ && zs.avail_in != 0) {
+        // no progress possible with the remaining input
+        return -1;
+    }
+    return static_cast<int>(nout);
+}
+
+#else
+struct Inflater::Stream {
+};
+
+bool Inflater::supported()
+{
+    return false;
+}
+
+Inflater *Inflater::create(const char *)
+{
+    return nullptr;
+}
+
+Inflater::Inflater()
+    : stream_(nullptr), buffer_(nullptr), done_(false), pending_(false), bytes_in_(0), bytes_out_(0), elapsed_(0)
+{
+}
+
+Inflater::~Inflater() = default;
+
+void Inflater::input(const char *, size_t) {}
+
+int Inflater::next(const char **)
+{
+    return -1;
+}
+#endif
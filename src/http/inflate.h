@@ -0,0 +1,129 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LCB_HTTP_INFLATE_H
+#define LCB_HTTP_INFLATE_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace lcb
+{
+namespace http
+{
+
+/**
+ * Streaming decoder for `Content-Encoding: gzip` and `Content-Encoding: deflate`
+ * response bodies.
+ *
+ * Compressed data is pushed with input(), and the decompressed output is then
+ * pulled in bounded pieces with next(). The output buffer is allocated once and
+ * reused for the lifetime of the object, so the memory footprint does not depend
+ * on the size of the response.
+ *
+ * @code{.cpp}
+ * inflater->input(body, nbody);
+ * const char *out;
+ * int nout;
+ * while ((nout = inflater->next(&out)) > 0) {
+ *     deliver(out, nout);
+ * }
+ * if (nout < 0) {
+ *     // corrupt stream
+ * }
+ * @endcode
+ */
+class Inflater
+{
+  public:
+    /** Size of the (reused) output buffer */
+    static const size_t BUFFER_SIZE = 16384;
+
+    /**
+     * @return true if the library was built with support for compressed
+     * responses.
+     */
+    static bool supported();
+
+    /**
+     * Create an inflater for the given `Content-Encoding` header value.
+     * @param encoding the header value (may be NULL)
+     * @return the new inflater, or NULL if the encoding is not compressed, or
+     * is not supported.
+     */
+    static Inflater *create(const char *encoding);
+
+    ~Inflater();
+
+    /**
+     * Append compressed data. The buffer must remain valid until next()
+     * returns 0.
+     */
+    void input(const char *buf, size_t nbuf);
+
+    /**
+     * Retrieve the next piece of decompressed data.
+     * @param[out] out set to the decompressed data. Valid until the next call
+     * @return the number of bytes in `out`, 0 if more input is needed, or -1
+     * if the stream is corrupt.
+     */
+    int next(const char **out);
+
+    /** @return true once the end of the compressed stream has been seen */
+    bool done() const
+    {
+        return done_;
+    }
+
+    /** @return total number of compressed bytes consumed */
+    uint64_t bytes_in() const
+    {
+        return bytes_in_;
+    }
+
+    /** @return total number of decompressed bytes produced */
+    uint64_t bytes_out() const
+    {
+        return bytes_out_;
+    }
+
+    /** @return total time spent decompressing, in nanoseconds */
+    uint64_t elapsed() const
+    {
+        return elapsed_;
+    }
+
+  private:
+    Inflater();
+    Inflater(const Inflater &);
+    Inflater &operator=(const Inflater &);
+
+    struct Stream;
+    Stream *stream_;
+    char *buffer_;
+    bool done_;
+    /** Whether the output buffer was filled by the last call to next() */
+    bool pending_;
+    uint64_t bytes_in_;
+    uint64_t bytes_out_;
+    uint64_t elapsed_;
+};
+
+} // namespace http
+} // namespace lcb
+
+#endif /* LCB_HTTP_INFLATE_H */
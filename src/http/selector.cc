@@ -0,0 +1,212 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+#include "selector.h"
+#include "settings.h"
+#include "rnd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <vector>
+
+using namespace lcb::http;
+
+/** Weight of a new sample in the moving average */
+static const double LATENCY_WEIGHT = 0.2;
+
+/**
+ * Samples lose half of their weight for each period of this length without a
+ * new sample. A node which was slow is otherwise never chosen again (and
+ * therefore never gets a chance to show that it recovered) as long as the
+ * other nodes keep up.
+ */
+static const uint64_t LATENCY_TTL = LCB_S2NS(10);
+
+/** Cap on the share of failed requests, which keeps the cost of a failing node finite */
+static const double MAX_ERROR_RATE = 0.99;
+
+static const char *svcname(unsigned svc)
+{
+    // Same names as used for the connections in the diagnostics report
+    switch (svc) {
+        case LCBVB_SVCTYPE_VIEWS:
+            return "view";
+        case LCBVB_SVCTYPE_QUERY:
+            return "n1ql";
+        case LCBVB_SVCTYPE_SEARCH:
+            return "fts";
+        case LCBVB_SVCTYPE_ANALYTICS:
+            return "cbas";
+        case LCBVB_SVCTYPE_EVENTING:
+            return "eventing";
+        default:
+            return nullptr;
+    }
+}
+
+double EndpointSelector::cost(lcbvb_CONFIG *vbc, unsigned ix, lcbvb_SVCTYPE svc, lcbvb_SVCMODE mode,
+                              uint64_t now) const
+{
+    const char *hostport = lcbvb_get_hostport(vbc, ix, svc, mode);
+    const Endpoint *ep = hostport ? get(svc, hostport) : nullptr;
+    if (ep == nullptr) {
+        return 0;
+    }
+    double latency = ep->latency_us;
+    if (ep->last_sample && now > ep->last_sample + LATENCY_TTL) {
+        latency *= std::pow(0.5, static_cast<double>(now - ep->last_sample) / LATENCY_TTL);
+    }
+    // A request which has not been answered yet took at least this long
+    if (!ep->started.empty() && now > *ep->started.begin()) {
+        latency = std::max(latency, static_cast<double>(now - *ep->started.begin()) / 1000);
+    }
+    latency = std::max(latency, 1.0);
+    // Expected wait if requests were served one after another, and the failed
+    // requests had to be sent again
+    double expected = (ep->inflight + 1) * latency;
+    return expected / (1 - std::min(ep->error_rate, MAX_ERROR_RATE));
+}
+
+int EndpointSelector::select(lcbvb_CONFIG *vbc, lcbvb_SVCTYPE svc, lcbvb_SVCMODE mode, const int *used)
+{
+    if (settings_->http_endpoint_selection != LCB_HTTP_ENDPOINT_LEAST_LOADED || svc >= LCBVB_SVCTYPE__MAX) {
+        return lcbvb_get_randhost_ex(vbc, svc, mode, const_cast<int *>(used));
+    }
+
+    std::vector<unsigned> candidates;
+    candidates.reserve(LCBVB_NSERVERS(vbc));
+    for (unsigned ii = 0; ii < LCBVB_NSERVERS(vbc); ii++) {
+        if ((used == nullptr || !used[ii]) && lcbvb_get_port(vbc, ii, svc, mode) != 0) {
+            candidates.push_back(ii);
+        }
+    }
+    if (candidates.empty()) {
+        return -1;
+    } else if (candidates.size() == 1) {
+        return static_cast<int>(candidates[0]);
+    }
+
+    size_t first = lcb_next_rand32() % candidates.size();
+    size_t second = lcb_next_rand32() % (candidates.size() - 1);
+    if (second >= first) {
+        second++;
+    }
+    uint64_t now = gethrtime();
+    if (cost(vbc, candidates[second], svc, mode, now) < cost(vbc, candidates[first], svc, mode, now)) {
+        return static_cast<int>(candidates[second]);
+    }
+    return static_cast<int>(candidates[first]);
+}
+
+uint64_t EndpointSelector::start(lcbvb_SVCTYPE svc, const std::string &endpoint, uint64_t now)
+{
+    if (now == 0) {
+        now = gethrtime();
+    }
+    Endpoint &ep = endpoints_[svc][endpoint];
+    ep.inflight++;
+    ep.requests++;
+    ep.started.insert(now);
+    return now;
+}
+
+void EndpointSelector::sample(lcbvb_SVCTYPE svc, const std::string &endpoint, uint64_t elapsed, uint64_t now)
+{
+    if (now == 0) {
+        now = gethrtime();
+    }
+    Endpoint &ep = endpoints_[svc][endpoint];
+    double latency = static_cast<double>(elapsed) / 1000;
+    if (ep.last_sample == 0) {
+        ep.latency_us = latency;
+    } else {
+        ep.latency_us += LATENCY_WEIGHT * (latency - ep.latency_us);
+    }
+    ep.last_sample = now;
+}
+
+void EndpointSelector::finish(lcbvb_SVCTYPE svc, const std::string &endpoint, bool failed, uint64_t started)
+{
+    Endpoint &ep = endpoints_[svc][endpoint];
+    if (ep.inflight) {
+        ep.inflight--;
+    }
+    if (!ep.started.empty()) {
+        auto it = ep.started.find(started);
+        ep.started.erase(it == ep.started.end() ? ep.started.begin() : it);
+    }
+    if (failed) {
+        ep.errors++;
+    }
+    ep.error_rate += LATENCY_WEIGHT * ((failed ? 1.0 : 0.0) - ep.error_rate);
+}
+
+void EndpointSelector::prune(lcbvb_CONFIG *vbc)
+{
+    for (unsigned svc = 0; svc < LCBVB_SVCTYPE__MAX; svc++) {
+        if (endpoints_[svc].empty()) {
+            continue;
+        }
+        std::set<std::string> current;
+        for (unsigned ii = 0; ii < LCBVB_NSERVERS(vbc); ii++) {
+            for (lcbvb_SVCMODE mode : {LCBVB_SVCMODE_PLAIN, LCBVB_SVCMODE_SSL}) {
+                const char *hostport = lcbvb_get_hostport(vbc, ii, static_cast<lcbvb_SVCTYPE>(svc), mode);
+                if (hostport) {
+                    current.insert(hostport);
+                }
+            }
+        }
+        for (auto it = endpoints_[svc].begin(); it != endpoints_[svc].end();) {
+            if (it->second.inflight == 0 && current.find(it->first) == current.end()) {
+                it = endpoints_[svc].erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+const EndpointSelector::Endpoint *EndpointSelector::get(lcbvb_SVCTYPE svc, const std::string &endpoint) const
+{
+    if (svc >= LCBVB_SVCTYPE__MAX) {
+        return nullptr;
+    }
+    auto it = endpoints_[svc].find(endpoint);
+    return it == endpoints_[svc].end() ? nullptr : &it->second;
+}
+
+void EndpointSelector::to_json(Json::Value &root) const
+{
+    for (unsigned svc = 0; svc < LCBVB_SVCTYPE__MAX; svc++) {
+        const char *name = svcname(svc);
+        if (name == nullptr || endpoints_[svc].empty()) {
+            continue;
+        }
+        Json::Value &nodes = root[name];
+        for (const auto &it : endpoints_[svc]) {
+            Json::Value node;
+            node["remote"] = it.first;
+            node["in_flight"] = it.second.inflight;
+            node["latency_us"] = static_cast<Json::Value::UInt64>(it.second.latency_us);
+            node["requests"] = static_cast<Json::Value::UInt64>(it.second.requests);
+            node["errors"] = static_cast<Json::Value::UInt64>(it.second.errors);
+            nodes.append(node);
+        }
+    }
+}
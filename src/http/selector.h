@@ -0,0 +1,120 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LCB_HTTP_SELECTOR_H
+#define LCB_HTTP_SELECTOR_H
+
+#include <libcouchbase/couchbase.h>
+#include <libcouchbase/vbucket.h>
+#include "contrib/lcb-jsoncpp/lcb-jsoncpp.h"
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+
+struct lcb_settings_st;
+
+namespace lcb
+{
+namespace http
+{
+
+/**
+ * Chooses the node which query, analytics, search and view requests are sent
+ * to, and keeps track of how busy each of these nodes is.
+ *
+ * For every endpoint (`host:port` of the service) the number of requests in
+ * flight and a moving average of the response time (the time until the
+ * response headers are received) are maintained. With
+ * @ref LCB_HTTP_ENDPOINT_LEAST_LOADED two eligible nodes are picked at random,
+ * and the request is sent to the one with the lower expected wait, which avoids
+ * both herding onto a single "best" node and piling up requests on a slow one.
+ *
+ * A node which stops answering is charged for the age of its oldest request
+ * in flight, and a node whose requests fail for the share of them which
+ * failed recently, so that neither looks cheaper than the healthy nodes.
+ */
+class EndpointSelector
+{
+  public:
+    struct Endpoint {
+        /** Requests currently sent to this endpoint */
+        uint32_t inflight{0};
+        /** Moving average of the response time, in microseconds */
+        double latency_us{0};
+        /** Time of the last latency sample */
+        uint64_t last_sample{0};
+        /** Total requests sent to this endpoint */
+        uint64_t requests{0};
+        /** Requests which failed (or got a 5xx response) */
+        uint64_t errors{0};
+        /** Moving average of the share of requests which failed */
+        double error_rate{0};
+        /** Times at which the requests in flight were sent */
+        std::multiset<uint64_t> started;
+    };
+
+    explicit EndpointSelector(lcb_settings_st *settings) : settings_(settings) {}
+
+    /**
+     * Select a node providing the service.
+     * @param used sparse array (indexed like the servers in the config) of
+     *        nodes to skip, or NULL
+     * @return index of the node, or -1 if no node is eligible
+     */
+    int select(lcbvb_CONFIG *vbc, lcbvb_SVCTYPE svc, lcbvb_SVCMODE mode, const int *used);
+
+    /**
+     * Record that a request was sent to the endpoint
+     * @param now time the request was sent, or 0 for the current time
+     * @return the time the request was sent, to be passed to finish()
+     */
+    uint64_t start(lcbvb_SVCTYPE svc, const std::string &endpoint, uint64_t now = 0);
+
+    /**
+     * Add a response time sample (in nanoseconds) for the endpoint
+     * @param now time of the sample, or 0 for the current time
+     */
+    void sample(lcbvb_SVCTYPE svc, const std::string &endpoint, uint64_t elapsed, uint64_t now = 0);
+
+    /**
+     * Record that a request previously passed to start() has completed
+     * @param started the value returned by start(), or 0 for the oldest
+     *        request in flight
+     */
+    void finish(lcbvb_SVCTYPE svc, const std::string &endpoint, bool failed, uint64_t started = 0);
+
+    /** Forget the endpoints which are no longer in the config (and have no requests in flight) */
+    void prune(lcbvb_CONFIG *vbc);
+
+    /** @return the stats for the endpoint, or NULL if none were recorded */
+    const Endpoint *get(lcbvb_SVCTYPE svc, const std::string &endpoint) const;
+
+    /** Add the per-endpoint statistics to a diagnostics report */
+    void to_json(Json::Value &root) const;
+
+  private:
+    double cost(lcbvb_CONFIG *vbc, unsigned ix, lcbvb_SVCTYPE svc, lcbvb_SVCMODE mode, uint64_t now) const;
+
+    lcb_settings_st *settings_;
+    std::map<std::string, Endpoint> endpoints_[LCBVB_SVCTYPE__MAX];
+};
+
+} // namespace http
+} // namespace lcb
+
+#endif /* LCB_HTTP_SELECTOR_H */
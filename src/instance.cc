@@ -22,9 +22,15 @@
 #include "hostlist.h"
 #include "rnd.h"
 #include "http/http.h"
+#include "http/selector.h"
+#include "hedge.h"
+#include "coalesce.h"
+#include "kvdispatch.h"
+#include "compqueue.h"
 #include "bucketconfig/clconfig.h"
 #include <lcbio/iotable.h>
 #include <lcbio/ssl.h>
+#include <cbsasl/cbsasl.h>
 
 #define LOGARGS(obj, lvl) (obj)->settings, "instance", LCB_LOG_##lvl, __FILE__, __LINE__
 
@@ -542,7 +548,11 @@ lcb_STATUS lcb_create(lcb_INSTANCE **instance, const lcb_CREATEOPTS *options)
     obj->ht_nodes = new Hostlist();
     obj->mc_nodes = new Hostlist();
     obj->retryq = new RetryQueue(&obj->cmdq, obj->iotable, obj->settings);
-    obj->n1ql_cache = lcb_n1qlcache_create();
+    obj->n1ql_cache = lcb_n1qlcache_create(settings);
+    obj->http_selector = new http::EndpointSelector(settings);
+    obj->kv_hedge = new HedgeTracker();
+    obj->kv_coalesce = new GetCoalescer();
+    obj->kv_dispatch = new KvDispatch();
     lcb_initialize_packet_handlers(obj);
     lcb_aspend_init(&obj->pendops);
     obj->collcache = new lcb::CollectionCache();
@@ -674,6 +684,7 @@ void lcb_destroy(lcb_INSTANCE *instance)
     DESTROY(do_pool_shutdown, http_sockpool)
     DESTROY(lcb_vbguess_destroy, vbguess)
     DESTROY(lcb_n1qlcache_destroy, n1ql_cache)
+    DESTROY(delete, http_selector)
     if (instance->cmdq.pipelines) {
         unsigned ii;
         for (ii = 0; ii < instance->cmdq.npipelines; ii++) {
@@ -684,6 +695,8 @@ void lcb_destroy(lcb_INSTANCE *instance)
         }
     }
     mcreq_queue_cleanup(&instance->cmdq);
+    DESTROY(delete, kv_hedge)
+    DESTROY(delete, kv_coalesce)
     lcb_aspend_cleanup(po);
 
     if (instance->settings && instance->settings->tracer) {
@@ -704,9 +717,19 @@ void lcb_destroy(lcb_INSTANCE *instance)
         } while (!sd.stopped);
     }
 
+    if (instance->settings) {
+        /* The settings may outlive the instance; don't keep password-equivalent data around.
+         * Negotiations still in flight may use the cache until the events above are drained */
+        cbsasl_salted_cache_free(instance->settings->sasl_salted_cache);
+        instance->settings->sasl_salted_cache = nullptr;
+    }
+
+    lcb_asynclog_flush();
     DESTROY(lcbio_table_unref, iotable)
     DESTROY(lcb_settings_unref, settings)
     DESTROY(lcb_histogram_destroy, kv_timings)
+    DESTROY(delete, kv_dispatch)
+    DESTROY(delete, completions)
     DESTROY(delete, op_metrics)
     if (instance->scratch) {
         delete instance->scratch;
@@ -863,11 +886,13 @@ void lcb_sched_enter(lcb_INSTANCE *instance)
 LIBCOUCHBASE_API
 void lcb_sched_leave(lcb_INSTANCE *instance)
 {
+    instance->kv_coalesce->commit();
     mcreq_sched_leave(&instance->cmdq, LCBT_SETTING(instance, sched_implicit_flush));
 }
 LIBCOUCHBASE_API
 void lcb_sched_fail(lcb_INSTANCE *instance)
 {
+    instance->kv_coalesce->rollback();
     mcreq_sched_fail(&instance->cmdq);
 }
 
@@ -978,7 +1003,11 @@ lcb_STATUS lcb_enable_timings(lcb_INSTANCE *instance)
         return LCB_ERR_DOCUMENT_EXISTS;
     }
     instance->kv_timings = lcb_histogram_create();
-    return instance->kv_timings == nullptr ? LCB_ERR_NO_MEMORY : LCB_SUCCESS;
+    if (instance->kv_timings == nullptr) {
+        return LCB_ERR_NO_MEMORY;
+    }
+    LCBT_SETTING(instance, session_timings) = lcb_histogram_create();
+    return LCBT_SETTING(instance, session_timings) == nullptr ? LCB_ERR_NO_MEMORY : LCB_SUCCESS;
 }
 
 LIBCOUCHBASE_API
@@ -989,6 +1018,9 @@ lcb_STATUS lcb_disable_timings(lcb_INSTANCE *instance)
     }
     lcb_histogram_destroy(instance->kv_timings);
     instance->kv_timings = nullptr;
+    lcb_histogram_destroy(LCBT_SETTING(instance, session_timings));
+    LCBT_SETTING(instance, session_timings) = nullptr;
+    instance->kv_dispatch->clear_timings();
     return LCB_SUCCESS;
 }
 
@@ -64,6 +64,14 @@ struct Spechost;
 class RetryQueue;
 class Bootstrap;
 class CollectionCache;
+class HedgeTracker;
+class GetCoalescer;
+class KvDispatch;
+class CompletionQueue;
+namespace http
+{
+class EndpointSelector;
+} // namespace http
 namespace metrics
 {
 class Meter;
@@ -80,8 +88,18 @@ extern "C" {
 
 #ifdef __cplusplus
 typedef lcb::CollectionCache lcb_COLLCACHE;
+typedef lcb::http::EndpointSelector lcb_HTSELECTOR;
+typedef lcb::HedgeTracker lcb_HEDGETRACKER;
+typedef lcb::GetCoalescer lcb_GETCOALESCER;
+typedef lcb::KvDispatch lcb_KVDISPATCH;
+typedef lcb::CompletionQueue lcb_COMPQUEUE;
 #else
 typedef struct lcb_CollectionCache_st lcb_COLLCACHE;
+typedef struct lcb_HTSELECTOR_st lcb_HTSELECTOR;
+typedef struct lcb_HEDGETRACKER_st lcb_HEDGETRACKER;
+typedef struct lcb_GETCOALESCER_st lcb_GETCOALESCER;
+typedef struct lcb_KVDISPATCH_st lcb_KVDISPATCH;
+typedef struct lcb_COMPQUEUE_st lcb_COMPQUEUE;
 #endif
 
 struct lcb_callback_st {
@@ -133,6 +151,11 @@ struct lcb_st {
     lcb_pSCRATCHBUF scratch;          /**< Generic buffer space */
     struct lcb_GUESSVB_st *vbguess;   /**< Heuristic masters for vbuckets */
     lcb_N1QLCACHE *n1ql_cache;
+    lcb_HTSELECTOR *http_selector; /**< Chooses nodes for query/search/view requests */
+    lcb_HEDGETRACKER *kv_hedge;    /**< Get response times, for hedged gets */
+    lcb_GETCOALESCER *kv_coalesce; /**< Gets in flight, when coalescing */
+    lcb_KVDISPATCH *kv_dispatch;   /**< Response handlers and counters, by opcode */
+    lcb_COMPQUEUE *completions;    /**< Completed operations, see lcb_completion_queue_enable() */
     lcb_MUTATION_TOKEN *dcpinfo; /**< Mapping of known vbucket to {uuid,seqno} info */
     lcbio_pTIMER dtor_timer;     /**< Asynchronous destruction timer */
     lcb_BTYPE btype;             /**< Type of the bucket */
@@ -260,6 +283,22 @@ lcb_RETRY_ACTION lcb_query_should_retry(const lcb_settings *settings, lcb_QUERY_
 
 lcb_RESPCALLBACK lcb_find_callback(lcb_INSTANCE *instance, lcb_CALLBACK_TYPE cbtype);
 
+/**
+ * Decode the next entry of a subdoc response body
+ * @param iter offset of the entry, advanced past it
+ * @return non-zero if an entry was decoded
+ */
+int lcb_sdresult_next(const lcb_RESPSUBDOC *resp, lcb_SDENTRY *ent, size_t *iter);
+
+/**
+ * Get the result of a spec of a subdoc response
+ * @return zero if the index is out of range
+ */
+int lcb_sdresult_get(const lcb_RESPSUBDOC *resp, size_t index, lcb_SDENTRY *ent);
+
+/** Free anything allocated by lcb_sdresult_get() */
+void lcb_sdresult_release(lcb_RESPSUBDOC *resp);
+
 /* These two functions exist to allow the tests to keep the loop alive while
  * scheduling other operations asynchronously */
 
@@ -228,6 +228,12 @@ struct lcb_RESPBASE_ {
  */
 #define LCB_CMDGET_F_CLEAREXP (1 << 16)
 
+/**
+ * If this bit is set in lcb_CMDGET::cmdflags then a replica read is sent if the
+ * active node does not respond within the hedge delay (see lcb_cmdget_hedge())
+ */
+#define LCB_CMDGET_F_HEDGE (1 << 17)
+
 struct lcb_CMDGET_ {
     LCB_CMD_BASE;
     /**If set to true, the `exptime` field inside `options` will take to mean
@@ -455,7 +461,7 @@ typedef struct {
     /**
      * The durability check may involve more than a single call to observe - or
      * more than a single packet sent to a server to check the key status. This
-     * value determines the time to wait (in microseconds)
+     * value determines the maximum time to wait (in microseconds)
      * between multiple probes for the same server.
      * If not set, the @ref LCB_CNTL_DURABILITY_INTERVAL will be used
      * instead.
@@ -1360,6 +1366,9 @@ typedef struct {
 struct lcb_SUBDOCSPECS_ {
     uint32_t options;
 
+    /**
+     * Allocated together with the structure, and stored directly after it
+     */
     lcb_SDSPEC *specs;
     /**
      * Number of entries in #specs
@@ -1424,9 +1433,12 @@ typedef struct {
     lcb_U8 index;
 } lcb_SDENTRY;
 
+/** Number of result offsets kept in lcb_RESPSUBDOC itself (see #offsets_inline) */
+#define LCB_SDRESULT_INLINE 16
+
 /**
  * Response structure for multi lookups. If the top level response is successful
- * then the individual results may be retrieved using lcb_sdmlookup_next()
+ * then the individual results may be retrieved using lcb_sdresult_get()
  */
 struct lcb_RESPSUBDOC_ {
     LCB_RESP_BASE
@@ -1434,7 +1446,23 @@ struct lcb_RESPSUBDOC_ {
     /** Use with lcb_backbuf_ref/unref */
     void *bufh;
     size_t nres;
-    lcb_SDENTRY *res;
+
+    /**
+     * The results are decoded from #responses only when they are read.
+     * #cursor is the offset of the next entry in the body, and #cursor_low the
+     * first spec whose result can be at or after it, so that reading the results
+     * in order is a single pass over the body.
+     */
+    size_t cursor;
+    size_t cursor_low;
+    /**
+     * Set once the offset of every result has been recorded, which is only
+     * needed when the results are read out of order. The offsets are kept in
+     * #offsets_inline, or in #offsets if there are more than LCB_SDRESULT_INLINE
+     */
+    int indexed;
+    uint32_t offsets_inline[LCB_SDRESULT_INLINE];
+    uint32_t *offsets;
 };
 
 /** TODO: remove me */
@@ -117,7 +117,9 @@ void lcb_metrics_dumpserver(const lcb_SERVERMETRICS *metrics, FILE *fp)
     fprintf(fp, "Packets errored: %lu\n", (unsigned long int)metrics->packets_errored);
     fprintf(fp, "Packets NMV: %lu\n", (unsigned long int)metrics->packets_nmv);
     fprintf(fp, "Packets timeout: %lu\n", (unsigned long int)metrics->packets_timeout);
-    fprintf(fp, "Packets orphaned: %lu", (unsigned long int)metrics->packets_ownerless);
+    fprintf(fp, "Packets orphaned: %lu\n", (unsigned long int)metrics->packets_ownerless);
+    fprintf(fp, "Reads: %lu\n", (unsigned long int)metrics->reads);
+    fprintf(fp, "Bytes consolidated: %lu", (unsigned long int)metrics->bytes_consolidated);
 }
 
 void lcb_metrics_reset_pipeline_gauges(lcb_SERVERMETRICS *metrics)
@@ -0,0 +1,411 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "writer.h"
+
+#include <cctype>
+#include <cstring>
+
+using namespace lcb::jsparse;
+
+namespace
+{
+/** Maximum nesting accepted by validate() */
+const int MAX_DEPTH = 256;
+
+class Validator
+{
+  public:
+    Validator(const char *s, size_t n) : p_(s), end_(s + n) {}
+
+    bool run()
+    {
+        skip_ws();
+        if (!parse_value(0)) {
+            return false;
+        }
+        skip_ws();
+        return p_ == end_;
+    }
+
+  private:
+    const char *p_;
+    const char *end_;
+
+    void skip_ws()
+    {
+        while (p_ != end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')) {
+            ++p_;
+        }
+    }
+
+    bool consume(char c)
+    {
+        if (p_ != end_ && *p_ == c) {
+            ++p_;
+            return true;
+        }
+        return false;
+    }
+
+    bool literal(const char *lit)
+    {
+        size_t n = strlen(lit);
+        if (static_cast<size_t>(end_ - p_) < n || memcmp(p_, lit, n) != 0) {
+            return false;
+        }
+        p_ += n;
+        return true;
+    }
+
+    bool digits()
+    {
+        const char *begin = p_;
+        while (p_ != end_ && *p_ >= '0' && *p_ <= '9') {
+            ++p_;
+        }
+        return p_ != begin;
+    }
+
+    bool parse_number()
+    {
+        consume('-');
+        if (consume('0')) {
+            // no leading zeroes
+        } else if (!digits()) {
+            return false;
+        }
+        if (consume('.') && !digits()) {
+            return false;
+        }
+        if (p_ != end_ && (*p_ == 'e' || *p_ == 'E')) {
+            ++p_;
+            if (!consume('+')) {
+                consume('-');
+            }
+            if (!digits()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool parse_string()
+    {
+        // opening quote already consumed
+        while (p_ != end_) {
+            auto c = static_cast<unsigned char>(*p_++);
+            if (c == '"') {
+                return true;
+            } else if (c < 0x20) {
+                return false;
+            } else if (c == '\\') {
+                if (p_ == end_) {
+                    return false;
+                }
+                switch (*p_++) {
+                    case '"':
+                    case '\\':
+                    case '/':
+                    case 'b':
+                    case 'f':
+                    case 'n':
+                    case 'r':
+                    case 't':
+                        break;
+                    case 'u':
+                        for (int ii = 0; ii < 4; ii++) {
+                            if (p_ == end_ || !isxdigit(static_cast<unsigned char>(*p_))) {
+                                return false;
+                            }
+                            ++p_;
+                        }
+                        break;
+                    default:
+                        return false;
+                }
+            }
+        }
+        return false;
+    }
+
+    bool parse_container(int depth, char close)
+    {
+        skip_ws();
+        if (consume(close)) {
+            return true;
+        }
+        do {
+            skip_ws();
+            if (close == '}') {
+                if (!consume('"') || !parse_string()) {
+                    return false;
+                }
+                skip_ws();
+                if (!consume(':')) {
+                    return false;
+                }
+                skip_ws();
+            }
+            if (!parse_value(depth + 1)) {
+                return false;
+            }
+            skip_ws();
+        } while (consume(','));
+        return consume(close);
+    }
+
+    bool parse_value(int depth)
+    {
+        if (p_ == end_ || depth > MAX_DEPTH) {
+            return false;
+        }
+        switch (*p_) {
+            case '{':
+                ++p_;
+                return parse_container(depth, '}');
+            case '[':
+                ++p_;
+                return parse_container(depth, ']');
+            case '"':
+                ++p_;
+                return parse_string();
+            case 't':
+                return literal("true");
+            case 'f':
+                return literal("false");
+            case 'n':
+                return literal("null");
+            default:
+                return parse_number();
+        }
+    }
+};
+
+/**
+ * Validate an application-provided value, returning it in the form it
+ * should be written to the request. Values which are not strict JSON, but are
+ * accepted by Json::Reader (e.g. with comments), are re-encoded.
+ */
+bool normalize(const char *value, size_t nvalue, std::string &out)
+{
+    if (validate(value, nvalue)) {
+        out.assign(value, nvalue);
+        return true;
+    }
+    Json::Value parsed;
+    if (!Json::Reader().parse(value, value + nvalue, parsed)) {
+        return false;
+    }
+    out = Json::FastWriter().write(parsed);
+    if (!out.empty() && out[out.size() - 1] == '\n') {
+        out.erase(out.size() - 1);
+    }
+    return true;
+}
+} // namespace
+
+bool lcb::jsparse::validate(const char *s, size_t n)
+{
+    return Validator(s, n).run();
+}
+
+bool EncodedParams::set_named(const std::string &name, const char *value, size_t nvalue)
+{
+    std::string encoded;
+    if (!normalize(value, nvalue, encoded)) {
+        return false;
+    }
+    for (auto &param : named) {
+        if (param.first == name) {
+            param.second.swap(encoded);
+            return true;
+        }
+    }
+    named.emplace_back(name, std::move(encoded));
+    return true;
+}
+
+void EncodedParams::remove_named(const std::string &name)
+{
+    for (auto it = named.begin(); it != named.end(); ++it) {
+        if (it->first == name) {
+            named.erase(it);
+            return;
+        }
+    }
+}
+
+bool EncodedParams::add_positional(const char *value, size_t nvalue)
+{
+    std::string encoded;
+    if (!normalize(value, nvalue, encoded)) {
+        return false;
+    }
+    if (!positional.empty()) {
+        positional += ',';
+    }
+    positional += encoded;
+    return true;
+}
+
+void Writer::quote(std::string &out, const char *s, size_t n)
+{
+    static const char hex[] = "0123456789abcdef";
+    out += '"';
+    const char *run = s;
+    for (const char *end = s + n; s != end; ++s) {
+        auto c = static_cast<unsigned char>(*s);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        // Copy the unescaped run in one go
+        out.append(run, s - run);
+        run = s + 1;
+        out += '\\';
+        switch (c) {
+            case '"':
+            case '\\':
+                out += static_cast<char>(c);
+                break;
+            case '\b':
+                out += 'b';
+                break;
+            case '\f':
+                out += 'f';
+                break;
+            case '\n':
+                out += 'n';
+                break;
+            case '\r':
+                out += 'r';
+                break;
+            case '\t':
+                out += 't';
+                break;
+            default:
+                out += "u00";
+                out += hex[c >> 4u];
+                out += hex[c & 0xfu];
+                break;
+        }
+    }
+    out.append(run, s - run);
+    out += '"';
+}
+
+Writer &Writer::key(const char *name, size_t nname)
+{
+    if (!first_) {
+        out_ += ',';
+    }
+    first_ = false;
+    quote(out_, name, nname);
+    out_ += ':';
+    return *this;
+}
+
+void Writer::string(const char *s, size_t n)
+{
+    quote(out_, s, n);
+}
+
+void Writer::value(const Json::Value &value)
+{
+    switch (value.type()) {
+        case Json::nullValue:
+            out_ += "null";
+            break;
+        case Json::booleanValue:
+            out_ += value.asBool() ? "true" : "false";
+            break;
+        case Json::intValue:
+            out_ += Json::valueToString(value.asLargestInt());
+            break;
+        case Json::uintValue:
+            out_ += Json::valueToString(value.asLargestUInt());
+            break;
+        case Json::realValue:
+            out_ += Json::valueToString(value.asDouble());
+            break;
+        case Json::stringValue: {
+            const char *begin = nullptr, *end = nullptr;
+            value.getString(&begin, &end);
+            quote(out_, begin, end - begin);
+            break;
+        }
+        case Json::arrayValue: {
+            out_ += '[';
+            for (Json::ArrayIndex ii = 0; ii < value.size(); ii++) {
+                if (ii) {
+                    out_ += ',';
+                }
+                this->value(value[ii]);
+            }
+            out_ += ']';
+            break;
+        }
+        case Json::objectValue: {
+            bool first = first_;
+            begin_object();
+            members(value);
+            end_object();
+            first_ = first;
+            break;
+        }
+    }
+}
+
+void Writer::members(const Json::Value &object, const char *skip)
+{
+    for (auto it = object.begin(); it != object.end(); ++it) {
+        const char *name_end = nullptr;
+        const char *name = it.memberName(&name_end);
+        size_t nname = name_end - name;
+        if (skip != nullptr && strlen(skip) == nname && memcmp(skip, name, nname) == 0) {
+            continue;
+        }
+        key(name, nname);
+        value(*it);
+    }
+}
+
+void Writer::fragment(const std::string &members)
+{
+    if (members.empty()) {
+        return;
+    }
+    if (!first_) {
+        out_ += ',';
+    }
+    first_ = false;
+    out_ += members;
+}
+
+void Writer::params(const EncodedParams &params)
+{
+    for (const auto &param : params.named) {
+        key(param.first);
+        raw(param.second.c_str(), param.second.size());
+    }
+    if (!params.positional.empty()) {
+        key("args", 4);
+        out_ += '[';
+        out_ += params.positional;
+        out_ += ']';
+    }
+}
@@ -0,0 +1,164 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LCB_JSPARSE_WRITER_H
+#define LCB_JSPARSE_WRITER_H
+
+#include "contrib/lcb-jsoncpp/lcb-jsoncpp.h"
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace lcb
+{
+namespace jsparse
+{
+
+/**
+ * Check that the buffer contains exactly one well-formed JSON value
+ * (optionally surrounded by whitespace). Nothing is allocated.
+ */
+bool validate(const char *s, size_t n);
+
+/**
+ * Query parameters (e.g. `$name` and `args`) as provided by the application.
+ *
+ * Values are validated when they are set, but are kept in their encoded form
+ * and copied verbatim into the request body, so that they never need to be
+ * converted to and from Json::Value.
+ */
+struct EncodedParams {
+    /** Named parameters, in the order they were first set */
+    std::vector<std::pair<std::string, std::string>> named;
+    /** Encoded positional parameters, separated by commas (without brackets) */
+    std::string positional;
+
+    /**
+     * Set a named parameter, replacing any previous value with this name
+     * @return false if the value is not valid JSON
+     */
+    bool set_named(const std::string &name, const char *value, size_t nvalue);
+
+    /** Remove the named parameter, if it was set */
+    void remove_named(const std::string &name);
+
+    /**
+     * Append a positional parameter
+     * @return false if the value is not valid JSON
+     */
+    bool add_positional(const char *value, size_t nvalue);
+
+    bool empty() const
+    {
+        return named.empty() && positional.empty();
+    }
+
+    void clear()
+    {
+        named.clear();
+        positional.clear();
+    }
+};
+
+/**
+ * Encodes a single JSON object, appending it to an existing buffer.
+ *
+ * This is used for request bodies (query, analytics), which consist of a
+ * handful of top-level members. String and scalar members are written directly;
+ * pre-encoded values are copied as-is.
+ *
+ * @code{.cpp}
+ * std::string body;
+ * Writer w(body);
+ * w.begin_object();
+ * w.key("statement").string(statement);
+ * w.members(options);
+ * w.params(params);
+ * w.end_object();
+ * @endcode
+ */
+class Writer
+{
+  public:
+    explicit Writer(std::string &out) : out_(out), first_(true) {}
+
+    void begin_object()
+    {
+        out_ += '{';
+        first_ = true;
+    }
+
+    void end_object()
+    {
+        out_ += '}';
+    }
+
+    /** Write the name of the next member */
+    Writer &key(const char *name, size_t nname);
+    Writer &key(const std::string &name)
+    {
+        return key(name.c_str(), name.size());
+    }
+
+    void string(const char *s, size_t n);
+    void string(const std::string &s)
+    {
+        string(s.c_str(), s.size());
+    }
+
+    /** Write a value which is already encoded (and known to be valid) */
+    void raw(const char *s, size_t n)
+    {
+        out_.append(s, n);
+    }
+
+    void value(const Json::Value &value);
+
+    /**
+     * Write all members of a JSON object (which must be an object or null)
+     * @param skip name of a member to leave out, or NULL
+     */
+    void members(const Json::Value &object, const char *skip = nullptr);
+
+    /**
+     * Write one or more encoded members (e.g. `"a":1,"b":2`), which are
+     * known to be valid
+     */
+    void fragment(const std::string &members);
+
+    /** Write the named parameters, and the `args` array */
+    void params(const EncodedParams &params);
+
+    /** The output buffer, to append a value after key() */
+    std::string &buffer()
+    {
+        return out_;
+    }
+
+    /** Write a string, quoted and escaped, to the buffer */
+    static void quote(std::string &out, const char *s, size_t n);
+
+  private:
+    std::string &out_;
+    bool first_;
+};
+
+} // namespace jsparse
+} // namespace lcb
+
+#endif /* LCB_JSPARSE_WRITER_H */
@@ -0,0 +1,107 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LCB_KVDISPATCH_H
+#define LCB_KVDISPATCH_H
+
+#include <libcouchbase/couchbase.h>
+#include <libcouchbase/utils.h>
+#include "mc/mcreq.h"
+#include <cstdint>
+
+namespace lcb
+{
+class MemcachedResponse;
+
+/**
+ * Handler for the response to a memcached request.
+ *
+ * @param pipeline the pipeline (or "Server") upon which the request was sent
+ * @param request the original request
+ * @param response the response which was received
+ * @param immerr set if the request failed without a response (e.g. network
+ *  failure or timeout), in which case @p response only has the opcode and status
+ */
+typedef void (*KvHandler)(mc_PIPELINE *pipeline, mc_PACKET *request, MemcachedResponse *response,
+                          lcb_STATUS immerr);
+
+/**
+ * Table of the handlers of memcached responses, indexed by opcode.
+ *
+ * Each instance has its own table, populated with the built-in handlers when
+ * the instance is created. The number of responses for each opcode is counted,
+ * and if timings are enabled (lcb_enable_timings()), their latencies are
+ * recorded in a histogram for each opcode.
+ */
+class KvDispatch
+{
+  public:
+    struct Entry {
+        KvHandler handler;
+        uint64_t count;
+        /** Created for the opcode's first response while timings are enabled */
+        lcb_HISTOGRAM *timings;
+    };
+
+    /** Registers the built-in handlers (see handler.cc) */
+    KvDispatch();
+    ~KvDispatch();
+
+    KvDispatch(const KvDispatch &) = delete;
+    KvDispatch &operator=(const KvDispatch &) = delete;
+
+    /**
+     * Set the handler for an opcode, replacing the built-in one if there is
+     * one. Passing NULL makes the opcode unknown.
+     */
+    void set_handler(uint8_t opcode, KvHandler handler)
+    {
+        entries_[opcode].handler = handler;
+    }
+
+    Entry &entry(uint8_t opcode)
+    {
+        return entries_[opcode];
+    }
+
+    const Entry &entry(uint8_t opcode) const
+    {
+        return entries_[opcode];
+    }
+
+    /** Record the time (in nanoseconds) it took to receive a response */
+    void record(Entry &ent, uint64_t duration)
+    {
+        if (ent.timings == nullptr) {
+            ent.timings = lcb_histogram_create();
+            if (ent.timings == nullptr) {
+                return;
+            }
+        }
+        lcb_histogram_record(ent.timings, duration);
+    }
+
+    /** Drop the latency histograms, when timings are disabled */
+    void clear_timings();
+
+  private:
+    Entry entries_[256];
+};
+
+} // namespace lcb
+
+#endif /* LCB_KVDISPATCH_H */
@@ -78,7 +78,11 @@ lcbio_CTX *lcbio_ctx_new(lcbio_SOCKET *sock, void *data, const lcbio_CTXPROCS *p
     sock->service = LCBIO_SERVICE_UNSPEC;
     sock->atime = LCB_NS2US(gethrtime());
 
-    rdb_init(&ctx->ior, sock->settings->allocator_factory());
+    if (sock->settings->allocator_factory) {
+        rdb_init(&ctx->ior, sock->settings->allocator_factory());
+    } else {
+        rdb_init(&ctx->ior, rdb_adaptalloc_new(sock->settings->read_buffer_cache));
+    }
     lcbio_ref(sock);
 
     if (IOT_IS_EVENT(ctx->io)) {
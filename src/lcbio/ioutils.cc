@@ -323,6 +323,14 @@ lcb_STATUS lcbio_ssl_get_error(lcbio_SOCKET *)
 {
     return LCB_SUCCESS;
 }
+int lcbio_ssl_session_reused(lcbio_SOCKET *)
+{
+    return 0;
+}
+lcb_U64 lcbio_ssl_handshake_cputime(lcbio_SOCKET *)
+{
+    return 0;
+}
 void lcbio_ssl_global_init(void) {}
 lcb_STATUS lcbio_sslify_if_needed(lcbio_SOCKET *, lcb_settings *)
 {
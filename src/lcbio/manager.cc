@@ -33,10 +33,22 @@ namespace io
 {
 
 struct PoolHost {
-    inline PoolHost(Pool *, std::string);
+    inline PoolHost(Pool *, std::string, lcbio_SERVICE);
     inline void connection_available();
     inline void start_new_connection(uint32_t timeout);
 
+    const Pool::ServiceOptions &svc_options() const
+    {
+        return parent->svc_options[service];
+    }
+
+    /** Whether another connection may be opened without exceeding the limit */
+    bool can_connect() const
+    {
+        unsigned maxhost = svc_options().maxhost;
+        return maxhost == 0 || n_total < maxhost;
+    }
+
     void ref()
     {
         refcount++;
@@ -80,6 +92,7 @@ struct PoolHost {
     lcb_clist_t ll_pending{}; /* pending cinfo */
     lcb_clist_t requests{};   /* pending requests */
     const std::string key;    /* host:port */
+    lcbio_SERVICE service;
     Pool *parent;
     lcb::io::Timer<PoolHost, &PoolHost::connection_available> async;
     unsigned n_total; /* number of total connections */
@@ -137,9 +150,9 @@ namespace lcb
 namespace io
 {
 struct PoolRequest : ReqNode, ConnectionRequest {
-    PoolRequest(PoolHost *host_, lcbio_CONNDONE_cb cb, void *cbarg)
+    PoolRequest(PoolHost *host_, lcbio_CONNDONE_cb cb, void *cbarg, uint32_t timeout_)
         : host(host_), callback(cb), arg(cbarg), timer(host->parent->io, this), state(PENDING), sock(nullptr),
-          err(LCB_SUCCESS)
+          err(LCB_SUCCESS), start(gethrtime()), timeout(timeout_)
     {
     }
 
@@ -161,7 +174,7 @@ struct PoolRequest : ReqNode, ConnectionRequest {
         timer.signal();
     }
 
-    inline void set_pending(uint32_t timeout)
+    inline void set_pending()
     {
         timer.rearm(timeout);
     }
@@ -180,6 +193,8 @@ struct PoolRequest : ReqNode, ConnectionRequest {
     State state;
     lcbio_SOCKET *sock;
     lcb_STATUS err;
+    hrtime_t start;
+    uint32_t timeout;
 };
 } // namespace io
 } // namespace lcb
@@ -209,6 +224,11 @@ PoolConnInfo::~PoolConnInfo()
         lcbio_connect_cancel(cs);
     }
 
+    if (parent->num_requests() && parent->num_pending() < parent->num_requests()) {
+        // A slot is free for requests waiting because of ServiceOptions::maxhost
+        parent->async.signal();
+    }
+
     if (sock) {
         // Ensure destructor is not called!
         dtor = nullptr;
@@ -322,6 +342,16 @@ void Pool::toJSON(hrtime_t now, Json::Value &node)
 
 void PoolRequest::invoke()
 {
+    Pool::Stats &stats = host->parent->stats;
+    hrtime_t wait = gethrtime() - start;
+    stats.wait_total += wait;
+    if (wait > stats.wait_max) {
+        stats.wait_max = wait;
+    }
+    if (!sock) {
+        stats.failed++;
+    }
+
     if (sock) {
         PoolConnInfo *info = PoolConnInfo::from_sock(sock);
         info->set_leased();
@@ -351,6 +381,13 @@ void PoolHost::connection_available()
         req->sock = info->sock;
         req->invoke();
     }
+
+    // Requests still waiting, e.g. because a connection was closed while
+    // they were held back by ServiceOptions::maxhost
+    while (num_pending() < num_requests() && can_connect()) {
+        PoolRequest *req = PoolRequest::from_llnode(LCB_LIST_HEAD((lcb_list_t *)&requests));
+        start_new_connection(req->timeout);
+    }
 }
 
 /**
@@ -387,9 +424,12 @@ void PoolConnInfo::on_connected(lcbio_SOCKET *sock_, lcb_STATUS err)
         sock = sock_;
         lcbio_ref(sock);
         lcbio_protoctx_add(sock, this);
+        if (parent->service != LCBIO_SERVICE_UNSPEC) {
+            sock->service = parent->service;
+        }
 
         lcb_clist_append(&parent->ll_idle, this);
-        idle_timer.rearm(parent->parent->options.maxidle);
+        idle_timer.rearm(parent->parent->options.tmoidle);
         parent->connection_available();
     }
 }
@@ -421,6 +461,7 @@ void PoolHost::start_new_connection(uint32_t timeout)
     lcb_clist_append(&ll_pending, info);
     n_total++;
     refcount++;
+    parent->stats.created++;
 }
 
 void PoolRequest::timer_handler()
@@ -438,8 +479,8 @@ void PoolRequest::timer_handler()
     }
 }
 
-PoolHost::PoolHost(Pool *parent_, std::string key_)
-    : key(std::move(key_)), parent(parent_), async(parent->io, this), n_total(0), refcount(1)
+PoolHost::PoolHost(Pool *parent_, std::string key_, lcbio_SERVICE service_)
+    : key(std::move(key_)), service(service_), parent(parent_), async(parent->io, this), n_total(0), refcount(1)
 {
 
     lcb_clist_init(&ll_idle);
@@ -448,11 +489,8 @@ PoolHost::PoolHost(Pool *parent_, std::string key_)
     parent->ref();
 }
 
-ConnectionRequest *Pool::get(const lcb_host_t &dest, uint32_t timeout, lcbio_CONNDONE_cb cb, void *cbarg)
+PoolHost *Pool::get_host(const lcb_host_t &dest, lcbio_SERVICE svc)
 {
-    PoolHost *he;
-    lcb_list_t *cur;
-
     std::string key;
     if (dest.ipv6) {
         key.append("[").append(dest.host).append("]:").append(dest.port);
@@ -462,13 +500,23 @@ ConnectionRequest *Pool::get(const lcb_host_t &dest, uint32_t timeout, lcbio_CON
 
     auto m = ht.find(key);
     if (m == ht.end()) {
-        he = new PoolHost(this, key);
-        ht.insert(std::make_pair(key, he));
-    } else {
-        he = m->second;
+        auto *he = new PoolHost(this, key, svc);
+        ht.emplace(key, he);
+        return he;
     }
+    if (m->second->service == LCBIO_SERVICE_UNSPEC) {
+        m->second->service = svc;
+    }
+    return m->second;
+}
 
-    auto *req = new PoolRequest(he, cb, cbarg);
+ConnectionRequest *Pool::get(const lcb_host_t &dest, uint32_t timeout, lcbio_CONNDONE_cb cb, void *cbarg,
+                             lcbio_SERVICE svc)
+{
+    lcb_list_t *cur;
+    PoolHost *he = get_host(dest, svc);
+    auto *req = new PoolRequest(he, cb, cbarg, timeout);
+    stats.requests++;
 
 GT_POPAGAIN:
 
@@ -489,15 +537,20 @@ GT_POPAGAIN:
         }
 
         req->set_ready(info);
+        stats.reused++;
         lcb_log(LOGARGS(this, DEBUG),
                 HE_LOGFMT "Found ready connection in pool. Reusing socket and not creating new connection",
                 HE_LOGID(he));
 
     } else {
-        req->set_pending(timeout);
+        req->set_pending();
 
         lcb_clist_append(&he->requests, req);
-        if (he->num_pending() < he->num_requests()) {
+        if (he->num_pending() < he->num_requests() && !he->can_connect()) {
+            lcb_log(LOGARGS(this, DEBUG), HE_LOGFMT "Waiting for a connection. Limit of %u connections reached",
+                    HE_LOGID(he), he->svc_options().maxhost);
+
+        } else if (he->num_pending() < he->num_requests()) {
             lcb_log(LOGARGS(this, DEBUG), HE_LOGFMT "Creating new connection because none are available in the pool",
                     HE_LOGID(he));
             he->start_new_connection(timeout);
@@ -510,6 +563,20 @@ GT_POPAGAIN:
     return req;
 }
 
+void Pool::warmup(const lcb_host_t &dest, uint32_t timeout, lcbio_SERVICE svc)
+{
+    PoolHost *he = get_host(dest, svc);
+    unsigned minidle = he->svc_options().minidle;
+    if (he->n_total >= minidle) {
+        return;
+    }
+    lcb_log(LOGARGS(this, DEBUG), HE_LOGFMT "Opening %u connection(s) in advance", HE_LOGID(he),
+            minidle - he->n_total);
+    while (he->n_total < minidle && he->can_connect()) {
+        he->start_new_connection(timeout);
+    }
+}
+
 void PoolRequest::cancel()
 {
     Pool *mgr = host->parent;
@@ -528,6 +595,12 @@ void PoolRequest::cancel()
 
 void PoolConnInfo::on_idle_timeout()
 {
+    if (parent->num_idle() <= parent->svc_options().minidle) {
+        // Keep the connection open. If the server closed it in the meantime,
+        // this is detected when it is taken out of the pool
+        idle_timer.rearm(parent->parent->options.tmoidle);
+        return;
+    }
     lcb_log(LOGARGS(parent->parent, DEBUG), HE_LOGFMT "Idle connection expired", HE_LOGID(parent));
     lcbio_unref(sock)
 }
@@ -546,7 +619,7 @@ void Pool::put(lcbio_SOCKET *sock)
     he = info->parent;
     mgr = he->parent;
 
-    if (he->num_idle() >= mgr->options.maxidle) {
+    if (he->num_idle() >= mgr->options.maxidle && he->num_idle() >= he->svc_options().minidle) {
         lcb_log(LOGARGS(mgr, INFO), HE_LOGFMT "Closing idle connection. Too many in quota", HE_LOGID(he));
         lcbio_unref(info->sock) return;
     }
@@ -556,6 +629,9 @@ void Pool::put(lcbio_SOCKET *sock)
     info->idle_timer.rearm(mgr->options.tmoidle);
     lcb_clist_append(&he->ll_idle, info);
     info->state = PoolConnInfo::IDLE;
+    if (he->num_requests()) {
+        he->async.signal();
+    }
 }
 
 void Pool::discard(lcbio_SOCKET *sock)
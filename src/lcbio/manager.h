@@ -41,7 +41,7 @@
  */
 
 #ifdef __cplusplus
-#include <map>
+#include <unordered_map>
 
 namespace lcb
 {
@@ -101,10 +101,19 @@ class Pool
      * @param timeout amount of time to wait for a connection to be estblished
      * @param handler a callback to invoke when the result is ready
      * @param arg an argument passed to the callback
+     * @param svc the service provided by the host (see set_service_options())
      * @return a request handle which may be cancelled
      * @see lcbio_connect()
      */
-    ConnectionRequest *get(const lcb_host_t &, uint32_t, lcbio_CONNDONE_cb, void *);
+    ConnectionRequest *get(const lcb_host_t &, uint32_t, lcbio_CONNDONE_cb, void *,
+                           lcbio_SERVICE svc = LCBIO_SERVICE_UNSPEC);
+
+    /**
+     * Open connections to the host in the background, until there are
+     * ServiceOptions::minidle connections for it, so that subsequent get()
+     * calls do not need to wait for a new connection.
+     */
+    void warmup(const lcb_host_t &dest, uint32_t timeout, lcbio_SERVICE svc);
 
     /**
      * Release a socket back into the pool. This means the socket is no longer
@@ -178,6 +187,48 @@ class Pool
         return options;
     }
 
+    /** Limits applied to the hosts of a single service */
+    struct ServiceOptions {
+        ServiceOptions() : minidle(0), maxhost(0) {}
+
+        /**
+         * Number of connections to open by warmup(), and to keep open even
+         * when they are idle for longer than Options::tmoidle
+         */
+        unsigned minidle;
+
+        /**
+         * Maximum number of connections (idle, leased or pending) to a single
+         * host. Once reached, requests wait for a connection to be released.
+         * 0 means no limit
+         */
+        unsigned maxhost;
+    };
+
+    ServiceOptions &get_service_options(lcbio_SERVICE svc)
+    {
+        return svc_options[svc];
+    }
+
+    struct Stats {
+        /** Number of get() calls */
+        uint64_t requests{0};
+        /** Requests which were given an idle connection */
+        uint64_t reused{0};
+        /** Connections opened, including by warmup() */
+        uint64_t created{0};
+        /** Requests which failed or timed out */
+        uint64_t failed{0};
+        /** Total and maximum time between get() and the callback (ns) */
+        uint64_t wait_total{0};
+        uint64_t wait_max{0};
+    };
+
+    const Stats &get_stats() const
+    {
+        return stats;
+    }
+
     void toJSON(hrtime_t now, Json::Value &node);
 
   private:
@@ -185,11 +236,15 @@ class Pool
     friend struct PoolConnInfo;
     friend struct PoolHost;
 
-    typedef std::map< std::string, PoolHost * > HostMap;
+    PoolHost *get_host(const lcb_host_t &dest, lcbio_SERVICE svc);
+
+    typedef std::unordered_map< std::string, PoolHost * > HostMap;
     HostMap ht;
     lcb_settings *settings;
     lcbio_pTABLE io;
     Options options;
+    ServiceOptions svc_options[LCBIO_SERVICE_MAX];
+    Stats stats;
     unsigned refcount;
 };
 } // namespace io
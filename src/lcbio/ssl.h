@@ -117,6 +117,25 @@ int lcbio_ssl_check(lcbio_SOCKET *sock);
 LCB_INTERNAL_API
 lcb_STATUS lcbio_ssl_get_error(lcbio_SOCKET *sock);
 
+/**
+ * Checks whether the TLS handshake on the given socket resumed a session
+ * negotiated by an earlier connection to the same endpoint.
+ *
+ * @param sock
+ * @return nonzero if the session was resumed, 0 if a full handshake was
+ * performed (or the socket does not use SSL).
+ */
+LCB_INTERNAL_API
+int lcbio_ssl_session_reused(lcbio_SOCKET *sock);
+
+/**
+ * @param sock
+ * @return the CPU time, in nanoseconds, spent performing the TLS handshake
+ * on the given socket (0 if the socket does not use SSL).
+ */
+LCB_INTERNAL_API
+lcb_U64 lcbio_ssl_handshake_cputime(lcbio_SOCKET *sock);
+
 /**
  * @brief
  * Initialize any application-level globals needed for SSL support
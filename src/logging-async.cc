@@ -0,0 +1,190 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/**
+ * Output thread for the console logger (see LCB_CNTL_CONLOGGER_ASYNC).
+ *
+ * Lines are queued in a bounded ring which can be written to by any number
+ * of threads without locking (each slot carries a sequence number, which
+ * tells producers whether it is free, and the consumer whether it is
+ * filled). A single consumer, either the background thread or a caller of
+ * lcb_asynclog_flush(), writes them out.
+ */
+
+#include "config.h"
+#include <libcouchbase/couchbase.h>
+#include <cstdio>
+#include "logging.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+namespace
+{
+class AsyncLog
+{
+  public:
+    static const size_t NSLOTS = 4096;
+
+    AsyncLog() : slots_(new Slot[NSLOTS]), head_(0), tail_(0), dropped_(0), sleeping_(false)
+    {
+        for (size_t ii = 0; ii < NSLOTS; ii++) {
+            slots_[ii].seq.store(ii, std::memory_order_relaxed);
+        }
+    }
+
+    void push(FILE *fp, const char *line, size_t nline)
+    {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        Slot *slot;
+        for (;;) {
+            slot = &slots_[pos % NSLOTS];
+            size_t seq = slot->seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                /* full: the event loop must not wait for the output */
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+        slot->fp = fp;
+        slot->len = nline;
+        memcpy(slot->data, line, nline);
+        slot->seq.store(pos + 1, std::memory_order_release);
+
+        /* the thread wakes up by itself shortly, only hurry it along if the ring is filling up */
+        if ((pos + 1) % (NSLOTS / 4) == 0 && sleeping_.load(std::memory_order_relaxed)) {
+            wakeup_.notify_one();
+        }
+    }
+
+    /** Write out everything queued. @return the number of lines written */
+    size_t drain()
+    {
+        std::lock_guard<std::mutex> guard(consumer_);
+        size_t nwritten = 0;
+        FILE *last = nullptr;
+        for (;;) {
+            Slot &slot = slots_[tail_ % NSLOTS];
+            if (slot.seq.load(std::memory_order_acquire) != tail_ + 1) {
+                break;
+            }
+            fwrite(slot.data, 1, slot.len, slot.fp);
+            if (last && last != slot.fp) {
+                fflush(last);
+            }
+            last = slot.fp;
+            slot.seq.store(tail_ + NSLOTS, std::memory_order_release);
+            tail_++;
+            nwritten++;
+        }
+        size_t dropped = dropped_.exchange(0, std::memory_order_relaxed);
+        if (dropped && last) {
+            fprintf(last, "(%lu log messages dropped)\n", static_cast<unsigned long>(dropped));
+        }
+        if (last) {
+            fflush(last);
+        }
+        return nwritten;
+    }
+
+    void run()
+    {
+        for (;;) {
+            if (drain()) {
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleep_);
+            sleeping_.store(true, std::memory_order_relaxed);
+            wakeup_.wait_for(lock, std::chrono::milliseconds(10));
+            sleeping_.store(false, std::memory_order_relaxed);
+        }
+    }
+
+  private:
+    struct Slot {
+        std::atomic<size_t> seq;
+        FILE *fp;
+        size_t len;
+        char data[LCB_ASYNCLOG_LINE_MAX];
+    };
+
+    Slot *slots_;
+    std::atomic<size_t> head_;
+    size_t tail_; /**< Protected by consumer_ */
+    std::atomic<size_t> dropped_;
+    std::atomic<bool> sleeping_;
+    std::mutex consumer_;
+    std::mutex sleep_;
+    std::condition_variable wakeup_;
+};
+
+/* Never freed: the thread keeps running until the process exits */
+std::atomic<AsyncLog *> asynclog(nullptr);
+std::once_flag asynclog_once;
+
+void flush_at_exit()
+{
+    lcb_asynclog_flush();
+}
+} // namespace
+
+int lcb_asynclog_start(void)
+{
+    std::call_once(asynclog_once, []() {
+        auto *log = new AsyncLog();
+        try {
+            std::thread(&AsyncLog::run, log).detach();
+        } catch (const std::system_error &) {
+            delete log;
+            return;
+        }
+        asynclog.store(log);
+        atexit(flush_at_exit);
+    });
+    return asynclog.load() ? 0 : -1;
+}
+
+int lcb_asynclog_push(FILE *fp, const char *line, size_t nline)
+{
+    AsyncLog *log = asynclog.load(std::memory_order_acquire);
+    if (log == nullptr || nline > LCB_ASYNCLOG_LINE_MAX) {
+        return -1;
+    }
+    log->push(fp, line, nline);
+    return 0;
+}
+
+void lcb_asynclog_flush(void)
+{
+    AsyncLog *log = asynclog.load(std::memory_order_acquire);
+    if (log != nullptr) {
+        log->drain();
+    }
+}
@@ -78,7 +78,7 @@ static hrtime_t start_time = 0;
 static void console_log(const lcb_LOGGER *procs, uint64_t iid, const char *subsys, lcb_LOG_SEVERITY severity,
                         const char *srcfile, int srcline, const char *fmt, va_list ap);
 
-static struct lcb_CONSOLELOGGER console_logprocs = {{console_log, NULL}, NULL, LCB_LOG_INFO /* Minimum severity */};
+static struct lcb_CONSOLELOGGER console_logprocs = {{console_log, NULL, LCB_LOG_INFO /* Minimum severity */}, NULL, 0};
 
 lcb_LOGGER *lcb_console_logger = &console_logprocs.base;
 
@@ -115,7 +115,7 @@ static void console_log(const lcb_LOGGER *procs, uint64_t iid, const char *subsy
     hrtime_t now;
     struct lcb_CONSOLELOGGER *vprocs = (struct lcb_CONSOLELOGGER *)procs;
 
-    if ((int)severity < vprocs->minlevel) {
+    if ((int)severity < procs->minlevel) {
         return;
     }
 
@@ -130,6 +130,30 @@ static void console_log(const lcb_LOGGER *procs, uint64_t iid, const char *subsy
 
     fp = vprocs->fp ? vprocs->fp : stderr;
 
+    if (vprocs->async) {
+        /* Format on this thread (the arguments may not outlive the call), but leave the I/O to the logger thread */
+        char line[LCB_ASYNCLOG_LINE_MAX];
+        int nprefix, nmsg;
+        va_list aq;
+
+        nprefix = snprintf(line, sizeof(line), "%lums [I%" PRIx64 "] {%" THREAD_ID_FMT "} [%s] (%s - L:%d) ",
+                           (unsigned long)(now - start_time) / 1000000, iid, GET_THREAD_ID(),
+                           level_to_string(severity), subsys, srcline);
+        if (nprefix > 0 && (size_t)nprefix < sizeof(line) - 1) {
+            va_copy(aq, ap);
+            nmsg = vsnprintf(line + nprefix, sizeof(line) - nprefix, fmt, aq);
+            va_end(aq);
+            if (nmsg >= 0 && (size_t)(nprefix + nmsg) < sizeof(line) - 1) {
+                line[nprefix + nmsg] = '\n';
+                if (lcb_asynclog_push(fp, line, nprefix + nmsg + 1) == 0) {
+                    return;
+                }
+            }
+        }
+        /* Too long to be queued. Write it directly, after anything queued before it */
+        lcb_asynclog_flush();
+    }
+
     flockfile(fp);
     fprintf(fp, "%lums ", (unsigned long)(now - start_time) / 1000000);
 
@@ -144,8 +168,8 @@ static void console_log(const lcb_LOGGER *procs, uint64_t iid, const char *subsy
 }
 
 LCB_INTERNAL_API
-void lcb_log(const struct lcb_settings_st *settings, const char *subsys, int severity, const char *srcfile, int srcline,
-             const char *fmt, ...)
+void(lcb_log)(const struct lcb_settings_st *settings, const char *subsys, int severity, const char *srcfile, int srcline,
+              const char *fmt, ...)
 {
     va_list ap;
     lcb_LOGGER_CALLBACK callback;
@@ -211,9 +235,13 @@ lcb_LOGGER *lcb_init_console_logger(void)
         return NULL;
     }
 
+    if (lcb_getenv_boolean("LCB_LOGASYNC") && !console_logprocs.async) {
+        console_logprocs.async = lcb_asynclog_start() == 0;
+    }
+
     /** The "lowest" level we can expose is WARN, e.g. ERROR-1 */
     lvl = LCB_LOG_ERROR - lvl;
-    console_logprocs.minlevel = lvl;
+    console_logprocs.base.minlevel = lvl;
     return lcb_console_logger;
 }
 
@@ -236,6 +264,12 @@ LIBCOUCHBASE_API lcb_STATUS lcb_logger_callback(lcb_LOGGER *logger, lcb_LOGGER_C
     return LCB_SUCCESS;
 }
 
+LIBCOUCHBASE_API lcb_STATUS lcb_logger_minlevel(lcb_LOGGER *logger, lcb_LOG_SEVERITY severity)
+{
+    logger->minlevel = severity;
+    return LCB_SUCCESS;
+}
+
 LIBCOUCHBASE_API lcb_STATUS lcb_logger_cookie(const lcb_LOGGER *logger, void **cookie)
 {
     *cookie = logger->cookie;
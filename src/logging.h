@@ -39,6 +39,8 @@ struct lcbvb_CONFIG_st;
 struct lcb_LOGGER_ {
     lcb_LOGGER_CALLBACK callback;
     void *cookie;
+    /** Messages below this severity are discarded before they are formatted */
+    int minlevel;
 };
 
 /**
@@ -50,9 +52,25 @@ extern lcb_LOGGER *lcb_console_logger;
 struct lcb_CONSOLELOGGER {
     struct lcb_LOGGER_ base;
     FILE *fp;
-    int minlevel;
+    /** Whether output is written by a background thread, see lcb_asynclog_push() */
+    int async;
 };
 
+/**
+ * Messages below this severity are removed at compile time. Configured with
+ * the LCB_LOG_MIN_LEVEL CMake variable
+ */
+#ifndef LCB_LOG_MIN_LEVEL
+#define LCB_LOG_MIN_LEVEL 0
+#endif
+
+/**
+ * Whether a message of this severity would be passed to the logger. This is
+ * checked by lcb_log() before any of the arguments are evaluated.
+ */
+#define LCB_LOG_ENABLED(settings, severity)                                                                            \
+    ((int)(severity) >= LCB_LOG_MIN_LEVEL && (settings)->logger && (int)(severity) >= (settings)->logger->minlevel)
+
 /**
  * Log a message via the installed logger. The parameters correlate to the
  * arguments passed to the lcb_logging_callback function.
@@ -61,20 +79,48 @@ struct lcb_CONSOLELOGGER {
  * number of arguments manually passed for each message.
  */
 LCB_INTERNAL_API
-void lcb_log(const struct lcb_settings_st *settings, const char *subsys, int severity, const char *srcfile, int srcline,
-             const char *fmt, ...)
+void(lcb_log)(const struct lcb_settings_st *settings, const char *subsys, int severity, const char *srcfile, int srcline,
+              const char *fmt, ...)
 
 #ifdef __GNUC__
     __attribute__((format(printf, 6, 7)))
 #endif
     ;
 
+/*
+ * The arguments are usually given as LOGARGS(obj, LEVEL), "fmt", ..., so they
+ * are expanded once more before the settings and severity are picked out.
+ */
+#define lcb_log(...) LCB_LOG_EXPAND_(LCB_LOG_GATED_(__VA_ARGS__))
+#define LCB_LOG_EXPAND_(x) x
+#define LCB_LOG_GATED_(settings, subsys, severity, ...)                                                                \
+    (LCB_LOG_ENABLED(settings, severity) ? (lcb_log)(settings, subsys, severity, __VA_ARGS__) : (void)0)
+
 LCB_INTERNAL_API
 void lcb_log_badconfig(const struct lcb_settings_st *settings, const char *subsys, int severity, const char *srcfile,
                        int srcline, const struct lcbvb_CONFIG_st *vbc, const char *origin_txt);
 
 lcb_LOGGER *lcb_init_console_logger(void);
 
+/**
+ * Start the background thread of the asynchronous console logger.
+ * @return 0 on success
+ */
+int lcb_asynclog_start(void);
+
+/** Longest line (including the newline) which is queued by the asynchronous logger */
+#define LCB_ASYNCLOG_LINE_MAX 512
+
+/**
+ * Queue a formatted line for the background thread, without blocking.
+ * @return 0 if the line was queued, -1 if it is too long (and should be
+ * written directly, after calling lcb_asynclog_flush())
+ */
+int lcb_asynclog_push(FILE *fp, const char *line, size_t nline);
+
+/** Write out all queued lines. Called when an instance is destroyed, and at exit */
+void lcb_asynclog_flush(void);
+
 #define LCB_LOGS(settings, subsys, severity, msg) lcb_log(settings, subsys, severity, __FILE__, __LINE__, msg)
 
 #define LCB_LOG_EX(settings, subsys, severity, msg) lcb_log(settings, subsys, severity, __FILE__, __LINE__, msg)
@@ -298,26 +298,29 @@ void mcreq_wipe_packet(mc_PIPELINE *pipeline, mc_PACKET *packet)
     }
 }
 
+static mc_PACKET *init_packet(mc_PIPELINE *pipeline, nb_SPAN *span)
+{
+    mc_PACKET *ret = (void *)SPAN_MBUFFER_NC(span);
+    ret->alloc_parent = span->parent;
+    ret->flags = 0;
+    ret->retries = 0;
+    ret->opaque = pipeline->parent->seq++;
+    ret->u_rdata.reqdata.span = NULL;
+    ret->u_rdata.reqdata.deadline = 0;
+    return ret;
+}
+
 mc_PACKET *mcreq_allocate_packet(mc_PIPELINE *pipeline)
 {
     nb_SPAN span;
     int rv;
-    mc_PACKET *ret;
-    span.size = sizeof(*ret);
+    span.size = sizeof(mc_PACKET);
 
     rv = netbuf_mblock_reserve(&pipeline->reqpool, &span);
     if (rv != 0) {
         return NULL;
     }
-
-    ret = (void *)SPAN_MBUFFER_NC(&span);
-    ret->alloc_parent = span.parent;
-    ret->flags = 0;
-    ret->retries = 0;
-    ret->opaque = pipeline->parent->seq++;
-    ret->u_rdata.reqdata.span = NULL;
-    ret->u_rdata.reqdata.deadline = 0;
-    return ret;
+    return init_packet(pipeline, &span);
 }
 
 void mcreq_release_packet(mc_PIPELINE *pipeline, mc_PACKET *packet)
@@ -467,28 +470,65 @@ mc_EPKTDATUM *mcreq_epkt_find(mc_EXPACKET *ep, const char *key)
     return NULL;
 }
 
+static void get_hashkey(const lcb_KEYBUF *key, unsigned nhdr, const void **hk, size_t *nhk)
+{
+    if (key->type == LCB_KV_COPY) {
+        *hk = key->contig.bytes;
+        *nhk = key->contig.nbytes;
+    } else {
+        *hk = ((const char *)key->contig.bytes) + nhdr;
+        *nhk = key->contig.nbytes - nhdr;
+    }
+}
+
 void mcreq_map_key(mc_CMDQUEUE *queue, const lcb_KEYBUF *key, unsigned nhdr, int *vbid, int *srvix)
 {
     const void *hk;
     size_t nhk = 0;
-    switch (key->type) {
-        case LCB_KV_VBID:
-            *vbid = key->vbid;
-            *srvix = lcbvb_vbmaster(queue->config, *vbid);
-            return;
-        case LCB_KV_COPY:
-            hk = key->contig.bytes;
-            nhk = key->contig.nbytes;
-            break;
-        case LCB_KV_HEADER_AND_KEY:
-        default:
-            hk = ((const char *)key->contig.bytes) + nhdr;
-            nhk = key->contig.nbytes - nhdr;
-            break;
+    if (key->type == LCB_KV_VBID) {
+        *vbid = key->vbid;
+        *srvix = lcbvb_vbmaster(queue->config, *vbid);
+        return;
     }
+    get_hashkey(key, nhdr, &hk, &nhk);
     lcbvb_map_key(queue->config, hk, nhk, vbid, srvix);
 }
 
+/**
+ * Look up the master pipeline of a vBucket. The vBucket map in the config is
+ * authoritative and may be modified in place, so the cached entry is refreshed
+ * if it no longer matches the map
+ */
+static mc_PIPELINE *vb_pipeline(mc_CMDQUEUE *queue, int vbid)
+{
+    mc_PIPELINE *pl = queue->vbpipelines[vbid];
+    if (pl == NULL || pl->index != lcbvb_vbmaster(queue->config, vbid)) {
+        mcreq_queue_refresh_vbroute(queue, vbid);
+        pl = queue->vbpipelines[vbid];
+    }
+    return pl;
+}
+
+/**
+ * Map the key directly to its master pipeline using the vBucket-to-pipeline
+ * table, bypassing the server index. Returns NULL if the vBucket has no master
+ */
+static mc_PIPELINE *map_key_pipeline(mc_CMDQUEUE *queue, const lcb_KEYBUF *key, unsigned nhdr, int *vbid)
+{
+    const void *hk;
+    size_t nhk = 0;
+    if (key->type == LCB_KV_VBID) {
+        *vbid = key->vbid;
+        if ((unsigned)*vbid >= queue->nvbpipelines) {
+            return NULL;
+        }
+    } else {
+        get_hashkey(key, nhdr, &hk, &nhk);
+        *vbid = lcbvb_k2vb(queue->config, hk, nhk);
+    }
+    return vb_pipeline(queue, *vbid);
+}
+
 uint16_t mcreq_get_key_size(protocol_binary_request_header *hdr)
 {
     if (hdr->request.magic == PROTOCOL_BINARY_AREQ) {
@@ -512,11 +552,14 @@ lcb_STATUS mcreq_basic_packet(mc_CMDQUEUE *queue, const lcb_CMDBASE *cmd, protoc
         return LCB_ERR_INVALID_ARGUMENT;
     }
 
-    mcreq_map_key(queue, &cmd->key, sizeof(*req) + extlen + ffextlen, &vb, &srvix);
-    if (srvix > -1 && srvix < (int)queue->npipelines) {
-        *pipeline = queue->pipelines[srvix];
-
+    if (queue->vbpipelines) {
+        *pipeline = map_key_pipeline(queue, &cmd->key, sizeof(*req) + extlen + ffextlen, &vb);
     } else {
+        mcreq_map_key(queue, &cmd->key, sizeof(*req) + extlen + ffextlen, &vb, &srvix);
+        *pipeline = (srvix > -1 && srvix < (int)queue->npipelines) ? queue->pipelines[srvix] : NULL;
+    }
+
+    if (*pipeline == NULL) {
         if ((options & MCREQ_BASICPACKET_F_FALLBACKOK) && queue->fallback) {
             *pipeline = queue->fallback;
         } else {
@@ -545,6 +588,98 @@ lcb_STATUS mcreq_basic_packet(mc_CMDQUEUE *queue, const lcb_CMDBASE *cmd, protoc
     return LCB_SUCCESS;
 }
 
+lcb_STATUS mcreq_map_batch(mc_CMDQUEUE *queue, mc_BATCHITEM *items, unsigned nitems, int options)
+{
+    unsigned ii;
+
+    if (!queue->config) {
+        return LCB_ERR_NO_CONFIGURATION;
+    }
+
+    for (ii = 0; ii < nitems; ii++) {
+        mc_BATCHITEM *item = items + ii;
+        if (queue->vbpipelines) {
+            item->vbid = lcbvb_k2vb(queue->config, item->key, item->nkey);
+            item->pipeline = vb_pipeline(queue, item->vbid);
+        } else {
+            int srvix;
+            lcbvb_map_key(queue->config, item->key, item->nkey, &item->vbid, &srvix);
+            item->pipeline = (srvix > -1 && srvix < (int)queue->npipelines) ? queue->pipelines[srvix] : NULL;
+        }
+        if (item->pipeline == NULL) {
+            if ((options & MCREQ_BASICPACKET_F_FALLBACKOK) && queue->fallback) {
+                item->pipeline = queue->fallback;
+            } else {
+                return LCB_ERR_NO_MATCHING_SERVER;
+            }
+        }
+    }
+    return LCB_SUCCESS;
+}
+
+lcb_STATUS mcreq_batch_packets(mc_PIPELINE *pipeline, const mc_BATCHITEM *items, unsigned nitems, uint8_t hdrsize,
+                               uint32_t collection_id, mc_PACKET **packets)
+{
+    lcb_INSTANCE *instance = (lcb_INSTANCE *)pipeline->parent->cqdata;
+    nb_SPAN *spans;
+    unsigned ii, nspans;
+    uint8_t ncid = 0;
+    uint8_t cid[5] = {0};
+
+    if (instance && LCBT_SETTING(instance, use_collections)) {
+        ncid = leb128_encode(collection_id, cid);
+    }
+
+    /* the packet structures, then the header/key and value of each packet */
+    spans = malloc(sizeof(*spans) * nitems * 2);
+    if (spans == NULL) {
+        return LCB_ERR_NO_MEMORY;
+    }
+    for (ii = 0; ii < nitems; ii++) {
+        spans[ii].size = sizeof(mc_PACKET);
+    }
+    if (netbuf_mblock_reserve_multi(&pipeline->reqpool, spans, nitems) != 0) {
+        free(spans);
+        return LCB_ERR_NO_MEMORY;
+    }
+    for (ii = 0; ii < nitems; ii++) {
+        packets[ii] = init_packet(pipeline, &spans[ii]);
+    }
+
+    for (ii = 0, nspans = 0; ii < nitems; ii++) {
+        spans[nspans++].size = hdrsize + ncid + items[ii].nkey;
+        if (items[ii].nvalue) {
+            spans[nspans++].size = items[ii].nvalue;
+        }
+    }
+    if (netbuf_mblock_reserve_multi(&pipeline->nbmgr, spans, nspans) != 0) {
+        for (ii = 0; ii < nitems; ii++) {
+            mcreq_release_packet(pipeline, packets[ii]);
+        }
+        free(spans);
+        return LCB_ERR_NO_MEMORY;
+    }
+
+    for (ii = 0, nspans = 0; ii < nitems; ii++) {
+        mc_PACKET *packet = packets[ii];
+        const mc_BATCHITEM *item = items + ii;
+
+        packet->extlen = hdrsize - MCREQ_PKT_BASESIZE;
+        packet->kh_span = spans[nspans++];
+        memcpy(SPAN_BUFFER(&packet->kh_span) + hdrsize, cid, ncid);
+        memcpy(SPAN_BUFFER(&packet->kh_span) + hdrsize + ncid, item->key, item->nkey);
+
+        packet->u_value.single.size = 0;
+        if (item->nvalue) {
+            packet->u_value.single = spans[nspans++];
+            packet->flags |= MCREQ_F_HASVALUE;
+            memcpy(SPAN_BUFFER(&packet->u_value.single), item->value, item->nvalue);
+        }
+    }
+    free(spans);
+    return LCB_SUCCESS;
+}
+
 void mcreq_set_cid(mc_PIPELINE *pipeline, mc_PACKET *packet, uint32_t cid)
 {
     uint8_t ffext = 0;
@@ -741,6 +876,45 @@ void mcreq_queue_add_pipelines(mc_CMDQUEUE *queue, mc_PIPELINE *const *pipelines
         queue->pipelines[queue->npipelines] = queue->fallback;
         queue->_npipelines_ex++;
     }
+
+    mcreq_queue_refresh_vbroutes(queue);
+}
+
+void mcreq_queue_refresh_vbroute(mc_CMDQUEUE *queue, int vbid)
+{
+    int srvix;
+    if (!queue->vbpipelines || vbid < 0 || (unsigned)vbid >= queue->nvbpipelines) {
+        return;
+    }
+    srvix = lcbvb_vbmaster(queue->config, vbid);
+    if (srvix > -1 && srvix < (int)queue->npipelines) {
+        queue->vbpipelines[vbid] = queue->pipelines[srvix];
+    } else {
+        queue->vbpipelines[vbid] = NULL;
+    }
+}
+
+void mcreq_queue_refresh_vbroutes(mc_CMDQUEUE *queue)
+{
+    unsigned ii, nvb;
+    lcbvb_CONFIG *config = queue->config;
+
+    if (!config || config->dtype != LCBVB_DIST_VBUCKET || !queue->pipelines) {
+        free(queue->vbpipelines);
+        queue->vbpipelines = NULL;
+        queue->nvbpipelines = 0;
+        return;
+    }
+
+    nvb = config->nvb;
+    if (nvb != queue->nvbpipelines) {
+        free(queue->vbpipelines);
+        queue->vbpipelines = calloc(nvb, sizeof(*queue->vbpipelines));
+        queue->nvbpipelines = queue->vbpipelines ? nvb : 0;
+    }
+    for (ii = 0; ii < queue->nvbpipelines; ii++) {
+        mcreq_queue_refresh_vbroute(queue, (int)ii);
+    }
 }
 
 mc_PIPELINE **mcreq_queue_take_pipelines(mc_CMDQUEUE *queue, unsigned *count)
@@ -749,6 +923,9 @@ mc_PIPELINE **mcreq_queue_take_pipelines(mc_CMDQUEUE *queue, unsigned *count)
     *count = queue->npipelines;
     queue->pipelines = NULL;
     queue->npipelines = 0;
+    free(queue->vbpipelines);
+    queue->vbpipelines = NULL;
+    queue->nvbpipelines = 0;
     return ret;
 }
 
@@ -759,6 +936,8 @@ int mcreq_queue_init(mc_CMDQUEUE *queue)
     queue->scheds = NULL;
     queue->fallback = NULL;
     queue->npipelines = 0;
+    queue->vbpipelines = NULL;
+    queue->nvbpipelines = 0;
     return 0;
 }
 
@@ -771,8 +950,11 @@ void mcreq_queue_cleanup(mc_CMDQUEUE *queue)
     }
     free(queue->scheds);
     free(queue->pipelines);
+    free(queue->vbpipelines);
     queue->pipelines = NULL;
     queue->npipelines = 0;
+    queue->vbpipelines = NULL;
+    queue->nvbpipelines = 0;
     queue->scheds = NULL;
 }
 
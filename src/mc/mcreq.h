@@ -294,7 +294,13 @@ typedef enum {
      * The request has "replace" store semantics.
      * Utilized during error translation to map DOCUMENT_EXISTS to CAS_MISMATCH (see make_error() in handler.cc)
      */
-    MCREQ_F_REPLACE_SEMANTICS = 1u << 11u
+    MCREQ_F_REPLACE_SEMANTICS = 1u << 11u,
+
+    /**
+     * The response to this forwarded (MCREQ_F_UFWD) packet may be delivered in
+     * several IOVs, rather than consolidated into a single buffer
+     */
+    MCREQ_F_UFWD_IOV = 1u << 12u
 } mcreq_flags;
 
 /** @brief mask of flags indicating user-allocated buffers */
@@ -455,6 +461,18 @@ typedef struct mc_cmdqueue_st {
     /** Configuration handle for vBucket mapping */
     lcbvb_CONFIG *config;
 
+    /**
+     * Master pipeline for each vBucket, indexed by vBucket ID. This is derived
+     * from the config's vBucket map and rebuilt whenever the pipelines change.
+     * An entry is checked against the map when used, and refreshed if the
+     * master has changed. NULL for non-vBucket (e.g. memcached) buckets.
+     * An entry is NULL if the vBucket has no master.
+     */
+    mc_PIPELINE **vbpipelines;
+
+    /** Number of entries in vbpipelines */
+    unsigned nvbpipelines;
+
     /** Opaque pointer to be used by the application (in this case, lcb core) */
     void *cqdata;
 
@@ -668,6 +686,50 @@ lcb_STATUS mcreq_basic_packet(mc_CMDQUEUE *queue, const lcb_CMDBASE *cmd, protoc
                               uint8_t extlen, uint8_t ffextlen, mc_PACKET **packet, mc_PIPELINE **pipeline,
                               int options);
 
+/** @brief A key (and its value, if any) of a batch of commands */
+typedef struct {
+    const void *key;
+    lcb_SIZE nkey;
+    const void *value;
+    lcb_SIZE nvalue;
+    /** vBucket of the key, set by mcreq_map_batch() */
+    int vbid;
+    /** Pipeline of the key, set by mcreq_map_batch() */
+    mc_PIPELINE *pipeline;
+} mc_BATCHITEM;
+
+/**
+ * Map the keys of a batch to their vBuckets and pipelines
+ * @param queue the queue
+ * @param items the keys to map
+ * @param nitems number of keys
+ * @param options `0` or @ref MCREQ_BASICPACKET_F_FALLBACKOK
+ * @return LCB_ERR_NO_MATCHING_SERVER if any key could not be mapped
+ */
+lcb_STATUS mcreq_map_batch(mc_CMDQUEUE *queue, mc_BATCHITEM *items, unsigned nitems, int options);
+
+/**
+ * Allocate the packets of a batch of keys mapped to the same pipeline.
+ *
+ * The packet structures are reserved together, and so are the buffers of all
+ * the packets: each header and key (which is copied, along with the
+ * collection ID) is directly followed by the value (if any), and by the next
+ * packet. Once scheduled, the batch is flushed as a single buffer.
+ *
+ * The headers are left for the caller to write, as with mcreq_basic_packet()
+ *
+ * @param pipeline the pipeline of the keys
+ * @param items the keys
+ * @param nitems number of keys
+ * @param hdrsize size of the header and extras of each packet
+ * @param collection_id collection ID of the keys
+ * @param[out] packets the packets, one per key
+ * @return LCB_ERR_NO_MEMORY if the packets could not be allocated, in which
+ * case none were
+ */
+lcb_STATUS mcreq_batch_packets(mc_PIPELINE *pipeline, const mc_BATCHITEM *items, unsigned nitems, uint8_t hdrsize,
+                               uint32_t collection_id, mc_PACKET **packets);
+
 /**
  * @brief Get the key from a packet
  * @param[in] packet The packet from which to retrieve the key
@@ -729,6 +791,21 @@ void mcreq_queue_add_pipelines(mc_CMDQUEUE *queue, mc_PIPELINE *const *pipelines
  */
 mc_PIPELINE **mcreq_queue_take_pipelines(mc_CMDQUEUE *queue, unsigned *count);
 
+/**
+ * Rebuild the vBucket-to-pipeline table from the current config. This is
+ * done automatically by mcreq_queue_add_pipelines()
+ * @param queue the queue
+ */
+void mcreq_queue_refresh_vbroutes(mc_CMDQUEUE *queue);
+
+/**
+ * Refresh the pipeline table entry for a single vBucket. This should be called
+ * whenever the master of the vBucket has been remapped within the config
+ * @param queue the queue
+ * @param vbid the vBucket whose master has changed
+ */
+void mcreq_queue_refresh_vbroute(mc_CMDQUEUE *queue, int vbid);
+
 int mcreq_queue_init(mc_CMDQUEUE *queue);
 
 void mcreq_queue_cleanup(mc_CMDQUEUE *queue);
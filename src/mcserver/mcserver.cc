@@ -42,6 +42,7 @@
 #define LOGID_T() LOGID(this)
 
 #define MCREQ_MAXIOV 32
+#define MC_UFWD_MAXIOV 16
 #define LCBCONN_UNWANT(conn, flags) (conn)->want &= ~(flags)
 
 using namespace lcb;
@@ -489,8 +490,20 @@ Server::ReadState Server::try_read(lcbio_CTX *ctx, rdb_IOROPE *ior)
 
     pktsize += mcresp.bodylen();
     if (rdb_get_nused(ior) < pktsize) {
+        /* read the rest of the packet right behind its beginning, unless it is
+         * handed out as it sits in the rope (MCREQ_F_UFWD_IOV), in which case
+         * what was received so far is not copied and the rest is read into a
+         * segment of its own */
+        request = mcreq_pipeline_find(this, mcresp.opaque());
+        if (request && (request->flags & MCREQ_F_UFWD_IOV)) {
+            ior->rdsize = pktsize - rdb_get_nused(ior);
+        } else {
+            rdb_expect(ior, pktsize);
+        }
         RETURN_NEED_MORE(pktsize);
     }
+    rdb_sizer_add(&rdsizer, pktsize);
+    ior->rdsize = rdb_sizer_get(&rdsizer);
 
     /* Find the packet */
     if (mcresp.opcode() == PROTOCOL_BINARY_CMD_STAT && mcresp.keylen() != 0) {
@@ -588,19 +601,26 @@ Server::ReadState Server::try_read(lcbio_CTX *ctx, rdb_IOROPE *ior)
         DO_SWALLOW_PAYLOAD()
 
     } else {
-        /* figure out how many buffers we want to use as an upper limit for the
-         * IOV arrays. Currently we'll keep it simple and ensure the entire
-         * response is contiguous. */
+        /* Unless the application accepts a response spread over several
+         * buffers (lcb_CMDPKTFWD::version >= 1), the entire response is made
+         * contiguous. Otherwise it is handed out as it sits in the rope, and
+         * only consolidated if it spans more than MC_UFWD_MAXIOV segments */
         lcb_PKTFWDRESP resp = {0}; /* TODO: next ABI version should include is_last flag */
-        rdb_ROPESEG *segs;
-        nb_IOV iov;
+        rdb_ROPESEG *segs[MC_UFWD_MAXIOV];
+        nb_IOV iovs[MC_UFWD_MAXIOV];
+        int nitems = -1;
 
-        rdb_consolidate(ior, pktsize);
-        rdb_refread_ex(ior, &iov, &segs, 1, pktsize);
+        if (request->flags & MCREQ_F_UFWD_IOV) {
+            nitems = rdb_refread_ex(ior, iovs, segs, MC_UFWD_MAXIOV, pktsize);
+        }
+        if (nitems < 0) {
+            rdb_consolidate(ior, pktsize);
+            nitems = rdb_refread_ex(ior, iovs, segs, 1, pktsize);
+        }
 
-        resp.bufs = &segs;
-        resp.iovs = (lcb_IOV *)&iov;
-        resp.nitems = 1;
+        resp.bufs = segs;
+        resp.iovs = (lcb_IOV *)iovs;
+        resp.nitems = nitems;
         resp.header = mcresp.hdrbytes();
         instance->callbacks.pktfwd(instance, MCREQ_PKT_COOKIE(request), LCB_SUCCESS, &resp);
         rdb_consumed(ior, pktsize);
@@ -624,6 +644,10 @@ static void on_read(lcbio_CTX *ctx, unsigned)
 
     while (server->try_read(ctx, ior) == Server::PKT_READ_COMPLETE)
         ;
+    MC_INCR_METRIC(server, reads, ior->nreads);
+    MC_INCR_METRIC(server, bytes_consolidated, ior->nconsolidated);
+    ior->nreads = 0;
+    ior->nconsolidated = 0;
     lcbio_ctx_schedule(ctx);
     lcb_maybe_breakout(server->instance);
 }
@@ -1031,6 +1055,18 @@ void Server::connect()
     state = Server::S_CLEAN;
 }
 
+void Server::prewarm()
+{
+    if (state != Server::S_CLEAN || connctx != nullptr || connreq != nullptr || curhost->host[0] == '\0') {
+        return;
+    }
+    if (flush_start != (mcreq_flushstart_fn)server_connect) {
+        return;
+    }
+    lcb_log(LOGARGS_T(DEBUG), LOGFMT "Pre-warming connection", LOGID_T());
+    connect();
+}
+
 static void buf_done_cb(mc_PIPELINE *pl, const void *cookie, void *, void *)
 {
     auto *server = static_cast<Server *>(pl);
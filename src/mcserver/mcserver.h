@@ -192,6 +192,13 @@ class Server : public mc_PIPELINE
 
     void connect();
 
+    /**
+     * Start connecting if the server has no connection and no connection
+     * attempt in progress. Used to establish connections ahead of the first
+     * operation.
+     */
+    void prewarm();
+
     void handle_connected(lcbio_SOCKET *socket, lcb_STATUS err, lcbio_OSERR syserr);
 
     enum ReadState { PKT_READ_COMPLETE, PKT_READ_PARTIAL, PKT_READ_ABORT };
@@ -238,6 +245,12 @@ class Server : public mc_PIPELINE
     /** Request for current connection */
     lcb_host_t *curhost;
     std::string bucket{}; /** non-empty if bucket has been selected */
+
+    /**
+     * Sizes of the responses received, used to size the reads of the
+     * connection. Kept across reconnects.
+     */
+    rdb_SIZER rdsizer{};
 };
 } // namespace lcb
 #endif /* __cplusplus */
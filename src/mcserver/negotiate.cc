@@ -28,6 +28,7 @@
 #include <lcbio/timer-ng.h>
 #include <lcbio/ssl.h>
 #include <cbsasl/cbsasl.h>
+#include <libcouchbase/utils.h>
 #include "negotiate.h"
 #include "ctx-log-inl.h"
 #include "auth-priv.h"
@@ -120,6 +121,14 @@ class lcb::SessionRequestImpl : public SessionRequest
         /** Dislodge the connection, and return it back to the caller */
         lcbio_SOCKET *s;
 
+        hrtime_t elapsed = gethrtime() - start_time;
+        cpu_time += gethrcputime() - cpu_begin + lcbio_ssl_handshake_cputime(ctx->sock);
+        if (settings->session_timings) {
+            lcb_histogram_record(settings->session_timings, cpu_time);
+        }
+        lcb_log(LOGARGS(this, DEBUG), LOGFMT "Session established in %.3fms, %.3fms CPU (TLS resumed: %s)",
+                LOGID(this), elapsed / 1e6, cpu_time / 1e6, lcbio_ssl_session_reused(ctx->sock) ? "yes" : "no");
+
         lcbio_ctx_close(ctx, close_cb, &s);
         ctx = nullptr;
 
@@ -180,6 +189,11 @@ class lcb::SessionRequestImpl : public SessionRequest
     cbsasl_conn_t *sasl_client{};
     SessionInfo *info;
     lcb_settings *settings;
+    hrtime_t start_time{0};
+    /** CPU time spent handling the session so far, excluding the TLS handshake */
+    hrtime_t cpu_time{0};
+    /** CPU time when the current callback was entered */
+    hrtime_t cpu_begin{0};
 };
 
 static void handle_read(lcbio_CTX *ioctx, unsigned)
@@ -241,7 +255,11 @@ bool SessionRequestImpl::setup(const lcbio_NAMEINFO &nistrs, const lcb_host_t &h
 
     cbsasl_error_t saslerr =
         cbsasl_client_new("couchbase", host.host, nistrs.local, nistrs.remote, &sasl_callbacks, 0, &sasl_client);
-    return saslerr == SASL_OK;
+    if (saslerr != SASL_OK) {
+        return false;
+    }
+    sasl_client->c.client.salted_cache = settings->sasl_salted_cache;
+    return true;
 }
 
 static void timeout_handler(void *arg)
@@ -563,11 +581,13 @@ void SessionRequestImpl::handle_read(lcbio_CTX *ioctx)
     lcb::MemcachedResponse resp;
     unsigned required;
     bool completed = false;
+    cpu_begin = gethrcputime();
 
 GT_NEXT_PACKET:
 
     if (!resp.load(ioctx, &required)) {
         LCBIO_CTX_RSCHEDULE(ioctx, required);
+        cpu_time += gethrcputime() - cpu_begin;
         return;
     }
     const uint16_t status = resp.status();
@@ -706,6 +726,8 @@ static void cleanup_negotiated(SessionInfo *info)
 void SessionRequestImpl::start(lcbio_SOCKET *sock)
 {
     info = new SessionInfo();
+    start_time = gethrtime();
+    cpu_begin = gethrcputime();
 
     lcb_STATUS err = lcbio_sslify_if_needed(sock, settings);
     if (err != LCB_SUCCESS) {
@@ -740,6 +762,7 @@ void SessionRequestImpl::start(lcbio_SOCKET *sock)
         send_list_mechs();
     }
     LCBIO_CTX_RSCHEDULE(ctx, 24);
+    cpu_time += gethrcputime() - cpu_begin;
 }
 
 SessionRequestImpl::~SessionRequestImpl()
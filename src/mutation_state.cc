@@ -0,0 +1,172 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "internal.h"
+#include "mutation_state.h"
+#include "jsparse/writer.h"
+#include <cstring>
+
+using lcb::MutationState;
+
+MutationState::Bucket &MutationState::bucket(const char *name, size_t nname)
+{
+    for (auto &bucket : buckets_) {
+        if (bucket.name.size() == nname && memcmp(bucket.name.c_str(), name, nname) == 0) {
+            return bucket;
+        }
+    }
+    buckets_.emplace_back();
+    buckets_.back().name.assign(name, nname);
+    return buckets_.back();
+}
+
+void MutationState::update(Bucket &bucket, uint16_t vbid, uint64_t uuid, uint64_t seqno)
+{
+    if (seqno == 0) {
+        return;
+    }
+    if (vbid >= bucket.seqnos.size()) {
+        bucket.seqnos.resize(vbid + 1);
+        bucket.uuids.resize(vbid + 1);
+    }
+    if (bucket.seqnos[vbid] == 0) {
+        bucket.nvbuckets++;
+    } else if (bucket.seqnos[vbid] >= seqno) {
+        return;
+    }
+    bucket.seqnos[vbid] = seqno;
+    bucket.uuids[vbid] = uuid;
+}
+
+void MutationState::add(const char *name, size_t nname, const lcb_MUTATION_TOKEN &token)
+{
+    update(bucket(name, nname), token.vbid_, token.uuid_, token.seqno_);
+}
+
+void MutationState::add(const char *name, size_t nname, const lcb_MUTATION_TOKEN *tokens, size_t ntokens)
+{
+    Bucket &dst = bucket(name, nname);
+    for (size_t ii = 0; ii < ntokens; ii++) {
+        update(dst, static_cast<uint16_t>(ii), tokens[ii].uuid_, tokens[ii].seqno_);
+    }
+}
+
+void MutationState::merge(const MutationState &other)
+{
+    for (const auto &src : other.buckets_) {
+        Bucket &dst = bucket(src.name.c_str(), src.name.size());
+        for (size_t ii = 0; ii < src.seqnos.size(); ii++) {
+            update(dst, static_cast<uint16_t>(ii), src.uuids[ii], src.seqnos[ii]);
+        }
+    }
+}
+
+/** Append the decimal representation of a number */
+static void append_number(std::string &out, uint64_t value)
+{
+    char buf[20];
+    char *p = buf + sizeof(buf);
+    do {
+        *--p = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value);
+    out.append(p, buf + sizeof(buf) - p);
+}
+
+void MutationState::encode(std::string &out) const
+{
+    bool first = true;
+    out += '{';
+    for (const auto &bucket : buckets_) {
+        if (bucket.nvbuckets == 0) {
+            continue;
+        }
+        if (!first) {
+            out += ',';
+        }
+        first = false;
+        lcb::jsparse::Writer::quote(out, bucket.name.c_str(), bucket.name.size());
+        out += ":{";
+        bool first_vb = true;
+        for (size_t ii = 0; ii < bucket.seqnos.size(); ii++) {
+            if (bucket.seqnos[ii] == 0) {
+                continue;
+            }
+            if (!first_vb) {
+                out += ',';
+            }
+            first_vb = false;
+            out += '"';
+            append_number(out, ii);
+            out += "\":[";
+            append_number(out, bucket.seqnos[ii]);
+            out += ",\"";
+            append_number(out, bucket.uuids[ii]);
+            out += "\"]";
+        }
+        out += '}';
+    }
+    out += '}';
+}
+
+LIBCOUCHBASE_API lcb_STATUS lcb_mutation_state_create(lcb_MUTATION_STATE **state)
+{
+    *state = new lcb_MUTATION_STATE;
+    return LCB_SUCCESS;
+}
+
+LIBCOUCHBASE_API lcb_STATUS lcb_mutation_state_destroy(lcb_MUTATION_STATE *state)
+{
+    delete state;
+    return LCB_SUCCESS;
+}
+
+LIBCOUCHBASE_API lcb_STATUS lcb_mutation_state_add(lcb_MUTATION_STATE *state, const char *bucket, size_t bucket_len,
+                                                   const lcb_MUTATION_TOKEN *token)
+{
+    if (bucket == nullptr || !lcb_mutation_token_is_valid(token)) {
+        return LCB_ERR_INVALID_ARGUMENT;
+    }
+    if (bucket_len == (size_t)-1) {
+        bucket_len = strlen(bucket);
+    }
+    state->add(bucket, bucket_len, *token);
+    return LCB_SUCCESS;
+}
+
+LIBCOUCHBASE_API lcb_STATUS lcb_mutation_state_add_instance(lcb_MUTATION_STATE *state, lcb_INSTANCE *instance)
+{
+    lcbvb_CONFIG *vbc = LCBT_VBCONFIG(instance);
+    if (vbc == nullptr) {
+        return LCB_ERR_NO_CONFIGURATION;
+    }
+    if (vbc->dtype != LCBVB_DIST_VBUCKET || !LCBT_SETTING(instance, fetch_mutation_tokens)) {
+        return LCB_ERR_UNSUPPORTED_OPERATION;
+    }
+    const char *bucket = LCBT_SETTING(instance, bucket);
+    if (instance->dcpinfo == nullptr || bucket == nullptr) {
+        return LCB_ERR_DOCUMENT_NOT_FOUND;
+    }
+    state->add(bucket, strlen(bucket), instance->dcpinfo, vbc->nvb);
+    return LCB_SUCCESS;
+}
+
+LIBCOUCHBASE_API lcb_STATUS lcb_mutation_state_merge(lcb_MUTATION_STATE *state, const lcb_MUTATION_STATE *other)
+{
+    state->merge(*other);
+    return LCB_SUCCESS;
+}
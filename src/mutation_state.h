@@ -0,0 +1,100 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LCB_MUTATION_STATE_H
+#define LCB_MUTATION_STATE_H
+
+#include <libcouchbase/couchbase.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lcb
+{
+
+/**
+ * The latest known sequence number of each vBucket, for one or more buckets.
+ *
+ * This is what an `at_plus` query waits for: the index must have caught up
+ * with every mutation in the state. Tokens may be added from responses,
+ * from the per-instance log of mutation tokens, or by merging another state
+ * (e.g. one built by another instance).
+ */
+class MutationState
+{
+  public:
+    struct Bucket {
+        std::string name;
+        /** Indexed by vBucket. Zero if nothing is known for the vBucket */
+        std::vector<uint64_t> seqnos;
+        std::vector<uint64_t> uuids;
+        /** Number of non-zero entries in #seqnos */
+        size_t nvbuckets{0};
+    };
+
+    /**
+     * Add a token, unless a higher sequence number is already known for its
+     * vBucket
+     */
+    void add(const char *bucket, size_t nbucket, const lcb_MUTATION_TOKEN &token);
+
+    /** Add the valid tokens of an array indexed by vBucket */
+    void add(const char *bucket, size_t nbucket, const lcb_MUTATION_TOKEN *tokens, size_t ntokens);
+
+    void merge(const MutationState &other);
+
+    /** True if no sequence number is known for any vBucket */
+    bool empty() const
+    {
+        for (const auto &bucket : buckets_) {
+            if (bucket.nvbuckets) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void clear()
+    {
+        buckets_.clear();
+    }
+
+    const std::vector<Bucket> &buckets() const
+    {
+        return buckets_;
+    }
+
+    /**
+     * Append the state to a buffer, in the form used for `scan_vectors`:
+     * `{"bucket":{"vbid":[seqno,"uuid"],...},...}`
+     */
+    void encode(std::string &out) const;
+
+  private:
+    Bucket &bucket(const char *name, size_t nname);
+    static void update(Bucket &bucket, uint16_t vbid, uint64_t uuid, uint64_t seqno);
+
+    std::vector<Bucket> buckets_;
+};
+
+} // namespace lcb
+
+struct lcb_MUTATION_STATE_ : lcb::MutationState {
+};
+
+#endif /* LCB_MUTATION_STATE_H */
@@ -24,10 +24,28 @@ extern "C" {
 #endif
 
 typedef struct lcb_N1QLCACHE_st lcb_N1QLCACHE;
-lcb_N1QLCACHE *lcb_n1qlcache_create(void);
+struct lcb_settings_st;
+lcb_N1QLCACHE *lcb_n1qlcache_create(struct lcb_settings_st *settings);
+/** Destroys the cache, saving it first if a file was set */
 void lcb_n1qlcache_destroy(lcb_N1QLCACHE *);
 void lcb_n1qlcache_clear(lcb_N1QLCACHE *);
 
+/**
+ * Set the file the cache is persisted to. Entries are loaded from the file
+ * immediately (if it exists), and saved to it when the cache is destroyed.
+ * @param path the file, or NULL to disable persistence
+ */
+lcb_STATUS lcb_n1qlcache_set_file(lcb_N1QLCACHE *, const char *path);
+const char *lcb_n1qlcache_get_file(lcb_N1QLCACHE *);
+
+/**
+ * Save the cache now
+ * @param path the file to write, or NULL to use the one set with
+ *  lcb_n1qlcache_set_file()
+ */
+lcb_STATUS lcb_n1qlcache_save(lcb_N1QLCACHE *, const char *path);
+void lcb_n1qlcache_stats(lcb_N1QLCACHE *, lcb_QUERY_CACHE_STATS *stats);
+
 #ifdef __cplusplus
 void lcb_n1qlcache_getplan(lcb_N1QLCACHE *cache, const std::string &key, std::string &out);
 
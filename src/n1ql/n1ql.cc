@@ -17,16 +17,30 @@
 
 #include <libcouchbase/couchbase.h>
 #include <jsparse/parser.h>
+#include <jsparse/writer.h>
 #include "internal.h"
 #include "auth-priv.h"
 #include "http/http.h"
+#include "http/selector.h"
 #include "logging.h"
 #include "contrib/lcb-jsoncpp/lcb-jsoncpp.h"
-#include <map>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
 #include <string>
 #include <list>
+#include <unordered_map>
 #include <regex>
 #include <utility>
+#ifdef _WIN32
+#include <process.h> // for _getpid
+#define getpid _getpid
+#else
+#include <unistd.h> // for getpid
+#endif
 
 #include "capi/query.hh"
 
@@ -43,30 +57,25 @@ class Plan
     friend struct lcb_N1QLCACHE_st;
     std::string key;
     std::string planstr;
-    explicit Plan(std::string k) : key(std::move(k)) {}
+    size_t hash;
+    Plan(std::string k, size_t h) : key(std::move(k)), hash(h) {}
 
   public:
     /**
-     * Applies the plan to the output 'bodystr'. We don't assign the
+     * Applies the plan to the request body being written. We don't assign the
      * Json::Value directly, as this appears to be horribly slow. On my system
      * an assignment took about 200ms!
-     * @param body The request body (e.g. N1QLREQ::json)
-     * @param[out] bodystr the actual request payload
+     * @param writer the request body (without the statement)
      */
-    void apply_plan(Json::Value &body, std::string &bodystr) const
+    void apply_plan(lcb::jsparse::Writer &writer) const
     {
-        body.removeMember("statement");
-        bodystr = Json::FastWriter().write(body);
-
-        // Assume bodystr ends with '}'
-        size_t pos = bodystr.rfind('}');
-        bodystr.erase(pos);
+        writer.fragment(planstr);
+    }
 
-        if (!body.empty()) {
-            bodystr.append(",");
-        }
-        bodystr.append(planstr);
-        bodystr.append("}");
+    /** Memory accounted to this entry for the cache's byte budget */
+    size_t size() const
+    {
+        return sizeof(*this) + key.size() + planstr.size();
     }
 
   private:
@@ -77,12 +86,11 @@ class Plan
     void set_plan(const Json::Value &plan, bool include_encoded_plan)
     {
         // Set the plan as a string
-        planstr = "\"prepared\":";
-        planstr += Json::FastWriter().write(plan["name"]);
+        planstr.clear();
+        lcb::jsparse::Writer writer(planstr);
+        writer.key("prepared", 8).value(plan["name"]);
         if (include_encoded_plan) {
-            planstr += ",";
-            planstr += "\"encoded_plan\":";
-            planstr += Json::FastWriter().write(plan["encoded_plan"]);
+            writer.key("encoded_plan", 12).value(plan["encoded_plan"]);
         }
     }
 };
@@ -90,39 +98,70 @@ class Plan
 // LRU Cache structure..
 struct lcb_N1QLCACHE_st {
     typedef std::list<Plan *> LruCache;
-    typedef std::map<std::string, LruCache::iterator> Lookup;
+    /** Entries are looked up by the hash of the statement */
+    typedef std::unordered_map<size_t, LruCache::iterator> Lookup;
 
-    Lookup by_name;
+    Lookup by_hash;
     LruCache lru;
-
-    /** Maximum number of entries in LRU cache. This is fixed at 5000 */
-    static size_t max_size()
+    lcb_settings *settings;
+    /** Sum of Plan::size() for all entries */
+    size_t nbytes{0};
+    lcb_QUERY_CACHE_STATS stats{};
+    /** File the cache is loaded from, and saved to on destruction */
+    std::string filename;
+
+    explicit lcb_N1QLCACHE_st(lcb_settings *settings_) : settings(settings_)
     {
-        return 5000;
+        lcb_settings_ref(settings);
     }
 
     /**
-     * Adds an entry for a given key
+     * Adds an entry for a given key. Least recently used entries are evicted
+     * if this brings the cache over the limits set with
+     * @ref LCB_CNTL_QUERY_CACHE_MAX_ENTRIES and @ref LCB_CNTL_QUERY_CACHE_MAX_BYTES.
      * @param key The key to add
      * @param json The prepared statement returned by the server
      * @return the newly added plan.
      */
     const Plan &add_entry(const std::string &key, const Json::Value &json, bool include_encoded_plan = true)
     {
-        if (lru.size() == max_size()) {
-            // Purge entry from end
-            remove_entry(lru.back()->key);
+        size_t hash = std::hash<std::string>()(key);
+        // Remove old entry (or one which has the same hash), if present
+        auto m = by_hash.find(hash);
+        if (m != by_hash.end()) {
+            remove(m);
         }
 
-        // Remove old entry, if present
-        remove_entry(key);
-
-        lru.push_front(new Plan(key));
-        by_name[key] = lru.begin();
+        lru.push_front(new Plan(key, hash));
+        by_hash[hash] = lru.begin();
         lru.front()->set_plan(json, include_encoded_plan);
+        nbytes += lru.front()->size();
+
+        // The new entry is kept even if it exceeds the budget on its own
+        size_t max_bytes = settings->query_cache_max_bytes;
+        while (lru.size() > 1 && (lru.size() > settings->query_cache_max_entries || (max_bytes && nbytes > max_bytes))) {
+            // Purge entry from end
+            remove(by_hash.find(lru.back()->hash));
+            stats.evictions++;
+        }
         return *lru.front();
     }
 
+    /**
+     * Gets the entry for a given key, without updating the LRU or statistics
+     * @param key The statement (key) to look up
+     * @return the lookup iterator, or by_hash.end()
+     */
+    Lookup::iterator find(const std::string &key)
+    {
+        auto m = by_hash.find(std::hash<std::string>()(key));
+        if (m != by_hash.end() && (*m->second)->key != key) {
+            // hash collision
+            return by_hash.end();
+        }
+        return m;
+    }
+
     /**
      * Gets the entry for a given key
      * @param key The statement (key) to look up
@@ -130,10 +169,12 @@ struct lcb_N1QLCACHE_st {
      */
     const Plan *get_entry(const std::string &key)
     {
-        auto m = by_name.find(key);
-        if (m == by_name.end()) {
+        auto m = find(key);
+        if (m == by_hash.end()) {
+            stats.misses++;
             return nullptr;
         }
+        stats.hits++;
 
         const Plan *cur = *m->second;
 
@@ -147,15 +188,10 @@ struct lcb_N1QLCACHE_st {
     /** Removes an entry with the given key */
     void remove_entry(const std::string &key)
     {
-        auto m = by_name.find(key);
-        if (m == by_name.end()) {
-            return;
+        auto m = find(key);
+        if (m != by_hash.end()) {
+            remove(m);
         }
-        // Remove entry from map
-        auto m2 = m->second;
-        delete *m2;
-        by_name.erase(m);
-        lru.erase(m2);
     }
 
     /** Clears the LRU cache */
@@ -165,12 +201,33 @@ struct lcb_N1QLCACHE_st {
             delete ii;
         }
         lru.clear();
-        by_name.clear();
+        by_hash.clear();
+        nbytes = 0;
     }
 
+    /**
+     * Write all entries to a file, so that they can be loaded by another
+     * instance (or process) with load()
+     */
+    lcb_STATUS save(const std::string &path) const;
+
+    /** Add the entries from a file written by save() */
+    lcb_STATUS load(const std::string &path);
+
     ~lcb_N1QLCACHE_st()
     {
         clear();
+        lcb_settings_unref(settings);
+    }
+
+  private:
+    void remove(Lookup::iterator m)
+    {
+        auto m2 = m->second;
+        nbytes -= (*m2)->size();
+        delete *m2;
+        by_hash.erase(m);
+        lru.erase(m2);
     }
 };
 
@@ -196,6 +253,12 @@ typedef struct lcb_QUERY_HANDLE_ : lcb::jsparse::Parser::Actions {
     {
         return json;
     }
+    /** Query parameters, which are not part of ::json */
+    lcb::jsparse::EncodedParams params;
+    /** Mutations to wait for, not part of ::json either */
+    lcb::MutationState scan_vectors;
+    /** Encoded request body. Reused when the request is retried */
+    std::string body;
 
     /** String of the original statement. Cached here to avoid jsoncpp lookups */
     std::string statement;
@@ -214,6 +277,8 @@ typedef struct lcb_QUERY_HANDLE_ : lcb::jsparse::Parser::Actions {
     std::vector<int> used_nodes{};
     int last_vbcrev{0};
     bool idempotent{false};
+    /** Whether row delivery was paused by the application */
+    bool paused{false};
 
     lcbtrace_SPAN *span;
 
@@ -242,12 +307,33 @@ typedef struct lcb_QUERY_HANDLE_ : lcb::jsparse::Parser::Actions {
      * @param payload The body to send
      * @return Error code from lcb's http subsystem
      */
-    inline lcb_STATUS issue_htreq(const std::string &body);
+    inline lcb_STATUS issue_htreq(const std::string &payload);
 
     lcb_STATUS issue_htreq()
     {
-        std::string s = Json::FastWriter().write(json);
-        return issue_htreq(s);
+        encode_body(nullptr);
+        return issue_htreq(body);
+    }
+
+    /**
+     * Write ::json and ::params into ::body
+     * @param plan if not NULL, the prepared plan to use instead of the statement
+     */
+    void encode_body(const Plan *plan)
+    {
+        body.clear();
+        lcb::jsparse::Writer writer(body);
+        writer.begin_object();
+        writer.members(json, plan ? "statement" : nullptr);
+        writer.params(params);
+        if (!scan_vectors.empty()) {
+            writer.key("scan_vectors", 12);
+            scan_vectors.encode(writer.buffer());
+        }
+        if (plan) {
+            plan->apply_plan(writer);
+        }
+        writer.end_object();
     }
 
     /**
@@ -329,16 +415,147 @@ static bool parse_json(const char *s, size_t n, Json::Value &res)
     return Json::Reader().parse(s, s + n, res);
 }
 
-lcb_N1QLCACHE *lcb_n1qlcache_create(void)
+lcb_STATUS lcb_N1QLCACHE_st::save(const std::string &path) const
+{
+    std::string contents;
+    lcb::jsparse::Writer writer(contents);
+    writer.begin_object();
+    writer.key("version", 7).raw("1", 1);
+    writer.key("entries", 7).raw("[", 1);
+    // Oldest first, so that load() restores the LRU order
+    for (auto it = lru.rbegin(); it != lru.rend(); ++it) {
+        if (it != lru.rbegin()) {
+            writer.raw(",", 1);
+        }
+        lcb::jsparse::Writer entry(contents);
+        entry.begin_object();
+        entry.key("statement", 9).string((*it)->key);
+        (*it)->apply_plan(entry);
+        entry.end_object();
+    }
+    writer.raw("]", 1);
+    writer.end_object();
+
+    // Write to a temporary file first, so that other processes never load
+    // a partially written cache. The name is unique to this process and call,
+    // so that concurrent saves do not write into each other's file
+    static std::atomic<unsigned> nsaves{0};
+    std::string tmppath =
+        path + "." + std::to_string(getpid()) + "." + std::to_string(nsaves.fetch_add(1)) + ".tmp";
+    bool written;
+    {
+        std::ofstream ofs(tmppath.c_str(), std::ios::trunc | std::ios::binary);
+        if (!ofs.good()) {
+            lcb_log(settings, "n1ql", LCB_LOG_ERROR, __FILE__, __LINE__,
+                    "Couldn't open query cache file '%s' for writing: %s", tmppath.c_str(), strerror(errno));
+            return LCB_ERR_INVALID_ARGUMENT;
+        }
+        ofs.write(contents.c_str(), contents.size());
+        ofs.close();
+        written = ofs.good();
+    }
+    if (!written) {
+        std::remove(tmppath.c_str());
+        return LCB_ERR_GENERIC;
+    }
+    if (std::rename(tmppath.c_str(), path.c_str()) != 0) {
+        lcb_log(settings, "n1ql", LCB_LOG_ERROR, __FILE__, __LINE__, "Couldn't rename '%s' to '%s': %s",
+                tmppath.c_str(), path.c_str(), strerror(errno));
+        std::remove(tmppath.c_str());
+        return LCB_ERR_GENERIC;
+    }
+    lcb_log(settings, "n1ql", LCB_LOG_DEBUG, __FILE__, __LINE__, "Saved %lu prepared statements to '%s'",
+            (unsigned long)lru.size(), path.c_str());
+    return LCB_SUCCESS;
+}
+
+lcb_STATUS lcb_N1QLCACHE_st::load(const std::string &path)
+{
+    std::ifstream ifs(path.c_str(), std::ios::binary);
+    if (!ifs.good()) {
+        lcb_log(settings, "n1ql", LCB_LOG_ERROR, __FILE__, __LINE__, "Couldn't open query cache file '%s': %s",
+                path.c_str(), strerror(errno));
+        return LCB_ERR_INVALID_ARGUMENT;
+    }
+    std::string contents((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+    Json::Value root;
+    if (!parse_json(contents.c_str(), contents.size(), root) || !root.isObject() || root["version"] != 1 ||
+        !root["entries"].isArray()) {
+        lcb_log(settings, "n1ql", LCB_LOG_WARN, __FILE__, __LINE__, "Ignoring invalid query cache file '%s'",
+                path.c_str());
+        return LCB_ERR_PROTOCOL_ERROR;
+    }
+
+    size_t nloaded = 0;
+    for (const auto &entry : root["entries"]) {
+        if (!entry.isObject() || !entry["statement"].isString() || !entry["prepared"].isString()) {
+            continue;
+        }
+        Json::Value plan(Json::objectValue);
+        plan["name"] = entry["prepared"];
+        plan["encoded_plan"] = entry["encoded_plan"];
+        add_entry(entry["statement"].asString(), plan, entry.isMember("encoded_plan"));
+        nloaded++;
+    }
+    lcb_log(settings, "n1ql", LCB_LOG_DEBUG, __FILE__, __LINE__, "Loaded %lu prepared statements from '%s'",
+            (unsigned long)nloaded, path.c_str());
+    return LCB_SUCCESS;
+}
+
+lcb_N1QLCACHE *lcb_n1qlcache_create(lcb_settings *settings)
 {
-    return new lcb_N1QLCACHE;
+    return new lcb_N1QLCACHE(settings);
 }
 
 void lcb_n1qlcache_destroy(lcb_N1QLCACHE *cache)
 {
+    if (!cache->filename.empty()) {
+        cache->save(cache->filename);
+    }
     delete cache;
 }
 
+lcb_STATUS lcb_n1qlcache_set_file(lcb_N1QLCACHE *cache, const char *path)
+{
+    if (path == nullptr || *path == '\0') {
+        cache->filename.clear();
+        return LCB_SUCCESS;
+    }
+    // The file is created when the instance is destroyed if it does not exist yet
+    if (std::ifstream(path).good()) {
+        lcb_STATUS rc = cache->load(path);
+        if (rc != LCB_SUCCESS) {
+            return rc;
+        }
+    }
+    cache->filename = path;
+    return LCB_SUCCESS;
+}
+
+const char *lcb_n1qlcache_get_file(lcb_N1QLCACHE *cache)
+{
+    return cache->filename.empty() ? nullptr : cache->filename.c_str();
+}
+
+lcb_STATUS lcb_n1qlcache_save(lcb_N1QLCACHE *cache, const char *path)
+{
+    if (path == nullptr) {
+        if (cache->filename.empty()) {
+            return LCB_ERR_INVALID_ARGUMENT;
+        }
+        path = cache->filename.c_str();
+    }
+    return cache->save(path);
+}
+
+void lcb_n1qlcache_stats(lcb_N1QLCACHE *cache, lcb_QUERY_CACHE_STATS *stats)
+{
+    *stats = cache->stats;
+    stats->entries = cache->lru.size();
+    stats->bytes = cache->nbytes;
+}
+
 void lcb_n1qlcache_clear(lcb_N1QLCACHE *cache)
 {
     cache->clear();
@@ -348,10 +565,14 @@ void lcb_n1qlcache_clear(lcb_N1QLCACHE *cache)
 // the plan
 void lcb_n1qlcache_getplan(lcb_N1QLCACHE *cache, const std::string &key, std::string &out)
 {
-    const Plan *plan = cache->get_entry(key);
-    if (plan != nullptr) {
-        Json::Value tmp(Json::objectValue);
-        plan->apply_plan(tmp, out);
+    auto m = cache->find(key);
+    if (m != cache->by_hash.end()) {
+        const Plan *plan = *m->second;
+        out.clear();
+        lcb::jsparse::Writer writer(out);
+        writer.begin_object();
+        plan->apply_plan(writer);
+        writer.end_object();
     }
 }
 
@@ -371,7 +592,7 @@ lcb_STATUS N1QLREQ::request_address()
     }
     used_nodes.resize(LCBVB_NSERVERS(vbc));
 
-    int ix = lcbvb_get_randhost_ex(vbc, LCBVB_SVCTYPE_QUERY, mode, &used_nodes[0]);
+    int ix = instance->http_selector->select(vbc, LCBVB_SVCTYPE_QUERY, mode, &used_nodes[0]);
     if (ix < 0) {
         return LCB_ERR_UNSUPPORTED_OPERATION;
     }
@@ -753,7 +974,7 @@ static void prepare_rowcb(lcb_INSTANCE *instance, int, const lcb_RESPQUERY *row)
     }
 }
 
-lcb_STATUS N1QLREQ::issue_htreq(const std::string &body)
+lcb_STATUS N1QLREQ::issue_htreq(const std::string &payload)
 {
     lcb_STATUS rc = request_address();
     if (rc != LCB_SUCCESS) {
@@ -764,7 +985,7 @@ lcb_STATUS N1QLREQ::issue_htreq(const std::string &body)
 
     lcb_CMDHTTP *htcmd;
     lcb_cmdhttp_create(&htcmd, LCB_HTTP_TYPE_QUERY);
-    lcb_cmdhttp_body(htcmd, body.c_str(), body.size());
+    lcb_cmdhttp_body(htcmd, payload.c_str(), payload.size());
     lcb_cmdhttp_content_type(htcmd, content_type.c_str(), content_type.size());
     lcb_cmdhttp_method(htcmd, LCB_HTTP_METHOD_POST);
     lcb_cmdhttp_streaming(htcmd, true);
@@ -785,6 +1006,9 @@ lcb_STATUS N1QLREQ::issue_htreq(const std::string &body)
     lcb_cmdhttp_destroy(htcmd);
     if (rc == LCB_SUCCESS) {
         htreq->set_callback(chunk_callback);
+        if (paused) {
+            htreq->pause_delivery();
+        }
     }
     return rc;
 }
@@ -811,9 +1035,8 @@ lcb_STATUS N1QLREQ::request_plan()
 lcb_STATUS N1QLREQ::apply_plan(const Plan &plan)
 {
     lcb_log(LOGARGS(this, DEBUG), LOGFMT "Using prepared plan", LOGID(this));
-    std::string bodystr;
-    plan.apply_plan(json, bodystr);
-    return issue_htreq(bodystr);
+    encode_body(&plan);
+    return issue_htreq(body);
 }
 
 lcb_U32 lcb_n1qlreq_parsetmo(const std::string &s)
@@ -855,14 +1078,12 @@ lcb_QUERY_HANDLE_::lcb_QUERY_HANDLE_(lcb_INSTANCE *obj, void *user_cookie, const
         *cmd->handle = this;
     }
 
-    if (flags & LCB_CMDN1QL_F_JSONQUERY) {
-        json = cmd->root;
-    } else {
-        std::string encoded = Json::FastWriter().write(cmd->root);
-        if (!parse_json(encoded.c_str(), encoded.size(), json)) {
-            lasterr = LCB_ERR_INVALID_ARGUMENT;
-            return;
-        }
+    json = cmd->root;
+    params = cmd->params;
+    scan_vectors = cmd->scan_vectors;
+    if (!json.isObject() && !json.isNull()) {
+        lasterr = LCB_ERR_INVALID_ARGUMENT;
+        return;
     }
     if (!cmd->scope_qualifier.empty()) {
         json["query_context"] = cmd->scope_qualifier;
@@ -960,7 +1181,7 @@ lcb_STATUS lcb_query(lcb_INSTANCE *instance, void *cookie, const lcb_CMDQUERY *c
 {
     lcb_STATUS err;
 
-    if ((cmd->query.empty() && cmd->root.empty()) || cmd->callback == nullptr) {
+    if ((cmd->query.empty() && cmd->root.empty() && cmd->params.empty()) || cmd->callback == nullptr) {
         return LCB_ERR_INVALID_ARGUMENT;
     }
     auto *req = new lcb_QUERY_HANDLE_(instance, cookie, cmd);
@@ -1021,6 +1242,34 @@ LIBCOUCHBASE_API lcb_STATUS lcb_query_cancel(lcb_INSTANCE *instance, lcb_QUERY_H
             handle->prepare_req = nullptr;
         }
         handle->callback = nullptr;
+        // the handle is destroyed once the next chunk arrives
+        if (handle->htreq) {
+            handle->htreq->resume_delivery();
+        }
+    }
+    return LCB_SUCCESS;
+}
+
+LIBCOUCHBASE_API lcb_STATUS lcb_query_pause(lcb_INSTANCE *, lcb_QUERY_HANDLE *handle)
+{
+    if (handle == nullptr) {
+        return LCB_ERR_INVALID_ARGUMENT;
+    }
+    handle->paused = true;
+    if (handle->htreq) {
+        handle->htreq->pause_delivery();
+    }
+    return LCB_SUCCESS;
+}
+
+LIBCOUCHBASE_API lcb_STATUS lcb_query_resume(lcb_INSTANCE *, lcb_QUERY_HANDLE *handle)
+{
+    if (handle == nullptr) {
+        return LCB_ERR_INVALID_ARGUMENT;
+    }
+    handle->paused = false;
+    if (handle->htreq) {
+        handle->htreq->resume_delivery();
     }
     return LCB_SUCCESS;
 }
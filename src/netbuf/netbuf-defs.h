@@ -18,6 +18,8 @@
 #ifndef NETBUF_DEFS_H
 #define NETBUF_DEFS_H
 
+#include <stddef.h>
+
 typedef struct netbuf_st nb_MGR;
 typedef unsigned int nb_SIZE;
 
@@ -53,6 +55,14 @@ typedef unsigned int nb_SIZE;
 #define NB_DATA_CACHEBLOCKS 16
 /** @brief Default data allocation size */
 #define NB_DATA_BASEALLOC 32768
+/**
+ * @brief Spans of at least this size get a block of their own
+ *
+ * Such a block is mapped directly from the OS and unmapped as soon as its
+ * span is released, rather than growing a pooled block which then lingers
+ * until all its other spans are released. Set to 0 to disable.
+ */
+#define NB_DATA_LARGE_THRESHOLD 262144
 /**@}*/
 
 typedef struct {
@@ -62,6 +72,7 @@ typedef struct {
     nb_SIZE dea_basealloc;
     nb_SIZE data_cacheblocks;
     nb_SIZE data_basealloc;
+    nb_SIZE data_large_threshold;
 } nb_SETTINGS;
 
 #ifndef _WIN32
@@ -189,6 +189,13 @@ typedef struct {
      */
     struct netbuf_mblock_dealloc_queue_st *deallocs;
     struct netbuf_mblock_st *parent;
+
+    /**
+     * Length of the mapping holding both this header and `root`, if this
+     * block was allocated for a single large span (see
+     * nb_SETTINGS::data_large_threshold). Zero for all other blocks.
+     */
+    size_t nmapped;
 } nb_MBLOCK;
 
 /**
@@ -214,6 +221,18 @@ typedef struct netbuf_mblock_st {
     nb_SIZE ncacheblocks;
 
     struct netbuf_st *mgr;
+
+    /** Bytes currently allocated for the buffers of the pool's blocks */
+    size_t nbytes;
+
+    /** Highest value of `nbytes` */
+    size_t peak_nbytes;
+
+    /** Number of block buffers allocated over the lifetime of the pool */
+    unsigned long nallocs;
+
+    /** Number of block buffers freed over the lifetime of the pool */
+    unsigned long nfrees;
 } nb_MBPOOL;
 
 /**
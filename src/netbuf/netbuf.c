@@ -26,6 +26,13 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
 #include "netbuf.h"
 #include "sllist-inl.h"
 
@@ -54,7 +61,7 @@ static void mblock_release_data(nb_MBPOOL *, nb_MBLOCK *, nb_SIZE, nb_SIZE);
 static void mblock_release_ptr(nb_MBPOOL *, char *, nb_SIZE);
 static void mblock_init(nb_MBPOOL *);
 static void mblock_cleanup(nb_MBPOOL *);
-static void mblock_wipe_block(nb_MBLOCK *block);
+static void mblock_wipe_block(nb_MBPOOL *, nb_MBLOCK *);
 
 /******************************************************************************
  ******************************************************************************
@@ -71,6 +78,21 @@ static int mblock_is_standalone(nb_MBLOCK *block)
     return block->parent == NULL;
 }
 
+static void pool_add_bytes(nb_MBPOOL *pool, size_t nbytes)
+{
+    pool->nbytes += nbytes;
+    pool->nallocs++;
+    if (pool->nbytes > pool->peak_nbytes) {
+        pool->peak_nbytes = pool->nbytes;
+    }
+}
+
+static void pool_remove_bytes(nb_MBPOOL *pool, size_t nbytes)
+{
+    pool->nbytes -= nbytes;
+    pool->nfrees++;
+}
+
 /**
  * Allocates a new block with at least the given capacity and places it
  * inside the active list.
@@ -112,6 +134,7 @@ static nb_MBLOCK *alloc_new_block(nb_MBPOOL *pool, nb_SIZE capacity)
         return NULL;
     }
 
+    pool_add_bytes(pool, ret->nalloc);
     return ret;
 }
 
@@ -360,7 +383,7 @@ static INLINE void mblock_release_data(nb_MBPOOL *pool, nb_MBLOCK *block, nb_SIZ
         sllist_append(&pool->avail, &block->slnode);
         pool->curblocks++;
     } else {
-        mblock_wipe_block(block);
+        mblock_wipe_block(pool, block);
     }
 }
 
@@ -424,10 +447,25 @@ static int mblock_get_next_size(const nb_MBPOOL *pool, int allow_wrap)
     return block->nalloc - block->wrap;
 }
 
-static void mblock_wipe_block(nb_MBLOCK *block)
+static void large_unmap(nb_MBLOCK *block)
 {
+#ifdef _WIN32
+    free(block);
+#else
+    munmap((void *)block, block->nmapped);
+#endif
+}
+
+static void mblock_wipe_block(nb_MBPOOL *pool, nb_MBLOCK *block)
+{
+    if (block->nmapped) {
+        pool_remove_bytes(pool, block->nmapped);
+        large_unmap(block);
+        return;
+    }
     if (block->root) {
         free(block->root);
+        pool_remove_bytes(pool, block->nalloc);
     }
     if (block->deallocs) {
         sllist_iterator dea_iter;
@@ -457,9 +495,8 @@ static void free_blocklist(nb_MBPOOL *pool, sllist_root *list)
     {
         nb_MBLOCK *block = SLLIST_ITEM(iter.cur, nb_MBLOCK, slnode);
         sllist_iter_remove(list, &iter);
-        mblock_wipe_block(block);
+        mblock_wipe_block(pool, block);
     }
-    (void)pool;
 }
 
 static void mblock_cleanup(nb_MBPOOL *pool)
@@ -481,11 +518,103 @@ static void mblock_init(nb_MBPOOL *pool)
     }
 }
 
+#ifndef NETBUF_LIBC_PROXY
+/** Allocations at least this large are advised to use transparent huge pages */
+#define NB_HUGEPAGE_SIZE (2 * 1024 * 1024)
+
+/**
+ * Reserve a span in a block of its own, mapped directly rather than taken
+ * from the data pool. The block header is placed at the start of the mapping,
+ * followed by the span's buffer.
+ */
+static int large_reserve(nb_MBPOOL *pool, nb_SPAN *span)
+{
+    nb_MBLOCK *block;
+    size_t nmapped = sizeof(*block) + span->size;
+
+#ifdef _WIN32
+    block = malloc(nmapped);
+    if (!block) {
+        return -1;
+    }
+#else
+    void *addr = mmap(NULL, nmapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED) {
+        return -1;
+    }
+#ifdef MADV_HUGEPAGE
+    if (nmapped >= NB_HUGEPAGE_SIZE) {
+        madvise(addr, nmapped, MADV_HUGEPAGE);
+    }
+#endif
+    block = addr;
+#endif
+
+    memset(block, 0, sizeof(*block));
+    block->root = (char *)(block + 1);
+    block->nalloc = span->size;
+    block->wrap = span->size;
+    block->cursor = span->size;
+    block->nmapped = nmapped;
+    sllist_append(&pool->active, &block->slnode);
+    pool_add_bytes(pool, nmapped);
+
+    span->parent = block;
+    span->offset = 0;
+    return 0;
+}
+
+static void large_release(nb_MBPOOL *pool, nb_MBLOCK *block)
+{
+    sllist_remove(&pool->active, &block->slnode);
+    mblock_wipe_block(pool, block);
+}
+#endif /* NETBUF_LIBC_PROXY */
+
 int netbuf_mblock_reserve(nb_MGR *mgr, nb_SPAN *span)
 {
+#ifndef NETBUF_LIBC_PROXY
+    if (mgr->settings.data_large_threshold && span->size >= mgr->settings.data_large_threshold) {
+        return large_reserve(&mgr->largepool, span);
+    }
+#endif
     return mblock_reserve_data(&mgr->datapool, span);
 }
 
+int netbuf_mblock_reserve_multi(nb_MGR *mgr, nb_SPAN *spans, unsigned nspans)
+{
+    unsigned ii;
+#ifndef NETBUF_LIBC_PROXY
+    nb_SPAN region;
+    nb_SIZE offset;
+
+    region.size = 0;
+    for (ii = 0; ii < nspans; ii++) {
+        region.size += spans[ii].size;
+    }
+    if (mgr->settings.data_large_threshold == 0 || region.size < mgr->settings.data_large_threshold) {
+        if (mblock_reserve_data(&mgr->datapool, &region) != 0) {
+            return -1;
+        }
+        for (ii = 0, offset = region.offset; ii < nspans; ii++) {
+            spans[ii].parent = region.parent;
+            spans[ii].offset = offset;
+            offset += spans[ii].size;
+        }
+        return 0;
+    }
+#endif
+    for (ii = 0; ii < nspans; ii++) {
+        if (netbuf_mblock_reserve(mgr, &spans[ii]) != 0) {
+            while (ii--) {
+                netbuf_mblock_release(mgr, &spans[ii]);
+            }
+            return -1;
+        }
+    }
+    return 0;
+}
+
 /******************************************************************************
  ******************************************************************************
  ** Informational Routines                                                   **
@@ -685,7 +814,11 @@ void netbuf_mblock_release(nb_MGR *mgr, nb_SPAN *span)
     free(span->parent);
     (void)mgr;
 #else
-    mblock_release_data(&mgr->datapool, span->parent, span->size, span->offset);
+    if (span->parent->nmapped) {
+        large_release(&mgr->largepool, span->parent);
+    } else {
+        mblock_release_data(&mgr->datapool, span->parent, span->size, span->offset);
+    }
 #endif
 }
 
@@ -698,6 +831,7 @@ void netbuf_default_settings(nb_SETTINGS *settings)
 {
     settings->data_basealloc = NB_DATA_BASEALLOC;
     settings->data_cacheblocks = NB_DATA_CACHEBLOCKS;
+    settings->data_large_threshold = NB_DATA_LARGE_THRESHOLD;
     settings->dea_basealloc = NB_MBDEALLOC_BASEALLOC;
     settings->dea_cacheblocks = NB_MBDEALLOC_CACHEBLOCKS;
     settings->sndq_basealloc = NB_SNDQ_BASEALLOC;
@@ -727,6 +861,8 @@ void netbuf_init(nb_MGR *mgr, const nb_SETTINGS *user_settings)
     bufpool->ncacheblocks = mgr->settings.data_cacheblocks;
     bufpool->mgr = mgr;
     mblock_init(bufpool);
+
+    mgr->largepool.mgr = mgr;
 }
 
 void netbuf_cleanup(nb_MGR *mgr)
@@ -742,6 +878,7 @@ void netbuf_cleanup(nb_MGR *mgr)
 
     mblock_cleanup(&mgr->sendq.elempool);
     mblock_cleanup(&mgr->datapool);
+    mblock_cleanup(&mgr->largepool);
 }
 
 /******************************************************************************
@@ -803,6 +940,12 @@ static void dump_sendq(nb_SENDQ *q, FILE *fp)
     }
 }
 
+static void dump_pool_stats(const char *name, const nb_MBPOOL *pool, FILE *fp)
+{
+    fprintf(fp, "%s: HELD=%luB, PEAK=%luB, ALLOCS=%lu, FREES=%lu\n", name, (unsigned long)pool->nbytes,
+            (unsigned long)pool->peak_nbytes, pool->nallocs, pool->nfrees);
+}
+
 void netbuf_dump_status(nb_MGR *mgr, FILE *fp)
 {
     sllist_node *ll;
@@ -821,7 +964,24 @@ void netbuf_dump_status(nb_MGR *mgr, FILE *fp)
         const char *indent = "    ";
         fprintf(fp, "%sBLOCK(AVAIL)=%p; BUF=%p, %uB\n", indent, (void *)block, (void *)block->root, block->nalloc);
     }
+    fprintf(fp, "LARGE:\n");
+    SLLIST_FOREACH(&mgr->largepool.active, ll)
+    {
+        nb_MBLOCK *block = SLLIST_ITEM(ll, nb_MBLOCK, slnode);
+        const char *indent = "    ";
+        fprintf(fp, "%sBLOCK(LARGE)=%p; BUF=%p, %uB\n", indent, (void *)block, (void *)block->root, block->nalloc);
+    }
     dump_sendq(&mgr->sendq, fp);
+    fprintf(fp, "Allocations\n");
+    dump_pool_stats("  DATA", &mgr->datapool, fp);
+    dump_pool_stats("  LARGE", &mgr->largepool, fp);
+    dump_pool_stats("  SENDQ", &mgr->sendq.elempool, fp);
+    fprintf(fp, "  TOTAL: HELD=%luB\n", (unsigned long)netbuf_get_allocated(mgr));
+}
+
+size_t netbuf_get_allocated(const nb_MGR *mgr)
+{
+    return mgr->datapool.nbytes + mgr->largepool.nbytes + mgr->sendq.elempool.nbytes;
 }
 
 static int is_pool_clean(const nb_MBPOOL *pool, int is_dealloc)
@@ -863,6 +1023,11 @@ int netbuf_is_clean(nb_MGR *mgr)
         ret = 0;
     }
 
+    if (!SLLIST_IS_EMPTY(&mgr->largepool.active)) {
+        printf("LARGE @%p: Still have unreleased large spans\n", (void *)mgr);
+        ret = 0;
+    }
+
     if (!SLLIST_IS_EMPTY(&mgr->sendq.pending)) {
         printf("SENDQ @%p: Still have pending flush items\n", (void *)mgr);
         ret = 0;
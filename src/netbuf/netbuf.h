@@ -132,6 +132,13 @@ struct netbuf_st {
     /** Pool for variable-size data */
     nb_MBPOOL datapool;
 
+    /**
+     * Blocks of spans larger than nb_SETTINGS::data_large_threshold. Each
+     * block holds a single span and is kept in the `active` list until the
+     * span is released.
+     */
+    nb_MBPOOL largepool;
+
     nb_SETTINGS settings;
 };
 
@@ -170,10 +177,28 @@ struct netbuf_st {
  * The contents of the span are guaranteed to be contiguous (though not aligned)
  * and are available via the SPAN_BUFFER macro.
  *
+ * Spans of at least nb_SETTINGS::data_large_threshold bytes are instead
+ * given a block of their own, which is returned to the OS once the span is
+ * released.
+ *
  * @return 0 if successful, -1 on error
  */
 int netbuf_mblock_reserve(nb_MGR *mgr, nb_SPAN *span);
 
+/**
+ * @brief allocate several spans at once
+ *
+ * Reserve the spans (whose sizes are set by the caller) as a single region,
+ * one span right after the other, so that they are flushed together. Each
+ * span may still be released on its own with netbuf_mblock_release().
+ *
+ * If the region would be a large span (see netbuf_mblock_reserve()), the spans
+ * are reserved one by one instead.
+ *
+ * @return 0 if successful, -1 on error, in which case no span is reserved
+ */
+int netbuf_mblock_reserve_multi(nb_MGR *mgr, nb_SPAN *spans, unsigned nspans);
+
 /**
  * @brief release a span
  *
@@ -347,11 +372,19 @@ void netbuf_cleanup(nb_MGR *mgr);
 void netbuf_default_settings(nb_SETTINGS *settings);
 
 /**
- * Dump the internal structure of the manager to the screen. Useful for
- * debugging.
+ * Dump the internal structure of the manager to the screen, along with its
+ * allocation statistics. Useful for debugging.
  */
 void netbuf_dump_status(nb_MGR *mgr, FILE *fp);
 
+/**
+ * Get the number of bytes the manager currently holds for its buffers: the
+ * pooled blocks (whether in use or cached for reuse) and the blocks of large
+ * spans. Once a workload reaches a steady state this is the manager's share
+ * of the resident size of the process.
+ */
+size_t netbuf_get_allocated(const nb_MGR *mgr);
+
 /**
  * Mark a PDU as being enqueued. This should be called whenever the final IOV
  * for a given PDU has just been enqueued.
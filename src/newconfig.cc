@@ -18,6 +18,8 @@
 #include "internal.h"
 #include "packetutils.h"
 #include "bucketconfig/clconfig.h"
+#include "http/http.h"
+#include "http/selector.h"
 #include "vbucket/aliases.h"
 #include "sllist-inl.h"
 
@@ -62,6 +64,7 @@ static int should_keep_guess(lcb_GUESSVB *guess, lcbvb_VBUCKET *vb)
 void lcb_vbguess_newconfig(lcb_INSTANCE *instance, lcbvb_CONFIG *cfg, lcb_GUESSVB *guesses)
 {
     unsigned ii;
+    bool remapped = false;
 
     if (!guesses) {
         return;
@@ -81,6 +84,7 @@ void lcb_vbguess_newconfig(lcb_INSTANCE *instance, lcbvb_CONFIG *cfg, lcb_GUESSV
             lcb_log(LOGARGS(instance, TRACE), "Keeping heuristically guessed index. VBID=%d. Current=%d. Old=%d.", ii,
                     guess->newix, guess->oldix);
             vb->servers[0] = guess->newix;
+            remapped = true;
         } else {
             /* We don't reassign to the guess structure here. The idea is that
              * we will simply use the new config. If this gives us problems, the
@@ -91,6 +95,10 @@ void lcb_vbguess_newconfig(lcb_INSTANCE *instance, lcbvb_CONFIG *cfg, lcb_GUESSV
             guess->used = 0;
         }
     }
+
+    if (remapped) {
+        lcbvb_update_routes(cfg);
+    }
 }
 
 int lcb_vbguess_remap(lcb_INSTANCE *instance, int vbid, int bad)
@@ -101,6 +109,7 @@ int lcb_vbguess_remap(lcb_INSTANCE *instance, int vbid, int bad)
 
     if (LCBT_SETTING(instance, vb_noguess)) {
         int newix = lcbvb_nmv_remap_ex(LCBT_VBCONFIG(instance), vbid, bad, 0);
+        mcreq_queue_refresh_vbroute(&instance->cmdq, vbid);
         if (newix > -1 && newix != bad) {
             lcb_log(LOGARGS(instance, TRACE), "Got new index from ffmap. VBID=%d. Old=%d. New=%d", vbid, bad, newix);
         }
@@ -114,6 +123,7 @@ int lcb_vbguess_remap(lcb_INSTANCE *instance, int vbid, int bad)
         }
         lcb_GUESSVB *guess = guesses + vbid;
         int newix = lcbvb_nmv_remap_ex(LCBT_VBCONFIG(instance), vbid, bad, 1);
+        mcreq_queue_refresh_vbroute(&instance->cmdq, vbid);
         if (newix > -1 && newix != bad) {
             guess->newix = static_cast<char>(newix);
             guess->oldix = static_cast<char>(bad);
@@ -342,6 +352,16 @@ void lcb_update_vbconfig(lcb_INSTANCE *instance, lcb_pCONFIGINFO config)
         mcreq_queue_add_pipelines(q, &servers[0], nservers, config->vbc);
     }
 
+    if (LCBT_SETTING(instance, kv_prewarm)) {
+        for (size_t ii = 0; ii < LCBT_NSERVERS(instance); ++ii) {
+            instance->get_server(ii)->prewarm();
+        }
+    }
+    lcb::http::warmup_pool(instance);
+    if (instance->http_selector) {
+        instance->http_selector->prune(config->vbc);
+    }
+
     /* Update the list of nodes here for server list */
     instance->ht_nodes->clear();
     for (size_t ii = 0; ii < LCBVB_NSERVERS(config->vbc); ++ii) {
@@ -0,0 +1,117 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "internal.h"
+#include "bulk.h"
+
+using namespace lcb;
+
+static void bulk_callback(mc_PIPELINE *, mc_PACKET *pkt, lcb_STATUS err, const void *arg)
+{
+    auto *item = static_cast<BulkItem *>(pkt->u_rdata.exdata);
+    BulkRequest *req = item->parent;
+    auto *resp = reinterpret_cast<lcb_RESPBASE *>(const_cast<void *>(arg));
+    if (resp) {
+        resp->cookie = req->cookie;
+        lcb_find_callback(req->instance, req->cbtype)(req->instance, req->cbtype, resp);
+        err = resp->ctx.rc;
+    }
+    req->complete(item->index, err);
+}
+
+static void bulk_dtor(mc_PACKET *pkt)
+{
+    static_cast<BulkItem *>(pkt->u_rdata.exdata)->parent->unref();
+}
+
+static mc_REQDATAPROCS bulk_procs = {bulk_callback, bulk_dtor};
+
+BulkItem::BulkItem(BulkRequest *parent_, size_t index_)
+    : mc_REQDATAEX(parent_->cookie, bulk_procs, 0), parent(parent_), index(index_)
+{
+}
+
+BulkRequest::BulkRequest(lcb_INSTANCE *instance_, void *cookie_, lcb_CALLBACK_TYPE cbtype_,
+                         lcb_BULK_CALLBACK callback_, const char *const *keys, const size_t *keys_len,
+                         const char *const *values, const size_t *values_len, size_t nitems)
+    : instance(instance_), cookie(cookie_), cbtype(cbtype_), callback(callback_), batch(nitems),
+      statuses(nitems, LCB_SUCCESS), pending(0), refcount(1)
+{
+    items.reserve(nitems);
+    for (size_t ii = 0; ii < nitems; ii++) {
+        batch[ii].key = keys[ii];
+        batch[ii].nkey = keys_len[ii];
+        if (values) {
+            batch[ii].value = values[ii];
+            batch[ii].nvalue = values_len[ii];
+        }
+        items.emplace_back(this, ii);
+    }
+}
+
+void BulkRequest::own()
+{
+    size_t total = 0;
+    for (const auto &item : batch) {
+        total += item.nkey + item.nvalue;
+    }
+    storage.reserve(total);
+    for (const auto &item : batch) {
+        storage.append(static_cast<const char *>(item.key), item.nkey);
+        storage.append(static_cast<const char *>(item.value), item.nvalue);
+    }
+    const char *pos = storage.data();
+    for (auto &item : batch) {
+        item.key = pos;
+        item.value = pos + item.nkey;
+        pos += item.nkey + item.nvalue;
+    }
+}
+
+void BulkRequest::fail(lcb_STATUS rc)
+{
+    lcb_RESPCALLBACK cb = lcb_find_callback(instance, cbtype);
+    for (size_t ii = 0; ii < batch.size(); ii++) {
+        lcb_RESPGET get{};
+        lcb_RESPSTORE store{};
+        lcb_RESPBASE *resp;
+        if (cbtype == LCB_CALLBACK_STORE) {
+            resp = reinterpret_cast<lcb_RESPBASE *>(&store);
+        } else {
+            resp = reinterpret_cast<lcb_RESPBASE *>(&get);
+        }
+        resp->ctx.rc = rc;
+        resp->ctx.key = static_cast<const char *>(batch[ii].key);
+        resp->ctx.key_len = batch[ii].nkey;
+        resp->cookie = cookie;
+        resp->rflags = LCB_RESP_F_FINAL;
+        cb(instance, cbtype, resp);
+        statuses[ii] = rc;
+    }
+    if (callback) {
+        callback(instance, cookie, statuses.data(), statuses.size());
+    }
+}
+
+void BulkRequest::complete(size_t index, lcb_STATUS rc)
+{
+    statuses[index] = rc;
+    if (--pending == 0 && callback) {
+        callback(instance, cookie, statuses.data(), statuses.size());
+    }
+    unref();
+}
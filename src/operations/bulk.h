@@ -0,0 +1,244 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LCB_BULK_H
+#define LCB_BULK_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "collections.h"
+
+namespace lcb
+{
+class BulkRequest;
+
+/** Request data of the packet of one key of a bulk operation */
+struct BulkItem : mc_REQDATAEX {
+    BulkItem(BulkRequest *parent, size_t index);
+
+    BulkRequest *parent;
+    size_t index;
+};
+
+/**
+ * State of a bulk operation (see lcb_get_multi()), shared by the packets of
+ * all its keys.
+ *
+ * The request is reference counted: the caller holds a reference until it is
+ * done scheduling, and each scheduled packet holds one until it completes.
+ */
+class BulkRequest
+{
+  public:
+    BulkRequest(lcb_INSTANCE *instance, void *cookie, lcb_CALLBACK_TYPE cbtype, lcb_BULK_CALLBACK callback,
+                const char *const *keys, const size_t *keys_len, const char *const *values, const size_t *values_len,
+                size_t nitems);
+
+    /**
+     * Copy the keys and values, so that they can be scheduled once the
+     * operation returned (i.e. after its collection is resolved)
+     */
+    void own();
+
+    /**
+     * Schedule a packet for each key. The packets of each pipeline are built
+     * together, see mcreq_batch_packets().
+     *
+     * @param hdrsize size of the header (and extras) of each packet
+     * @param cid collection ID of the keys
+     * @param timeout operation timeout, in microseconds
+     * @param encoder provides `bool copy_values(mc_PIPELINE *)`, which tells
+     *        whether the values should be copied with the keys, and
+     *        `lcb_STATUS encode(mc_PIPELINE *, mc_PACKET *, const mc_BATCHITEM *)`,
+     *        which writes the header of a packet (and the value, if not copied)
+     * @return an error if the keys could not be scheduled, in which case none
+     *         of them are
+     */
+    template <typename Encoder>
+    lcb_STATUS schedule(uint8_t hdrsize, uint32_t cid, uint32_t timeout, Encoder &encoder);
+
+    /**
+     * Schedule the keys in the collection of `cmd`. If the collection ID is
+     * not cached, it is resolved first (once, for all the keys), and errors
+     * from then on are reported through fail() rather than returned.
+     *
+     * @param cmd the template command of the operation
+     * @param dup clones `cmd` (e.g. lcb_cmdget_clone)
+     * @param dtor destroys the clone (e.g. lcb_cmdget_destroy)
+     */
+    template <typename Command, typename Encoder, typename Duplicator, typename Destructor>
+    lcb_STATUS dispatch(const Command *cmd, uint8_t hdrsize, uint32_t timeout, Encoder encoder, Duplicator dup,
+                        Destructor dtor);
+
+    /** Complete all the keys with an error, without scheduling them */
+    void fail(lcb_STATUS rc);
+
+    /** Record the status of a key, and invoke the callback once all completed */
+    void complete(size_t index, lcb_STATUS rc);
+
+    void ref()
+    {
+        refcount++;
+    }
+
+    void unref()
+    {
+        if (--refcount == 0) {
+            delete this;
+        }
+    }
+
+    size_t size() const
+    {
+        return batch.size();
+    }
+
+    const mc_BATCHITEM &operator[](size_t index) const
+    {
+        return batch[index];
+    }
+
+    lcb_INSTANCE *instance;
+    void *cookie;
+    lcb_CALLBACK_TYPE cbtype;
+
+  private:
+    lcb_BULK_CALLBACK callback;
+    std::vector<mc_BATCHITEM> batch;
+    std::vector<BulkItem> items;
+    std::vector<lcb_STATUS> statuses;
+    /** Keys and values, once owned */
+    std::string storage;
+    size_t pending;
+    size_t refcount;
+};
+
+template <typename Encoder>
+lcb_STATUS BulkRequest::schedule(uint8_t hdrsize, uint32_t cid, uint32_t timeout, Encoder &encoder)
+{
+    mc_CMDQUEUE *cq = &instance->cmdq;
+    lcb_STATUS rc = mcreq_map_batch(cq, batch.data(), batch.size(), MCREQ_BASICPACKET_F_FALLBACKOK);
+    if (rc != LCB_SUCCESS) {
+        return rc;
+    }
+
+    /* sort the keys by pipeline, keeping their order within each pipeline */
+    std::vector<size_t> offsets(cq->_npipelines_ex + 1, 0);
+    for (const auto &item : batch) {
+        offsets[item.pipeline->index + 1]++;
+    }
+    for (size_t ii = 1; ii < offsets.size(); ii++) {
+        offsets[ii] += offsets[ii - 1];
+    }
+    std::vector<size_t> order(batch.size());
+    std::vector<mc_BATCHITEM> sorted(batch.size());
+    {
+        std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+        for (size_t ii = 0; ii < batch.size(); ii++) {
+            size_t pos = next[batch[ii].pipeline->index]++;
+            order[pos] = ii;
+            sorted[pos] = batch[ii];
+        }
+    }
+
+    std::vector<mc_PACKET *> packets(batch.size());
+    size_t nbuilt = 0;
+    for (unsigned ix = 0; ix < cq->_npipelines_ex && rc == LCB_SUCCESS; ix++) {
+        size_t begin = offsets[ix], count = offsets[ix + 1] - begin;
+        if (count == 0) {
+            continue;
+        }
+        mc_PIPELINE *pl = sorted[begin].pipeline;
+        bool copy_values = encoder.copy_values(pl);
+        if (!copy_values) {
+            for (size_t ii = begin; ii < begin + count; ii++) {
+                sorted[ii].nvalue = 0;
+            }
+        }
+        rc = mcreq_batch_packets(pl, &sorted[begin], count, hdrsize, cid, &packets[begin]);
+        if (rc != LCB_SUCCESS) {
+            break;
+        }
+        nbuilt = begin + count;
+        for (size_t ii = begin; ii < begin + count && rc == LCB_SUCCESS; ii++) {
+            mc_BATCHITEM item = batch[order[ii]];
+            item.vbid = sorted[ii].vbid;
+            rc = encoder.encode(pl, packets[ii], &item);
+        }
+    }
+
+    if (rc != LCB_SUCCESS) {
+        for (size_t ii = 0; ii < nbuilt; ii++) {
+            mc_PIPELINE *pl = sorted[ii].pipeline;
+            mcreq_wipe_packet(pl, packets[ii]);
+            mcreq_release_packet(pl, packets[ii]);
+        }
+        return rc;
+    }
+
+    hrtime_t now = gethrtime();
+    for (size_t ii = 0; ii < packets.size(); ii++) {
+        BulkItem &item = items[order[ii]];
+        item.start = now;
+        item.deadline = now + LCB_US2NS(timeout);
+        packets[ii]->u_rdata.exdata = &item;
+        packets[ii]->flags |= MCREQ_F_REQEXT;
+        ref();
+        mcreq_sched_add(sorted[ii].pipeline, packets[ii]);
+    }
+    pending = batch.size();
+    MAYBE_SCHEDLEAVE(instance)
+    return LCB_SUCCESS;
+}
+
+template <typename Command, typename Encoder, typename Duplicator, typename Destructor>
+lcb_STATUS BulkRequest::dispatch(const Command *cmd, uint8_t hdrsize, uint32_t timeout, Encoder encoder, Duplicator dup,
+                                 Destructor dtor)
+{
+    if (!LCBT_SETTING(instance, use_collections)) {
+        /* fast path if collections are not enabled */
+        return schedule(hdrsize, 0, timeout, encoder);
+    }
+
+    uint32_t cid = 0;
+    if (collcache_get(instance, cmd->scope, cmd->nscope, cmd->collection, cmd->ncollection, &cid) == LCB_SUCCESS) {
+        return schedule(hdrsize, cid, timeout, encoder);
+    }
+
+    /* the keys are scheduled once the collection is resolved, after this returns */
+    own();
+    Command lookup = *cmd; /* shallow clone, keyed for the collection lookup */
+    LCB_CMD_SET_KEY(&lookup, batch[0].key, batch[0].nkey);
+    ref();
+    std::shared_ptr<BulkRequest> self(this, [](BulkRequest *req) { req->unref(); });
+    auto operation = [self, hdrsize, timeout, encoder](const lcb_RESPGETCID *resp, const Command *resolved) mutable {
+        lcb_STATUS rc = resp->ctx.rc;
+        if (rc == LCB_SUCCESS) {
+            rc = self->schedule(hdrsize, resolved->cid, timeout, encoder);
+        }
+        if (rc != LCB_SUCCESS) {
+            self->fail(rc);
+        }
+        return rc;
+    };
+    return collcache_resolve(instance, &lookup, operation, dup, dtor);
+}
+} // namespace lcb
+
+#endif
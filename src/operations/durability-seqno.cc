@@ -19,10 +19,33 @@
 #include "internal.h"
 #include "durability_internal.h"
 
+#include <algorithm>
+#include <map>
+
 using namespace lcb::durability;
 
+#define LOGARGS(c, lvl) (c)->instance->settings, "endure", LCB_LOG_##lvl, __FILE__, __LINE__
+
 namespace
 {
+/**
+ * OBSERVE_SEQNO reports the state of the whole vBucket, so a single probe
+ * to a server answers for every item in the vBucket (with the same UUID)
+ * that still needs that server. Items are grouped accordingly for each poll.
+ */
+struct PollGroup : public CallbackCookie {
+    lcb_U64 uuid;
+    lcb_U64 maxseqno; /**< Highest sequence number required by the items */
+    lcb_U16 vbid;
+    lcb_U16 server_index;
+    std::vector< Item * > items;
+
+    PollGroup(lcb_U64 uuid_, lcb_U16 vbid_, lcb_U16 server_index_)
+        : uuid(uuid_), maxseqno(0), vbid(vbid_), server_index(server_index_)
+    {
+    }
+};
+
 class SeqnoDurset : public Durset
 {
   public:
@@ -34,7 +57,8 @@ class SeqnoDurset : public Durset
     // Override
     lcb_STATUS after_add(Item &item, const lcb_CMDENDURE *cmd);
 
-    void update(const lcb_RESPOBSEQNO *resp);
+    /** Probes for the current poll. Not modified while responses are pending */
+    std::vector< PollGroup > groups;
 };
 } // namespace
 
@@ -45,16 +69,11 @@ Durset *Durset::createSeqnoDurset(lcb_INSTANCE *instance, const lcb_durability_o
 
 #define ENT_SEQNO(ent) (ent)->reqseqno
 
-static void seqno_callback(lcb_INSTANCE *, int, const lcb_RESPBASE *rb)
+static void update_item(Item *ent, const lcb_RESPOBSEQNO *resp)
 {
-    const lcb_RESPOBSEQNO *resp = (const lcb_RESPOBSEQNO *)rb;
-    int flags = 0;
-    Item *ent = static_cast< Item * >(reinterpret_cast< CallbackCookie * >(resp->cookie));
-
-    /* Now, process the response */
     if (resp->ctx.rc != LCB_SUCCESS) {
         ent->res().ctx.rc = resp->ctx.rc;
-        goto GT_TALLY;
+        return;
     }
 
     lcb_U64 seqno_mem, seqno_disk;
@@ -63,7 +82,7 @@ static void seqno_callback(lcb_INSTANCE *, int, const lcb_RESPBASE *rb)
         seqno_mem = seqno_disk = resp->old_seqno;
         if (seqno_mem < ENT_SEQNO(ent)) {
             ent->finish(LCB_ERR_MUTATION_LOST);
-            goto GT_TALLY;
+            return;
         }
     } else {
         seqno_mem = resp->mem_seqno;
@@ -71,21 +90,40 @@ static void seqno_callback(lcb_INSTANCE *, int, const lcb_RESPBASE *rb)
     }
 
     if (seqno_mem < ENT_SEQNO(ent)) {
-        goto GT_TALLY;
+        return;
     }
 
-    flags = Item::UPDATE_REPLICATED;
+    int flags = Item::UPDATE_REPLICATED;
     if (seqno_disk >= ENT_SEQNO(ent)) {
         flags |= Item::UPDATE_PERSISTED;
     }
 
     ent->update(flags, resp->server_index);
+}
+
+static void seqno_callback(lcb_INSTANCE *, int, const lcb_RESPBASE *rb)
+{
+    const lcb_RESPOBSEQNO *resp = (const lcb_RESPOBSEQNO *)rb;
+    PollGroup *group = static_cast< PollGroup * >(reinterpret_cast< CallbackCookie * >(resp->cookie));
+    Durset *dset = group->items.front()->parent;
 
-GT_TALLY:
-    if (!--ent->parent->waiting) {
+    for (size_t ii = 0; ii < group->items.size(); ii++) {
+        Item *ent = group->items[ii];
+        if (ent->done) {
+            continue;
+        }
+        if (resp->ctx.rc == LCB_SUCCESS && !resp->old_uuid && resp->persisted_seqno >= group->maxseqno) {
+            /* Persisted (and therefore also replicated) everything we asked for */
+            ent->update(Item::UPDATE_REPLICATED | Item::UPDATE_PERSISTED, resp->server_index);
+        } else {
+            update_item(ent, resp);
+        }
+    }
+
+    if (!--dset->waiting) {
         /* avoid ssertion (wait==0)! */
-        ent->parent->waiting = 1;
-        ent->parent->on_poll_done();
+        dset->waiting = 1;
+        dset->on_poll_done();
     }
 }
 
@@ -93,41 +131,61 @@ lcb_STATUS SeqnoDurset::poll_impl()
 {
     lcb_STATUS ret_err = LCB_ERR_SDK_INTERNAL; /* This should never be returned */
     bool has_ops = false;
+    std::map< std::pair< lcb_U32, lcb_U64 >, size_t > index;
 
-    lcb_sched_enter(instance);
+    groups.clear();
     for (size_t ii = 0; ii < entries.size(); ii++) {
         Item &ent = entries[ii];
         lcb_U16 servers[4];
-        lcb_CMDOBSEQNO cmd = {0};
 
         if (ent.done) {
             continue;
         }
 
-        cmd.uuid = ent.uuid;
-        cmd.vbid = ent.vbid;
-        cmd.cmdflags = LCB_CMD_F_INTERNAL_CALLBACK;
-        ent.callback = seqno_callback;
-
         size_t nservers = ent.prepare(servers);
         if (nservers == 0) {
             ret_err = LCB_ERR_DURABILITY_TOO_MANY;
             continue;
         }
         for (size_t jj = 0; jj < nservers; jj++) {
-            lcb_STATUS err;
-            cmd.server_index = servers[jj];
-            LCB_CMD_SET_TRACESPAN(&cmd, span);
-            err = lcb_observe_seqno3(instance, &ent.callback, &cmd);
-            if (err == LCB_SUCCESS) {
-                waiting++;
-                has_ops = true;
-            } else {
-                ent.res().ctx.rc = ret_err = err;
+            std::pair< lcb_U32, lcb_U64 > key(((lcb_U32)servers[jj] << 16) | ent.vbid, ent.uuid);
+            std::map< std::pair< lcb_U32, lcb_U64 >, size_t >::iterator it = index.find(key);
+            if (it == index.end()) {
+                it = index.insert(std::make_pair(key, groups.size())).first;
+                groups.push_back(PollGroup(ent.uuid, ent.vbid, servers[jj]));
+                groups.back().callback = seqno_callback;
+            }
+            PollGroup &group = groups[it->second];
+            group.items.push_back(&ent);
+            group.maxseqno = std::max(group.maxseqno, ENT_SEQNO(&ent));
+        }
+    }
+
+    lcb_sched_enter(instance);
+    for (size_t ii = 0; ii < groups.size(); ii++) {
+        PollGroup &group = groups[ii];
+        lcb_CMDOBSEQNO cmd = {0};
+        cmd.uuid = group.uuid;
+        cmd.vbid = group.vbid;
+        cmd.server_index = group.server_index;
+        cmd.cmdflags = LCB_CMD_F_INTERNAL_CALLBACK;
+        LCB_CMD_SET_TRACESPAN(&cmd, span);
+
+        lcb_STATUS err = lcb_observe_seqno3(instance, static_cast< CallbackCookie * >(&group), &cmd);
+        if (err == LCB_SUCCESS) {
+            waiting++;
+            has_ops = true;
+        } else {
+            ret_err = err;
+            for (size_t jj = 0; jj < group.items.size(); jj++) {
+                group.items[jj]->res().ctx.rc = err;
             }
         }
     }
     lcb_sched_leave(instance);
+    lcb_log(LOGARGS(this, TRACE), "Polling %u items with %u OBSEQNO requests", (unsigned)nremaining,
+            (unsigned)groups.size());
+
     if (!has_ops) {
         return ret_err;
     } else {
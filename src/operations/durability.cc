@@ -32,6 +32,9 @@ using namespace lcb::durability;
 
 static void timer_callback(lcb_socket_t sock, short which, void *arg);
 
+/** Shortest delay between two polls */
+#define DURABILITY_MIN_INTERVAL LCB_MS2US(1)
+
 bool Item::is_all_done() const
 {
     const lcb_DURABILITYOPTSv0 &opts = parent->opts;
@@ -157,6 +160,10 @@ void Item::update(int flags, int srvix)
     bool is_master = lcbvb_vbmaster(LCBT_VBCONFIG(instance), vbid) == srvix;
     const lcb::Server *server = instance->get_server(srvix);
 
+    if (info->server != server || (!info->persisted && (flags & UPDATE_PERSISTED)) ||
+        (!info->exists && (flags & UPDATE_REPLICATED))) {
+        parent->progress = true;
+    }
     info->clear();
     info->server = server;
 
@@ -207,6 +214,7 @@ void Item::finish()
 
     done = 1;
     parent->nremaining--;
+    parent->progress = true;
 
     /** Invoke the callback now :) */
     result.cookie = (void *)parent->cookie;
@@ -249,6 +257,19 @@ void Durset::on_poll_done()
     decref();
 }
 
+uint32_t Durset::next_interval()
+{
+    uint32_t initial = std::min(std::max(opts.interval / 16, (uint32_t)DURABILITY_MIN_INTERVAL), opts.interval);
+
+    if (progress || interval == 0) {
+        interval = initial;
+    } else if (interval < opts.interval) {
+        interval = std::min(interval * 2, opts.interval);
+    }
+    progress = false;
+    return interval;
+}
+
 /**
  * Schedules a single sweep of observe requests.
  * The `initial` parameter determines if this is a retry or if this is the
@@ -392,7 +413,8 @@ void lcbdurctx_set_durstore(lcb_MULTICMD_CTX *mctx, int enabled)
 
 Durset::Durset(lcb_INSTANCE *instance_, const lcb_durability_opts_t *options)
     : MultiCmdContext(), nremaining(0), waiting(0), refcnt(0), next_state(STATE_OBSPOLL), lasterr(LCB_SUCCESS),
-      is_durstore(false), cookie(NULL), ns_timeout(0), timer(NULL), instance(instance_), span(NULL)
+      is_durstore(false), cookie(NULL), ns_timeout(0), interval(0), progress(false), timer(NULL), instance(instance_),
+      span(NULL)
 {
     const lcb_DURABILITYOPTSv0 *opts_in = &options->v.v0;
 
@@ -553,8 +575,9 @@ void Durset::switch_state(State state)
             delay = 0;
         }
     } else if (state == STATE_OBSPOLL) {
-        if (now + LCB_US2NS(opts.interval) < ns_timeout) {
-            delay = opts.interval;
+        uint32_t next = next_interval();
+        if (now + LCB_US2NS(next) < ns_timeout) {
+            delay = next;
         } else {
             delay = 0;
             state = STATE_TIMEOUT;
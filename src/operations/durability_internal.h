@@ -194,6 +194,13 @@ struct Durset : public MultiCmdContext {
      */
     void on_poll_done();
 
+    /**
+     * Returns the delay before the next poll. This starts short and is
+     * doubled (up to the configured interval) for every poll after which no
+     * item made progress.
+     */
+    uint32_t next_interval();
+
     void incref()
     {
         refcnt++;
@@ -276,6 +283,8 @@ struct Durset : public MultiCmdContext {
     std::string kvbufs;  /**< Backing storage for key buffers */
     const void *cookie;  /**< User cookie */
     hrtime_t ns_timeout; /**< Timestamp of next timeout */
+    uint32_t interval;   /**< Current polling interval, in microseconds */
+    bool progress;       /**< Whether any item changed state since the last poll */
     void *timer;
     lcb_INSTANCE *instance;
     lcbtrace_SPAN *span;
@@ -18,6 +18,9 @@
 #include "internal.h"
 #include "collections.h"
 #include "trace.h"
+#include "hedge.h"
+#include "coalesce.h"
+#include "bulk.h"
 
 LIBCOUCHBASE_API lcb_STATUS lcb_respget_status(const lcb_RESPGET *resp)
 {
@@ -41,6 +44,11 @@ LIBCOUCHBASE_API lcb_STATUS lcb_respget_error_context(const lcb_RESPGET *resp, c
     return LCB_SUCCESS;
 }
 
+LIBCOUCHBASE_API int lcb_respget_is_replica(const lcb_RESPGET *resp)
+{
+    return (resp->rflags & LCB_RESP_F_REPLICA) != 0;
+}
+
 LIBCOUCHBASE_API lcb_STATUS lcb_respget_cookie(const lcb_RESPGET *resp, void **cookie)
 {
     *cookie = resp->cookie;
@@ -103,6 +111,16 @@ LIBCOUCHBASE_API lcb_STATUS lcb_cmdget_timeout(lcb_CMDGET *cmd, uint32_t timeout
     return LCB_SUCCESS;
 }
 
+LIBCOUCHBASE_API lcb_STATUS lcb_cmdget_hedge(lcb_CMDGET *cmd, int enable)
+{
+    if (enable) {
+        cmd->cmdflags |= LCB_CMDGET_F_HEDGE;
+    } else {
+        cmd->cmdflags &= ~LCB_CMDGET_F_HEDGE;
+    }
+    return LCB_SUCCESS;
+}
+
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdget_parent_span(lcb_CMDGET *cmd, lcbtrace_SPAN *span)
 {
     cmd->pspan = span;
@@ -150,10 +168,233 @@ static lcb_STATUS get_validate(lcb_INSTANCE *instance, const lcb_CMDGET *cmd)
     if (cmd->cas) {
         return LCB_ERR_OPTIONS_CONFLICT;
     }
+    if ((cmd->cmdflags & LCB_CMDGET_F_HEDGE) && (cmd->lock || cmd->exptime || (cmd->cmdflags & LCB_CMDGET_F_CLEAREXP))) {
+        return LCB_ERR_OPTIONS_CONFLICT;
+    }
 
     return LCB_SUCCESS;
 }
 
+/**
+ * State of a hedged get. It is shared by the get sent to the active node and
+ * the replica read (if one was sent), and is freed once both have completed.
+ */
+struct HedgeCookie : mc_REQDATAEX {
+    HedgeCookie(const void *cookie, lcb_INSTANCE *instance, const lcb_CMDGET *cmd, int vbucket, int master);
+
+    void hedge();
+    void handle(mc_PACKET *pkt, lcb_STATUS err, lcb_RESPGET *resp);
+    void deliver(lcb_RESPGET *resp, bool from_replica);
+
+    lcb_INSTANCE *instance;
+    lcb::io::Timer<HedgeCookie, &HedgeCookie::hedge> timer;
+    std::string key;
+    uint32_t cid;
+    int vbucket;
+    int master;
+    /** Packets which have not yet completed */
+    int remaining;
+    /** Error received from the active node, while the replica is pending */
+    lcb_STATUS active_error;
+    bool done;
+    bool internal_callback;
+};
+
+static void hedge_callback(mc_PIPELINE *, mc_PACKET *pkt, lcb_STATUS err, const void *arg)
+{
+    auto *hck = static_cast<HedgeCookie *>(pkt->u_rdata.exdata);
+    hck->handle(pkt, err, reinterpret_cast<lcb_RESPGET *>(const_cast<void *>(arg)));
+    if (--hck->remaining == 0) {
+        delete hck;
+    }
+}
+
+static void hedge_dtor(mc_PACKET *pkt)
+{
+    auto *hck = static_cast<HedgeCookie *>(pkt->u_rdata.exdata);
+    if (--hck->remaining == 0) {
+        delete hck;
+    }
+}
+
+static mc_REQDATAPROCS hedge_procs = {hedge_callback, hedge_dtor};
+
+HedgeCookie::HedgeCookie(const void *cookie_, lcb_INSTANCE *instance_, const lcb_CMDGET *cmd, int vbucket_,
+                         int master_)
+    : mc_REQDATAEX(cookie_, hedge_procs, gethrtime()), instance(instance_), timer(instance_->iotable, this),
+      key(static_cast<const char *>(cmd->key.contig.bytes), cmd->key.contig.nbytes), cid(cmd->cid),
+      vbucket(vbucket_), master(master_), remaining(1), active_error(LCB_SUCCESS), done(false),
+      internal_callback(cmd->cmdflags & LCB_CMD_F_INTERNAL_CALLBACK)
+{
+}
+
+/* Invoked when the active node has not responded within the hedge delay */
+void HedgeCookie::hedge()
+{
+    mc_CMDQUEUE *cq = &instance->cmdq;
+    if (done || cq->config == nullptr) {
+        return;
+    }
+
+    mc_PIPELINE *pl = nullptr;
+    for (unsigned ii = 0; ii < LCBT_NREPLICAS(instance); ii++) {
+        int ix = lcbvb_vbreplica(cq->config, vbucket, ii);
+        if (ix > -1 && ix != master && ix < static_cast<int>(cq->npipelines)) {
+            pl = cq->pipelines[ix];
+            break;
+        }
+    }
+    if (pl == nullptr) {
+        return;
+    }
+
+    mc_PACKET *pkt = mcreq_allocate_packet(pl);
+    if (!pkt) {
+        return;
+    }
+    pkt->u_rdata.exdata = this;
+    pkt->flags |= MCREQ_F_REQEXT;
+
+    lcb_KEYBUF kbuf;
+    LCB_KREQ_SIMPLE(&kbuf, key.c_str(), key.size());
+    protocol_binary_request_header req{};
+    mcreq_reserve_key(pl, pkt, sizeof(req.bytes), &kbuf, cid);
+    size_t nkey = pkt->kh_span.size - MCREQ_PKT_BASESIZE + pkt->extlen;
+    req.request.magic = PROTOCOL_BINARY_REQ;
+    req.request.opcode = PROTOCOL_BINARY_CMD_GET_REPLICA;
+    req.request.datatype = PROTOCOL_BINARY_RAW_BYTES;
+    req.request.vbucket = htons(static_cast<uint16_t>(vbucket));
+    req.request.keylen = htons(static_cast<uint16_t>(nkey));
+    req.request.bodylen = htonl(static_cast<uint32_t>(nkey));
+    req.request.opaque = pkt->opaque;
+    mcreq_write_hdr(pkt, &req);
+
+    remaining++;
+    instance->kv_hedge->issued++;
+    mcreq_sched_enter(cq);
+    mcreq_sched_add(pl, pkt);
+    mcreq_sched_leave(cq, 1);
+}
+
+void HedgeCookie::handle(mc_PACKET *pkt, lcb_STATUS err, lcb_RESPGET *resp)
+{
+    if (done) {
+        /* the other response was already delivered */
+        return;
+    }
+    protocol_binary_request_header hdr;
+    mcreq_read_hdr(pkt, &hdr);
+    bool from_replica = hdr.request.opcode == PROTOCOL_BINARY_CMD_GET_REPLICA;
+
+    if (err == LCB_SUCCESS || remaining == 1) {
+        if (err != LCB_SUCCESS && from_replica && active_error != LCB_SUCCESS) {
+            /* both failed: report the error of the active node */
+            resp->ctx.rc = active_error;
+            from_replica = false;
+        }
+        deliver(resp, from_replica);
+    } else if (!from_replica) {
+        if (err == LCB_ERR_DOCUMENT_NOT_FOUND) {
+            /* the active node is authoritative */
+            deliver(resp, false);
+        } else {
+            active_error = err;
+        }
+    }
+    /* otherwise the replica failed, wait for the active node */
+}
+
+void HedgeCookie::deliver(lcb_RESPGET *resp, bool from_replica)
+{
+    done = true;
+    timer.cancel();
+    resp->cookie = const_cast<void *>(cookie);
+    resp->rflags |= LCB_RESP_F_FINAL;
+    if (from_replica) {
+        resp->rflags |= LCB_RESP_F_REPLICA;
+        if (resp->ctx.rc == LCB_SUCCESS) {
+            instance->kv_hedge->won++;
+        }
+    }
+    const auto *base = reinterpret_cast<const lcb_RESPBASE *>(resp);
+    if (internal_callback) {
+        (*(lcb_RESPCALLBACK *)resp->cookie)(instance, LCB_CALLBACK_GET, base);
+    } else {
+        lcb_find_callback(instance, LCB_CALLBACK_GET)(instance, LCB_CALLBACK_GET, base);
+    }
+}
+
+/**
+ * A get sent to the server while coalescing is enabled. Gets for the same key
+ * scheduled before the response arrives are attached to it instead of being
+ * sent, and are completed with the same response.
+ */
+struct CoalesceCookie : mc_REQDATAEX {
+    CoalesceCookie(const void *cookie, lcb_INSTANCE *instance, std::string key);
+
+    lcb_INSTANCE *instance;
+    lcb::GetCoalescer::Flight flight;
+};
+
+static void coalesce_callback(mc_PIPELINE *, mc_PACKET *pkt, lcb_STATUS, const void *arg)
+{
+    auto *cck = static_cast<CoalesceCookie *>(pkt->u_rdata.exdata);
+    auto *resp = reinterpret_cast<lcb_RESPGET *>(const_cast<void *>(arg));
+    lcb_INSTANCE *instance = cck->instance;
+
+    /* gets scheduled from the callbacks must not be attached to this one */
+    instance->kv_coalesce->remove(&cck->flight);
+
+    lcb_RESPCALLBACK cb = lcb_find_callback(instance, LCB_CALLBACK_GET);
+    const auto *base = reinterpret_cast<const lcb_RESPBASE *>(resp);
+    resp->cookie = const_cast<void *>(cck->cookie);
+    cb(instance, LCB_CALLBACK_GET, base);
+    for (const void *waiter : cck->flight.waiters) {
+        resp->cookie = const_cast<void *>(waiter);
+        cb(instance, LCB_CALLBACK_GET, base);
+    }
+    delete cck;
+}
+
+static void coalesce_dtor(mc_PACKET *pkt)
+{
+    auto *cck = static_cast<CoalesceCookie *>(pkt->u_rdata.exdata);
+    lcb_INSTANCE *instance = cck->instance;
+    instance->kv_coalesce->remove(&cck->flight);
+
+    /* gets still attached were accepted, and expect their callback */
+    if (!cck->flight.waiters.empty()) {
+        const std::string &key = cck->flight.key;
+        lcb_RESPCALLBACK cb = lcb_find_callback(instance, LCB_CALLBACK_GET);
+        lcb_RESPGET resp{};
+        resp.ctx.rc = LCB_ERR_REQUEST_CANCELED;
+        /* the lookup key is prefixed with the collection id */
+        resp.ctx.key = key.c_str() + sizeof(uint32_t);
+        resp.ctx.key_len = key.size() - sizeof(uint32_t);
+        for (const void *waiter : cck->flight.waiters) {
+            resp.cookie = const_cast<void *>(waiter);
+            cb(instance, LCB_CALLBACK_GET, reinterpret_cast<const lcb_RESPBASE *>(&resp));
+        }
+    }
+    delete cck;
+}
+
+static mc_REQDATAPROCS coalesce_procs = {coalesce_callback, coalesce_dtor};
+
+CoalesceCookie::CoalesceCookie(const void *cookie_, lcb_INSTANCE *instance_, std::string key)
+    : mc_REQDATAEX(cookie_, coalesce_procs, gethrtime()), instance(instance_)
+{
+    flight.key.swap(key);
+}
+
+static bool can_coalesce(lcb_INSTANCE *instance, const lcb_CMDGET *cmd)
+{
+    if (!LCBT_SETTING(instance, kv_coalesce_gets) || cmd->lock || cmd->exptime) {
+        return false;
+    }
+    return (cmd->cmdflags & (LCB_CMDGET_F_CLEAREXP | LCB_CMDGET_F_HEDGE | LCB_CMD_F_INTERNAL_CALLBACK)) == 0;
+}
+
 LIBCOUCHBASE_API
 lcb_STATUS lcb_get(lcb_INSTANCE *instance, void *cookie, const lcb_CMDGET *command)
 {
@@ -175,6 +416,19 @@ lcb_STATUS lcb_get(lcb_INSTANCE *instance, void *cookie, const lcb_CMDGET *comma
             cb(instance, LCB_CALLBACK_GET, reinterpret_cast<const lcb_RESPBASE *>(&get));
             return resp->ctx.rc;
         }
+        uint32_t timeout = cmd->timeout ? cmd->timeout : LCBT_SETTING(instance, operation_timeout);
+        std::string coalesce_key;
+        if (can_coalesce(instance, cmd)) {
+            coalesce_key = lcb::GetCoalescer::make_key(cmd->cid, cmd->key.contig.bytes, cmd->key.contig.nbytes);
+            lcb::GetCoalescer::Flight *flight = instance->kv_coalesce->find(coalesce_key);
+            /* do not let the get wait longer than its own timeout */
+            if (flight && flight->deadline <= gethrtime() + LCB_US2NS(timeout)) {
+                /* lcb_sched_fail() detaches the get again */
+                instance->kv_coalesce->join(flight, cookie, instance->cmdq.ctxenter);
+                return LCB_SUCCESS;
+            }
+        }
+
         mc_PIPELINE *pl;
         mc_PACKET *pkt;
         mc_REQDATA *rdata;
@@ -200,11 +454,33 @@ lcb_STATUS lcb_get(lcb_INSTANCE *instance, void *cookie, const lcb_CMDGET *comma
             return err;
         }
 
-        rdata = &pkt->u_rdata.reqdata;
-        rdata->cookie = cookie;
-        rdata->start = gethrtime();
-        rdata->deadline =
-            rdata->start + LCB_US2NS(cmd->timeout ? cmd->timeout : LCBT_SETTING(instance, operation_timeout));
+        lcbtrace_SPAN **span;
+        if (!coalesce_key.empty()) {
+            auto *cck = new CoalesceCookie(cookie, instance, std::move(coalesce_key));
+            cck->deadline = cck->start + LCB_US2NS(timeout);
+            cck->flight.deadline = cck->deadline;
+            instance->kv_coalesce->add(&cck->flight);
+            instance->kv_coalesce->issued++;
+            pkt->u_rdata.exdata = cck;
+            pkt->flags |= MCREQ_F_REQEXT;
+            span = &cck->span;
+        } else if ((cmd->cmdflags & LCB_CMDGET_F_HEDGE) && LCBT_NREPLICAS(instance) > 0) {
+            auto *hck = new HedgeCookie(cookie, instance, cmd, ntohs(hdr->request.vbucket), pl->index);
+            hck->deadline = hck->start + LCB_US2NS(timeout);
+            hck->timer.rearm(instance->kv_hedge->delay(LCBT_SETTING(instance, kv_hedge_delay)));
+            pkt->u_rdata.exdata = hck;
+            pkt->flags |= MCREQ_F_REQEXT;
+            span = &hck->span;
+        } else {
+            rdata = &pkt->u_rdata.reqdata;
+            rdata->cookie = cookie;
+            rdata->start = gethrtime();
+            rdata->deadline = rdata->start + LCB_US2NS(timeout);
+            if (cmd->cmdflags & LCB_CMD_F_INTERNAL_CALLBACK) {
+                pkt->flags |= MCREQ_F_PRIVCALLBACK;
+            }
+            span = &rdata->span;
+        }
 
         hdr->request.opcode = opcode;
         hdr->request.datatype = PROTOCOL_BINARY_RAW_BYTES;
@@ -216,13 +492,9 @@ lcb_STATUS lcb_get(lcb_INSTANCE *instance, void *cookie, const lcb_CMDGET *comma
             gcmd.message.body.norm.expiration = htonl(cmd->exptime);
         }
 
-        if (cmd->cmdflags & LCB_CMD_F_INTERNAL_CALLBACK) {
-            pkt->flags |= MCREQ_F_PRIVCALLBACK;
-        }
-
         memcpy(SPAN_BUFFER(&pkt->kh_span), gcmd.bytes, MCREQ_PKT_BASESIZE + extlen);
         LCB_SCHED_ADD(instance, pl, pkt);
-        LCBTRACE_KV_START(instance->settings, cmd, LCBTRACE_OP_GET, pkt->opaque, rdata->span);
+        LCBTRACE_KV_START(instance->settings, cmd, LCBTRACE_OP_GET, pkt->opaque, *span);
         TRACE_GET_BEGIN(instance, hdr, cmd);
         return LCB_SUCCESS;
     };
@@ -243,6 +515,83 @@ lcb_STATUS lcb_get(lcb_INSTANCE *instance, void *cookie, const lcb_CMDGET *comma
     }
 }
 
+/** Writes the headers of the packets of lcb_get_multi() */
+struct GetBulkEncoder {
+    lcb_uint8_t opcode;
+    lcb_uint8_t extlen;
+    lcb_U32 exptime;
+
+    bool copy_values(mc_PIPELINE *)
+    {
+        return true;
+    }
+
+    lcb_STATUS encode(mc_PIPELINE *, mc_PACKET *pkt, const mc_BATCHITEM *item)
+    {
+        protocol_binary_request_gat gcmd;
+        protocol_binary_request_header *hdr = &gcmd.message.header;
+        lcb_uint16_t nkey = pkt->kh_span.size - MCREQ_PKT_BASESIZE - extlen;
+
+        hdr->request.magic = PROTOCOL_BINARY_REQ;
+        hdr->request.opcode = opcode;
+        hdr->request.keylen = htons(nkey);
+        hdr->request.extlen = extlen;
+        hdr->request.vbucket = htons(item->vbid);
+        hdr->request.datatype = PROTOCOL_BINARY_RAW_BYTES;
+        hdr->request.bodylen = htonl(extlen + nkey);
+        hdr->request.opaque = pkt->opaque;
+        hdr->request.cas = 0;
+
+        if (extlen) {
+            gcmd.message.body.norm.expiration = htonl(exptime);
+        }
+
+        memcpy(SPAN_BUFFER(&pkt->kh_span), gcmd.bytes, MCREQ_PKT_BASESIZE + extlen);
+        return LCB_SUCCESS;
+    }
+};
+
+LIBCOUCHBASE_API
+lcb_STATUS lcb_get_multi(lcb_INSTANCE *instance, void *cookie, const lcb_CMDGET *cmd, const char *const *keys,
+                         const size_t *keys_len, size_t nitems, lcb_BULK_CALLBACK callback)
+{
+    auto err = lcb_is_collection_valid(instance, cmd->scope, cmd->nscope, cmd->collection, cmd->ncollection);
+    if (err != LCB_SUCCESS) {
+        return err;
+    }
+    if (nitems == 0 || keys == nullptr || keys_len == nullptr) {
+        return LCB_ERR_INVALID_ARGUMENT;
+    }
+    for (size_t ii = 0; ii < nitems; ii++) {
+        if (keys[ii] == nullptr || keys_len[ii] == 0) {
+            return LCB_ERR_EMPTY_KEY;
+        }
+    }
+    if (cmd->cas) {
+        return LCB_ERR_OPTIONS_CONFLICT;
+    }
+    if (cmd->cmdflags & LCB_CMDGET_F_HEDGE) {
+        return LCB_ERR_UNSUPPORTED_OPERATION;
+    }
+
+    GetBulkEncoder encoder{PROTOCOL_BINARY_CMD_GET, 0, cmd->exptime};
+    if (cmd->lock) {
+        encoder.extlen = 4;
+        encoder.opcode = PROTOCOL_BINARY_CMD_GET_LOCKED;
+    } else if (cmd->exptime || (cmd->cmdflags & LCB_CMDGET_F_CLEAREXP)) {
+        encoder.extlen = 4;
+        encoder.opcode = PROTOCOL_BINARY_CMD_GAT;
+    }
+    uint32_t timeout = cmd->timeout ? cmd->timeout : LCBT_SETTING(instance, operation_timeout);
+
+    auto *req = new lcb::BulkRequest(instance, cookie, LCB_CALLBACK_GET, callback, keys, keys_len, nullptr, nullptr,
+                                     nitems);
+    err = req->dispatch(cmd, MCREQ_PKT_BASESIZE + encoder.extlen, timeout, encoder, lcb_cmdget_clone,
+                        lcb_cmdget_destroy);
+    req->unref();
+    return err;
+}
+
 LIBCOUCHBASE_API lcb_STATUS lcb_respunlock_status(const lcb_RESPUNLOCK *resp)
 {
     return resp->ctx.rc;
@@ -17,6 +17,7 @@
 
 #include "internal.h"
 #include "http/http.h"
+#include "http/selector.h"
 #include "auth-priv.h"
 
 LIBCOUCHBASE_API lcb_STATUS lcb_respping_status(const lcb_RESPPING *resp)
@@ -734,6 +735,13 @@ lcb_STATUS lcb_diag(lcb_INSTANCE *instance, void *cookie, const lcb_CMDDIAG *cmd
     }
     instance->memd_sockpool->toJSON(now, root);
     instance->http_sockpool->toJSON(now, root);
+    {
+        Json::Value endpoints;
+        instance->http_selector->to_json(endpoints);
+        if (!endpoints.isNull()) {
+            root["http_endpoints"] = endpoints;
+        }
+    }
     {
         Json::Value cur;
         lcb_ASPEND_SETTYPE::iterator it;
@@ -63,6 +63,10 @@ lcb_STATUS lcb_pktfwd3(lcb_INSTANCE *instance, const void *cookie, const lcb_CMD
         return err;
     }
 
+    if (cmd->version >= 1) {
+        packet->flags |= MCREQ_F_UFWD_IOV;
+    }
+
     /* set the cookie */
     packet->u_rdata.reqdata.cookie = cookie;
     packet->u_rdata.reqdata.start = gethrtime();
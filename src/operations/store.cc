@@ -19,6 +19,7 @@
 #include "mc/compress.h"
 #include "trace.h"
 #include "durability_internal.h"
+#include "bulk.h"
 
 LIBCOUCHBASE_API int lcb_mutation_token_is_valid(const lcb_MUTATION_TOKEN *token)
 {
@@ -578,3 +579,122 @@ LIBCOUCHBASE_API lcb_STATUS lcb_store(lcb_INSTANCE *instance, void *cookie, cons
         return collcache_resolve(instance, command, operation, lcb_cmdstore_clone, lcb_cmdstore_destroy);
     }
 }
+
+/** Writes the headers (and compressed values) of the packets of lcb_store_multi() */
+struct StoreBulkEncoder {
+    lcb_INSTANCE *instance;
+    lcb_U8 datatype;
+    lcb_STORE_OPERATION operation;
+    protocol_binary_request_set scmd;
+    lcb_U8 ffextlen;
+
+    bool copy_values(mc_PIPELINE *pipeline)
+    {
+        return !can_compress(instance, pipeline, datatype);
+    }
+
+    lcb_STATUS encode(mc_PIPELINE *pipeline, mc_PACKET *packet, const mc_BATCHITEM *item)
+    {
+        protocol_binary_request_header *hdr = &scmd.message.header;
+        int should_compress = 0;
+
+        if (!(packet->flags & MCREQ_F_HASVALUE) && item->nvalue) {
+            lcb_VALBUF vbuf{};
+            vbuf.vtype = LCB_KV_COPY;
+            vbuf.u_buf.contig.bytes = item->value;
+            vbuf.u_buf.contig.nbytes = item->nvalue;
+            should_compress = 1;
+            if (mcreq_compress_value(pipeline, packet, &vbuf, instance->settings, &should_compress) != 0) {
+                return LCB_ERR_NO_MEMORY;
+            }
+        }
+
+        lcb_U16 nkey = packet->kh_span.size - MCREQ_PKT_BASESIZE - packet->extlen;
+        if (ffextlen) {
+            hdr->request.keylen = ((0xff & nkey) << 8) | ffextlen;
+        } else {
+            hdr->request.keylen = htons(nkey);
+        }
+        hdr->request.vbucket = htons(item->vbid);
+        hdr->request.datatype = PROTOCOL_BINARY_RAW_BYTES;
+        if (should_compress || (datatype & LCB_VALUE_F_SNAPPYCOMP)) {
+            hdr->request.datatype |= PROTOCOL_BINARY_DATATYPE_COMPRESSED;
+        }
+        if ((datatype & LCB_VALUE_F_JSON) && static_cast<const lcb::Server *>(pipeline)->supports_json()) {
+            hdr->request.datatype |= PROTOCOL_BINARY_DATATYPE_JSON;
+        }
+        hdr->request.opaque = packet->opaque;
+        hdr->request.bodylen = htonl(hdr->request.extlen + ffextlen + nkey + get_value_size(packet));
+
+        memcpy(SPAN_BUFFER(&packet->kh_span), scmd.bytes, MCREQ_PKT_BASESIZE + packet->extlen);
+        switch (operation) {
+            case LCB_STORE_UPSERT:
+            case LCB_STORE_REPLACE:
+            case LCB_STORE_APPEND:
+            case LCB_STORE_PREPEND:
+                packet->flags |= MCREQ_F_REPLACE_SEMANTICS;
+                break;
+            default:
+                break;
+        }
+        return LCB_SUCCESS;
+    }
+};
+
+LIBCOUCHBASE_API
+lcb_STATUS lcb_store_multi(lcb_INSTANCE *instance, void *cookie, const lcb_CMDSTORE *cmd, const char *const *keys,
+                           const size_t *keys_len, const char *const *values, const size_t *values_len, size_t nitems,
+                           lcb_BULK_CALLBACK callback)
+{
+    if (nitems == 0 || keys == nullptr || keys_len == nullptr || values == nullptr || values_len == nullptr) {
+        return LCB_ERR_INVALID_ARGUMENT;
+    }
+    for (size_t ii = 0; ii < nitems; ii++) {
+        if (keys[ii] == nullptr || keys_len[ii] == 0) {
+            return LCB_ERR_EMPTY_KEY;
+        }
+    }
+    /* the keys were checked above, validate the rest of the command */
+    lcb_CMDSTORE keyed = *cmd;
+    LCB_CMD_SET_KEY(&keyed, keys[0], keys_len[0]);
+    lcb_STATUS err = store_validate(instance, &keyed);
+    if (err != LCB_SUCCESS) {
+        return err;
+    }
+    if (cmd->durability_mode == LCB_DURABILITY_POLL) {
+        return LCB_ERR_UNSUPPORTED_OPERATION;
+    }
+
+    StoreBulkEncoder encoder{instance, cmd->datatype, cmd->operation, {}, 0};
+    protocol_binary_request_header *hdr = &encoder.scmd.message.header;
+    hdr->request.magic = PROTOCOL_BINARY_REQ;
+    bool sync_durability = cmd->durability_mode == LCB_DURABILITY_SYNC && cmd->durability.sync.dur_level &&
+                           LCBT_SUPPORT_SYNCREPLICATION(instance);
+    if (sync_durability) {
+        hdr->request.magic = PROTOCOL_BINARY_AREQ;
+        encoder.ffextlen = 4;
+    }
+    err = get_esize_and_opcode(cmd->operation, &hdr->request.opcode, &hdr->request.extlen);
+    if (err != LCB_SUCCESS) {
+        return err;
+    }
+    hdr->request.cas = lcb_htonll(cmd->cas);
+    if (sync_durability) {
+        encoder.scmd.message.body.alt.expiration = htonl(cmd->exptime);
+        encoder.scmd.message.body.alt.flags = htonl(cmd->flags);
+        encoder.scmd.message.body.alt.meta = (1 << 4) | 3;
+        encoder.scmd.message.body.alt.level = cmd->durability.sync.dur_level;
+        encoder.scmd.message.body.alt.timeout = htons(lcb_durability_timeout(instance, cmd->timeout));
+    } else {
+        encoder.scmd.message.body.norm.expiration = htonl(cmd->exptime);
+        encoder.scmd.message.body.norm.flags = htonl(cmd->flags);
+    }
+    uint32_t timeout = cmd->timeout ? cmd->timeout : LCBT_SETTING(instance, operation_timeout);
+
+    auto *req = new lcb::BulkRequest(instance, cookie, LCB_CALLBACK_STORE, callback, keys, keys_len, values,
+                                     values_len, nitems);
+    err = req->dispatch(cmd, MCREQ_PKT_BASESIZE + hdr->request.extlen + encoder.ffextlen, timeout, encoder,
+                        lcb_cmdstore_clone, lcb_cmdstore_destroy);
+    req->unref();
+    return err;
+}
@@ -26,20 +26,22 @@ LIBCOUCHBASE_API size_t lcb_respsubdoc_result_size(const lcb_RESPSUBDOC *resp)
 
 LIBCOUCHBASE_API lcb_STATUS lcb_respsubdoc_result_status(const lcb_RESPSUBDOC *resp, size_t index)
 {
-    if (index >= resp->nres) {
+    lcb_SDENTRY ent;
+    if (!lcb_sdresult_get(resp, index, &ent)) {
         return LCB_ERR_OPTIONS_CONFLICT;
     }
-    return resp->res[index].status;
+    return ent.status;
 }
 
 LIBCOUCHBASE_API lcb_STATUS lcb_respsubdoc_result_value(const lcb_RESPSUBDOC *resp, size_t index, const char **value,
                                                         size_t *value_len)
 {
-    if (index >= resp->nres) {
+    lcb_SDENTRY ent;
+    if (!lcb_sdresult_get(resp, index, &ent)) {
         return LCB_ERR_OPTIONS_CONFLICT;
     }
-    *value = (const char *)resp->res[index].value;
-    *value_len = resp->res[index].nvalue;
+    *value = (const char *)ent.value;
+    *value_len = ent.nvalue;
     return LCB_SUCCESS;
 }
 
@@ -102,9 +104,10 @@ LIBCOUCHBASE_API lcb_STATUS lcb_respsubdoc_mutation_token(const lcb_RESPSUBDOC *
 
 LIBCOUCHBASE_API lcb_STATUS lcb_subdocspecs_create(lcb_SUBDOCSPECS **operations, size_t capacity)
 {
-    lcb_SUBDOCSPECS *res = (lcb_SUBDOCSPECS *)calloc(1, sizeof(lcb_SUBDOCSPECS));
+    // The specs are stored inline, directly after the structure
+    lcb_SUBDOCSPECS *res = (lcb_SUBDOCSPECS *)calloc(1, sizeof(lcb_SUBDOCSPECS) + capacity * sizeof(lcb_SDSPEC));
     res->nspecs = capacity;
-    res->specs = (lcb_SDSPEC *)calloc(res->nspecs, sizeof(lcb_SDSPEC));
+    res->specs = reinterpret_cast<lcb_SDSPEC *>(res + 1);
     *operations = res;
     return LCB_SUCCESS;
 }
@@ -120,7 +123,6 @@ LIBCOUCHBASE_API lcb_STATUS lcb_subdocspecs_destroy(lcb_SUBDOCSPECS *operations)
                 }
             }
         }
-        free(operations->specs);
     }
     free(operations);
     return LCB_SUCCESS;
@@ -603,6 +605,12 @@ static uint8_t make_doc_flags(const uint32_t user)
     return flags;
 }
 
+/**
+ * Encodes the specs of a multi lookup/mutation. The specs are first validated
+ * and measured with add_spec(), and then written with encode() directly into
+ * the value of the packet, so that nothing needs to be allocated for the
+ * per-spec headers, or to collect the paths and values into an IOV list.
+ */
 struct MultiBuilder {
     static unsigned infer_mode(const lcb_CMDSUBDOC *cmd)
     {
@@ -616,28 +624,12 @@ struct MultiBuilder {
         return trait.mode();
     }
 
-    MultiBuilder(const lcb_CMDSUBDOC *cmd_) : cmd(cmd_), payload_size(0)
+    explicit MultiBuilder(const lcb_CMDSUBDOC *cmd_) : cmd(cmd_), payload_size(0)
     {
         mode = infer_mode(cmd_);
-        size_t ebufsz = is_lookup() ? cmd->nspecs * 4 : cmd->nspecs * 8;
-        extra_body = new char[ebufsz];
-        bodysz = 0;
-    }
-
-    ~MultiBuilder()
-    {
-        if (extra_body != NULL) {
-            delete[] extra_body;
-        }
     }
 
-    inline MultiBuilder(const MultiBuilder &);
-
-    // IOVs which are fed into lcb_VALBUF for subsequent use
     const lcb_CMDSUBDOC *cmd;
-    std::vector<lcb_IOV> iovs;
-    char *extra_body;
-    size_t bodysz;
 
     // Total size of the payload itself
     size_t payload_size;
@@ -661,55 +653,45 @@ struct MultiBuilder {
         }
     }
 
-    template <typename T>
-    void add_field(T itm, size_t len)
+    size_t header_size() const
     {
-        const char *b = reinterpret_cast<const char *>(&itm);
-        memcpy(extra_body + bodysz, b, len);
-        bodysz += len;
+        return is_lookup() ? 4 : 8;
     }
 
-    const char *extra_mark() const
-    {
-        return extra_body + bodysz;
-    }
-
-    void add_extras_iov(const char *last_begin)
+    template <typename T>
+    static char *put_field(char *dst, T itm)
     {
-        const char *p_end = extra_mark();
-        add_iov(last_begin, p_end - last_begin);
+        memcpy(dst, &itm, sizeof(itm));
+        return dst + sizeof(itm);
     }
 
-    void add_iov(const void *b, size_t n)
+    static char *put_bytes(char *dst, const void *b, size_t n)
     {
-        if (!n) {
-            return;
+        if (n) {
+            memcpy(dst, b, n);
         }
-
-        lcb_IOV iov;
-        iov.iov_base = const_cast<void *>(b);
-        iov.iov_len = n;
-        iovs.push_back(iov);
-        payload_size += n;
+        return dst + n;
     }
 
-    void add_iov(const lcb_VALBUF &vb)
+    static char *put_value(char *dst, const lcb_VALBUF &vb)
     {
         if (vb.vtype == LCB_KV_CONTIG || vb.vtype == LCB_KV_COPY) {
-            add_iov(vb.u_buf.contig.bytes, vb.u_buf.contig.nbytes);
-        } else {
-            for (size_t ii = 0; ii < vb.u_buf.contig.nbytes; ++ii) {
-                const lcb_IOV &iov = vb.u_buf.multi.iov[ii];
-                if (!iov.iov_len) {
-                    continue; // Skip it
-                }
-                payload_size += iov.iov_len;
-                iovs.push_back(iov);
-            }
+            return put_bytes(dst, vb.u_buf.contig.bytes, vb.u_buf.contig.nbytes);
         }
+        for (size_t ii = 0; ii < vb.u_buf.multi.niov; ++ii) {
+            const lcb_IOV &iov = vb.u_buf.multi.iov[ii];
+            dst = put_bytes(dst, iov.iov_base, iov.iov_len);
+        }
+        return dst;
     }
 
     inline lcb_STATUS add_spec(const lcb_SDSPEC *);
+
+    /**
+     * Write all specs (which must have been accepted by add_spec()) to the
+     * buffer, which must be at least #payload_size bytes long.
+     */
+    inline void encode(char *dst) const;
 };
 
 lcb_STATUS MultiBuilder::add_spec(const lcb_SDSPEC *spec)
@@ -724,36 +706,47 @@ lcb_STATUS MultiBuilder::add_spec(const lcb_SDSPEC *spec)
         return LCB_ERR_OPTIONS_CONFLICT;
     }
 
-    const char *p_begin = extra_mark();
-    // opcode
-    add_field(trait.opcode, 1);
-    // flags
-    add_field(make_path_flags(spec->options), 1);
-
-    uint16_t npath = static_cast<uint16_t>(spec->path.contig.nbytes);
+    size_t npath = spec->path.contig.nbytes;
     if (!npath && !trait.chk_allow_empty_path(spec->options)) {
         return LCB_ERR_SUBDOC_PATH_INVALID;
     }
+    // The lengths are encoded as 16 and 32 bit fields
+    if (npath > UINT16_MAX) {
+        return LCB_ERR_SUBDOC_PATH_TOO_BIG;
+    }
+    size_t nvalue = is_mutate() ? get_valbuf_size(spec->value) : 0;
+    if (nvalue > UINT32_MAX) {
+        return LCB_ERR_VALUE_TOO_LARGE;
+    }
+
+    // opcode, flags, path length (and value length for mutations), then the path and value
+    payload_size += header_size() + npath + nvalue;
+    return LCB_SUCCESS;
+}
 
-    // Path length
-    add_field(static_cast<uint16_t>(htons(npath)), 2);
+void MultiBuilder::encode(char *dst) const
+{
+    for (size_t ii = 0; ii < cmd->nspecs; ++ii) {
+        const lcb_SDSPEC *spec = cmd->specs + ii;
+        const SubdocCmdTraits::Traits &trait = SubdocCmdTraits::find(spec->sdcmd);
+        uint16_t npath = static_cast<uint16_t>(spec->path.contig.nbytes);
 
-    uint32_t vsize = 0;
-    if (is_mutate()) {
-        // Mutation needs an additional 'value' spec.
-        vsize = get_valbuf_size(spec->value);
-        add_field(static_cast<uint32_t>(htonl(vsize)), 4);
-    }
+        dst = put_field(dst, trait.opcode);
+        dst = put_field(dst, make_path_flags(spec->options));
+        dst = put_field(dst, static_cast<uint16_t>(htons(npath)));
 
-    // Finalize the header..
-    add_extras_iov(p_begin);
+        uint32_t vsize = 0;
+        if (is_mutate()) {
+            // Mutation needs an additional 'value' spec.
+            vsize = static_cast<uint32_t>(get_valbuf_size(spec->value));
+            dst = put_field(dst, static_cast<uint32_t>(htonl(vsize)));
+        }
 
-    // Add the actual path
-    add_iov(spec->path.contig.bytes, spec->path.contig.nbytes);
-    if (vsize) {
-        add_iov(spec->value);
+        dst = put_bytes(dst, spec->path.contig.bytes, npath);
+        if (vsize) {
+            dst = put_value(dst, spec->value);
+        }
     }
-    return LCB_SUCCESS;
 }
 
 static lcb_STATUS subdoc_validate(lcb_INSTANCE *instance, const lcb_CMDSUBDOC *cmd)
@@ -858,17 +851,13 @@ lcb_STATUS lcb_subdoc(lcb_INSTANCE *instance, void *cookie, const lcb_CMDSUBDOC
             return rc;
         }
 
-        lcb_VALBUF vb = {LCB_KV_IOVCOPY};
-        vb.u_buf.multi.iov = &ctx.iovs[0];
-        vb.u_buf.multi.niov = ctx.iovs.size();
-        vb.u_buf.multi.total_length = ctx.payload_size;
-        rc = mcreq_reserve_value(pl, pkt, &vb);
-
+        rc = mcreq_reserve_value2(pl, pkt, ctx.payload_size);
         if (rc != LCB_SUCCESS) {
             mcreq_wipe_packet(pl, pkt);
             mcreq_release_packet(pl, pkt);
             return rc;
         }
+        ctx.encode(SPAN_BUFFER(&pkt->u_value.single));
 
         // Set the header fields.
         if (ctx.is_lookup()) {
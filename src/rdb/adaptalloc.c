@@ -0,0 +1,226 @@
+/* -*- Mode: C; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include "rope.h"
+#include "adaptalloc.h"
+
+/**
+ * Get the size class for a segment of at least `size` bytes, or -1 if it is
+ * too large to be cached
+ */
+static int size_class(unsigned size)
+{
+    int ii;
+    for (ii = 0; ii < RDB_SEGCACHE_NCLASSES; ii++) {
+        if (size <= 1u << (RDB_SEGCACHE_MINSHIFT + ii)) {
+            return ii;
+        }
+    }
+    return -1;
+}
+
+/** Get the class of a segment which holds exactly a class size, or -1 */
+static int exact_class(unsigned size)
+{
+    int ii = size_class(size);
+    if (ii < 0 || size != 1u << (RDB_SEGCACHE_MINSHIFT + ii)) {
+        return -1;
+    }
+    return ii;
+}
+
+static void seg_free(rdb_ROPESEG *seg)
+{
+    free(seg->root);
+    free(seg);
+}
+
+LCB_INTERNAL_API
+rdb_SEGCACHE *rdb_segcache_new(unsigned max_bytes)
+{
+    int ii;
+    rdb_SEGCACHE *cache = calloc(1, sizeof(*cache));
+    for (ii = 0; ii < RDB_SEGCACHE_NCLASSES; ii++) {
+        lcb_clist_init(&cache->classes[ii]);
+    }
+    cache->max_bytes = max_bytes;
+    cache->refcount = 1;
+    return cache;
+}
+
+/** Free cached segments until the cache is within `max_bytes` */
+static void cache_trim(rdb_SEGCACHE *cache, size_t max_bytes)
+{
+    int ii;
+    /* largest segments first */
+    for (ii = RDB_SEGCACHE_NCLASSES - 1; ii >= 0 && cache->nbytes > max_bytes; ii--) {
+        while (LCB_CLIST_SIZE(&cache->classes[ii]) && cache->nbytes > max_bytes) {
+            lcb_list_t *ll = lcb_clist_pop(&cache->classes[ii]);
+            rdb_ROPESEG *seg = LCB_LIST_ITEM(ll, rdb_ROPESEG, llnode);
+            cache->nbytes -= seg->nalloc;
+            seg_free(seg);
+        }
+    }
+}
+
+LCB_INTERNAL_API
+void rdb_segcache_set_limit(rdb_SEGCACHE *cache, unsigned max_bytes)
+{
+    cache->max_bytes = max_bytes;
+    cache_trim(cache, max_bytes);
+}
+
+LCB_INTERNAL_API
+unsigned rdb_segcache_get_limit(const rdb_SEGCACHE *cache)
+{
+    return (unsigned)cache->max_bytes;
+}
+
+LCB_INTERNAL_API
+void rdb_segcache_unref(rdb_SEGCACHE *cache)
+{
+    if (--cache->refcount) {
+        return;
+    }
+    cache_trim(cache, 0);
+    free(cache);
+}
+
+static void alloc_decref(rdb_ALLOCATOR *abase)
+{
+    rdb_ADAPTALLOC *alloc = (rdb_ADAPTALLOC *)abase;
+    if (--alloc->refcount) {
+        return;
+    }
+    rdb_segcache_unref(alloc->cache);
+    free(alloc);
+}
+
+static rdb_ROPESEG *seg_alloc(rdb_ALLOCATOR *abase, unsigned size)
+{
+    rdb_ADAPTALLOC *alloc = (rdb_ADAPTALLOC *)abase;
+    rdb_SEGCACHE *cache = alloc->cache;
+    rdb_ROPESEG *seg = NULL;
+    int cls = size_class(size);
+
+    if (cls >= 0 && LCB_CLIST_SIZE(&cache->classes[cls])) {
+        seg = LCB_LIST_ITEM(lcb_clist_shift(&cache->classes[cls]), rdb_ROPESEG, llnode);
+        cache->nbytes -= seg->nalloc;
+        cache->nhits++;
+    } else {
+        if (cls >= 0) {
+            size = 1u << (RDB_SEGCACHE_MINSHIFT + cls);
+            cache->nmisses++;
+        }
+        seg = calloc(1, sizeof(*seg));
+        seg->root = malloc(size);
+        seg->nalloc = size;
+    }
+
+    seg->shflags = RDB_ROPESEG_F_LIB;
+    seg->allocator = abase;
+    seg->allocid = RDB_ALLOCATOR_ADAPTIVE;
+    seg->start = 0;
+    seg->nused = 0;
+    alloc->refcount++;
+    return seg;
+}
+
+static void buf_reserve(rdb_ALLOCATOR *abase, rdb_ROPEBUF *buf, unsigned size)
+{
+    rdb_ROPESEG *lastseg = RDB_SEG_LAST(buf);
+    if (lastseg && RDB_SEG_SPACE(lastseg) + buf->nused >= size) {
+        return;
+    }
+    lastseg = seg_alloc(abase, size);
+    lcb_list_append(&buf->segments, &lastseg->llnode);
+}
+
+static rdb_ROPESEG *seg_realloc(rdb_ALLOCATOR *abase, rdb_ROPESEG *seg, unsigned size)
+{
+    /* Keep the segment at a class size, so it can be cached once released */
+    int cls = size_class(size);
+    if (cls >= 0) {
+        size = 1u << (RDB_SEGCACHE_MINSHIFT + cls);
+    }
+    seg->root = realloc(seg->root, size);
+    seg->nalloc = size;
+    (void)abase;
+    return seg;
+}
+
+static void seg_release(rdb_ALLOCATOR *abase, rdb_ROPESEG *seg)
+{
+    rdb_ADAPTALLOC *alloc = (rdb_ADAPTALLOC *)abase;
+    rdb_SEGCACHE *cache = alloc->cache;
+    int cls = exact_class(seg->nalloc);
+
+    if (cls < 0) {
+        seg_free(seg);
+    } else if (cache->nbytes + seg->nalloc > cache->max_bytes) {
+        cache->nevicted++;
+        seg_free(seg);
+    } else {
+        lcb_clist_prepend(&cache->classes[cls], &seg->llnode);
+        cache->nbytes += seg->nalloc;
+    }
+    alloc_decref(abase);
+}
+
+static void dump_wrap(rdb_pALLOCATOR abase, FILE *fp)
+{
+    rdb_segcache_dump(((rdb_ADAPTALLOC *)abase)->cache, fp);
+}
+
+LCB_INTERNAL_API
+rdb_ALLOCATOR *rdb_adaptalloc_new(rdb_SEGCACHE *cache)
+{
+    rdb_ALLOCATOR *abase;
+    rdb_ADAPTALLOC *alloc = calloc(1, sizeof(*alloc));
+    alloc->cache = cache;
+    alloc->refcount = 1;
+    cache->refcount++;
+
+    abase = &alloc->base;
+    abase->r_reserve = buf_reserve;
+    abase->s_release = seg_release;
+    abase->s_alloc = seg_alloc;
+    abase->s_realloc = seg_realloc;
+    abase->a_release = alloc_decref;
+    abase->dump = dump_wrap;
+    return abase;
+}
+
+void rdb_segcache_dump(const rdb_SEGCACHE *cache, FILE *fp)
+{
+    static const char *indent = "  ";
+    int ii;
+    fprintf(fp, "SEGCACHE @%p\n", (void *)cache);
+    fprintf(fp, "%sCached Bytes: %lu (max %lu)\n", indent, (unsigned long)cache->nbytes,
+            (unsigned long)cache->max_bytes);
+    for (ii = 0; ii < RDB_SEGCACHE_NCLASSES; ii++) {
+        if (LCB_CLIST_SIZE(&cache->classes[ii])) {
+            fprintf(fp, "%s%uB Segments: %lu\n", indent, 1u << (RDB_SEGCACHE_MINSHIFT + ii),
+                    (unsigned long)LCB_CLIST_SIZE(&cache->classes[ii]));
+        }
+    }
+    fprintf(fp, "%sHits: %lu\n", indent, cache->nhits);
+    fprintf(fp, "%sMisses: %lu\n", indent, cache->nmisses);
+    fprintf(fp, "%sEvicted: %lu\n", indent, cache->nevicted);
+}
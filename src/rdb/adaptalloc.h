@@ -0,0 +1,75 @@
+/* -*- Mode: C; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef RDB_ADAPTALLOC
+#define RDB_ADAPTALLOC
+#include "list.h"
+#include <stdio.h>
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Adaptive allocator. Each read is given a single segment of (at least) the
+ * rope's current read size, rounded up to a power of two. The owner of the
+ * rope adjusts the read size to the messages it receives (see rdb_SIZER and
+ * rdb_expect()), so the segments follow the workload rather than a fixed
+ * chunk size.
+ *
+ * Released segments are kept in a cache which is shared by all the allocators
+ * of an instance, and bounded in bytes. Idle connections thus do not each hold
+ * on to a pool of their own.
+ *
+ * This header file exists for internal use. To create an allocator instance,
+ * refer to rdb_adaptalloc_new() in rope.h
+ */
+
+/** Smallest segment size (as a power of two) kept in the cache */
+#define RDB_SEGCACHE_MINSHIFT 12
+/** Number of segment sizes kept in the cache (4KB ... 4MB) */
+#define RDB_SEGCACHE_NCLASSES 11
+
+struct rdb_SEGCACHE {
+    /** Free segments of `1 << (RDB_SEGCACHE_MINSHIFT + ii)` bytes */
+    lcb_clist_t classes[RDB_SEGCACHE_NCLASSES];
+    unsigned refcount;
+    size_t nbytes;    /* bytes held in free segments */
+    size_t max_bytes; /* limit for nbytes */
+
+    unsigned long nhits;    /* segments taken from the cache */
+    unsigned long nmisses;  /* segments allocated because the cache had none */
+    unsigned long nevicted; /* released segments freed because the cache was full */
+};
+
+typedef struct {
+    rdb_ALLOCATOR base;
+    struct rdb_SEGCACHE *cache;
+    unsigned refcount;
+} rdb_ADAPTALLOC;
+
+/**
+ * Dumps a textual representation of the specified cache to a FILE
+ * @param cache
+ * @param fp
+ */
+void rdb_segcache_dump(const rdb_SEGCACHE *cache, FILE *fp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -75,6 +75,8 @@ void rdb_rdend(rdb_IOROPE *ior, unsigned nr)
     unsigned to_chop;
     lcb_list_t *llcur, *llnext;
 
+    ior->nreads++;
+
     /** Chop the first segment at the end, if there's space */
     rdb_ROPESEG *seg = RDB_SEG_LAST(&ior->recvd);
     if (seg && RDB_SEG_SPACE(seg)) {
@@ -175,18 +177,25 @@ static void try_compact(rdb_ROPESEG *seg)
     seg->start = 0;
 }
 
-static void rope_consolidate(rdb_ROPEBUF *rope, unsigned nr)
+/**
+ * Make the first nr bytes of the rope contiguous (or, if fewer bytes were
+ * received, make room for them after the data already received).
+ * @return the number of bytes copied
+ */
+static unsigned rope_consolidate(rdb_ROPEBUF *rope, unsigned nr)
 {
     rdb_ROPESEG *seg, *newseg;
     lcb_list_t *llcur, *llnext;
+    unsigned ncopied, orig_nr = nr;
 
     seg = RDB_SEG_FIRST(rope);
     if (seg->nused + RDB_SEG_SPACE(seg) >= nr || nr < 2) {
-        return;
+        return 0;
     }
 
     try_compact(seg);
     lcb_list_delete(&seg->llnode);
+    ncopied = seg->nused;
 
     if (rdb_seg_recyclable(seg)) {
         unsigned to_alloc = nr + seg->start;
@@ -211,6 +220,7 @@ static void rope_consolidate(rdb_ROPEBUF *rope, unsigned nr)
 
         memcpy(RDB_SEG_WBUF(newseg), RDB_SEG_RBUF(seg), to_copy);
         newseg->nused += to_copy;
+        ncopied += to_copy;
 
         seg_consumed(rope, seg, to_copy);
         if (!(nr -= to_copy)) {
@@ -220,12 +230,22 @@ static void rope_consolidate(rdb_ROPEBUF *rope, unsigned nr)
 
     lcb_list_prepend(&rope->segments, &newseg->llnode);
     rope->nused += newseg->nused;
-    lcb_assert(rope->nused >= nr);
+    lcb_assert(newseg->nalloc - newseg->start >= orig_nr);
+    return ncopied;
 }
 
 void rdb_consolidate(rdb_IOROPE *ior, unsigned nr)
 {
-    rope_consolidate(&ior->recvd, nr);
+    ior->nconsolidated += rope_consolidate(&ior->recvd, nr);
+}
+
+void rdb_expect(rdb_IOROPE *ior, unsigned n)
+{
+    if (!ior->recvd.nused || ior->recvd.nused >= n) {
+        return;
+    }
+    rdb_consolidate(ior, n);
+    ior->rdsize = n - ior->recvd.nused;
 }
 
 void rdb_copyread(rdb_IOROPE *ior, void *tgt, unsigned n)
@@ -352,6 +372,50 @@ void rdb_challoc(rdb_IOROPE *ior, rdb_ALLOCATOR *alloc)
     ior->avail.allocator = alloc;
 }
 
+void rdb_sizer_init(rdb_SIZER *sizer)
+{
+    memset(sizer, 0, sizeof(*sizer));
+}
+
+void rdb_sizer_add(rdb_SIZER *sizer, unsigned msgsize)
+{
+    unsigned cls = 0;
+    while (cls < RDB_SIZER_NCLASSES - 1 && (1u << cls) < msgsize) {
+        cls++;
+    }
+    sizer->counts[cls]++;
+    sizer->total++;
+
+    if (++sizer->nsamples == RDB_SIZER_DECAY) {
+        unsigned ii;
+        sizer->total = 0;
+        for (ii = 0; ii < RDB_SIZER_NCLASSES; ii++) {
+            sizer->counts[ii] /= 2;
+            sizer->total += sizer->counts[ii];
+        }
+        sizer->nsamples = 0;
+    }
+}
+
+unsigned rdb_sizer_get(const rdb_SIZER *sizer)
+{
+    unsigned ii, seen = 0, rdsize;
+    if (!sizer->total) {
+        return RDB_SIZER_RDSIZE_MIN;
+    }
+    for (ii = 0; ii < RDB_SIZER_NCLASSES - 1; ii++) {
+        seen += sizer->counts[ii];
+        if (seen * 10 >= sizer->total * 9) {
+            break;
+        }
+    }
+    if ((1u << ii) >= RDB_SIZER_RDSIZE_MAX / RDB_SIZER_READAHEAD) {
+        return RDB_SIZER_RDSIZE_MAX;
+    }
+    rdsize = (1u << ii) * RDB_SIZER_READAHEAD;
+    return rdsize < RDB_SIZER_RDSIZE_MIN ? RDB_SIZER_RDSIZE_MIN : rdsize;
+}
+
 void rdb_copywrite(rdb_IOROPE *ior, void *buf, unsigned nbuf)
 {
     char *cur = buf;
@@ -167,6 +167,7 @@ enum rdb_ALLOCID {
     RDB_ALLOCATOR_BIGALLOC = 1,
     RDB_ALLOCATOR_CHUNKED,
     RDB_ALLOCATOR_LIBCALLOC,
+    RDB_ALLOCATOR_ADAPTIVE,
 
     /** use constants higher than this for your own allocator(s) */
     RDB_ALLOCATOR_MAX
@@ -189,6 +190,9 @@ typedef struct {
     rdb_ROPEBUF recvd; /** rope containing read data */
     rdb_ROPEBUF avail; /** rope used for subsequent network reads */
     unsigned rdsize;   /** preferred read size */
+
+    unsigned long nreads;        /** number of reads placed into the rope (rdb_rdend) */
+    unsigned long nconsolidated; /** number of bytes copied to make data contiguous */
 } rdb_IOROPE;
 
 /**
@@ -312,6 +316,17 @@ void rdb_consolidate(rdb_IOROPE *ior, unsigned n);
  */
 char *rdb_get_consolidated(rdb_IOROPE *ior, unsigned n);
 
+/**
+ * Indicate that the first n bytes of the rope form a single message, of which
+ * only a part has been received.
+ *
+ * The data received so far is consolidated into a segment with room for the
+ * whole message, and the read size is set to the remainder of the message.
+ * The rest of the message is then read directly behind the data already
+ * received, and consolidating it once complete copies nothing.
+ */
+void rdb_expect(rdb_IOROPE *ior, unsigned n);
+
 /**
  * @}
  */
@@ -408,6 +423,48 @@ void rdb_seg_unref(rdb_ROPESEG *seg);
 
 #define rdb_get_nused(ior) (ior)->recvd.nused
 
+/**
+ * @name Read Sizing
+ * @{
+ */
+
+/** Smallest read size suggested by an rdb_SIZER */
+#define RDB_SIZER_RDSIZE_MIN 8192
+/** Largest read size suggested by an rdb_SIZER */
+#define RDB_SIZER_RDSIZE_MAX 1048576
+/** Number of message sizes covered by a suggested read */
+#define RDB_SIZER_READAHEAD 16
+/** Halve the recorded counts every <n> messages, so that older sizes fade */
+#define RDB_SIZER_DECAY 256
+#define RDB_SIZER_NCLASSES 32
+
+/**
+ * Learns the sizes of the messages read from a connection, and suggests a
+ * read size (rdb_IOROPE::rdsize) for them: big enough for several of the
+ * typical (90th percentile) messages, without giving every connection the
+ * same large buffer when messages are small.
+ */
+typedef struct {
+    /** Recent message counts, by power of two of their size */
+    unsigned counts[RDB_SIZER_NCLASSES];
+    /** Sum of counts */
+    unsigned total;
+    /** Messages recorded since the last decay */
+    unsigned nsamples;
+} rdb_SIZER;
+
+void rdb_sizer_init(rdb_SIZER *sizer);
+
+/** Record the size of a complete message */
+void rdb_sizer_add(rdb_SIZER *sizer, unsigned msgsize);
+
+/** Get the suggested read size */
+unsigned rdb_sizer_get(const rdb_SIZER *sizer);
+
+/**
+ * @}
+ */
+
 /**
  * Add data into the read buffer. This is primarily used for testing and does
  * the equivalent of a network "Read".
@@ -438,6 +495,38 @@ rdb_ALLOCATOR *rdb_chunkalloc_new(unsigned chunksize);
 LCB_INTERNAL_API
 rdb_ALLOCATOR *rdb_libcalloc_new(void);
 
+/** Cache of free segments, shared by adaptive allocators */
+typedef struct rdb_SEGCACHE rdb_SEGCACHE;
+
+/**
+ * Create a segment cache.
+ * @param max_bytes the maximum number of bytes held in free segments
+ */
+LCB_INTERNAL_API
+rdb_SEGCACHE *rdb_segcache_new(unsigned max_bytes);
+
+/** Change the limit of the cache, freeing segments above it */
+LCB_INTERNAL_API
+void rdb_segcache_set_limit(rdb_SEGCACHE *cache, unsigned max_bytes);
+
+LCB_INTERNAL_API
+unsigned rdb_segcache_get_limit(const rdb_SEGCACHE *cache);
+
+/**
+ * Release a reference to the cache. Each allocator using the cache holds a
+ * reference of its own.
+ */
+LCB_INTERNAL_API
+void rdb_segcache_unref(rdb_SEGCACHE *cache);
+
+/**
+ * Returns an allocator which sizes each read buffer to the rope's read size,
+ * and takes and returns its segments from a shared cache.
+ * @param cache the cache. The allocator holds a reference to it
+ */
+LCB_INTERNAL_API
+rdb_ALLOCATOR *rdb_adaptalloc_new(rdb_SEGCACHE *cache);
+
 /**
  * Dump information about the iorope structure to a file
  * @param ior The rope structure to dump
@@ -18,6 +18,8 @@
 #include "settings.h"
 #include <lcbio/ssl.h>
 #include <rdb/rope.h>
+#include <libcouchbase/utils.h>
+#include <cbsasl/cbsasl.h>
 
 LCB_INTERNAL_API
 void lcb_default_settings(lcb_settings *settings)
@@ -26,6 +28,8 @@ void lcb_default_settings(lcb_settings *settings)
     settings->operation_timeout = LCB_DEFAULT_TIMEOUT;
     settings->config_timeout = LCB_DEFAULT_CONFIGURATION_TIMEOUT;
     settings->config_node_timeout = LCB_DEFAULT_NODECONFIG_TIMEOUT;
+    settings->bootstrap_race_width = LCB_DEFAULT_BOOTSTRAP_RACE_WIDTH;
+    settings->bootstrap_race_delay = LCB_DEFAULT_BOOTSTRAP_RACE_DELAY;
     settings->views_timeout = LCB_DEFAULT_VIEW_TIMEOUT;
     settings->n1ql_timeout = LCB_DEFAULT_N1QL_TIMEOUT;
     settings->analytics_timeout = LCB_DEFAULT_ANALYTICS_TIMEOUT;
@@ -51,7 +55,7 @@ void lcb_default_settings(lcb_settings *settings)
     settings->compressopts = LCB_DEFAULT_COMPRESSOPTS;
     settings->compress_min_size = LCB_DEFAULT_COMPRESS_MIN_SIZE;
     settings->compress_min_ratio = (float)LCB_DEFAULT_COMPRESS_MIN_RATIO;
-    settings->allocator_factory = rdb_bigalloc_new;
+    settings->allocator_factory = nullptr;
     settings->detailed_neterr = 0;
     settings->refresh_on_hterr = 1;
     settings->sched_implicit_flush = 1;
@@ -63,6 +67,14 @@ void lcb_default_settings(lcb_settings *settings)
     settings->vb_noremap = LCB_DEFAULT_VB_NOREMAP;
     settings->select_bucket = LCB_DEFAULT_SELECT_BUCKET;
     settings->tcp_keepalive = LCB_DEFAULT_TCP_KEEPALIVE;
+    settings->kv_prewarm = LCB_DEFAULT_KV_PREWARM;
+    settings->http_compression = LCB_DEFAULT_HTTP_COMPRESSION;
+    settings->http_stream_hwm = LCB_DEFAULT_HTTP_STREAM_HWM;
+    settings->query_cache_max_entries = LCB_DEFAULT_QUERY_CACHE_MAX_ENTRIES;
+    settings->query_cache_max_bytes = LCB_DEFAULT_QUERY_CACHE_MAX_BYTES;
+    settings->http_endpoint_selection = LCB_DEFAULT_HTTP_ENDPOINT_SELECTION;
+    settings->kv_hedge_delay = LCB_DEFAULT_KV_HEDGE_DELAY;
+    settings->kv_coalesce_gets = LCB_DEFAULT_KV_COALESCE_GETS;
     settings->config_poll_interval = LCB_DEFAULT_CONFIG_POLL_INTERVAL;
     settings->use_collections = 1;
     settings->log_redaction = 0;
@@ -95,6 +107,8 @@ lcb_settings *lcb_settings_new(void)
     settings->refcount = 1;
     settings->auth = lcbauth_new();
     settings->errmap = lcb_errmap_new();
+    settings->read_buffer_cache = rdb_segcache_new(LCB_DEFAULT_READ_BUFFER_CACHE_SIZE);
+    settings->sasl_salted_cache = cbsasl_salted_cache_new();
     return settings;
 }
 
@@ -113,6 +127,11 @@ void lcb_settings_unref(lcb_settings *settings)
 
     lcbauth_unref(settings->auth);
     lcb_errmap_free(settings->errmap);
+    rdb_segcache_unref(settings->read_buffer_cache);
+    cbsasl_salted_cache_free(settings->sasl_salted_cache);
+    if (settings->session_timings) {
+        lcb_histogram_destroy(settings->session_timings);
+    }
 
     if (settings->ssl_ctx) {
         lcbio_ssl_free(settings->ssl_ctx);
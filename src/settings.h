@@ -49,6 +49,12 @@
 /** 2 seconds per node */
 #define LCB_DEFAULT_NODECONFIG_TIMEOUT LCB_MS2US(2000)
 
+/** Bootstrap from one node at a time */
+#define LCB_DEFAULT_BOOTSTRAP_RACE_WIDTH 1
+
+/** 250 ms between starting concurrent bootstrap connections */
+#define LCB_DEFAULT_BOOTSTRAP_RACE_DELAY LCB_MS2US(250)
+
 #define LCB_DEFAULT_VIEW_TIMEOUT LCB_MS2US(75000)
 #define LCB_DEFAULT_N1QL_TIMEOUT LCB_MS2US(75000)
 #define LCB_DEFAULT_ANALYTICS_TIMEOUT LCB_MS2US(75000)
@@ -92,6 +98,16 @@
 #define LCB_DEFAULT_TCP_NODELAY 1
 #define LCB_DEFAULT_SELECT_BUCKET 1
 #define LCB_DEFAULT_TCP_KEEPALIVE 1
+#define LCB_DEFAULT_KV_PREWARM 0
+#define LCB_DEFAULT_HTTP_COMPRESSION 0
+#define LCB_DEFAULT_HTTP_STREAM_HWM 0
+#define LCB_DEFAULT_QUERY_CACHE_MAX_ENTRIES 5000
+#define LCB_DEFAULT_QUERY_CACHE_MAX_BYTES 0
+#define LCB_DEFAULT_HTTP_ENDPOINT_SELECTION LCB_HTTP_ENDPOINT_LEAST_LOADED
+#define LCB_DEFAULT_KV_HEDGE_DELAY 0
+#define LCB_DEFAULT_KV_COALESCE_GETS 0
+/* 4 MB */
+#define LCB_DEFAULT_READ_BUFFER_CACHE_SIZE 4194304
 /* 2.5 s */
 #define LCB_DEFAULT_CONFIG_POLL_INTERVAL LCB_MS2US(2500)
 /* 50 ms */
@@ -123,7 +139,10 @@ extern "C" {
 #endif
 
 struct lcbio_SSLCTX;
+struct cbsasl_salted_cache_st;
+struct lcb_histogram_st;
 struct rdb_ALLOCATOR;
+struct rdb_SEGCACHE;
 struct lcb_METRICS_st;
 
 /**
@@ -147,6 +166,13 @@ typedef struct lcb_settings_st {
     lcb_U32 persistence_timeout_floor;
     lcb_U32 config_timeout;
     lcb_U32 config_node_timeout;
+
+    /** Maximum number of nodes to bootstrap from concurrently */
+    lcb_U32 bootstrap_race_width;
+
+    /** Delay before starting the next concurrent bootstrap connection */
+    lcb_U32 bootstrap_race_delay;
+
     lcb_U32 retry_interval;
     lcb_U32 weird_things_threshold;
     lcb_U32 weird_things_delay;
@@ -197,6 +223,10 @@ typedef struct lcb_settings_st {
     unsigned wait_for_config : 1;
     unsigned enable_durable_write : 1;
     unsigned enable_unordered_execution : 1;
+    /** Connect to all data nodes as soon as a configuration is applied */
+    unsigned kv_prewarm : 1;
+    /** Ask query, analytics and search services for compressed responses */
+    unsigned http_compression : 1;
 
     lcb_RETRY_STRATEGY retry_strategy;
     short max_redir;
@@ -210,8 +240,15 @@ typedef struct lcb_settings_st {
     char *certpath;
     char *keypath;
     lcb_AUTHENTICATOR *auth;
+    /** Allocator for read buffers. If NULL, rdb_adaptalloc_new() is used with read_buffer_cache */
     struct rdb_ALLOCATOR *(*allocator_factory)(void);
+    /** Free read buffers, shared by the connections of the instance */
+    struct rdb_SEGCACHE *read_buffer_cache;
     struct lcbio_SSLCTX *ssl_ctx;
+    /** Salted SCRAM passwords, shared by the connections of the instance */
+    struct cbsasl_salted_cache_st *sasl_salted_cache;
+    /** Time taken to establish KV sessions, while timings are enabled */
+    struct lcb_histogram_st *session_timings;
     const lcb_LOGGER *logger;
     void (*dtorcb)(const void *);
     void *dtorarg;
@@ -228,6 +265,17 @@ typedef struct lcb_settings_st {
     lcb_U32 tracer_threshold[LCBTRACE_THRESHOLD__MAX];
     lcb_U32 compress_min_size;
     float compress_min_ratio;
+    /** Bytes to read ahead for streaming HTTP requests while delivery is paused */
+    lcb_U32 http_stream_hwm;
+    /** Limits for the prepared statement cache (0 bytes means no limit) */
+    lcb_U32 query_cache_max_entries;
+    lcb_U32 query_cache_max_bytes;
+    /** lcb_HTTP_ENDPOINT_SELECTION */
+    unsigned http_endpoint_selection : 1;
+    /** Delay before hedged gets read a replica (0 to use the recent p95) */
+    lcb_U32 kv_hedge_delay;
+    /** Attach gets for a key which is already being fetched to the pending request */
+    unsigned kv_coalesce_gets : 1;
     char *network; /** network resolution, AKA "Multi Network Configurations" */
     lcb_U32 op_metrics_flush_interval;
     unsigned op_metrics_enabled : 1;
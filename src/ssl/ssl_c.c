@@ -111,9 +111,12 @@ static void appdata_encode(lcbio_CSSL *cs)
 
         for (; ctx->niov && cs->error == 0; ctx->niov--, ctx->iov++) {
             int rv;
+            lcb_U64 hs_begin;
 
             lcb_assert(ctx->iov->iov_len);
+            hs_begin = iotssl_handshake_begin((lcbio_XSSL *)cs);
             rv = SSL_write(cs->ssl, ctx->iov->iov_base, ctx->iov->iov_len);
+            iotssl_handshake_end((lcbio_XSSL *)cs, hs_begin);
             if (rv > 0) {
                 continue;
             } else if (maybe_set_error(cs, rv) == 0) {
@@ -167,12 +170,15 @@ static void appdata_read(lcbio_CSSL *cs)
 {
     /* either an error or an actual read event */
     int nr;
+    lcb_U64 hs_begin;
     lcb_ioC_read2_callback cb = cs->urd_cb;
     if (!cb) {
         return;
     }
     lcb_assert(!cs->rdactive);
+    hs_begin = iotssl_handshake_begin((lcbio_XSSL *)cs);
     nr = SSL_read(cs->ssl, cs->urd_iov.iov_base, cs->urd_iov.iov_len);
+    iotssl_handshake_end((lcbio_XSSL *)cs, hs_begin);
     if (nr > 0) {
         /* nothing */
     } else if (cs->closed || nr == 0) {
@@ -236,12 +242,14 @@ static void schedule_wants(lcbio_CSSL *cs)
 {
     size_t npend = BIO_ctrl_pending(cs->wbio);
     char dummy;
+    lcb_U64 hs_begin = iotssl_handshake_begin((lcbio_XSSL *)cs);
 
     int has_appdata = 0;
 
     if (SSL_peek(cs->ssl, &dummy, 1) == 1) {
         has_appdata = 1;
     }
+    iotssl_handshake_end((lcbio_XSSL *)cs, hs_begin);
 
     if (npend) {
         /* Have pending data to write. The buffer is copied here because the
@@ -352,7 +360,9 @@ static int Cssl_write2(lcb_io_opt_t io, lcb_sockdata_t *sd, lcb_IOV *iov, lcb_si
     if (cs->error == 0 && SLLIST_IS_EMPTY(&cs->writes)) {
         unsigned ii;
         for (ii = 0; ii < niov; ++ii) {
+            lcb_U64 hs_begin = iotssl_handshake_begin((lcbio_XSSL *)cs);
             int rv = SSL_write(cs->ssl, iov->iov_base, iov->iov_len);
+            iotssl_handshake_end((lcbio_XSSL *)cs, hs_begin);
             if (rv > 0) {
                 iov++;
                 niov--;
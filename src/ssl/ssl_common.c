@@ -274,10 +274,73 @@ msg_callback(int write_p, int version, int ctype, const void *buf, size_t n,
 }
 #endif
 
+/**
+ * Number of remote endpoints for which a TLS session is remembered. Sessions
+ * are reused by subsequent connections to the same endpoint, turning a full
+ * handshake into an abbreviated one.
+ */
+#define LCB_SSL_SESSION_CACHE_SIZE 64
+
+typedef struct {
+    char key[NI_MAXHOST + NI_MAXSERV + 2];
+    SSL_SESSION *session;
+} lcbio_SSLSESSION;
+
 struct lcbio_SSLCTX {
     SSL_CTX *ctx;
+    lcbio_SSLSESSION sessions[LCB_SSL_SESSION_CACHE_SIZE];
+    unsigned next_session;
 };
 
+static void session_key(lcbio_SOCKET *sock, char *buf, size_t nbuf)
+{
+    const lcb_host_t *host = lcbio_get_host(sock);
+    snprintf(buf, nbuf, "%s:%s", host->host, host->port);
+}
+
+static lcbio_SSLSESSION *session_find(lcbio_pSSLCTX sctx, const char *key)
+{
+    unsigned ii;
+    for (ii = 0; ii < LCB_SSL_SESSION_CACHE_SIZE; ii++) {
+        lcbio_SSLSESSION *entry = sctx->sessions + ii;
+        if (entry->session && strcmp(entry->key, key) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Invoked by OpenSSL once a session (or, for TLS 1.3, a session ticket) has
+ * been negotiated. We take ownership of the session and keep it for the next
+ * connection to the same endpoint.
+ */
+static int new_session_callback(SSL *ssl, SSL_SESSION *session)
+{
+    lcbio_SOCKET *sock = SSL_get_app_data(ssl);
+    lcbio_pSSLCTX sctx = SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl));
+    lcbio_SSLSESSION *entry;
+    char key[sizeof(entry->key)];
+
+    if (!sock || !sctx || !sock->info) {
+        return 0;
+    }
+    session_key(sock, key, sizeof(key));
+    entry = session_find(sctx, key);
+    if (entry == NULL) {
+        entry = sctx->sessions + sctx->next_session;
+        sctx->next_session = (sctx->next_session + 1) % LCB_SSL_SESSION_CACHE_SIZE;
+        if (entry->session) {
+            SSL_SESSION_free(entry->session);
+        }
+        strcpy(entry->key, key);
+    } else {
+        SSL_SESSION_free(entry->session);
+    }
+    entry->session = session;
+    return 1;
+}
+
 #define LOGARGS_S(settings, lvl) settings, "SSL", lvl, __FILE__, __LINE__
 
 static long decode_ssl_protocol(const char *protocol)
@@ -410,6 +473,11 @@ lcbio_pSSLCTX lcbio_ssl_new(const char *tsfile, const char *cafile, const char *
      */
     SSL_CTX_set_mode(ret->ctx, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
     SSL_CTX_set_options(ret->ctx, decode_ssl_protocol(minimum_tls));
+
+    /* Remember sessions per endpoint so that reconnects can resume them */
+    SSL_CTX_set_app_data(ret->ctx, ret);
+    SSL_CTX_set_session_cache_mode(ret->ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(ret->ctx, new_session_callback);
     return ret;
 
 GT_ERR:
@@ -432,6 +500,8 @@ lcb_STATUS lcbio_ssl_apply(lcbio_SOCKET *sock, lcbio_pSSLCTX sctx)
 {
     lcbio_pTABLE old_iot = sock->io, new_iot;
     lcbio_PROTOCTX *sproto;
+    lcbio_SSLSESSION *entry;
+    char key[sizeof(entry->key)];
 
     if (old_iot->model == LCB_IOMODEL_EVENT) {
         new_iot = lcbio_Essl_new(old_iot, sock->u.fd, sctx->ctx);
@@ -446,8 +516,15 @@ lcb_STATUS lcbio_ssl_apply(lcbio_SOCKET *sock, lcbio_pSSLCTX sctx)
         lcbio_protoctx_add(sock, sproto);
         lcbio_table_unref(old_iot);
         sock->io = new_iot;
-        /* just for logging */
+        /* used for logging and for the session cache */
         SSL_set_app_data(((lcbio_XSSL *)new_iot)->ssl, sock);
+        if (sock->info) {
+            session_key(sock, key, sizeof(key));
+            entry = session_find(sctx, key);
+            if (entry) {
+                SSL_set_session(((lcbio_XSSL *)new_iot)->ssl, entry->session);
+            }
+        }
         return LCB_SUCCESS;
 
     } else {
@@ -466,8 +543,45 @@ lcb_STATUS lcbio_ssl_get_error(lcbio_SOCKET *sock)
     return xs->errcode;
 }
 
+int lcbio_ssl_session_reused(lcbio_SOCKET *sock)
+{
+    if (!lcbio_ssl_check(sock)) {
+        return 0;
+    }
+    return SSL_session_reused(((lcbio_XSSL *)sock->io)->ssl) != 0;
+}
+
+lcb_U64 lcbio_ssl_handshake_cputime(lcbio_SOCKET *sock)
+{
+    if (!lcbio_ssl_check(sock)) {
+        return 0;
+    }
+    return ((lcbio_XSSL *)sock->io)->hs_cputime;
+}
+
+lcb_U64 iotssl_handshake_begin(lcbio_XSSL *xs)
+{
+    if (SSL_is_init_finished(xs->ssl)) {
+        return 0;
+    }
+    return gethrcputime();
+}
+
+void iotssl_handshake_end(lcbio_XSSL *xs, lcb_U64 begin)
+{
+    if (begin) {
+        xs->hs_cputime += gethrcputime() - begin;
+    }
+}
+
 void lcbio_ssl_free(lcbio_pSSLCTX ctx)
 {
+    unsigned ii;
+    for (ii = 0; ii < LCB_SSL_SESSION_CACHE_SIZE; ii++) {
+        if (ctx->sessions[ii].session) {
+            SSL_SESSION_free(ctx->sessions[ii].session);
+        }
+    }
     SSL_CTX_free(ctx->ctx);
     free(ctx);
 }
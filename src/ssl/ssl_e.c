@@ -324,7 +324,9 @@ static void stop_watch(lcb_io_opt_t iops, lcb_socket_t sock, void *event)
 static lcb_ssize_t Essl_recv(lcb_io_opt_t iops, lcb_socket_t sock, void *buf, lcb_size_t nbuf, int ign)
 {
     lcbio_ESSL *es = ES_FROM_IOPS(iops);
+    lcb_U64 hs_begin = iotssl_handshake_begin((lcbio_XSSL *)es);
     int rv = SSL_read(es->ssl, buf, nbuf);
+    iotssl_handshake_end((lcbio_XSSL *)es, hs_begin);
 
     if (es->error) {
         IOTSSL_ERRNO(es) = EINVAL;
@@ -349,6 +351,7 @@ static lcb_ssize_t Essl_recv(lcb_io_opt_t iops, lcb_socket_t sock, void *buf, lc
 static lcb_ssize_t Essl_send(lcb_io_opt_t iops, lcb_socket_t sock, const void *buf, lcb_size_t nbuf, int ign)
 {
     lcbio_ESSL *es = ES_FROM_IOPS(iops);
+    lcb_U64 hs_begin;
     int rv;
     (void)ign;
     (void)sock;
@@ -358,7 +361,9 @@ static lcb_ssize_t Essl_send(lcb_io_opt_t iops, lcb_socket_t sock, const void *b
         return -1;
     }
 
+    hs_begin = iotssl_handshake_begin((lcbio_XSSL *)es);
     rv = SSL_write(es->ssl, buf, nbuf);
+    iotssl_handshake_end((lcbio_XSSL *)es, hs_begin);
     if (rv >= 0) {
         /* still need to schedule data to get flushed to the network */
         SCHEDULE_PENDING_SAFE(es);
@@ -34,7 +34,8 @@
     BIO *rbio;                /**< BIO used for reading data from network */                                           \
     lcb_io_opt_t iops_dummy_; /**< Dummy IOPS structure which is exposed to LCB */                                     \
     int error;                /**< Internal error flag set once a fatal error is detect */                             \
-    lcb_STATUS errcode;       /**< The error, converted into libcouchbase */
+    lcb_STATUS errcode;       /**< The error, converted into libcouchbase */                                           \
+    lcb_U64 hs_cputime;       /**< CPU time spent in the handshake, see iotssl_handshake_begin() */
 
 /**
  * @brief
@@ -81,6 +82,25 @@ typedef struct {
  */
 int iotssl_maybe_error(lcbio_XSSL *xs, int rv);
 
+/**
+ * @brief Start accounting the CPU time of an SSL call to the handshake
+ *
+ * Call this before `SSL_read()`, `SSL_write()` and friends, which perform
+ * the handshake while it is not finished, and pass the return value to
+ * iotssl_handshake_end() once the call returns.
+ *
+ * @param xs The XSSL context
+ * @return the current CPU time, or 0 if the handshake was finished already
+ */
+lcb_U64 iotssl_handshake_begin(lcbio_XSSL *xs);
+
+/**
+ * @brief Add the CPU time of an SSL call to the handshake
+ * @param xs The XSSL context
+ * @param begin the value returned by iotssl_handshake_begin()
+ */
+void iotssl_handshake_end(lcbio_XSSL *xs, lcb_U64 begin);
+
 /**
  * Flush errors from the internal error queue. Call this whenever an error
  * has taken place
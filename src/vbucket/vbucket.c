@@ -159,6 +159,46 @@ static void set_vb_count(lcbvb_CONFIG *cfg, lcbvb_VBUCKET *vbs)
     }
 }
 
+#define ROUTE_ALIGNMENT 64
+
+static void set_vb_route(lcbvb_CONFIG *cfg, unsigned vbid)
+{
+    unsigned ii;
+    int16_t *route = cfg->vbroutes + vbid * LCBVB_ROUTE_STRIDE;
+    for (ii = 0; ii < LCBVB_ROUTE_STRIDE; ++ii) {
+        route[ii] = ii < cfg->nrepl + 1 ? (int16_t)cfg->vbuckets[vbid].servers[ii] : -1;
+    }
+}
+
+int lcbvb_update_routes(lcbvb_CONFIG *cfg)
+{
+    unsigned ii;
+    size_t nbytes;
+    char *block;
+
+    if (cfg->dtype != LCBVB_DIST_VBUCKET || !cfg->vbuckets || !cfg->nvb) {
+        return 0;
+    }
+
+    if (!cfg->vbroutes) {
+        /* Over-allocate so the table can start on a cache line boundary. Each
+         * vBucket occupies 8 bytes, so a row never straddles two lines */
+        nbytes = cfg->nvb * LCBVB_ROUTE_STRIDE * sizeof(*cfg->vbroutes);
+        if (!(block = malloc(nbytes + ROUTE_ALIGNMENT - 1))) {
+            SET_ERRSTR(cfg, "Couldn't allocate vBucket routing table");
+            return -1;
+        }
+        cfg->vbroutes_alloc_ = block;
+        cfg->vbroutes =
+            (int16_t *)(block + ((ROUTE_ALIGNMENT - ((uintptr_t)block % ROUTE_ALIGNMENT)) % ROUTE_ALIGNMENT));
+    }
+
+    for (ii = 0; ii < cfg->nvb; ++ii) {
+        set_vb_route(cfg, ii);
+    }
+    return 0;
+}
+
 static int pair_server_list(lcbvb_CONFIG *cfg, cJSON *vbconfig)
 {
     cJSON *servers;
@@ -251,6 +291,10 @@ static int parse_vbucket(lcbvb_CONFIG *cfg, cJSON *cj)
     /** Now figure out which server goes where */
     set_vb_count(cfg, cfg->vbuckets);
     set_vb_count(cfg, cfg->ffvbuckets);
+
+    if (lcbvb_update_routes(cfg) != 0) {
+        goto GT_ERROR;
+    }
     return 1;
 
 GT_ERROR:
@@ -887,6 +931,7 @@ void lcbvb_destroy(lcbvb_CONFIG *conf)
     free(conf->bname);
     free(conf->vbuckets);
     free(conf->ffvbuckets);
+    free(conf->vbroutes_alloc_);
     free(conf->randbuf);
     free(conf);
 }
@@ -1031,6 +1076,395 @@ char *lcbvb_save_json(lcbvb_CONFIG *cfg)
     return ret;
 }
 
+/******************************************************************************
+ ******************************************************************************
+ ** Binary Snapshots                                                         **
+ ******************************************************************************
+ ******************************************************************************/
+
+/*
+ * The snapshot is a single contiguous block laid out so that it may be mapped
+ * directly into memory. All sections are 8-byte aligned and stored in host
+ * byte order (the header records the byte order used, and a snapshot written
+ * on a host with a different byte order is rejected):
+ *
+ *   [header] [servers] [vbucket map] [ff vbucket map] [continuum] [strings]
+ *
+ * String fields are stored as offsets into the string section, which contains
+ * NUL-terminated strings. The vBucket maps use the same layout as the in-memory
+ * routing table (LCBVB_ROUTE_STRIDE entries of int16_t per vBucket).
+ */
+#define BIN_MAGIC "LCBVBIN"
+#define BIN_VERSION 1
+#define BIN_BYTEORDER 0x01020304
+#define BIN_NOSTR 0xffffffff
+#define BIN_ALIGN(n) (((n) + 7) & ~(size_t)7)
+
+enum { BIN_SVC_PLAIN = 0, BIN_SVC_SSL, BIN_SVC_ALT, BIN_SVC_ALTSSL, BIN_SVC__MAX };
+enum {
+    BIN_STR_HOSTNAME = 0,
+    BIN_STR_ALTHOSTNAME,
+    BIN_STR_VIEWPATH,
+    BIN_STR_QUERYPATH,
+    BIN_STR_FTSPATH,
+    BIN_STR_CBASPATH,
+    BIN_STR_EVENTINGPATH,
+    BIN_STR__MAX
+};
+
+typedef struct {
+    char magic[8];
+    lcb_U32 version;
+    lcb_U32 byteorder;
+    lcb_U32 hdrsize;
+    lcb_U32 checksum; /* CRC32 of everything following the header */
+    lcb_U64 totalsize;
+    int64_t revid;
+    lcb_U64 caps;
+    lcb_U64 ccaps;
+    lcb_U32 dtype;
+    lcb_U32 nvb;
+    lcb_U32 nsrv;
+    lcb_U32 ndatasrv;
+    lcb_U32 nrepl;
+    lcb_U32 ncontinuum;
+    lcb_U32 is3x;
+    lcb_U32 has_ffmap;
+    lcb_U32 bname;
+    lcb_U32 buuid;
+    lcb_U32 off_servers;
+    lcb_U32 off_vbmap;
+    lcb_U32 off_ffmap;
+    lcb_U32 off_continuum;
+    lcb_U32 off_strings;
+    lcb_U32 nstrings;
+} bin_HEADER;
+
+typedef struct {
+    lcb_U32 strs[BIN_STR__MAX];
+    lcb_U32 nvbs;
+    lcb_U16 ports[BIN_SVC__MAX][9];
+    lcb_U16 pad_;
+} bin_SERVER;
+
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t cap;
+} bin_STRBUF;
+
+static lcb_U32 bin_add_string(bin_STRBUF *sb, const char *s)
+{
+    size_t n;
+    lcb_U32 off;
+    if (!s) {
+        return BIN_NOSTR;
+    }
+    n = strlen(s) + 1;
+    if (sb->len + n > sb->cap) {
+        size_t newcap = sb->cap ? sb->cap * 2 : 1024;
+        char *tmp;
+        while (newcap < sb->len + n) {
+            newcap *= 2;
+        }
+        if (!(tmp = realloc(sb->buf, newcap))) {
+            return BIN_NOSTR;
+        }
+        sb->buf = tmp;
+        sb->cap = newcap;
+    }
+    off = (lcb_U32)sb->len;
+    memcpy(sb->buf + sb->len, s, n);
+    sb->len += n;
+    return off;
+}
+
+static void bin_store_ports(lcb_U16 *dst, const lcbvb_SERVICES *svc)
+{
+    dst[0] = svc->data;
+    dst[1] = svc->mgmt;
+    dst[2] = svc->views;
+    dst[3] = svc->ixquery;
+    dst[4] = svc->ixadmin;
+    dst[5] = svc->n1ql;
+    dst[6] = svc->fts;
+    dst[7] = svc->cbas;
+    dst[8] = svc->eventing;
+}
+
+static void bin_load_ports(lcbvb_SERVICES *svc, const lcb_U16 *src)
+{
+    svc->data = src[0];
+    svc->mgmt = src[1];
+    svc->views = src[2];
+    svc->ixquery = src[3];
+    svc->ixadmin = src[4];
+    svc->n1ql = src[5];
+    svc->fts = src[6];
+    svc->cbas = src[7];
+    svc->eventing = src[8];
+}
+
+static void bin_store_map(int16_t *dst, const lcbvb_CONFIG *cfg, const lcbvb_VBUCKET *vbs)
+{
+    unsigned ii, jj;
+    for (ii = 0; ii < cfg->nvb; ++ii) {
+        for (jj = 0; jj < LCBVB_ROUTE_STRIDE; ++jj) {
+            *dst++ = jj < cfg->nrepl + 1 ? (int16_t)vbs[ii].servers[jj] : -1;
+        }
+    }
+}
+
+int lcbvb_save_binary(lcbvb_CONFIG *cfg, char **out, size_t *nout)
+{
+    bin_STRBUF sb = {NULL, 0, 0};
+    bin_HEADER hdr;
+    bin_SERVER *servers = NULL;
+    size_t nmap = 0, pos;
+    char *buf = NULL;
+    unsigned ii;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, BIN_MAGIC, sizeof(BIN_MAGIC));
+    hdr.version = BIN_VERSION;
+    hdr.byteorder = BIN_BYTEORDER;
+    hdr.hdrsize = sizeof(hdr);
+    hdr.revid = cfg->revid;
+    hdr.caps = cfg->caps;
+    hdr.ccaps = cfg->ccaps;
+    hdr.dtype = cfg->dtype;
+    hdr.nsrv = cfg->nsrv;
+    hdr.ndatasrv = cfg->ndatasrv;
+    hdr.nrepl = cfg->nrepl;
+    hdr.is3x = cfg->is3x;
+    hdr.bname = bin_add_string(&sb, cfg->bname);
+    hdr.buuid = bin_add_string(&sb, cfg->buuid);
+
+    if (cfg->dtype == LCBVB_DIST_VBUCKET && cfg->vbuckets) {
+        hdr.nvb = cfg->nvb;
+        hdr.has_ffmap = cfg->ffvbuckets != NULL;
+        nmap = BIN_ALIGN(cfg->nvb * LCBVB_ROUTE_STRIDE * sizeof(int16_t));
+    } else if (cfg->dtype == LCBVB_DIST_KETAMA) {
+        hdr.ncontinuum = cfg->ncontinuum;
+    }
+
+    if (cfg->nsrv && !(servers = calloc(cfg->nsrv, sizeof(*servers)))) {
+        goto GT_ERROR;
+    }
+    for (ii = 0; ii < cfg->nsrv; ++ii) {
+        const lcbvb_SERVER *srv = cfg->servers + ii;
+        bin_SERVER *dst = servers + ii;
+        dst->strs[BIN_STR_HOSTNAME] = bin_add_string(&sb, srv->hostname);
+        dst->strs[BIN_STR_ALTHOSTNAME] = bin_add_string(&sb, srv->alt_hostname);
+        dst->strs[BIN_STR_VIEWPATH] = bin_add_string(&sb, srv->viewpath);
+        dst->strs[BIN_STR_QUERYPATH] = bin_add_string(&sb, srv->querypath);
+        dst->strs[BIN_STR_FTSPATH] = bin_add_string(&sb, srv->ftspath);
+        dst->strs[BIN_STR_CBASPATH] = bin_add_string(&sb, srv->cbaspath);
+        dst->strs[BIN_STR_EVENTINGPATH] = bin_add_string(&sb, srv->eventingpath);
+        dst->nvbs = srv->nvbs;
+        bin_store_ports(dst->ports[BIN_SVC_PLAIN], &srv->svc);
+        bin_store_ports(dst->ports[BIN_SVC_SSL], &srv->svc_ssl);
+        bin_store_ports(dst->ports[BIN_SVC_ALT], &srv->alt_svc);
+        bin_store_ports(dst->ports[BIN_SVC_ALTSSL], &srv->alt_svc_ssl);
+    }
+
+    pos = BIN_ALIGN(sizeof(hdr));
+    hdr.off_servers = (lcb_U32)pos;
+    pos += BIN_ALIGN(cfg->nsrv * sizeof(*servers));
+    hdr.off_vbmap = (lcb_U32)pos;
+    pos += nmap;
+    hdr.off_ffmap = (lcb_U32)pos;
+    pos += hdr.has_ffmap ? nmap : 0;
+    hdr.off_continuum = (lcb_U32)pos;
+    pos += BIN_ALIGN(hdr.ncontinuum * sizeof(lcbvb_CONTINUUM));
+    hdr.off_strings = (lcb_U32)pos;
+    hdr.nstrings = (lcb_U32)sb.len;
+    pos += sb.len;
+    hdr.totalsize = pos;
+
+    if (!(buf = calloc(1, pos))) {
+        goto GT_ERROR;
+    }
+    if (cfg->nsrv) {
+        memcpy(buf + hdr.off_servers, servers, cfg->nsrv * sizeof(*servers));
+    }
+    if (nmap) {
+        bin_store_map((int16_t *)(buf + hdr.off_vbmap), cfg, cfg->vbuckets);
+        if (hdr.has_ffmap) {
+            bin_store_map((int16_t *)(buf + hdr.off_ffmap), cfg, cfg->ffvbuckets);
+        }
+    }
+    if (hdr.ncontinuum) {
+        memcpy(buf + hdr.off_continuum, cfg->continuum, hdr.ncontinuum * sizeof(lcbvb_CONTINUUM));
+    }
+    if (sb.len) {
+        memcpy(buf + hdr.off_strings, sb.buf, sb.len);
+    }
+    hdr.checksum = hash_crc32(buf + sizeof(hdr), pos - sizeof(hdr));
+    memcpy(buf, &hdr, sizeof(hdr));
+
+    free(servers);
+    free(sb.buf);
+    *out = buf;
+    *nout = pos;
+    return 0;
+
+GT_ERROR:
+    free(servers);
+    free(sb.buf);
+    SET_ERRSTR(cfg, "Couldn't allocate memory for binary snapshot");
+    return -1;
+}
+
+static int bin_get_string(const bin_HEADER *hdr, const char *data, lcb_U32 off, char **out)
+{
+    const char *s, *end;
+    *out = NULL;
+    if (off == BIN_NOSTR) {
+        return 1;
+    }
+    if (off >= hdr->nstrings) {
+        return 0;
+    }
+    s = data + hdr->off_strings + off;
+    end = memchr(s, '\0', hdr->nstrings - off);
+    if (!end) {
+        return 0;
+    }
+    return (*out = strdup(s)) != NULL;
+}
+
+static lcbvb_VBUCKET *bin_load_map(const lcbvb_CONFIG *cfg, const int16_t *src)
+{
+    unsigned ii, jj;
+    lcbvb_VBUCKET *vbs = calloc(cfg->nvb, sizeof(*vbs));
+    if (!vbs) {
+        return NULL;
+    }
+    for (ii = 0; ii < cfg->nvb; ++ii) {
+        for (jj = 0; jj < LCBVB_ROUTE_STRIDE; ++jj) {
+            int ix = *src++;
+            if (ix >= (int)cfg->nsrv) {
+                free(vbs);
+                return NULL;
+            }
+            vbs[ii].servers[jj] = ix;
+        }
+    }
+    return vbs;
+}
+
+int lcbvb_is_binary(const void *data, size_t ndata)
+{
+    return ndata >= sizeof(bin_HEADER) && memcmp(data, BIN_MAGIC, sizeof(BIN_MAGIC)) == 0;
+}
+
+int lcbvb_load_binary(lcbvb_CONFIG *cfg, const void *data_, size_t ndata)
+{
+    const char *data = data_;
+    const bin_SERVER *servers;
+    bin_HEADER hdr;
+    size_t nmap;
+    unsigned ii;
+
+    if (!lcbvb_is_binary(data, ndata)) {
+        SET_ERRSTR(cfg, "Not a binary configuration snapshot");
+        return -1;
+    }
+    memcpy(&hdr, data, sizeof(hdr));
+    if (hdr.version != BIN_VERSION || hdr.byteorder != BIN_BYTEORDER || hdr.hdrsize != sizeof(hdr)) {
+        SET_ERRSTR(cfg, "Incompatible binary snapshot version");
+        return -1;
+    }
+    nmap = BIN_ALIGN(hdr.nvb * LCBVB_ROUTE_STRIDE * sizeof(int16_t));
+    if (hdr.totalsize != ndata || hdr.off_servers + hdr.nsrv * sizeof(bin_SERVER) > hdr.off_vbmap ||
+        hdr.off_vbmap + nmap > hdr.off_ffmap || hdr.off_ffmap + (hdr.has_ffmap ? nmap : 0) > hdr.off_continuum ||
+        hdr.off_continuum + hdr.ncontinuum * sizeof(lcbvb_CONTINUUM) > hdr.off_strings ||
+        (lcb_U64)hdr.off_strings + hdr.nstrings != ndata || hdr.nrepl > LCBVB_ROUTE_STRIDE - 1 ||
+        hdr.ndatasrv > hdr.nsrv) {
+        SET_ERRSTR(cfg, "Corrupt binary snapshot layout");
+        return -1;
+    }
+    if (hash_crc32(data + sizeof(hdr), ndata - sizeof(hdr)) != hdr.checksum) {
+        SET_ERRSTR(cfg, "Binary snapshot checksum mismatch");
+        return -1;
+    }
+
+    cfg->dtype = (lcbvb_DISTMODE)hdr.dtype;
+    cfg->revid = hdr.revid;
+    cfg->caps = hdr.caps;
+    cfg->ccaps = hdr.ccaps;
+    cfg->nrepl = hdr.nrepl;
+    cfg->is3x = hdr.is3x;
+    cfg->ndatasrv = hdr.ndatasrv;
+    if (!bin_get_string(&hdr, data, hdr.bname, &cfg->bname) || !bin_get_string(&hdr, data, hdr.buuid, &cfg->buuid)) {
+        goto GT_CORRUPT;
+    }
+    cfg->bname_len = cfg->bname ? strlen(cfg->bname) : 0;
+
+    if (hdr.nsrv && !(cfg->servers = calloc(hdr.nsrv, sizeof(*cfg->servers)))) {
+        goto GT_NOMEM;
+    }
+    if (hdr.nsrv && !(cfg->randbuf = malloc(hdr.nsrv * sizeof(*cfg->randbuf)))) {
+        goto GT_NOMEM;
+    }
+    servers = (const bin_SERVER *)(data + hdr.off_servers);
+    for (ii = 0; ii < hdr.nsrv; ++ii) {
+        lcbvb_SERVER *srv = cfg->servers + ii;
+        bin_SERVER src;
+        memcpy(&src, servers + ii, sizeof(src));
+        /* count servers as they are populated, so lcbvb_destroy() releases
+         * partially loaded configs correctly */
+        cfg->nsrv = ii + 1;
+        if (!bin_get_string(&hdr, data, src.strs[BIN_STR_HOSTNAME], &srv->hostname) || srv->hostname == NULL ||
+            !bin_get_string(&hdr, data, src.strs[BIN_STR_ALTHOSTNAME], &srv->alt_hostname) ||
+            !bin_get_string(&hdr, data, src.strs[BIN_STR_VIEWPATH], &srv->viewpath) ||
+            !bin_get_string(&hdr, data, src.strs[BIN_STR_QUERYPATH], &srv->querypath) ||
+            !bin_get_string(&hdr, data, src.strs[BIN_STR_FTSPATH], &srv->ftspath) ||
+            !bin_get_string(&hdr, data, src.strs[BIN_STR_CBASPATH], &srv->cbaspath) ||
+            !bin_get_string(&hdr, data, src.strs[BIN_STR_EVENTINGPATH], &srv->eventingpath)) {
+            goto GT_CORRUPT;
+        }
+        srv->nvbs = src.nvbs;
+        bin_load_ports(&srv->svc, src.ports[BIN_SVC_PLAIN]);
+        bin_load_ports(&srv->svc_ssl, src.ports[BIN_SVC_SSL]);
+        bin_load_ports(&srv->alt_svc, src.ports[BIN_SVC_ALT]);
+        bin_load_ports(&srv->alt_svc_ssl, src.ports[BIN_SVC_ALTSSL]);
+        if (!build_server_strings(cfg, srv)) {
+            goto GT_NOMEM;
+        }
+    }
+
+    if (cfg->dtype == LCBVB_DIST_VBUCKET && hdr.nvb) {
+        cfg->nvb = hdr.nvb;
+        if (!(cfg->vbuckets = bin_load_map(cfg, (const int16_t *)(data + hdr.off_vbmap)))) {
+            goto GT_CORRUPT;
+        }
+        if (hdr.has_ffmap && !(cfg->ffvbuckets = bin_load_map(cfg, (const int16_t *)(data + hdr.off_ffmap)))) {
+            goto GT_CORRUPT;
+        }
+        if (lcbvb_update_routes(cfg) != 0) {
+            return -1;
+        }
+    } else if (cfg->dtype == LCBVB_DIST_KETAMA && hdr.ncontinuum) {
+        size_t ncont = hdr.ncontinuum * sizeof(*cfg->continuum);
+        if (!(cfg->continuum = malloc(ncont))) {
+            goto GT_NOMEM;
+        }
+        memcpy(cfg->continuum, data + hdr.off_continuum, ncont);
+        cfg->ncontinuum = hdr.ncontinuum;
+    }
+    return 0;
+
+GT_CORRUPT:
+    SET_ERRSTR(cfg, "Corrupt binary snapshot contents");
+    return -1;
+
+GT_NOMEM:
+    SET_ERRSTR(cfg, "Couldn't allocate memory for binary snapshot");
+    return -1;
+}
+
 /******************************************************************************
  ******************************************************************************
  ** Mapping Routines                                                         **
@@ -1149,6 +1583,9 @@ int lcbvb_nmv_remap_ex(lcbvb_CONFIG *cfg, int vbid, int bad, int heuristic)
 
     if (cfg->ffvbuckets && (rv = cfg->ffvbuckets[vbid].servers[0]) != bad && rv > -1) {
         memcpy(&cfg->vbuckets[vbid], &cfg->ffvbuckets[vbid], sizeof(lcbvb_VBUCKET));
+        if (cfg->vbroutes) {
+            set_vb_route(cfg, vbid);
+        }
     }
 
     /* this path is usually only followed if fvbuckets is not present */
@@ -1160,6 +1597,9 @@ int lcbvb_nmv_remap_ex(lcbvb_CONFIG *cfg, int vbid, int bad, int heuristic)
             if (cfg->servers[rv].nvbs) {
                 validrv = rv;
                 cfg->vbuckets[vbid].servers[0] = rv;
+                if (cfg->vbroutes) {
+                    cfg->vbroutes[vbid * LCBVB_ROUTE_STRIDE] = (int16_t)rv;
+                }
                 break;
             }
         }
@@ -1740,7 +2180,7 @@ int lcbvb_genconfig_ex(lcbvb_CONFIG *vb, const char *name, const char *uuid, con
             }
         }
     }
-    return 0;
+    return lcbvb_update_routes(vb);
 }
 
 int lcbvb_genconfig(lcbvb_CONFIG *vb, unsigned nservers, unsigned nreplica, unsigned nvbuckets)
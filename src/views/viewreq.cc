@@ -234,7 +234,7 @@ static void doc_callback(lcb_INSTANCE *, int, const lcb_RESPBASE *rb)
 
     q->ref();
 
-    q->n_awaiting_response--;
+    q->complete(dreq);
     dreq->docresp = *rg;
     dreq->ready = 1;
     dreq->docresp.ctx.key = (const char *)dreq->docid.iov_base;
@@ -364,6 +364,9 @@ lcb_STATUS lcb_VIEW_HANDLE_::request_http(const lcb_CMDVIEW *cmd)
     lcb_cmdhttp_destroy(htcmd);
     if (err == LCB_SUCCESS) {
         htreq->set_callback(chunk_callback);
+        if (paused) {
+            htreq->pause_delivery();
+        }
     }
     return err;
 }
@@ -429,6 +432,36 @@ LIBCOUCHBASE_API
 lcb_STATUS lcb_view_cancel(lcb_INSTANCE *, lcb_VIEW_HANDLE *handle)
 {
     handle->cancel();
+    // the handle is destroyed once the next chunk arrives
+    if (handle->htreq) {
+        handle->htreq->resume_delivery();
+    }
+    return LCB_SUCCESS;
+}
+
+LIBCOUCHBASE_API
+lcb_STATUS lcb_view_pause(lcb_INSTANCE *, lcb_VIEW_HANDLE *handle)
+{
+    if (handle == nullptr) {
+        return LCB_ERR_INVALID_ARGUMENT;
+    }
+    handle->paused = true;
+    if (handle->htreq) {
+        handle->htreq->pause_delivery();
+    }
+    return LCB_SUCCESS;
+}
+
+LIBCOUCHBASE_API
+lcb_STATUS lcb_view_resume(lcb_INSTANCE *, lcb_VIEW_HANDLE *handle)
+{
+    if (handle == nullptr) {
+        return LCB_ERR_INVALID_ARGUMENT;
+    }
+    handle->paused = false;
+    if (handle->htreq) {
+        handle->htreq->resume_delivery();
+    }
     return LCB_SUCCESS;
 }
 
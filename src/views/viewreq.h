@@ -95,4 +95,6 @@ struct lcb_VIEW_HANDLE_ : lcb::jsparse::Parser::Actions {
     uint32_t cmdflags;
     lcb_STATUS lasterr;
     lcbtrace_SPAN *span;
+    /** Whether row delivery was paused by the application */
+    bool paused{false};
 };
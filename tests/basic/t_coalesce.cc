@@ -0,0 +1,55 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+#include <gtest/gtest.h>
+#include "coalesce.h"
+
+using lcb::GetCoalescer;
+
+class GetCoalescerTest : public ::testing::Test
+{
+};
+
+TEST_F(GetCoalescerTest, testKeys)
+{
+    ASSERT_EQ(GetCoalescer::make_key(0, "foo", 3), GetCoalescer::make_key(0, "foo", 3));
+    ASSERT_NE(GetCoalescer::make_key(0, "foo", 3), GetCoalescer::make_key(8, "foo", 3));
+    ASSERT_NE(GetCoalescer::make_key(0, "foo", 3), GetCoalescer::make_key(0, "foo", 2));
+}
+
+TEST_F(GetCoalescerTest, testFlights)
+{
+    GetCoalescer coalescer;
+    GetCoalescer::Flight first, second;
+    first.key = second.key = GetCoalescer::make_key(0, "foo", 3);
+
+    ASSERT_EQ(nullptr, coalescer.find(first.key));
+    coalescer.add(&first);
+    ASSERT_EQ(&first, coalescer.find(first.key));
+    ASSERT_EQ(nullptr, coalescer.find(GetCoalescer::make_key(8, "foo", 3)));
+
+    // A newer get replaces the previous one, which no longer removes it
+    coalescer.add(&second);
+    ASSERT_EQ(&second, coalescer.find(first.key));
+    coalescer.remove(&first);
+    ASSERT_EQ(&second, coalescer.find(first.key));
+    ASSERT_EQ(1U, coalescer.size());
+    coalescer.remove(&second);
+    ASSERT_EQ(nullptr, coalescer.find(first.key));
+    ASSERT_EQ(0U, coalescer.size());
+}
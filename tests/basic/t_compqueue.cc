@@ -0,0 +1,252 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "compqueue.h"
+#include "internalstructs.h"
+#include "rdb/rope.h"
+
+using lcb::CompletionQueue;
+
+class CompletionQueueTest : public ::testing::Test
+{
+};
+
+static lcb_COMPLETION make_entry(uintptr_t ii)
+{
+    lcb_COMPLETION entry{};
+    entry.type = LCB_CALLBACK_GET;
+    entry.cookie = reinterpret_cast<void *>(ii);
+    return entry;
+}
+
+TEST_F(CompletionQueueTest, testOrder)
+{
+    CompletionQueue queue(3);
+    ASSERT_EQ(4, queue.capacity());
+
+    lcb_COMPLETION entries[8];
+    ASSERT_EQ(0, queue.poll(entries, 8));
+
+    // Wrap around the end of the ring
+    for (uintptr_t ii = 0; ii < 3; ii++) {
+        queue.push(make_entry(ii));
+    }
+    ASSERT_EQ(2, queue.poll(entries, 2));
+    ASSERT_EQ(reinterpret_cast<void *>(0), entries[0].cookie);
+    ASSERT_EQ(reinterpret_cast<void *>(1), entries[1].cookie);
+    for (uintptr_t ii = 3; ii < 6; ii++) {
+        queue.push(make_entry(ii));
+    }
+    ASSERT_EQ(4, queue.size());
+    ASSERT_EQ(4, queue.capacity());
+    ASSERT_EQ(0, queue.grown);
+
+    // A full ring grows, keeping the order of the entries
+    for (uintptr_t ii = 6; ii < 9; ii++) {
+        queue.push(make_entry(ii));
+    }
+    ASSERT_EQ(8, queue.capacity());
+    ASSERT_EQ(1, queue.grown);
+    ASSERT_EQ(7, queue.poll(entries, 8));
+    for (uintptr_t ii = 0; ii < 7; ii++) {
+        ASSERT_EQ(reinterpret_cast<void *>(ii + 2), entries[ii].cookie);
+    }
+    ASSERT_EQ(0, queue.size());
+}
+
+TEST_F(CompletionQueueTest, testRelease)
+{
+    CompletionQueue *queue = new CompletionQueue(2);
+    lcb_COMPLETION entry = make_entry(1);
+    entry.nvalue = 5;
+    entry.buffer = malloc(entry.nvalue);
+    entry.value = entry.buffer;
+    entry.allocated = 1;
+    queue->push(entry);
+
+    lcb_COMPLETION polled;
+    ASSERT_EQ(1, queue->poll(&polled, 1));
+    ASSERT_EQ(entry.value, polled.value);
+    lcb_completion_release(&polled);
+    ASSERT_TRUE(polled.buffer == nullptr);
+    ASSERT_TRUE(polled.value == nullptr);
+    // Releasing twice is harmless
+    lcb_completion_release(&polled);
+
+    // Entries which were never polled are released with the queue
+    entry.buffer = malloc(entry.nvalue);
+    entry.value = entry.buffer;
+    queue->push(entry);
+    delete queue;
+}
+
+static void dummy_callback(lcb_INSTANCE *, int, const lcb_RESPBASE *) {}
+
+TEST_F(CompletionQueueTest, testEnable)
+{
+    lcb_INSTANCE *instance;
+    ASSERT_EQ(LCB_SUCCESS, lcb_create(&instance, NULL));
+    lcb_install_callback(instance, LCB_CALLBACK_GET, dummy_callback);
+    lcb_install_callback(instance, LCB_CALLBACK_SDLOOKUP, dummy_callback);
+    lcb_RESPCALLBACK remove_callback = lcb_get_callback(instance, LCB_CALLBACK_REMOVE);
+
+    // The queue takes the place of the callbacks of key/value responses only
+    ASSERT_EQ(LCB_SUCCESS, lcb_completion_queue_enable(instance, 16));
+    lcb_RESPCALLBACK queued = lcb_get_callback(instance, LCB_CALLBACK_GET);
+    ASSERT_TRUE(queued != dummy_callback);
+    ASSERT_EQ(queued, lcb_get_callback(instance, LCB_CALLBACK_STORE));
+    ASSERT_EQ(dummy_callback, lcb_get_callback(instance, LCB_CALLBACK_SDLOOKUP));
+
+    // Enabling it again keeps the callbacks it replaced the first time
+    ASSERT_EQ(LCB_SUCCESS, lcb_completion_queue_enable(instance, 32));
+    ASSERT_EQ(queued, lcb_get_callback(instance, LCB_CALLBACK_GET));
+
+    // Disabling it restores them, but a callback installed meanwhile takes
+    // precedence
+    lcb_install_callback(instance, LCB_CALLBACK_STORE, dummy_callback);
+    ASSERT_EQ(LCB_SUCCESS, lcb_completion_queue_enable(instance, 0));
+    ASSERT_EQ(dummy_callback, lcb_get_callback(instance, LCB_CALLBACK_GET));
+    ASSERT_EQ(dummy_callback, lcb_get_callback(instance, LCB_CALLBACK_STORE));
+    ASSERT_EQ(remove_callback, lcb_get_callback(instance, LCB_CALLBACK_REMOVE));
+
+    lcb_COMPLETION entry;
+    ASSERT_EQ(0, lcb_completion_queue_poll(instance, &entry, 1));
+    lcb_destroy(instance);
+}
+
+/**
+ * Receive a response into a read buffer, the way the socket layer does, and
+ * return the segment it is in
+ */
+static rdb_ROPESEG *receive(rdb_IOROPE *ior, const std::string &data)
+{
+    nb_IOV iov;
+    rdb_rdstart(ior, &iov, 1);
+    EXPECT_GE(iov.iov_len, data.size());
+    memcpy(iov.iov_base, data.c_str(), data.size());
+    rdb_rdend(ior, data.size());
+    return rdb_get_first_segment(ior);
+}
+
+TEST_F(CompletionQueueTest, testTakeValue)
+{
+    lcb_INSTANCE *instance;
+    ASSERT_EQ(LCB_SUCCESS, lcb_create(&instance, NULL));
+    ASSERT_EQ(LCB_SUCCESS, lcb_completion_queue_enable(instance, 16));
+    lcb_RESPCALLBACK queued = lcb_get_callback(instance, LCB_CALLBACK_GET);
+
+    const std::string header("HEADER--");
+    const std::string value("{\"value\":42}");
+    rdb_IOROPE ior;
+    rdb_init(&ior, rdb_libcalloc_new());
+    rdb_ROPESEG *seg = receive(&ior, header + value);
+    unsigned refcnt = seg->refcnt;
+
+    // A value in the read buffer is not copied: the entry pins the segment
+    lcb_RESPGET get{};
+    get.cookie = &ior;
+    get.value = seg->root + seg->start + header.size();
+    get.nvalue = value.size();
+    get.bufh = seg;
+    get.itmflags = 0xcafe;
+    get.datatype = LCB_VALUE_F_JSON;
+    queued(instance, LCB_CALLBACK_GET, reinterpret_cast<const lcb_RESPBASE *>(&get));
+    ASSERT_EQ(refcnt + 1, seg->refcnt);
+
+    // A value outside of it (e.g. inflated) is copied
+    std::string inflated("inflated value");
+    lcb_RESPGET copied = get;
+    copied.value = inflated.c_str();
+    copied.nvalue = inflated.size();
+    queued(instance, LCB_CALLBACK_GET, reinterpret_cast<const lcb_RESPBASE *>(&copied));
+    ASSERT_EQ(refcnt + 1, seg->refcnt);
+
+    // The read buffer is done with once the response was handled
+    rdb_consumed(&ior, header.size() + value.size());
+    rdb_cleanup(&ior);
+    inflated.assign(inflated.size(), 'x');
+
+    lcb_COMPLETION entries[2];
+    ASSERT_EQ(2, lcb_completion_queue_poll(instance, entries, 2));
+    ASSERT_EQ(LCB_CALLBACK_GET, entries[0].type);
+    ASSERT_EQ(&ior, entries[0].cookie);
+    ASSERT_EQ(0xcafe, entries[0].flags);
+    ASSERT_EQ(LCB_VALUE_F_JSON, entries[0].datatype);
+    ASSERT_EQ(get.value, entries[0].value);
+    ASSERT_EQ(seg, entries[0].buffer);
+    ASSERT_EQ(0, entries[0].allocated);
+    ASSERT_EQ(value, std::string(static_cast<const char *>(entries[0].value), entries[0].nvalue));
+
+    ASSERT_NE(copied.value, entries[1].value);
+    ASSERT_EQ(1, entries[1].allocated);
+    ASSERT_EQ("inflated value", std::string(static_cast<const char *>(entries[1].value), entries[1].nvalue));
+
+    // Releasing the entry unpins (and here frees) the segment
+    lcb_completion_release(&entries[0]);
+    lcb_completion_release(&entries[1]);
+    lcb_destroy(instance);
+}
+
+struct StoreResult {
+    int invoked{0};
+    bool durability{false};
+};
+
+static void store_callback(lcb_INSTANCE *, int, const lcb_RESPBASE *rb)
+{
+    const auto *resp = reinterpret_cast<const lcb_RESPSTORE *>(rb);
+    auto *res = static_cast<StoreResult *>(resp->cookie);
+    res->invoked++;
+    res->durability = resp->dur_resp != nullptr;
+}
+
+TEST_F(CompletionQueueTest, testDurabilityStore)
+{
+    lcb_INSTANCE *instance;
+    ASSERT_EQ(LCB_SUCCESS, lcb_create(&instance, NULL));
+    lcb_install_callback(instance, LCB_CALLBACK_STORE, store_callback);
+    ASSERT_EQ(LCB_SUCCESS, lcb_completion_queue_enable(instance, 16));
+    lcb_RESPCALLBACK queued = lcb_get_callback(instance, LCB_CALLBACK_STORE);
+    ASSERT_TRUE(queued != store_callback);
+
+    StoreResult res;
+    lcb_RESPSTORE store{};
+    store.cookie = &res;
+    store.ctx.cas = 0xdeadbeef;
+    queued(instance, LCB_CALLBACK_STORE, reinterpret_cast<const lcb_RESPBASE *>(&store));
+    ASSERT_EQ(0, res.invoked);
+
+    // Stores which polled for durability keep going to the store callback
+    lcb_RESPENDURE endure{};
+    endure.npersisted = 1;
+    store.dur_resp = &endure;
+    store.store_ok = 1;
+    queued(instance, LCB_CALLBACK_STORE, reinterpret_cast<const lcb_RESPBASE *>(&store));
+    ASSERT_EQ(1, res.invoked);
+    ASSERT_TRUE(res.durability);
+
+    lcb_COMPLETION entries[2];
+    ASSERT_EQ(1, lcb_completion_queue_poll(instance, entries, 2));
+    ASSERT_EQ(LCB_CALLBACK_STORE, entries[0].type);
+    ASSERT_EQ(0xdeadbeef, entries[0].cas);
+    lcb_destroy(instance);
+}
@@ -18,6 +18,7 @@
 #include "config.h"
 #include <gtest/gtest.h>
 #include <libcouchbase/couchbase.h>
+#include <libcouchbase/utils.h>
 
 class CtlTest : public ::testing::Test
 {
@@ -74,6 +75,8 @@ TEST_F(CtlTest, testStringCtls)
                         {"error_thresh_delay", LCB_CNTL_CONFDELAY_THRESH},
                         {"config_total_timeout", LCB_CNTL_CONFIGURATION_TIMEOUT},
                         {"config_node_timeout", LCB_CNTL_CONFIG_NODE_TIMEOUT},
+                        {"bootstrap_race_delay", LCB_CNTL_BOOTSTRAP_RACE_DELAY},
+                        {"kv_hedge_delay", LCB_CNTL_KV_HEDGE_DELAY},
                         {NULL, 0}};
 
     for (PairMap *cur = ctlMap; cur->key; cur++) {
@@ -104,6 +107,93 @@ TEST_F(CtlTest, testStringCtls)
     ASSERT_EQ(LCB_SUCCESS, err);
     ASSERT_EQ(LCB_COMPRESS_IN, getSetting< lcb_COMPRESSOPTS >(instance, LCB_CNTL_COMPRESSION_OPTS));
 
+    err = lcb_cntl_string(instance, "bootstrap_race_width", "3");
+    ASSERT_EQ(LCB_SUCCESS, err);
+    ASSERT_EQ(3, lcb_cntl_getu32(instance, LCB_CNTL_BOOTSTRAP_RACE_WIDTH));
+    err = lcb_cntl_string(instance, "bootstrap_race_width", "0");
+    ASSERT_NE(LCB_SUCCESS, err);
+
+    err = lcb_cntl_string(instance, "http_compression", "true");
+#ifdef LCB_HAVE_ZLIB
+    ASSERT_EQ(LCB_SUCCESS, err);
+    ASSERT_NE(0, getSetting< int >(instance, LCB_CNTL_HTTP_COMPRESSION));
+#else
+    ASSERT_EQ(LCB_ERR_SDK_FEATURE_UNAVAILABLE, err);
+#endif
+
+    ASSERT_EQ(0, lcb_cntl_getu32(instance, LCB_CNTL_HTTP_STREAM_HWM));
+    err = lcb_cntl_string(instance, "http_stream_hwm", "1048576");
+    ASSERT_EQ(LCB_SUCCESS, err);
+    ASSERT_EQ(1048576, lcb_cntl_getu32(instance, LCB_CNTL_HTTP_STREAM_HWM));
+
+    ASSERT_EQ(5000, lcb_cntl_getu32(instance, LCB_CNTL_QUERY_CACHE_MAX_ENTRIES));
+    err = lcb_cntl_string(instance, "query_cache_max_entries", "100");
+    ASSERT_EQ(LCB_SUCCESS, err);
+    ASSERT_EQ(100, lcb_cntl_getu32(instance, LCB_CNTL_QUERY_CACHE_MAX_ENTRIES));
+    err = lcb_cntl_string(instance, "query_cache_max_entries", "0");
+    ASSERT_NE(LCB_SUCCESS, err);
+    err = lcb_cntl_string(instance, "query_cache_max_bytes", "65536");
+    ASSERT_EQ(LCB_SUCCESS, err);
+    ASSERT_EQ(65536, lcb_cntl_getu32(instance, LCB_CNTL_QUERY_CACHE_MAX_BYTES));
+    lcb_QUERY_CACHE_STATS cache_stats{};
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_QUERY_CACHE_STATS, &cache_stats));
+    ASSERT_EQ(0, cache_stats.entries);
+
+    lcb_HTTP_ENDPOINT_SELECTION selection = LCB_HTTP_ENDPOINT_RANDOM;
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_HTTP_ENDPOINT_SELECTION, &selection));
+    ASSERT_EQ(LCB_HTTP_ENDPOINT_LEAST_LOADED, selection);
+    err = lcb_cntl_string(instance, "http_endpoint_selection", "random");
+    ASSERT_EQ(LCB_SUCCESS, err);
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_HTTP_ENDPOINT_SELECTION, &selection));
+    ASSERT_EQ(LCB_HTTP_ENDPOINT_RANDOM, selection);
+    err = lcb_cntl_string(instance, "http_endpoint_selection", "fastest");
+    ASSERT_NE(LCB_SUCCESS, err);
+
+    err = lcb_cntl_string(instance, "http_pool_min_idle", "2");
+    ASSERT_EQ(LCB_SUCCESS, err);
+    err = lcb_cntl_string(instance, "http_pool_max_per_host", "8");
+    ASSERT_EQ(LCB_SUCCESS, err);
+    ASSERT_EQ(2, lcb_cntl_getu32(instance, LCB_CNTL_HTTP_POOL_MIN_IDLE));
+    lcb_HTTP_POOL_OPTIONS pool_opts{};
+    pool_opts.type = LCB_HTTP_TYPE_SEARCH;
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_HTTP_POOL_OPTIONS, &pool_opts));
+    ASSERT_EQ(2, pool_opts.min_idle);
+    ASSERT_EQ(8, pool_opts.max_per_host);
+    pool_opts.type = LCB_HTTP_TYPE_MANAGEMENT;
+    ASSERT_NE(LCB_SUCCESS, lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_HTTP_POOL_OPTIONS, &pool_opts));
+    lcb_HTTP_POOL_STATS pool_stats{};
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_HTTP_POOL_STATS, &pool_stats));
+    ASSERT_EQ(0, pool_stats.requests);
+    lcb_KV_HEDGE_STATS hedge_stats{};
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_KV_HEDGE_STATS, &hedge_stats));
+    ASSERT_EQ(0, hedge_stats.issued);
+    ASSERT_EQ(50000000, hedge_stats.delay_us);
+
+    ASSERT_EQ(0, getSetting< int >(instance, LCB_CNTL_KV_COALESCE_GETS));
+    err = lcb_cntl_string(instance, "kv_coalesce_gets", "true");
+    ASSERT_EQ(LCB_SUCCESS, err);
+    ASSERT_EQ(1, getSetting< int >(instance, LCB_CNTL_KV_COALESCE_GETS));
+    lcb_KV_COALESCE_STATS coalesce_stats{};
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_KV_COALESCE_STATS, &coalesce_stats));
+    ASSERT_EQ(0, coalesce_stats.issued);
+    ASSERT_EQ(0, coalesce_stats.coalesced);
+    lcb_KV_OPCODE_STATS opcode_stats{};
+    opcode_stats.opcode = 0x00; /* GET */
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_KV_OPCODE_STATS, &opcode_stats));
+    ASSERT_EQ(0, opcode_stats.responses);
+    ASSERT_EQ(nullptr, opcode_stats.timings);
+
+    ASSERT_EQ(4194304, getSetting< lcb_U32 >(instance, LCB_CNTL_READ_BUFFER_CACHE_SIZE));
+    err = lcb_cntl_string(instance, "read_buffer_cache_size", "65536");
+    ASSERT_EQ(LCB_SUCCESS, err);
+    ASSERT_EQ(65536, getSetting< lcb_U32 >(instance, LCB_CNTL_READ_BUFFER_CACHE_SIZE));
+
+    ASSERT_EQ(nullptr, getSetting< lcb_HISTOGRAM * >(instance, LCB_CNTL_SESSION_TIMINGS));
+    ASSERT_EQ(LCB_SUCCESS, lcb_enable_timings(instance));
+    ASSERT_NE(nullptr, getSetting< lcb_HISTOGRAM * >(instance, LCB_CNTL_SESSION_TIMINGS));
+    ASSERT_EQ(LCB_SUCCESS, lcb_disable_timings(instance));
+    ASSERT_EQ(nullptr, getSetting< lcb_HISTOGRAM * >(instance, LCB_CNTL_SESSION_TIMINGS));
+
     err = lcb_cntl_string(instance, "unsafe_optimize", "1");
     ASSERT_EQ(LCB_SUCCESS, err);
     err = lcb_cntl_string(instance, "unsafe_optimize", "0");
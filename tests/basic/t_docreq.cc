@@ -0,0 +1,244 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+
+#include "config.h"
+#include <gtest/gtest.h>
+#include "internal.h"
+#include "docreq/docreq.h"
+#include <string>
+#include <vector>
+
+using lcb::docreq::DocRequest;
+using lcb::docreq::Queue;
+
+namespace
+{
+struct TestRequest : DocRequest {
+    std::string id;
+    int index{};
+};
+
+struct TestState {
+    std::vector<TestRequest *> scheduled;
+    std::vector<int> delivered;
+    int throttled{-1};
+};
+
+TestState *state_of(Queue *q)
+{
+    return reinterpret_cast<TestState *>(q->parent);
+}
+
+lcb_STATUS cb_schedule(Queue *q, DocRequest *dreq)
+{
+    state_of(q)->scheduled.push_back(static_cast<TestRequest *>(dreq));
+    return LCB_SUCCESS;
+}
+
+void cb_ready(Queue *q, DocRequest *dreq)
+{
+    auto *req = static_cast<TestRequest *>(dreq);
+    state_of(q)->delivered.push_back(req->index);
+    delete req;
+}
+
+void cb_throttle(Queue *q, int enabled)
+{
+    state_of(q)->throttled = enabled;
+}
+} // namespace
+
+class DocreqTest : public ::testing::Test
+{
+  protected:
+    static const unsigned NSERVERS = 4;
+    lcb_INSTANCE *instance{};
+    lcbvb_CONFIG *vbc{};
+    Queue *q{};
+    TestState state;
+
+    void SetUp() override
+    {
+        ASSERT_EQ(LCB_SUCCESS, lcb_create(&instance, nullptr));
+        q = new Queue(instance);
+        q->parent = &state;
+        q->cb_schedule = cb_schedule;
+        q->cb_ready = cb_ready;
+        q->cb_throttle = cb_throttle;
+    }
+
+    void TearDown() override
+    {
+        q->unref();
+        LCBT_VBCONFIG(instance) = nullptr;
+        lcb_destroy(instance);
+        if (vbc) {
+            lcbvb_destroy(vbc);
+        }
+    }
+
+    /* Install a vBucket map (without connecting anywhere), so that the queue
+     * can tell which server each document is fetched from */
+    void set_config()
+    {
+        std::vector<lcbvb_SERVER> servers(NSERVERS);
+        for (unsigned ii = 0; ii < NSERVERS; ii++) {
+            memset(&servers[ii], 0, sizeof servers[ii]);
+            servers[ii].hostname = const_cast<char *>("kv.example.com");
+            servers[ii].svc.data = 11210 + ii;
+        }
+        vbc = lcbvb_create();
+        ASSERT_EQ(0, lcbvb_genconfig_ex(vbc, "default", nullptr, &servers[0], NSERVERS, 0, 64));
+        LCBT_VBCONFIG(instance) = vbc;
+    }
+
+    void add(int index)
+    {
+        auto *req = new TestRequest();
+        req->index = index;
+        req->id = "doc_" + std::to_string(index);
+        req->docid.iov_base = const_cast<char *>(req->id.c_str());
+        req->docid.iov_len = req->id.size();
+        q->add(req);
+    }
+
+    void respond(TestRequest *req)
+    {
+        req->docresp.ctx.rc = LCB_SUCCESS;
+        req->ready = 1;
+        q->complete(req);
+        q->check();
+    }
+
+    int server_of(const TestRequest *req)
+    {
+        int vbid, srvix;
+        lcbvb_map_key(vbc, req->id.c_str(), req->id.size(), &vbid, &srvix);
+        return srvix;
+    }
+};
+
+TEST_F(DocreqTest, testInOrderDelivery)
+{
+    for (int ii = 0; ii < 20; ii++) {
+        add(ii);
+    }
+    q->schedule();
+    ASSERT_EQ(20, state.scheduled.size());
+    ASSERT_EQ(0, state.throttled);
+    ASSERT_EQ(20, q->n_awaiting_response);
+
+    // Responses arrive in reverse order, but rows are delivered in the order
+    // they were added
+    std::vector<TestRequest *> scheduled;
+    scheduled.swap(state.scheduled);
+    for (auto it = scheduled.rbegin(); it != scheduled.rend(); ++it) {
+        respond(*it);
+        if (it + 1 != scheduled.rend()) {
+            ASSERT_TRUE(state.delivered.empty());
+        }
+    }
+    ASSERT_EQ(20, state.delivered.size());
+    for (int ii = 0; ii < 20; ii++) {
+        ASSERT_EQ(ii, state.delivered[ii]);
+    }
+    ASSERT_FALSE(q->has_pending());
+}
+
+TEST_F(DocreqTest, testPerServerWindow)
+{
+    set_config();
+    q->window = 2;
+    for (int ii = 0; ii < 100; ii++) {
+        add(ii);
+    }
+    q->schedule();
+    // Each server receives at most a window's worth of requests
+    std::vector<unsigned> counts(NSERVERS);
+    for (auto *req : state.scheduled) {
+        counts[server_of(req)]++;
+    }
+    for (unsigned ii = 0; ii < NSERVERS; ii++) {
+        ASSERT_EQ(2, counts[ii]);
+        ASSERT_EQ(2, q->server_pending[ii]);
+    }
+    ASSERT_EQ(1, state.throttled);
+
+    // A response frees a slot on that server only
+    TestRequest *first = state.scheduled.back();
+    int server = server_of(first);
+    state.scheduled.pop_back();
+    respond(first);
+    q->schedule();
+    ASSERT_EQ(2 * NSERVERS, state.scheduled.size());
+    ASSERT_EQ(server, server_of(state.scheduled.back()));
+
+    // Drain everything
+    while (!state.scheduled.empty()) {
+        std::vector<TestRequest *> scheduled;
+        scheduled.swap(state.scheduled);
+        for (auto *req : scheduled) {
+            respond(req);
+        }
+        q->schedule();
+    }
+    ASSERT_EQ(100, state.delivered.size());
+    ASSERT_FALSE(q->has_pending());
+}
+
+TEST_F(DocreqTest, testAdaptiveWindow)
+{
+    set_config();
+    unsigned initial = q->window;
+    q->max_pending_response = 1000;
+
+    // Fast and steady responses open the window
+    for (int ii = 0; ii < 200; ii++) {
+        add(ii);
+        q->schedule();
+        TestRequest *req = state.scheduled.back();
+        state.scheduled.clear();
+        respond(req);
+    }
+    ASSERT_GT(q->window, initial);
+
+    // Response times well above the lowest observed close it again
+    unsigned opened = q->window;
+    q->min_latency_us = 1;
+    q->latency_us = 1000000;
+    q->n_window_responses = q->window - 1;
+    add(1000);
+    q->schedule();
+    TestRequest *req = state.scheduled.back();
+    state.scheduled.clear();
+    req->start -= LCB_S2NS(1);
+    respond(req);
+    ASSERT_LT(q->window, opened);
+}
+
+TEST_F(DocreqTest, testCancel)
+{
+    for (int ii = 0; ii < 5; ii++) {
+        add(ii);
+    }
+    q->cancel();
+    q->schedule();
+    ASSERT_TRUE(state.scheduled.empty());
+    ASSERT_EQ(5, state.delivered.size());
+    ASSERT_FALSE(q->has_pending());
+}
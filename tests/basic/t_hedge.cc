@@ -0,0 +1,70 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+
+#include "config.h"
+#include <gtest/gtest.h>
+#include "settings.h"
+#include "hedge.h"
+
+using lcb::HedgeTracker;
+
+class HedgeTrackerTest : public ::testing::Test
+{
+};
+
+TEST_F(HedgeTrackerTest, testConfiguredDelay)
+{
+    HedgeTracker tracker;
+    ASSERT_EQ(2500U, tracker.delay(2500));
+    for (int ii = 0; ii < 100; ii++) {
+        tracker.sample(LCB_US2NS(50));
+    }
+    ASSERT_EQ(2500U, tracker.delay(2500));
+}
+
+TEST_F(HedgeTrackerTest, testPercentile)
+{
+    HedgeTracker tracker;
+    // Until enough samples are known, a fixed delay is used
+    uint32_t initial = tracker.delay(0);
+    ASSERT_GT(initial, 0U);
+    tracker.sample(LCB_US2NS(100));
+    ASSERT_EQ(initial, tracker.delay(0));
+
+    // 1..100ms, so that the 95th percentile is about 95ms (it is recomputed
+    // periodically, so may lag behind a little)
+    for (unsigned ii = 0; ii < 320; ii++) {
+        tracker.sample(LCB_US2NS(LCB_MS2US(ii % 100 + 1)));
+    }
+    ASSERT_GE(tracker.percentile(), LCB_MS2US(90));
+    ASSERT_LE(tracker.percentile(), LCB_MS2US(100));
+    ASSERT_EQ(tracker.percentile(), tracker.delay(0));
+
+    // Older samples are replaced, so the delay follows the response times
+    for (size_t ii = 0; ii < 2 * HedgeTracker::NSAMPLES; ii++) {
+        tracker.sample(LCB_US2NS(LCB_MS2US(2)));
+    }
+    ASSERT_EQ(LCB_MS2US(2), tracker.delay(0));
+
+    // ...but never gets very small
+    for (size_t ii = 0; ii < 2 * HedgeTracker::NSAMPLES; ii++) {
+        tracker.sample(LCB_US2NS(10));
+    }
+    ASSERT_EQ(10U, tracker.percentile());
+    ASSERT_GT(tracker.delay(0), 10U);
+}
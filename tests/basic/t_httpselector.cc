@@ -0,0 +1,236 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+#include <gtest/gtest.h>
+#include <libcouchbase/couchbase.h>
+#include "settings.h"
+#include "http/selector.h"
+#include <cstring>
+#include <vector>
+
+using lcb::http::EndpointSelector;
+
+class EndpointSelectorTest : public ::testing::Test
+{
+  protected:
+    static const unsigned NSERVERS = 4;
+    lcb_settings *settings{};
+    lcbvb_CONFIG *vbc{};
+
+    void SetUp() override
+    {
+        settings = lcb_settings_new();
+        std::vector<lcbvb_SERVER> servers(NSERVERS);
+        for (unsigned ii = 0; ii < NSERVERS; ii++) {
+            lcbvb_SERVER &server = servers[ii];
+            memset(&server, 0, sizeof server);
+            server.hostname = const_cast<char *>("query.example.com");
+            server.svc.data = 11210 + ii;
+            // the last node does not run the query service
+            if (ii != NSERVERS - 1) {
+                server.svc.n1ql = 8093 + ii;
+            }
+        }
+        vbc = lcbvb_create();
+        ASSERT_EQ(0, lcbvb_genconfig_ex(vbc, "default", nullptr, &servers[0], NSERVERS, 1, 64));
+    }
+
+    void TearDown() override
+    {
+        lcbvb_destroy(vbc);
+        lcb_settings_unref(settings);
+    }
+
+    std::string endpoint(unsigned ix)
+    {
+        return lcbvb_get_hostport(vbc, ix, LCBVB_SVCTYPE_QUERY, LCBVB_SVCMODE_PLAIN);
+    }
+
+    std::vector<int> distribution(EndpointSelector &selector, const int *used = nullptr)
+    {
+        std::vector<int> counts(NSERVERS);
+        for (int ii = 0; ii < 1000; ii++) {
+            int ix = selector.select(vbc, LCBVB_SVCTYPE_QUERY, LCBVB_SVCMODE_PLAIN, used);
+            EXPECT_GE(ix, 0);
+            EXPECT_LT(ix, static_cast<int>(NSERVERS - 1));
+            counts[ix]++;
+        }
+        return counts;
+    }
+};
+
+TEST_F(EndpointSelectorTest, testRandom)
+{
+    settings->http_endpoint_selection = LCB_HTTP_ENDPOINT_RANDOM;
+    EndpointSelector selector(settings);
+    for (int ii = 0; ii < 100; ii++) {
+        selector.start(LCBVB_SVCTYPE_QUERY, endpoint(0));
+    }
+    std::vector<int> counts = distribution(selector);
+    ASSERT_LT(0, counts[0]);
+    ASSERT_LT(0, counts[1]);
+    ASSERT_LT(0, counts[2]);
+}
+
+TEST_F(EndpointSelectorTest, testInflight)
+{
+    EndpointSelector selector(settings);
+    // Without any statistics, all nodes are used
+    std::vector<int> counts = distribution(selector);
+    ASSERT_LT(0, counts[0]);
+    ASSERT_LT(0, counts[1]);
+    ASSERT_LT(0, counts[2]);
+    ASSERT_EQ(0, counts[3]);
+
+    for (int ii = 0; ii < 10; ii++) {
+        selector.start(LCBVB_SVCTYPE_QUERY, endpoint(0));
+    }
+    // The busy node always loses against any other node
+    counts = distribution(selector);
+    ASSERT_EQ(0, counts[0]);
+    ASSERT_LT(0, counts[1]);
+    ASSERT_LT(0, counts[2]);
+
+    // ... unless it is the only one left
+    int used[NSERVERS] = {0, 1, 1, 0};
+    counts = distribution(selector, used);
+    ASSERT_EQ(1000, counts[0]);
+
+    for (int ii = 0; ii < 10; ii++) {
+        selector.finish(LCBVB_SVCTYPE_QUERY, endpoint(0), ii == 0);
+    }
+    const EndpointSelector::Endpoint *ep = selector.get(LCBVB_SVCTYPE_QUERY, endpoint(0));
+    ASSERT_NE(nullptr, ep);
+    ASSERT_EQ(0, ep->inflight);
+    ASSERT_EQ(10, ep->requests);
+    ASSERT_EQ(1, ep->errors);
+}
+
+TEST_F(EndpointSelectorTest, testLatency)
+{
+    EndpointSelector selector(settings);
+    selector.sample(LCBVB_SVCTYPE_QUERY, endpoint(0), LCB_MS2US(1) * 1000);
+    selector.sample(LCBVB_SVCTYPE_QUERY, endpoint(1), LCB_MS2US(50) * 1000);
+    selector.sample(LCBVB_SVCTYPE_QUERY, endpoint(2), LCB_MS2US(2) * 1000);
+
+    std::vector<int> counts = distribution(selector);
+    ASSERT_EQ(0, counts[1]);
+    ASSERT_LT(0, counts[0]);
+    ASSERT_LT(0, counts[2]);
+
+    // The slow node is preferred over a node with many requests waiting
+    for (int ii = 0; ii < 100; ii++) {
+        selector.start(LCBVB_SVCTYPE_QUERY, endpoint(0));
+        selector.start(LCBVB_SVCTYPE_QUERY, endpoint(2));
+    }
+    counts = distribution(selector);
+    ASSERT_LT(0, counts[1]);
+
+    // Moving average
+    for (int ii = 0; ii < 50; ii++) {
+        selector.sample(LCBVB_SVCTYPE_QUERY, endpoint(1), LCB_MS2US(1) * 1000);
+    }
+    const EndpointSelector::Endpoint *ep = selector.get(LCBVB_SVCTYPE_QUERY, endpoint(1));
+    ASSERT_NE(nullptr, ep);
+    ASSERT_LT(ep->latency_us, 1100);
+    ASSERT_GE(ep->latency_us, 1000);
+}
+
+TEST_F(EndpointSelectorTest, testDiagnostics)
+{
+    EndpointSelector selector(settings);
+    Json::Value root;
+    selector.to_json(root);
+    ASSERT_TRUE(root.isNull());
+
+    selector.start(LCBVB_SVCTYPE_QUERY, endpoint(1));
+    selector.sample(LCBVB_SVCTYPE_QUERY, endpoint(1), LCB_MS2US(3) * 1000);
+    selector.start(LCBVB_SVCTYPE_SEARCH, "search.example.com:8094");
+    selector.finish(LCBVB_SVCTYPE_SEARCH, "search.example.com:8094", true);
+    selector.to_json(root);
+
+    ASSERT_EQ(1, root["n1ql"].size());
+    const Json::Value &node = root["n1ql"][0];
+    ASSERT_EQ(endpoint(1), node["remote"].asString());
+    ASSERT_EQ(1, node["in_flight"].asInt());
+    ASSERT_EQ(3000, node["latency_us"].asInt());
+    ASSERT_EQ(1, node["requests"].asInt());
+    ASSERT_EQ(0, node["errors"].asInt());
+    ASSERT_EQ(1, root["fts"].size());
+    ASSERT_EQ(0, root["fts"][0]["in_flight"].asInt());
+    ASSERT_EQ(1, root["fts"][0]["errors"].asInt());
+}
+
+TEST_F(EndpointSelectorTest, testUnresponsive)
+{
+    EndpointSelector selector(settings);
+    uint64_t now = gethrtime();
+    uint64_t then = now - LCB_S2NS(20);
+    selector.sample(LCBVB_SVCTYPE_QUERY, endpoint(0), LCB_MS2US(1) * 1000, then);
+    selector.sample(LCBVB_SVCTYPE_QUERY, endpoint(1), LCB_MS2US(2) * 1000);
+    selector.sample(LCBVB_SVCTYPE_QUERY, endpoint(2), LCB_MS2US(2) * 1000);
+
+    // The node was the fastest until it stopped answering, and has not been
+    // sampled since. The request which is stuck makes it the slowest.
+    uint64_t started = selector.start(LCBVB_SVCTYPE_QUERY, endpoint(0), then);
+    std::vector<int> counts = distribution(selector);
+    ASSERT_EQ(0, counts[0]);
+    ASSERT_LT(0, counts[1]);
+    ASSERT_LT(0, counts[2]);
+
+    // Once the request is gone, the old sample is trusted again
+    selector.finish(LCBVB_SVCTYPE_QUERY, endpoint(0), false, started);
+    counts = distribution(selector);
+    ASSERT_LT(0, counts[0]);
+}
+
+TEST_F(EndpointSelectorTest, testFailing)
+{
+    EndpointSelector selector(settings);
+    // The node fails quickly, which must not make it look fast
+    for (int ii = 0; ii < 20; ii++) {
+        uint64_t started = selector.start(LCBVB_SVCTYPE_QUERY, endpoint(0));
+        selector.sample(LCBVB_SVCTYPE_QUERY, endpoint(0), LCB_MS2US(1) * 100);
+        selector.finish(LCBVB_SVCTYPE_QUERY, endpoint(0), true, started);
+    }
+    selector.sample(LCBVB_SVCTYPE_QUERY, endpoint(1), LCB_MS2US(2) * 1000);
+    selector.sample(LCBVB_SVCTYPE_QUERY, endpoint(2), LCB_MS2US(2) * 1000);
+
+    std::vector<int> counts = distribution(selector);
+    ASSERT_EQ(0, counts[0]);
+    ASSERT_LT(0, counts[1]);
+    ASSERT_LT(0, counts[2]);
+}
+
+TEST_F(EndpointSelectorTest, testPrune)
+{
+    EndpointSelector selector(settings);
+    selector.sample(LCBVB_SVCTYPE_QUERY, endpoint(0), LCB_MS2US(1) * 1000);
+    selector.sample(LCBVB_SVCTYPE_QUERY, "removed.example.com:8093", LCB_MS2US(1) * 1000);
+    selector.start(LCBVB_SVCTYPE_QUERY, "draining.example.com:8093");
+
+    selector.prune(vbc);
+    ASSERT_NE(nullptr, selector.get(LCBVB_SVCTYPE_QUERY, endpoint(0)));
+    ASSERT_EQ(nullptr, selector.get(LCBVB_SVCTYPE_QUERY, "removed.example.com:8093"));
+    // Kept until its request completes
+    ASSERT_NE(nullptr, selector.get(LCBVB_SVCTYPE_QUERY, "draining.example.com:8093"));
+
+    selector.finish(LCBVB_SVCTYPE_QUERY, "draining.example.com:8093", false);
+    selector.prune(vbc);
+    ASSERT_EQ(nullptr, selector.get(LCBVB_SVCTYPE_QUERY, "draining.example.com:8093"));
+}
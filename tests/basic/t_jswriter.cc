@@ -0,0 +1,231 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+#include <gtest/gtest.h>
+#include <libcouchbase/couchbase.h>
+#include "jsparse/writer.h"
+#include "contrib/lcb-jsoncpp/lcb-jsoncpp.h"
+
+using std::string;
+using lcb::jsparse::EncodedParams;
+using lcb::jsparse::Writer;
+
+class JsonWriterTest : public ::testing::Test
+{
+};
+
+static Json::Value parse(const string &s)
+{
+    Json::Value value;
+    EXPECT_TRUE(Json::Reader().parse(s, value)) << s;
+    return value;
+}
+
+TEST_F(JsonWriterTest, testValidate)
+{
+    const char *valid[] = {"1",          "-0.5e+10",   "0",         "\"\"",      "\"a\\u00e9\\n\"", "true",
+                           "false",      "null",       "[]",        "{}",        " [1, 2 ,3] ",     "{\"a\":{\"b\":[null]}}",
+                           "\"\xc3\xa9\"", "[[[[]]]]",   "-12E3"};
+    for (const char *s : valid) {
+        ASSERT_TRUE(lcb::jsparse::validate(s, strlen(s))) << s;
+    }
+    const char *invalid[] = {"",         "01",      "1.",     "-",         "\"abc",   "\"\\x\"", "tru",
+                             "[1,]",     "{\"a\"}", "{a:1}",  "[1] [2]",   "nul",     "{\"a\":1,}", "\"\t\"",
+                             "\"\\u12\"", "+1",      "[",      "{\"a\":1"};
+    for (const char *s : invalid) {
+        ASSERT_FALSE(lcb::jsparse::validate(s, strlen(s))) << s;
+    }
+    string deep(1000, '[');
+    deep += string(1000, ']');
+    ASSERT_FALSE(lcb::jsparse::validate(deep.c_str(), deep.size()));
+}
+
+TEST_F(JsonWriterTest, testQuote)
+{
+    string input("plain \"quoted\" back\\slash\n\r\t\b\f \x01\x1f caf\xc3\xa9 /");
+    string out;
+    Writer::quote(out, input.c_str(), input.size());
+    ASSERT_EQ("\"plain \\\"quoted\\\" back\\\\slash\\n\\r\\t\\b\\f \\u0001\\u001f caf\xc3\xa9 /\"", out);
+    ASSERT_EQ(input, parse("[" + out + "]")[0].asString());
+}
+
+TEST_F(JsonWriterTest, testWriteValue)
+{
+    Json::Value root(Json::objectValue);
+    root["statement"] = "SELECT * FROM `travel-sample` WHERE type = \"airline\"";
+    root["readonly"] = true;
+    root["scan_cap"] = 42;
+    root["negative"] = -7;
+    root["ratio"] = 0.25;
+    root["nothing"] = Json::Value();
+    root["scan_vectors"]["travel-sample"]["12"].append(42);
+    root["scan_vectors"]["travel-sample"]["12"].append("3457");
+    root["empty"] = Json::Value(Json::objectValue);
+
+    string out;
+    Writer writer(out);
+    writer.begin_object();
+    writer.members(root);
+    writer.end_object();
+    ASSERT_EQ(root, parse(out));
+
+    out.clear();
+    writer.begin_object();
+    writer.members(root, "statement");
+    writer.end_object();
+    Json::Value expected = root;
+    expected.removeMember("statement");
+    ASSERT_EQ(expected, parse(out));
+}
+
+TEST_F(JsonWriterTest, testParams)
+{
+    EncodedParams params;
+    ASSERT_TRUE(params.empty());
+    ASSERT_TRUE(params.set_named("$name", "\"airline\"", 9));
+    ASSERT_TRUE(params.set_named("$limit", "10", 2));
+    ASSERT_TRUE(params.set_named("$name", "\"hotel\"", 7));
+    ASSERT_FALSE(params.set_named("$bad", "{\"a\"", 4));
+    ASSERT_EQ(2, params.named.size());
+    ASSERT_TRUE(params.add_positional("[1,2]", 5));
+    ASSERT_TRUE(params.add_positional("\"x\"", 3));
+    ASSERT_FALSE(params.add_positional("nope", 4));
+    // accepted by Json::Reader, and re-encoded
+    ASSERT_TRUE(params.add_positional("/* c */ 3", 9));
+
+    string out;
+    Writer writer(out);
+    writer.begin_object();
+    writer.key("statement").string("SELECT $1");
+    writer.params(params);
+    writer.end_object();
+
+    Json::Value body = parse(out);
+    ASSERT_EQ("hotel", body["$name"].asString());
+    ASSERT_EQ(10, body["$limit"].asInt());
+    ASSERT_EQ(3, body["args"].size());
+    ASSERT_EQ(2, body["args"][0].size());
+    ASSERT_EQ("x", body["args"][1].asString());
+    ASSERT_EQ(3, body["args"][2].asInt());
+
+    params.remove_named("$name");
+    ASSERT_EQ(1, params.named.size());
+    params.clear();
+    ASSERT_TRUE(params.empty());
+}
+
+TEST_F(JsonWriterTest, testQueryPayload)
+{
+    lcb_CMDQUERY *cmd;
+    lcb_cmdquery_create(&cmd);
+    ASSERT_EQ(LCB_SUCCESS, lcb_cmdquery_statement(cmd, "SELECT $1, $v", -1));
+    ASSERT_EQ(LCB_SUCCESS, lcb_cmdquery_positional_param(cmd, "1", -1));
+    ASSERT_EQ(LCB_SUCCESS, lcb_cmdquery_positional_param(cmd, "{\"k\":[true]}", -1));
+    ASSERT_EQ(LCB_SUCCESS, lcb_cmdquery_named_param(cmd, "v", 1, "\"val\"", 5));
+    ASSERT_EQ(LCB_ERR_INVALID_ARGUMENT, lcb_cmdquery_named_param(cmd, "w", 1, "{", 1));
+    ASSERT_EQ(LCB_SUCCESS, lcb_cmdquery_readonly(cmd, 1));
+
+    const char *payload;
+    size_t npayload;
+    ASSERT_EQ(LCB_SUCCESS, lcb_cmdquery_encoded_payload(cmd, &payload, &npayload));
+    Json::Value body = parse(string(payload, npayload));
+    ASSERT_EQ("SELECT $1, $v", body["statement"].asString());
+    ASSERT_TRUE(body["readonly"].asBool());
+    ASSERT_EQ("val", body["$v"].asString());
+    ASSERT_FALSE(body.isMember("$w"));
+    ASSERT_EQ(2, body["args"].size());
+    ASSERT_TRUE(body["args"][1]["k"][0].asBool());
+
+    // an option with the same name replaces the parameter
+    ASSERT_EQ(LCB_SUCCESS, lcb_cmdquery_option(cmd, "$v", 2, "2", 1));
+    ASSERT_EQ(LCB_SUCCESS, lcb_cmdquery_encoded_payload(cmd, &payload, &npayload));
+    body = parse(string(payload, npayload));
+    ASSERT_EQ(2, body["$v"].asInt());
+
+    // explicit "args" option is extended by positional parameters
+    ASSERT_EQ(LCB_SUCCESS, lcb_cmdquery_option(cmd, "args", 4, "[\"a\"]", 5));
+    ASSERT_EQ(LCB_SUCCESS, lcb_cmdquery_positional_param(cmd, "\"b\"", 3));
+    ASSERT_EQ(LCB_SUCCESS, lcb_cmdquery_encoded_payload(cmd, &payload, &npayload));
+    body = parse(string(payload, npayload));
+    ASSERT_EQ(2, body["args"].size());
+    ASSERT_EQ("b", body["args"][1].asString());
+    lcb_cmdquery_destroy(cmd);
+}
+
+/**
+ * Compares building and encoding a typical request body (a point lookup with a
+ * couple of parameters) through Json::Value, as was done previously, with the
+ * writer.
+ */
+TEST_F(JsonWriterTest, testEncodeCost)
+{
+    const int iterations = 20000;
+    const char *statement = "SELECT * FROM `travel-sample` WHERE type = $type AND id = $1 LIMIT 1";
+    size_t total_jsoncpp = 0, total_writer = 0;
+
+    hrtime_t begin = gethrtime();
+    for (int ii = 0; ii < iterations; ii++) {
+        Json::Value root;
+        root["statement"] = statement;
+        Json::Value jval;
+        Json::Reader().parse("\"airline\"", jval);
+        root["$type"] = jval;
+        Json::Reader().parse("10123", jval);
+        root["args"].append(jval);
+        root["timeout"] = "75000000us";
+        root["client_context_id"] = "0123456789abcdef";
+
+        // the command was encoded and re-parsed when the request was created
+        Json::Value copy;
+        Json::Reader().parse(Json::FastWriter().write(root), copy);
+        total_jsoncpp += Json::FastWriter().write(copy).size();
+    }
+    hrtime_t jsoncpp_ns = gethrtime() - begin;
+
+    string body;
+    begin = gethrtime();
+    for (int ii = 0; ii < iterations; ii++) {
+        Json::Value root;
+        root["statement"] = statement;
+        EncodedParams params;
+        params.set_named("$type", "\"airline\"", 9);
+        params.add_positional("10123", 5);
+        root["timeout"] = "75000000us";
+        root["client_context_id"] = "0123456789abcdef";
+
+        Json::Value copy = root;
+        body.clear();
+        Writer writer(body);
+        writer.begin_object();
+        writer.members(copy);
+        writer.params(params);
+        writer.end_object();
+        total_writer += body.size();
+    }
+    hrtime_t writer_ns = gethrtime() - begin;
+
+    Json::Value parsed = parse(body);
+    ASSERT_EQ(statement, parsed["statement"].asString());
+    ASSERT_EQ("airline", parsed["$type"].asString());
+    ASSERT_EQ(10123, parsed["args"][0].asInt());
+    // no newline or other whitespace added by FastWriter
+    ASSERT_EQ(total_jsoncpp - iterations, total_writer);
+
+    RecordProperty("jsoncpp_ns_per_query", static_cast<int>(jsoncpp_ns / iterations));
+    RecordProperty("writer_ns_per_query", static_cast<int>(writer_ns / iterations));
+}
@@ -81,3 +81,155 @@ TEST_F(Logger, testLogger)
 
     lcb_logger_destroy(procs.base);
 }
+
+struct CountingLogprocs {
+    lcb_LOGGER *base{nullptr};
+    int messages{0};
+};
+
+extern "C" {
+static void counting_logger(const lcb_LOGGER *logger, uint64_t, const char *, lcb_LOG_SEVERITY, const char *, int,
+                            const char *, va_list)
+{
+    CountingLogprocs *procs;
+    lcb_logger_cookie(logger, reinterpret_cast< void ** >(&procs));
+    procs->messages++;
+}
+}
+
+static int count_evaluation(int *counter)
+{
+    return ++*counter;
+}
+
+TEST_F(Logger, testMinLevel)
+{
+    lcb_INSTANCE *instance;
+    CountingLogprocs procs;
+    lcb_logger_create(&procs.base, &procs);
+    lcb_logger_callback(procs.base, counting_logger);
+    lcb_create(&instance, NULL);
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl(instance, LCB_CNTL_SET, LCB_CNTL_LOGGER, procs.base));
+    const lcb_settings *settings = instance->getSettings();
+
+    // All messages are passed by default
+    int evaluated = 0;
+    lcb_log(settings, "test", LCB_LOG_TRACE, __FILE__, __LINE__, "%d", count_evaluation(&evaluated));
+    ASSERT_EQ(1, procs.messages);
+    ASSERT_EQ(1, evaluated);
+
+    // Arguments of messages below the level are not evaluated
+    lcb_logger_minlevel(procs.base, LCB_LOG_WARN);
+    lcb_log(settings, "test", LCB_LOG_DEBUG, __FILE__, __LINE__, "%d", count_evaluation(&evaluated));
+    ASSERT_EQ(1, procs.messages);
+    ASSERT_EQ(1, evaluated);
+    lcb_log(settings, "test", LCB_LOG_ERROR, __FILE__, __LINE__, "%d", count_evaluation(&evaluated));
+    ASSERT_EQ(2, procs.messages);
+    ASSERT_EQ(2, evaluated);
+
+    lcb_destroy(instance);
+    lcb_logger_destroy(procs.base);
+}
+
+static std::string read_all(FILE *fp)
+{
+    std::string out;
+    char buf[4096];
+    size_t nr;
+    fflush(fp);
+    rewind(fp);
+    while ((nr = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        out.append(buf, nr);
+    }
+    return out;
+}
+
+/**
+ * Restores the level and output of the console logger, which is shared by
+ * the whole process, when the test ends
+ */
+struct ConsoleLoggerState {
+    ConsoleLoggerState() : minlevel(lcb_console_logger->minlevel), fp(NULL)
+    {
+        lcb_cntl(NULL, LCB_CNTL_GET, LCB_CNTL_CONLOGGER_FP, &fp);
+    }
+
+    ~ConsoleLoggerState()
+    {
+        int async = 0;
+        lcb_cntl(NULL, LCB_CNTL_SET, LCB_CNTL_CONLOGGER_ASYNC, &async);
+        lcb_cntl(NULL, LCB_CNTL_SET, LCB_CNTL_CONLOGGER_FP, &fp);
+        lcb_logger_minlevel(lcb_console_logger, static_cast< lcb_LOG_SEVERITY >(minlevel));
+    }
+
+    int minlevel;
+    FILE *fp;
+};
+
+/**
+ * Compares the cost of DEBUG messages when they are discarded, written by the
+ * console logger directly, and queued for the console logger thread
+ */
+TEST_F(Logger, testAsyncConsole)
+{
+    if (lcb_getenv_boolean("LCB_LOGLEVEL")) {
+        // the console logger is shared, and already configured
+        return;
+    }
+    ConsoleLoggerState saved;
+    lcb_INSTANCE *instance;
+    lcb_create(&instance, NULL);
+    FILE *fp = tmpfile();
+    ASSERT_FALSE(fp == NULL);
+    // unbuffered, like stderr (the default output of the console logger)
+    setvbuf(fp, NULL, _IONBF, 0);
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl(NULL, LCB_CNTL_SET, LCB_CNTL_CONLOGGER_FP, &fp));
+    lcb_U32 level = 5; // TRACE
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl(instance, LCB_CNTL_SET, LCB_CNTL_CONLOGGER_LEVEL, &level));
+    const lcb_settings *settings = instance->getSettings();
+    const int iterations = 2000;
+
+    hrtime_t begin = gethrtime();
+    for (int ii = 0; ii < iterations; ii++) {
+        lcb_log(settings, "test", LCB_LOG_DEBUG, __FILE__, __LINE__, "sync message %d of %s", ii, "test");
+    }
+    hrtime_t sync_ns = gethrtime() - begin;
+    ASSERT_NE(std::string::npos, read_all(fp).find("sync message 1999 of test\n"));
+
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl_string(instance, "console_log_async", "true"));
+    int async = 0;
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_CONLOGGER_ASYNC, &async));
+    ASSERT_EQ(1, async);
+    begin = gethrtime();
+    for (int ii = 0; ii < iterations; ii++) {
+        lcb_log(settings, "test", LCB_LOG_DEBUG, __FILE__, __LINE__, "async message %d of %s", ii, "test");
+    }
+    hrtime_t async_ns = gethrtime() - begin;
+    // too long to be queued, written after the queued messages
+    std::string big(LCB_ASYNCLOG_LINE_MAX, 'x');
+    lcb_log(settings, "test", LCB_LOG_DEBUG, __FILE__, __LINE__, "%s", big.c_str());
+    lcb_asynclog_flush();
+    std::string output = read_all(fp);
+    size_t last = output.find("async message 1999 of test\n");
+    ASSERT_NE(std::string::npos, last);
+    ASSERT_LT(last, output.find(big));
+
+    lcb_logger_minlevel(const_cast< lcb_LOGGER * >(settings->logger), LCB_LOG_INFO);
+    begin = gethrtime();
+    for (int ii = 0; ii < iterations; ii++) {
+        lcb_log(settings, "test", LCB_LOG_DEBUG, __FILE__, __LINE__, "discarded message %d of %s", ii, "test");
+    }
+    hrtime_t discarded_ns = gethrtime() - begin;
+    lcb_asynclog_flush();
+    ASSERT_EQ(std::string::npos, read_all(fp).find("discarded message"));
+
+    async = 0;
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl(instance, LCB_CNTL_SET, LCB_CNTL_CONLOGGER_ASYNC, &async));
+    lcb_destroy(instance);
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl(NULL, LCB_CNTL_SET, LCB_CNTL_CONLOGGER_FP, &saved.fp));
+    fclose(fp);
+
+    RecordProperty("discarded_ns_per_message", static_cast< int >(discarded_ns / iterations));
+    RecordProperty("sync_ns_per_message", static_cast< int >(sync_ns / iterations));
+    RecordProperty("async_ns_per_message", static_cast< int >(async_ns / iterations));
+}
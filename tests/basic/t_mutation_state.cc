@@ -0,0 +1,198 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+#include <gtest/gtest.h>
+#include <libcouchbase/couchbase.h>
+#include "mutation_state.h"
+#include "contrib/lcb-jsoncpp/lcb-jsoncpp.h"
+#include <cstdio>
+
+using std::string;
+
+class MutationStateTest : public ::testing::Test
+{
+};
+
+static lcb_MUTATION_TOKEN token(uint16_t vbid, uint64_t uuid, uint64_t seqno)
+{
+    lcb_MUTATION_TOKEN out;
+    out.vbid_ = vbid;
+    out.uuid_ = uuid;
+    out.seqno_ = seqno;
+    return out;
+}
+
+static Json::Value encode(const lcb::MutationState &state)
+{
+    string out;
+    state.encode(out);
+    Json::Value value;
+    EXPECT_TRUE(Json::Reader().parse(out, value)) << out;
+    return value;
+}
+
+TEST_F(MutationStateTest, testAdd)
+{
+    lcb::MutationState state;
+    ASSERT_TRUE(state.empty());
+    string empty;
+    state.encode(empty);
+    ASSERT_EQ("{}", empty);
+
+    state.add("default", 7, token(12, 3457, 42));
+    state.add("default", 7, token(12, 3457, 40));
+    state.add("default", 7, token(3, 99, 1));
+    // unknown sequence numbers are ignored
+    state.add("travel-sample", 13, token(5, 1, 0));
+    ASSERT_FALSE(state.empty());
+    ASSERT_EQ(2, state.buckets().size());
+    ASSERT_EQ(2, state.buckets()[0].nvbuckets);
+    ASSERT_EQ(0, state.buckets()[1].nvbuckets);
+
+    Json::Value json = encode(state);
+    ASSERT_EQ(1, json.size());
+    ASSERT_EQ(2, json["default"].size());
+    ASSERT_EQ(42, json["default"]["12"][0].asUInt64());
+    ASSERT_EQ("3457", json["default"]["12"][1].asString());
+    ASSERT_EQ(1, json["default"]["3"][0].asUInt64());
+    ASSERT_EQ("99", json["default"]["3"][1].asString());
+
+    // a higher sequence number replaces the uuid too (e.g. after a failover)
+    state.add("default", 7, token(12, 18446744073709551615ull, 43));
+    json = encode(state);
+    ASSERT_EQ(43, json["default"]["12"][0].asUInt64());
+    ASSERT_EQ("18446744073709551615", json["default"]["12"][1].asString());
+
+    state.clear();
+    ASSERT_TRUE(state.empty());
+}
+
+TEST_F(MutationStateTest, testMerge)
+{
+    lcb::MutationState a, b;
+    a.add("default", 7, token(1, 10, 100));
+    a.add("default", 7, token(2, 20, 200));
+    b.add("default", 7, token(2, 21, 201));
+    b.add("default", 7, token(1, 11, 99));
+    b.add("beer-sample", 11, token(1023, 5, 5));
+
+    a.merge(b);
+    Json::Value json = encode(a);
+    ASSERT_EQ(2, json.size());
+    ASSERT_EQ(100, json["default"]["1"][0].asUInt64());
+    ASSERT_EQ("10", json["default"]["1"][1].asString());
+    ASSERT_EQ(201, json["default"]["2"][0].asUInt64());
+    ASSERT_EQ("21", json["default"]["2"][1].asString());
+    ASSERT_EQ(5, json["beer-sample"]["1023"][0].asUInt64());
+}
+
+TEST_F(MutationStateTest, testQueryPayload)
+{
+    lcb_MUTATION_STATE *state;
+    lcb_mutation_state_create(&state);
+    lcb_MUTATION_TOKEN tok = token(12, 3457, 42);
+    ASSERT_EQ(LCB_SUCCESS, lcb_mutation_state_add(state, "travel-sample", -1, &tok));
+
+    lcb_CMDQUERY *cmd;
+    lcb_cmdquery_create(&cmd);
+    lcb_cmdquery_statement(cmd, "SELECT 1", -1);
+    ASSERT_EQ(LCB_SUCCESS, lcb_cmdquery_mutation_state(cmd, state));
+    tok = token(7, 1, 2);
+    ASSERT_EQ(LCB_SUCCESS, lcb_cmdquery_consistency_token_for_keyspace(cmd, "default", 7, &tok));
+
+    const char *payload;
+    size_t npayload;
+    lcb_cmdquery_encoded_payload(cmd, &payload, &npayload);
+    Json::Value json;
+    ASSERT_TRUE(Json::Reader().parse(payload, payload + npayload, json));
+    ASSERT_EQ("at_plus", json["scan_consistency"].asString());
+    ASSERT_EQ(42, json["scan_vectors"]["travel-sample"]["12"][0].asUInt64());
+    ASSERT_EQ("3457", json["scan_vectors"]["travel-sample"]["12"][1].asString());
+    ASSERT_EQ(2, json["scan_vectors"]["default"]["7"][0].asUInt64());
+
+    // scan vectors given as an option replace the state
+    ASSERT_EQ(LCB_SUCCESS, lcb_cmdquery_option(cmd, "scan_vectors", -1, "{\"default\":{}}", -1));
+    lcb_cmdquery_encoded_payload(cmd, &payload, &npayload);
+    ASSERT_TRUE(Json::Reader().parse(payload, payload + npayload, json));
+    ASSERT_EQ(Json::Value(Json::objectValue), json["scan_vectors"]["default"]);
+    ASSERT_EQ(1, json["scan_vectors"].size());
+
+    lcb_cmdquery_destroy(cmd);
+
+    lcb_MUTATION_STATE *empty;
+    lcb_mutation_state_create(&empty);
+    lcb_cmdquery_create(&cmd);
+    ASSERT_EQ(LCB_ERR_DOCUMENT_NOT_FOUND, lcb_cmdquery_mutation_state(cmd, empty));
+    ASSERT_EQ(LCB_SUCCESS, lcb_mutation_state_merge(empty, state));
+    ASSERT_EQ(LCB_SUCCESS, lcb_cmdquery_mutation_state(cmd, empty));
+    lcb_cmdquery_destroy(cmd);
+    lcb_mutation_state_destroy(empty);
+    lcb_mutation_state_destroy(state);
+}
+
+/**
+ * Compares encoding the tokens of a 1024 vBucket bucket with jsoncpp (as
+ * lcb_cmdquery_consistency_tokens() used to) and with the state
+ */
+TEST_F(MutationStateTest, testEncodeCost)
+{
+    const int iterations = 200;
+    const uint16_t nvb = 1024;
+    std::vector<lcb_MUTATION_TOKEN> tokens;
+    for (uint16_t ii = 0; ii < nvb; ii++) {
+        tokens.push_back(token(ii, 0x1234567890ull + ii, 100000 + ii * 7));
+    }
+    size_t total_jsoncpp = 0, total_state = 0;
+
+    hrtime_t begin = gethrtime();
+    for (int ii = 0; ii < iterations; ii++) {
+        Json::Value root;
+        Json::Value &sv = root["scan_vectors"]["travel-sample"];
+        char buf[64];
+        for (const auto &tok : tokens) {
+            sprintf(buf, "%u", tok.vbid_);
+            Json::Value &cur = sv[buf];
+            cur[0] = static_cast<Json::UInt64>(tok.seqno_);
+            sprintf(buf, "%llu", (unsigned long long)tok.uuid_);
+            cur[1] = buf;
+        }
+        total_jsoncpp += Json::FastWriter().write(root["scan_vectors"]).size();
+    }
+    hrtime_t jsoncpp_ns = gethrtime() - begin;
+
+    string body;
+    begin = gethrtime();
+    for (int ii = 0; ii < iterations; ii++) {
+        lcb::MutationState state;
+        state.add("travel-sample", 13, tokens.data(), tokens.size());
+        body.clear();
+        state.encode(body);
+        total_state += body.size();
+    }
+    hrtime_t state_ns = gethrtime() - begin;
+
+    Json::Value parsed;
+    ASSERT_TRUE(Json::Reader().parse(body, parsed));
+    ASSERT_EQ(nvb, parsed["travel-sample"].size());
+    ASSERT_EQ(100000 + 1023 * 7, parsed["travel-sample"]["1023"][0].asUInt64());
+    // no newline added by FastWriter
+    ASSERT_EQ(total_jsoncpp - iterations, total_state);
+
+    RecordProperty("jsoncpp_ns_per_query", static_cast<int>(jsoncpp_ns / iterations));
+    RecordProperty("state_ns_per_query", static_cast<int>(state_ns / iterations));
+}
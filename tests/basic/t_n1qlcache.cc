@@ -0,0 +1,168 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+#include <gtest/gtest.h>
+#include <libcouchbase/couchbase.h>
+#include "settings.h"
+#include "n1ql/n1ql-internal.h"
+#include "contrib/lcb-jsoncpp/lcb-jsoncpp.h"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+using std::string;
+
+class N1QLCacheTest : public ::testing::Test
+{
+  protected:
+    lcb_settings *settings{};
+    lcb_N1QLCACHE *cache{};
+    string path;
+    string path2;
+
+    void SetUp() override
+    {
+        settings = lcb_settings_new();
+        cache = lcb_n1qlcache_create(settings);
+        path = testing::TempDir() + "lcb_n1qlcache_test.json";
+        path2 = path + ".copy";
+        std::remove(path.c_str());
+        std::remove(path2.c_str());
+    }
+
+    void TearDown() override
+    {
+        if (cache) {
+            lcb_n1qlcache_destroy(cache);
+        }
+        lcb_settings_unref(settings);
+        std::remove(path.c_str());
+        std::remove(path2.c_str());
+    }
+
+    /** Write a cache file with the given number of statements */
+    void write_file(const string &file, int nentries)
+    {
+        Json::Value root(Json::objectValue);
+        root["version"] = 1;
+        Json::Value &entries = root["entries"];
+        entries = Json::Value(Json::arrayValue);
+        for (int ii = 0; ii < nentries; ii++) {
+            Json::Value entry(Json::objectValue);
+            entry["statement"] = "SELECT " + std::to_string(ii);
+            entry["prepared"] = "p" + std::to_string(ii);
+            if (ii % 2) {
+                entry["encoded_plan"] = "plan" + std::to_string(ii);
+            }
+            entries.append(entry);
+        }
+        std::ofstream(file.c_str()) << Json::FastWriter().write(root);
+    }
+
+    string getplan(lcb_N1QLCACHE *c, const string &statement)
+    {
+        string out;
+        lcb_n1qlcache_getplan(c, statement, out);
+        return out;
+    }
+
+    lcb_QUERY_CACHE_STATS stats(lcb_N1QLCACHE *c)
+    {
+        lcb_QUERY_CACHE_STATS st{};
+        lcb_n1qlcache_stats(c, &st);
+        return st;
+    }
+};
+
+TEST_F(N1QLCacheTest, testLoadAndSave)
+{
+    write_file(path, 10);
+    ASSERT_EQ(LCB_SUCCESS, lcb_n1qlcache_set_file(cache, path.c_str()));
+    ASSERT_STREQ(path.c_str(), lcb_n1qlcache_get_file(cache));
+    ASSERT_EQ(10, stats(cache).entries);
+    ASSERT_LT(0, stats(cache).bytes);
+    ASSERT_EQ("{\"prepared\":\"p0\"}", getplan(cache, "SELECT 0"));
+    ASSERT_EQ("{\"prepared\":\"p1\",\"encoded_plan\":\"plan1\"}", getplan(cache, "SELECT 1"));
+    ASSERT_EQ("", getplan(cache, "SELECT 10"));
+
+    // a missing file is not an error, it is written when the cache is destroyed
+    lcb_N1QLCACHE *other = lcb_n1qlcache_create(settings);
+    ASSERT_EQ(LCB_SUCCESS, lcb_n1qlcache_set_file(other, path2.c_str()));
+    ASSERT_EQ(0, stats(other).entries);
+    lcb_n1qlcache_destroy(other);
+    other = lcb_n1qlcache_create(settings);
+    ASSERT_EQ(LCB_SUCCESS, lcb_n1qlcache_set_file(other, path2.c_str()));
+    ASSERT_EQ(0, stats(other).entries);
+
+    // explicit export to another file. The temporary file of a concurrent
+    // save is left alone
+    string foreign = path2 + ".tmp";
+    std::ofstream(foreign.c_str()) << "in progress";
+    ASSERT_EQ(LCB_SUCCESS, lcb_n1qlcache_save(cache, path2.c_str()));
+    std::ifstream foreign_in(foreign.c_str());
+    ASSERT_EQ("in progress", string(std::istreambuf_iterator<char>(foreign_in), std::istreambuf_iterator<char>()));
+    std::remove(foreign.c_str());
+    lcb_n1qlcache_clear(other);
+    ASSERT_EQ(LCB_SUCCESS, lcb_n1qlcache_set_file(other, path2.c_str()));
+    ASSERT_EQ(10, stats(other).entries);
+    ASSERT_EQ(stats(cache).bytes, stats(other).bytes);
+    ASSERT_EQ("{\"prepared\":\"p9\",\"encoded_plan\":\"plan9\"}", getplan(other, "SELECT 9"));
+    lcb_n1qlcache_destroy(other);
+
+    lcb_n1qlcache_clear(cache);
+    ASSERT_EQ(0, stats(cache).entries);
+    ASSERT_EQ(0, stats(cache).bytes);
+}
+
+TEST_F(N1QLCacheTest, testLimits)
+{
+    write_file(path, 100);
+
+    settings->query_cache_max_entries = 10;
+    ASSERT_EQ(LCB_SUCCESS, lcb_n1qlcache_set_file(cache, path.c_str()));
+    lcb_QUERY_CACHE_STATS st = stats(cache);
+    ASSERT_EQ(10, st.entries);
+    ASSERT_EQ(90, st.evictions);
+    // the most recently used entries (last in the file) are kept
+    ASSERT_EQ("", getplan(cache, "SELECT 89"));
+    ASSERT_NE("", getplan(cache, "SELECT 90"));
+    ASSERT_NE("", getplan(cache, "SELECT 99"));
+    size_t entry_size = st.bytes / st.entries;
+
+    lcb_n1qlcache_clear(cache);
+    settings->query_cache_max_entries = 5000;
+    settings->query_cache_max_bytes = entry_size * 20;
+    ASSERT_EQ(LCB_SUCCESS, lcb_n1qlcache_set_file(cache, path.c_str()));
+    st = stats(cache);
+    ASSERT_LE(st.bytes, settings->query_cache_max_bytes);
+    ASSERT_GE(st.entries, 15);
+    ASSERT_LE(st.entries, 25);
+}
+
+TEST_F(N1QLCacheTest, testInvalidFile)
+{
+    std::ofstream(path.c_str()) << "{\"version\":2,\"entries\":[]}";
+    ASSERT_EQ(LCB_ERR_PROTOCOL_ERROR, lcb_n1qlcache_set_file(cache, path.c_str()));
+    ASSERT_TRUE(lcb_n1qlcache_get_file(cache) == nullptr);
+
+    std::ofstream(path.c_str()) << "garbage";
+    ASSERT_EQ(LCB_ERR_PROTOCOL_ERROR, lcb_n1qlcache_set_file(cache, path.c_str()));
+
+    ASSERT_EQ(LCB_ERR_INVALID_ARGUMENT, lcb_n1qlcache_save(cache, nullptr));
+}
@@ -456,3 +456,203 @@ TEST_F(NetbufTest, testOutOfOrder)
 
     clean_check(&mgr);
 }
+
+static bool is_large_block(nb_MGR *mgr, nb_MBLOCK *block)
+{
+    sllist_node *ll;
+    SLLIST_FOREACH(&mgr->largepool.active, ll)
+    {
+        if (ll == &block->slnode) {
+            return true;
+        }
+    }
+    return false;
+}
+
+TEST_F(NetbufTest, testLargeSpan)
+{
+    nb_MGR mgr;
+    nb_SPAN small, large;
+    netbuf_init(&mgr, NULL);
+
+    small.size = SMALL_BUF_SIZE;
+    ASSERT_EQ(0, netbuf_mblock_reserve(&mgr, &small));
+    size_t pooled = mgr.datapool.nbytes;
+    ASSERT_NE(0, pooled);
+
+    large.size = NB_DATA_LARGE_THRESHOLD;
+    ASSERT_EQ(0, netbuf_mblock_reserve(&mgr, &large));
+    ASSERT_NE(small.parent, large.parent);
+    ASSERT_TRUE(is_large_block(&mgr, large.parent));
+    ASSERT_EQ(0, large.offset);
+    ASSERT_EQ(pooled, mgr.datapool.nbytes);
+    ASSERT_LE(NB_DATA_LARGE_THRESHOLD, mgr.largepool.nbytes);
+    ASSERT_EQ(pooled + mgr.largepool.nbytes + mgr.sendq.elempool.nbytes, netbuf_get_allocated(&mgr));
+    memset(SPAN_BUFFER(&large), 'x', large.size);
+
+    // Large spans are flushed like any other
+    netbuf_enqueue_span(&mgr, &small, NULL);
+    netbuf_enqueue_span(&mgr, &large, NULL);
+    nb_IOV iov[2];
+    int nused = 0;
+    ASSERT_EQ(small.size + large.size, netbuf_start_flush(&mgr, iov, 2, &nused));
+    ASSERT_EQ(2, nused);
+    ASSERT_EQ(SPAN_BUFFER(&large), iov[1].iov_base);
+    netbuf_end_flush(&mgr, small.size + large.size);
+
+    ASSERT_EQ(0, netbuf_is_clean(&mgr));
+    netbuf_mblock_release(&mgr, &large);
+    ASSERT_EQ(0, mgr.largepool.nbytes);
+    ASSERT_EQ(1, mgr.largepool.nallocs);
+    ASSERT_EQ(1, mgr.largepool.nfrees);
+    ASSERT_EQ(0, netbuf_is_clean(&mgr));
+
+    // Outstanding large spans are freed on cleanup
+    ASSERT_EQ(0, netbuf_mblock_reserve(&mgr, &large));
+    netbuf_dump_status(&mgr, stdout);
+    netbuf_mblock_release(&mgr, &small);
+    netbuf_cleanup(&mgr);
+
+    // A threshold of 0 keeps every span in the pool
+    nb_SETTINGS settings;
+    netbuf_default_settings(&settings);
+    settings.data_large_threshold = 0;
+    netbuf_init(&mgr, &settings);
+    ASSERT_EQ(0, netbuf_mblock_reserve(&mgr, &large));
+    ASSERT_FALSE(is_large_block(&mgr, large.parent));
+    ASSERT_EQ(0, mgr.largepool.nallocs);
+    netbuf_mblock_release(&mgr, &large);
+    clean_check(&mgr);
+}
+
+TEST_F(NetbufTest, testReserveMulti)
+{
+    nb_MGR mgr;
+    nb_SPAN spans[4];
+    int ii;
+
+    netbuf_init(&mgr, NULL);
+
+    for (ii = 0; ii < 4; ii++) {
+        spans[ii].size = 10 + ii;
+    }
+    ASSERT_EQ(0, netbuf_mblock_reserve_multi(&mgr, spans, 4));
+    for (ii = 1; ii < 4; ii++) {
+        ASSERT_EQ(spans[0].parent, spans[ii].parent);
+        ASSERT_EQ(SPAN_BUFFER(&spans[ii - 1]) + spans[ii - 1].size, SPAN_BUFFER(&spans[ii]));
+    }
+
+    // The spans are flushed as one buffer
+    for (ii = 0; ii < 4; ii++) {
+        memset(SPAN_BUFFER(&spans[ii]), 'a' + ii, spans[ii].size);
+        netbuf_enqueue_span(&mgr, &spans[ii], NULL);
+    }
+    nb_IOV iov[4];
+    int nused = 0;
+    ASSERT_EQ(10 + 11 + 12 + 13, netbuf_start_flush(&mgr, iov, 4, &nused));
+    ASSERT_EQ(1, nused);
+    netbuf_end_flush(&mgr, 10 + 11 + 12 + 13);
+
+    // ... and released one by one, in any order
+    netbuf_mblock_release(&mgr, &spans[2]);
+    netbuf_mblock_release(&mgr, &spans[0]);
+    netbuf_mblock_release(&mgr, &spans[3]);
+    netbuf_mblock_release(&mgr, &spans[1]);
+    clean_check(&mgr);
+
+#ifndef NETBUFS_LIBC_PROXY
+    // A region which would be a large span is reserved span by span
+    netbuf_init(&mgr, NULL);
+    spans[0].size = 100;
+    spans[1].size = NB_DATA_LARGE_THRESHOLD;
+    ASSERT_EQ(0, netbuf_mblock_reserve_multi(&mgr, spans, 2));
+    ASSERT_NE(spans[0].parent, spans[1].parent);
+    ASSERT_TRUE(is_large_block(&mgr, spans[1].parent));
+    netbuf_mblock_release(&mgr, &spans[1]);
+    netbuf_mblock_release(&mgr, &spans[0]);
+    clean_check(&mgr);
+#endif
+}
+
+static const int iterations = 20000;
+
+struct WorkloadStats {
+    size_t peak;
+    size_t steady;
+    /** Number of spans of at least NB_DATA_LARGE_THRESHOLD bytes */
+    unsigned nlarge;
+    /** Number of spans which were given a block of their own */
+    unsigned nstandalone;
+};
+
+/**
+ * Reserves spans of mixed sizes (mostly small packets, with the occasional
+ * large value), keeping a window of them outstanding as if awaiting
+ * responses, and records the bytes held by the manager
+ */
+static void run_mixed_workload(nb_SIZE threshold, WorkloadStats &stats)
+{
+    const int window = 64;
+    nb_SPAN spans[window];
+    nb_SETTINGS settings;
+    nb_MGR mgr;
+
+    netbuf_default_settings(&settings);
+    settings.data_large_threshold = threshold;
+    netbuf_init(&mgr, &settings);
+    stats.peak = 0;
+    stats.nlarge = 0;
+    stats.nstandalone = 0;
+
+    unsigned seed = 1;
+    for (int ii = 0; ii < iterations; ii++) {
+        nb_SPAN *span = spans + ii % window;
+        if (ii >= window) {
+            netbuf_mblock_release(&mgr, span);
+        }
+        seed = seed * 1103515245 + 12345;
+        if (ii % 50 == 0) {
+            span->size = 256 * 1024 + (seed >> 8) % (4 * 1024 * 1024);
+        } else {
+            span->size = 24 + (seed >> 8) % 4096;
+        }
+        ASSERT_EQ(0, netbuf_mblock_reserve(&mgr, span));
+        memset(SPAN_BUFFER(span), 'x', span->size);
+        if (span->size >= NB_DATA_LARGE_THRESHOLD) {
+            stats.nlarge++;
+        }
+        if (is_large_block(&mgr, span->parent)) {
+            stats.nstandalone++;
+        }
+        if (netbuf_get_allocated(&mgr) > stats.peak) {
+            stats.peak = netbuf_get_allocated(&mgr);
+        }
+    }
+    for (int ii = 0; ii < window; ii++) {
+        netbuf_mblock_release(&mgr, spans + (iterations + ii) % window);
+    }
+    stats.steady = netbuf_get_allocated(&mgr);
+    // nothing mapped for a large span outlives it
+    ASSERT_EQ(0, mgr.largepool.nbytes);
+    clean_check(&mgr);
+}
+
+TEST_F(NetbufTest, testMixedWorkload)
+{
+    WorkloadStats pooled, large;
+    run_mixed_workload(0, pooled);
+    run_mixed_workload(NB_DATA_LARGE_THRESHOLD, large);
+
+    ASSERT_EQ(iterations / 50, pooled.nlarge);
+    ASSERT_EQ(0, pooled.nstandalone);
+#ifndef NETBUFS_LIBC_PROXY
+    // Every large value got a block of its own rather than one from the pool
+    ASSERT_EQ(pooled.nlarge, large.nlarge);
+    ASSERT_EQ(large.nlarge, large.nstandalone);
+#endif
+
+    RecordProperty("pooled_peak_kb", static_cast<int>(pooled.peak / 1024));
+    RecordProperty("pooled_steady_kb", static_cast<int>(pooled.steady / 1024));
+    RecordProperty("large_peak_kb", static_cast<int>(large.peak / 1024));
+    RecordProperty("large_steady_kb", static_cast<int>(large.steady / 1024));
+}
@@ -147,8 +147,8 @@ TEST_F(ScramTest, GenerateSaltedPasswordWithSHA512)
                                  "\xd8\x34\xcf\xec";
     // warning: the expected output contains a binary zero, so don't use strlen()
 
-    cbsasl_error_t ret = generate_salted_password(SASL_AUTH_MECH_SCRAM_SHA512, &u_auth.secret, salt, strlen(salt), 1000,
-                                                  outbuffer, &outlen);
+    cbsasl_error_t ret = generate_salted_password(nullptr, SASL_AUTH_MECH_SCRAM_SHA512, &u_auth.secret, salt,
+                                                  strlen(salt), 1000, outbuffer, &outlen);
     ASSERT_EQ(SASL_OK, ret);
     EXPECT_EQ(CBSASL_SHA512_DIGEST_SIZE, outlen);
     EXPECT_EQ(std::string(expectedoutput, CBSASL_SHA512_DIGEST_SIZE),
@@ -176,8 +176,8 @@ TEST_F(ScramTest, GenerateSaltedPasswordWithSHA256)
                                  "\x7d\x2f\x81\x28\xf6\x26\x6b\x4a\x03\x26\x4d\x2a\x04\x60\xb7"
                                  "\xdc\xb3";
 
-    cbsasl_error_t ret = generate_salted_password(SASL_AUTH_MECH_SCRAM_SHA256, &u_auth.secret, salt, strlen(salt), 1000,
-                                                  outbuffer, &outlen);
+    cbsasl_error_t ret = generate_salted_password(nullptr, SASL_AUTH_MECH_SCRAM_SHA256, &u_auth.secret, salt,
+                                                  strlen(salt), 1000, outbuffer, &outlen);
     ASSERT_EQ(SASL_OK, ret);
     EXPECT_EQ(CBSASL_SHA256_DIGEST_SIZE, outlen);
     EXPECT_EQ(std::string(expectedoutput, CBSASL_SHA256_DIGEST_SIZE),
@@ -204,14 +204,58 @@ TEST_F(ScramTest, GenerateSaltedPasswordWithSHA1)
     const char *expectedoutput = "\x6e\x88\xbe\x8b\xad\x7e\xae\x9d\x9e\x10\xaa\x06\x12\x24\x03"
                                  "\x4f\xed\x48\xd0\x3f";
 
-    cbsasl_error_t ret = generate_salted_password(SASL_AUTH_MECH_SCRAM_SHA1, &u_auth.secret, salt, strlen(salt), 1000,
-                                                  outbuffer, &outlen);
+    cbsasl_error_t ret = generate_salted_password(nullptr, SASL_AUTH_MECH_SCRAM_SHA1, &u_auth.secret, salt,
+                                                  strlen(salt), 1000, outbuffer, &outlen);
     ASSERT_EQ(SASL_OK, ret);
     EXPECT_EQ(CBSASL_SHA1_DIGEST_SIZE, outlen);
     EXPECT_EQ(std::string(expectedoutput, CBSASL_SHA1_DIGEST_SIZE),
               std::string((const char *)outbuffer, CBSASL_SHA1_DIGEST_SIZE));
 }
 
+TEST_F(ScramTest, GenerateSaltedPasswordCached)
+{
+    // here we check that cached salted passwords are only reused for the exact
+    // same mechanism/password/salt/iteration count combination
+    union {
+        cbsasl_secret_t secret;
+        char buffer[30];
+    } u_auth;
+    unsigned char first[CBSASL_SHA256_DIGEST_SIZE], second[CBSASL_SHA256_DIGEST_SIZE];
+    unsigned char other[CBSASL_SHA512_DIGEST_SIZE];
+    unsigned int outlen;
+    const char *salt = "c2FsdA=="; // "salt" in base64
+    memcpy(u_auth.secret.data, "password", 8);
+    u_auth.secret.len = 8;
+
+    cbsasl_salted_cache_t *cache = cbsasl_salted_cache_new();
+    ASSERT_NE(nullptr, cache);
+    ASSERT_EQ(SASL_OK, generate_salted_password(cache, SASL_AUTH_MECH_SCRAM_SHA256, &u_auth.secret, salt, strlen(salt), 1000,
+                                                first, &outlen));
+    ASSERT_EQ(CBSASL_SHA256_DIGEST_SIZE, outlen);
+    ASSERT_EQ(SASL_OK, generate_salted_password(cache, SASL_AUTH_MECH_SCRAM_SHA256, &u_auth.secret, salt, strlen(salt), 1000,
+                                                second, &outlen));
+    ASSERT_EQ(CBSASL_SHA256_DIGEST_SIZE, outlen);
+    EXPECT_EQ(0, memcmp(first, second, sizeof(first)));
+
+    // different iteration count
+    ASSERT_EQ(SASL_OK, generate_salted_password(cache, SASL_AUTH_MECH_SCRAM_SHA256, &u_auth.secret, salt, strlen(salt), 1001,
+                                                second, &outlen));
+    EXPECT_NE(0, memcmp(first, second, sizeof(first)));
+
+    // different password
+    memcpy(u_auth.secret.data, "passwore", 8);
+    ASSERT_EQ(SASL_OK, generate_salted_password(cache, SASL_AUTH_MECH_SCRAM_SHA256, &u_auth.secret, salt, strlen(salt), 1000,
+                                                second, &outlen));
+    EXPECT_NE(0, memcmp(first, second, sizeof(first)));
+
+    // different mechanism
+    memcpy(u_auth.secret.data, "password", 8);
+    ASSERT_EQ(SASL_OK, generate_salted_password(cache, SASL_AUTH_MECH_SCRAM_SHA512, &u_auth.secret, salt, strlen(salt), 1000,
+                                                other, &outlen));
+    EXPECT_EQ(CBSASL_SHA512_DIGEST_SIZE, outlen);
+    cbsasl_salted_cache_free(cache);
+}
+
 TEST_F(ScramTest, ComputeClientProof_SHA512)
 {
     // we use the salted password computed in GenerateSaltedPasswordWithSHA512
@@ -0,0 +1,368 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+#include <gtest/gtest.h>
+#include "internal.h"
+#include "bucketconfig/clconfig.h"
+#include "sllist-inl.h"
+#include "packetutils.h"
+#include "rdb/rope.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+/*
+ * Count the C++ heap allocations made while an operation is scheduled. This
+ * replaces the global allocator for the whole test binary, but only counts
+ * while a test asks it to.
+ */
+static std::atomic<bool> count_allocations(false);
+static std::atomic<size_t> allocations(0);
+
+void *operator new(size_t n)
+{
+    if (count_allocations) {
+        ++allocations;
+    }
+    void *p = malloc(n ? n : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+class SubdocEncodingTest : public ::testing::Test
+{
+  protected:
+    lcb_INSTANCE *instance{nullptr};
+
+    void SetUp() override
+    {
+        lcb_CREATEOPTS *options = nullptr;
+        lcb_createopts_create(&options, LCB_TYPE_BUCKET);
+        ASSERT_EQ(LCB_SUCCESS, lcb_create(&instance, options));
+        lcb_createopts_destroy(options);
+        ASSERT_EQ(LCB_SUCCESS, lcb_cntl_string(instance, "enable_collections", "false"));
+
+        // Nothing is connected, as long as the packets are not flushed
+        lcbvb_SERVER server{};
+        server.hostname = const_cast<char *>("kv.example.com");
+        server.svc.data = 11210;
+        lcbvb_CONFIG *vbc = lcbvb_create();
+        ASSERT_EQ(0, lcbvb_genconfig_ex(vbc, "default", nullptr, &server, 1, 0, 64));
+        lcb::clconfig::ConfigInfo *info = lcb::clconfig::ConfigInfo::create(vbc, lcb::clconfig::CLCONFIG_PHONY, "");
+        lcb_update_vbconfig(instance, info);
+        info->decref();
+    }
+
+    void TearDown() override
+    {
+        lcb_destroy(instance);
+    }
+
+    /** The value of the only packet scheduled so far */
+    std::string scheduled_value()
+    {
+        mc_PIPELINE *pl = instance->cmdq.pipelines[0];
+        EXPECT_FALSE(SLLIST_IS_EMPTY(&pl->ctxqueued));
+        if (SLLIST_IS_EMPTY(&pl->ctxqueued)) {
+            return std::string();
+        }
+        mc_PACKET *pkt = SLLIST_ITEM(SLLIST_FIRST(&pl->ctxqueued), mc_PACKET, slnode);
+        const nb_SPAN *span = &pkt->u_value.single;
+        return std::string(SPAN_BUFFER(span), span->size);
+    }
+};
+
+TEST_F(SubdocEncodingTest, testLookup)
+{
+    lcb_SUBDOCSPECS *specs;
+    lcb_subdocspecs_create(&specs, 3);
+    lcb_subdocspecs_get(specs, 0, 0, "a.b", 3);
+    lcb_subdocspecs_exists(specs, 1, LCB_SUBDOCSPECS_F_XATTRPATH, "$document", 9);
+    lcb_subdocspecs_get(specs, 2, 0, nullptr, 0);
+
+    lcb_CMDSUBDOC *cmd;
+    lcb_cmdsubdoc_create(&cmd);
+    lcb_cmdsubdoc_key(cmd, "key", 3);
+    lcb_cmdsubdoc_specs(cmd, specs);
+
+    lcb_sched_enter(instance);
+    ASSERT_EQ(LCB_SUCCESS, lcb_subdoc(instance, nullptr, cmd));
+    std::string expected("\xc5\x00\x00\x03"
+                         "a.b"
+                         "\xc6\x04\x00\x09"
+                         "$document"
+                         "\x00\x00\x00\x00",
+                         24);
+    ASSERT_EQ(expected, scheduled_value());
+    lcb_sched_fail(instance);
+
+    lcb_cmdsubdoc_destroy(cmd);
+    lcb_subdocspecs_destroy(specs);
+}
+
+TEST_F(SubdocEncodingTest, testMutation)
+{
+    lcb_SUBDOCSPECS *specs;
+    lcb_subdocspecs_create(&specs, 3);
+    lcb_subdocspecs_dict_upsert(specs, 0, LCB_SUBDOCSPECS_F_MKINTERMEDIATES, "a.b", 3, "[1]", 3);
+    lcb_subdocspecs_counter(specs, 1, 0, "n", 1, -42);
+    lcb_subdocspecs_remove(specs, 2, 0, "c", 1);
+
+    // values made of several fragments are written contiguously
+    lcb_IOV iov[3] = {{const_cast<char *>("{\"x\""), 4}, {nullptr, 0}, {const_cast<char *>(":true}"), 6}};
+    lcb_SDSPEC iovspec = specs->specs[0];
+    LCB_SDSPEC_SET_PATH(&iovspec, "d", 1);
+    iovspec.value.vtype = LCB_KV_IOV;
+    iovspec.value.u_buf.multi.iov = iov;
+    iovspec.value.u_buf.multi.niov = 3;
+    iovspec.value.u_buf.multi.total_length = 0;
+    std::vector<lcb_SDSPEC> all(specs->specs, specs->specs + specs->nspecs);
+    all.push_back(iovspec);
+
+    lcb_CMDSUBDOC *cmd;
+    lcb_cmdsubdoc_create(&cmd);
+    lcb_cmdsubdoc_key(cmd, "key", 3);
+    lcb_cmdsubdoc_specs(cmd, specs);
+    cmd->specs = &all[0];
+    cmd->nspecs = all.size();
+
+    lcb_sched_enter(instance);
+    ASSERT_EQ(LCB_SUCCESS, lcb_subdoc(instance, nullptr, cmd));
+    std::string expected("\xc8\x01\x00\x03\x00\x00\x00\x03"
+                         "a.b[1]"
+                         "\xcf\x00\x00\x01\x00\x00\x00\x03"
+                         "n-42"
+                         "\xc9\x00\x00\x01\x00\x00\x00\x00"
+                         "c"
+                         "\xc8\x01\x00\x01\x00\x00\x00\x0a"
+                         "d{\"x\":true}",
+                         54);
+    ASSERT_EQ(expected, scheduled_value());
+    lcb_sched_fail(instance);
+
+    // the first invalid spec is reported
+    int error_index = -1;
+    lcb_cmdsubdoc_specs(cmd, specs);
+    all[2].sdcmd = LCB_SDCMD_GET;
+    cmd->specs = &all[0];
+    cmd->error_index = &error_index;
+    lcb_sched_enter(instance);
+    ASSERT_EQ(LCB_ERR_OPTIONS_CONFLICT, lcb_subdoc(instance, nullptr, cmd));
+    ASSERT_EQ(2, error_index);
+    lcb_sched_fail(instance);
+
+    // lengths which do not fit in the spec header are rejected
+    all[2] = specs->specs[2];
+    std::string longpath(UINT16_MAX + 1, 'p');
+    LCB_SDSPEC_SET_PATH(&all[1], longpath.c_str(), longpath.size());
+    lcb_sched_enter(instance);
+    ASSERT_EQ(LCB_ERR_SUBDOC_PATH_TOO_BIG, lcb_subdoc(instance, nullptr, cmd));
+    ASSERT_EQ(1, error_index);
+    lcb_sched_fail(instance);
+    LCB_SDSPEC_SET_PATH(&all[1], "n", 1);
+    if (sizeof(size_t) > sizeof(uint32_t)) {
+        // never read, as the spec is rejected before it is encoded
+        iov[1].iov_base = const_cast<char *>("");
+        iov[1].iov_len = static_cast<size_t>(UINT32_MAX) + 1;
+        cmd->nspecs = all.size();
+        lcb_sched_enter(instance);
+        ASSERT_EQ(LCB_ERR_VALUE_TOO_LARGE, lcb_subdoc(instance, nullptr, cmd));
+        ASSERT_EQ(3, error_index);
+        lcb_sched_fail(instance);
+    }
+
+    lcb_cmdsubdoc_destroy(cmd);
+    lcb_subdocspecs_destroy(specs);
+}
+
+/**
+ * Schedules a typical lookup repeatedly, and checks that encoding the
+ * command does not allocate (the packet and its buffers come from pools).
+ */
+TEST_F(SubdocEncodingTest, testAllocations)
+{
+    const int iterations = 20000;
+    const size_t nspecs = 4;
+    lcb_SUBDOCSPECS *specs;
+    lcb_subdocspecs_create(&specs, nspecs);
+    for (size_t ii = 0; ii < nspecs; ii++) {
+        lcb_subdocspecs_get(specs, ii, 0, "profile.address.city", 20);
+    }
+    lcb_CMDSUBDOC *cmd;
+    lcb_cmdsubdoc_create(&cmd);
+    lcb_cmdsubdoc_key(cmd, "user::0001", 10);
+    lcb_cmdsubdoc_specs(cmd, specs);
+
+    // warm up the buffer pools
+    lcb_sched_enter(instance);
+    ASSERT_EQ(LCB_SUCCESS, lcb_subdoc(instance, nullptr, cmd));
+    lcb_sched_fail(instance);
+
+    allocations = 0;
+    count_allocations = true;
+    hrtime_t begin = gethrtime();
+    for (int ii = 0; ii < iterations; ii++) {
+        lcb_sched_enter(instance);
+        lcb_subdoc(instance, nullptr, cmd);
+        lcb_sched_fail(instance);
+    }
+    hrtime_t elapsed = gethrtime() - begin;
+    count_allocations = false;
+
+    ASSERT_EQ(0U, allocations.load());
+    RecordProperty("subdoc_ns_per_op", static_cast<int>(elapsed / iterations));
+
+    lcb_cmdsubdoc_destroy(cmd);
+    lcb_subdocspecs_destroy(specs);
+}
+
+class SubdocResultTest : public ::testing::Test
+{
+  protected:
+    rdb_IOROPE ior{};
+    lcb::MemcachedResponse response;
+    std::string body;
+
+    void SetUp() override
+    {
+        rdb_init(&ior, rdb_libcalloc_new());
+    }
+
+    void TearDown() override
+    {
+        response.release(&ior);
+        rdb_cleanup(&ior);
+    }
+
+    void add_lookup(uint16_t status, const std::string &value)
+    {
+        uint16_t rc = htons(status);
+        uint32_t vlen = htonl(static_cast<uint32_t>(value.size()));
+        body.append(reinterpret_cast<const char *>(&rc), 2);
+        body.append(reinterpret_cast<const char *>(&vlen), 4);
+        body += value;
+    }
+
+    void add_mutation(uint8_t index, uint16_t status, const std::string &value)
+    {
+        uint16_t rc = htons(status);
+        body.append(reinterpret_cast<const char *>(&index), 1);
+        body.append(reinterpret_cast<const char *>(&rc), 2);
+        if (status == PROTOCOL_BINARY_RESPONSE_SUCCESS) {
+            uint32_t vlen = htonl(static_cast<uint32_t>(value.size()));
+            body.append(reinterpret_cast<const char *>(&vlen), 4);
+            body += value;
+        }
+    }
+
+    void respond(lcb_RESPSUBDOC *resp, uint8_t opcode, size_t nres)
+    {
+        protocol_binary_response_header hdr{};
+        hdr.response.magic = PROTOCOL_BINARY_RES;
+        hdr.response.opcode = opcode;
+        hdr.response.bodylen = htonl(static_cast<uint32_t>(body.size()));
+        rdb_copywrite(&ior, hdr.bytes, sizeof(hdr.bytes));
+        rdb_copywrite(&ior, &body[0], body.size());
+        unsigned wanted;
+        ASSERT_TRUE(response.load(&ior, &wanted));
+        resp->responses = &response;
+        resp->nres = nres;
+    }
+
+    static std::string value_of(const lcb_RESPSUBDOC *resp, size_t index)
+    {
+        const char *value = nullptr;
+        size_t nvalue = 0;
+        EXPECT_EQ(LCB_SUCCESS, lcb_respsubdoc_result_value(resp, index, &value, &nvalue));
+        return std::string(value ? value : "", nvalue);
+    }
+};
+
+TEST_F(SubdocResultTest, testLookup)
+{
+    add_lookup(PROTOCOL_BINARY_RESPONSE_SUCCESS, "\"first\"");
+    add_lookup(PROTOCOL_BINARY_RESPONSE_SUBDOC_PATH_ENOENT, "");
+    add_lookup(PROTOCOL_BINARY_RESPONSE_SUCCESS, "[1,2]");
+    lcb_RESPSUBDOC resp{};
+    respond(&resp, PROTOCOL_BINARY_CMD_SUBDOC_MULTI_LOOKUP, 3);
+
+    ASSERT_EQ(3, lcb_respsubdoc_result_size(&resp));
+    ASSERT_EQ(LCB_SUCCESS, lcb_respsubdoc_result_status(&resp, 0));
+    ASSERT_EQ("\"first\"", value_of(&resp, 0));
+    ASSERT_EQ(LCB_ERR_SUBDOC_PATH_NOT_FOUND, lcb_respsubdoc_result_status(&resp, 1));
+    ASSERT_EQ("", value_of(&resp, 1));
+    ASSERT_EQ("[1,2]", value_of(&resp, 2));
+    // in order, so the body was read once without recording offsets
+    ASSERT_EQ(0, resp.indexed);
+    ASSERT_EQ(LCB_ERR_OPTIONS_CONFLICT, lcb_respsubdoc_result_status(&resp, 3));
+
+    ASSERT_EQ("\"first\"", value_of(&resp, 0));
+    ASSERT_EQ(1, resp.indexed);
+    ASSERT_EQ(nullptr, resp.offsets);
+    ASSERT_EQ("[1,2]", value_of(&resp, 2));
+    ASSERT_EQ(LCB_ERR_SUBDOC_PATH_NOT_FOUND, lcb_respsubdoc_result_status(&resp, 1));
+    lcb_sdresult_release(&resp);
+}
+
+TEST_F(SubdocResultTest, testMutation)
+{
+    // only results with a value (counters) are returned
+    add_mutation(1, PROTOCOL_BINARY_RESPONSE_SUCCESS, "42");
+    add_mutation(3, PROTOCOL_BINARY_RESPONSE_SUCCESS, "-1");
+    lcb_RESPSUBDOC resp{};
+    respond(&resp, PROTOCOL_BINARY_CMD_SUBDOC_MULTI_MUTATION, 4);
+
+    ASSERT_EQ("", value_of(&resp, 0));
+    ASSERT_EQ("42", value_of(&resp, 1));
+    ASSERT_EQ(LCB_SUCCESS, lcb_respsubdoc_result_status(&resp, 2));
+    ASSERT_EQ("", value_of(&resp, 2));
+    ASSERT_EQ("-1", value_of(&resp, 3));
+    ASSERT_EQ(0, resp.indexed);
+
+    ASSERT_EQ("42", value_of(&resp, 1));
+    ASSERT_EQ("", value_of(&resp, 2));
+    ASSERT_EQ(1, resp.indexed);
+    lcb_sdresult_release(&resp);
+}
+
+TEST_F(SubdocResultTest, testManyResults)
+{
+    const size_t nres = LCB_SDRESULT_INLINE * 2;
+    for (size_t ii = 0; ii < nres; ii++) {
+        add_lookup(PROTOCOL_BINARY_RESPONSE_SUCCESS, std::to_string(ii));
+    }
+    lcb_RESPSUBDOC resp{};
+    respond(&resp, PROTOCOL_BINARY_CMD_SUBDOC_MULTI_LOOKUP, nres);
+
+    for (size_t ii = nres; ii > 0; ii--) {
+        ASSERT_EQ(std::to_string(ii - 1), value_of(&resp, ii - 1));
+    }
+    ASSERT_NE(nullptr, resp.offsets);
+    lcb_sdresult_release(&resp);
+    ASSERT_EQ(nullptr, resp.offsets);
+}
@@ -0,0 +1,130 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LCB_HTTEST_H
+#define LCB_HTTEST_H
+
+#include "internal.h"
+#include "http/http-priv.h"
+#include <gtest/gtest.h>
+#include <string>
+
+/** What the application received for a streaming HTTP request */
+struct HttpResult {
+    std::string body;
+    unsigned nchunks{0};
+    bool final{false};
+    lcb_STATUS rc{LCB_SUCCESS};
+    /** Pause delivery each time a chunk is received */
+    bool pause_each_chunk{false};
+};
+
+extern "C" {
+static void httest_callback(lcb_INSTANCE *, lcb_CALLBACK_TYPE, const lcb_RESPHTTP *resp)
+{
+    HttpResult *res = nullptr;
+    lcb_resphttp_cookie(resp, (void **)&res);
+    EXPECT_FALSE(res->final) << "callback invoked after the final response";
+    if (lcb_resphttp_is_final(resp)) {
+        res->final = true;
+        res->rc = lcb_resphttp_status(resp);
+        return;
+    }
+    const char *body;
+    size_t nbody;
+    lcb_resphttp_body(resp, &body, &nbody);
+    res->body.append(body, nbody);
+    res->nchunks++;
+    if (res->pause_each_chunk) {
+        lcb_HTTP_HANDLE *handle = nullptr;
+        lcb_resphttp_handle(resp, &handle);
+        handle->pause_delivery();
+    }
+}
+}
+
+/**
+ * A streaming query request, whose response is not read from a socket but
+ * passed to the parser by the test (see receive()). No I/O is ever performed:
+ * the connection to the (unused) endpoint is cancelled once the request is
+ * released.
+ */
+class HttpRequestWrap
+{
+  public:
+    /**
+     * @param compression whether the response may be compressed
+     * @param hwm the `http_stream_hwm` setting
+     */
+    explicit HttpRequestWrap(bool compression, const char *hwm = "0") : instance(nullptr), req(nullptr)
+    {
+        EXPECT_EQ(LCB_SUCCESS, lcb_create(&instance, nullptr));
+        EXPECT_EQ(LCB_SUCCESS, lcb_cntl_string(instance, "http_compression", compression ? "true" : "false"));
+        EXPECT_EQ(LCB_SUCCESS, lcb_cntl_string(instance, "http_stream_hwm", hwm));
+        lcb_install_callback(instance, LCB_CALLBACK_HTTP, (lcb_RESPCALLBACK)httest_callback);
+
+        lcb_CMDHTTP *cmd;
+        lcb_HTTP_HANDLE *handle = nullptr;
+        std::string path("/query/service");
+        std::string host("127.0.0.1:8093");
+        lcb_cmdhttp_create(&cmd, LCB_HTTP_TYPE_QUERY);
+        lcb_cmdhttp_method(cmd, LCB_HTTP_METHOD_POST);
+        lcb_cmdhttp_path(cmd, path.c_str(), path.size());
+        lcb_cmdhttp_host(cmd, host.c_str(), host.size());
+        lcb_cmdhttp_streaming(cmd, 1);
+        lcb_cmdhttp_handle(cmd, &handle);
+        EXPECT_EQ(LCB_SUCCESS, lcb_http(instance, &result, cmd));
+        lcb_cmdhttp_destroy(cmd);
+        req = handle;
+        if (req) {
+            // keep the request around once it has finished, so it can be inspected
+            req->incref();
+        }
+    }
+
+    ~HttpRequestWrap()
+    {
+        if (req) {
+            req->cancel();
+            req->decref();
+        }
+        lcb_destroy(instance);
+    }
+
+    /**
+     * Pass data read from the network to the request, and complete it once
+     * the response was parsed, the same way the socket read handler does
+     * @return false if the response could not be parsed
+     */
+    bool receive(const char *buf, size_t nbuf)
+    {
+        unsigned state = req->handle_parse_chunked(buf, static_cast<unsigned>(nbuf));
+        if (state & lcb::htparse::Parser::S_ERROR) {
+            return false;
+        }
+        if (!req->is_ongoing()) {
+            req->finish(LCB_SUCCESS);
+        }
+        return true;
+    }
+
+    lcb_INSTANCE *instance;
+    lcb::http::Request *req;
+    HttpResult result;
+};
+
+#endif
@@ -0,0 +1,175 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+#include "httest.h"
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+
+using std::string;
+
+class BacklogTest : public ::testing::Test
+{
+};
+
+/** Size of a single network read */
+static const size_t READ_SIZE = 16384;
+
+static string make_body(size_t size)
+{
+    string body;
+    body.reserve(size);
+    for (size_t ii = 0; ii < size; ii++) {
+        body += static_cast<char>('a' + ii % 26);
+    }
+    return body;
+}
+
+/** Frame the body as a chunked HTTP response, as the query service sends rows */
+static string make_response(const string &body, size_t chunk_size)
+{
+    std::stringstream wire;
+    wire << "HTTP/1.1 200 OK\r\n"
+         << "Content-Type: application/json\r\n"
+         << "Transfer-Encoding: chunked\r\n\r\n";
+    for (size_t off = 0; off < body.size(); off += chunk_size) {
+        size_t n = std::min(chunk_size, body.size() - off);
+        wire << std::hex << n << "\r\n" << body.substr(off, n) << "\r\n";
+    }
+    wire << "0\r\n\r\n";
+    return wire.str();
+}
+
+/**
+ * Streams a response to a consumer which pauses delivery after every chunk
+ * it receives, and only resumes every `slowness` iterations of the event loop.
+ */
+static void stream(HttpRequestWrap &hw, const string &response, unsigned slowness)
+{
+    lcb::http::Request *req = hw.req;
+    size_t received = 0;
+    hw.result.pause_each_chunk = true;
+    for (unsigned tick = 0; !hw.result.final; tick++) {
+        ASSERT_LT(tick, 100000U) << "stalled";
+
+        // the network, which is only read from when the request wants it
+        if (received < response.size() && req->wants_read()) {
+            size_t nread = std::min(READ_SIZE, response.size() - received);
+            ASSERT_TRUE(hw.receive(response.c_str() + received, nread));
+            received += nread;
+        }
+
+        // the application
+        if (tick % slowness == 0) {
+            req->resume_delivery();
+        }
+
+        // the flush timer, signalled by resume_delivery()
+        if (!req->backlog.paused() && !req->backlog.empty()) {
+            req->flush_backlog();
+        }
+    }
+    ASSERT_EQ(response.size(), received);
+}
+
+TEST_F(BacklogTest, testSlowConsumer)
+{
+    const string body = make_body(4 * 1024 * 1024);
+    const string response = make_response(body, 4000);
+    for (const char *hwm : {"0", "1", "65536", "262144"}) {
+        HttpRequestWrap hw(false, hwm);
+        ASSERT_TRUE(hw.req != nullptr);
+        stream(hw, response, 10);
+        ASSERT_EQ(LCB_SUCCESS, hw.result.rc) << "hwm=" << hwm;
+        ASSERT_EQ(body, hw.result.body) << "hwm=" << hwm;
+        // however slow the consumer, at most one read beyond the mark is kept
+        size_t mark = std::strtoul(hwm, nullptr, 10);
+        ASSERT_LE(hw.req->backlog.peak(), std::max(mark, size_t(1)) + READ_SIZE - 1) << "hwm=" << hwm;
+        if (mark > READ_SIZE) {
+            ASSERT_GE(hw.req->backlog.peak(), mark) << "hwm=" << hwm;
+        }
+    }
+}
+
+TEST_F(BacklogTest, testPausesAutomatically)
+{
+    const string body = make_body(1024 * 1024);
+    const string response = make_response(body, 4000);
+    HttpRequestWrap hw(false, "65536");
+    lcb::http::Request *req = hw.req;
+    ASSERT_TRUE(req->wants_read());
+
+    req->pause_delivery();
+    size_t received = 0;
+    while (req->wants_read()) {
+        ASSERT_TRUE(hw.receive(response.c_str() + received, READ_SIZE));
+        received += READ_SIZE;
+    }
+    ASSERT_EQ(0, hw.result.nchunks);
+    ASSERT_GE(req->backlog.size(), 65536);
+    ASSERT_LT(req->backlog.size(), 65536 + READ_SIZE);
+
+    // The application resumes, but the kept data has not been delivered yet:
+    // reading stays paused until the backlog is below the mark again
+    req->resume_delivery();
+    ASSERT_FALSE(req->wants_read());
+    hw.result.pause_each_chunk = true;
+    req->flush_backlog();
+    ASSERT_EQ(1, hw.result.nchunks);
+    ASSERT_TRUE(req->wants_read());
+
+    hw.result.pause_each_chunk = false;
+    req->resume_delivery();
+    req->flush_backlog();
+    ASSERT_TRUE(req->backlog.empty());
+    ASSERT_TRUE(req->wants_read());
+    // everything received so far was delivered, in order
+    ASSERT_FALSE(hw.result.body.empty());
+    ASSERT_EQ(body.substr(0, hw.result.body.size()), hw.result.body);
+}
+
+TEST_F(BacklogTest, testNoReadAhead)
+{
+    const string body = make_body(READ_SIZE);
+    const string response = make_response(body, 1000);
+    HttpRequestWrap hw(false);
+    lcb::http::Request *req = hw.req;
+    req->pause_delivery();
+    ASSERT_FALSE(req->wants_read());
+    req->resume_delivery();
+    ASSERT_TRUE(req->wants_read());
+
+    // The consumer pauses after the first chunk of a read: the rest of the
+    // read is kept, and flushed before anything else is read
+    hw.result.pause_each_chunk = true;
+    ASSERT_TRUE(hw.receive(response.c_str(), READ_SIZE));
+    ASSERT_EQ(1, hw.result.nchunks);
+    ASSERT_FALSE(req->backlog.empty());
+    ASSERT_FALSE(req->wants_read());
+    req->resume_delivery();
+    ASSERT_FALSE(req->wants_read());
+
+    hw.result.pause_each_chunk = false;
+    req->flush_backlog();
+    ASSERT_TRUE(req->backlog.empty());
+    ASSERT_TRUE(req->wants_read());
+    ASSERT_TRUE(hw.receive(response.c_str() + READ_SIZE, response.size() - READ_SIZE));
+    ASSERT_TRUE(hw.result.final);
+    ASSERT_EQ(body, hw.result.body);
+}
@@ -0,0 +1,256 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+#include "http/inflate.h"
+#include <gtest/gtest.h>
+#include <lcbht/lcbht.h>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include "settings.h"
+#include "httest.h"
+
+#ifdef LCB_HAVE_ZLIB
+#include <zlib.h>
+
+using std::string;
+using lcb::http::Inflater;
+using namespace lcb::htparse;
+
+class InflateTest : public ::testing::Test
+{
+};
+
+static string compress(const string &input, int window_bits)
+{
+    z_stream zs = {};
+    EXPECT_EQ(Z_OK, deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY));
+    string output(deflateBound(&zs, input.size()), '\0');
+    zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+    zs.avail_in = input.size();
+    zs.next_out = reinterpret_cast<Bytef *>(&output[0]);
+    zs.avail_out = output.size();
+    EXPECT_EQ(Z_STREAM_END, deflate(&zs, Z_FINISH));
+    output.resize(zs.total_out);
+    deflateEnd(&zs);
+    return output;
+}
+
+static string make_rows(size_t nrows)
+{
+    std::stringstream ss;
+    ss << "{\"requestID\":\"d3d1f5b6\",\"results\":[";
+    for (size_t ii = 0; ii < nrows; ii++) {
+        if (ii) {
+            ss << ",";
+        }
+        ss << "{\"id\":\"airline_" << ii << "\",\"type\":\"airline\",\"name\":\"Airline " << ii
+           << "\",\"country\":\"United States\",\"callsign\":\"CALLSIGN" << ii % 97 << "\"}";
+    }
+    ss << "],\"status\":\"success\"}";
+    return ss.str();
+}
+
+/** Frame a gzip compressed body as a chunked HTTP response */
+static string make_chunked_response(const string &compressed)
+{
+    std::stringstream wire;
+    wire << "HTTP/1.1 200 OK\r\n"
+         << "Content-Type: application/json\r\n"
+         << "Content-Encoding: gzip\r\n"
+         << "Transfer-Encoding: chunked\r\n\r\n";
+    for (size_t off = 0; off < compressed.size(); off += 4000) {
+        size_t n = std::min<size_t>(4000, compressed.size() - off);
+        wire << std::hex << n << "\r\n" << compressed.substr(off, n) << "\r\n";
+    }
+    wire << "0\r\n\r\n";
+    return wire.str();
+}
+
+/**
+ * Drain the inflater, checking that every piece fits in the reused buffer
+ * @return false if the stream is corrupt
+ */
+static bool drain(Inflater *inflater, const char *buf, size_t nbuf, string &out)
+{
+    const char *piece = nullptr;
+    int npiece;
+    inflater->input(buf, nbuf);
+    while ((npiece = inflater->next(&piece)) > 0) {
+        EXPECT_LE(static_cast<size_t>(npiece), Inflater::BUFFER_SIZE);
+        out.append(piece, npiece);
+    }
+    return npiece == 0;
+}
+
+TEST_F(InflateTest, testEncodings)
+{
+    ASSERT_TRUE(Inflater::supported());
+    ASSERT_TRUE(Inflater::create(nullptr) == nullptr);
+    ASSERT_TRUE(Inflater::create("identity") == nullptr);
+    ASSERT_TRUE(Inflater::create("br") == nullptr);
+
+    string body = make_rows(100);
+    const char *encodings[] = {"gzip", "GZIP", "x-gzip", "deflate"};
+    for (const char *encoding : encodings) {
+        std::unique_ptr<Inflater> inflater(Inflater::create(encoding));
+        ASSERT_TRUE(inflater.get() != nullptr) << encoding;
+        // deflate is the zlib format (RFC 1950), gzip adds its own header
+        string compressed = compress(body, strcmp(encoding, "deflate") == 0 ? 15 : 15 + 16);
+        string out;
+        ASSERT_TRUE(drain(inflater.get(), compressed.data(), compressed.size(), out));
+        ASSERT_TRUE(inflater->done());
+        ASSERT_EQ(body, out);
+        ASSERT_EQ(compressed.size(), inflater->bytes_in());
+        ASSERT_EQ(body.size(), inflater->bytes_out());
+    }
+}
+
+TEST_F(InflateTest, testPendingOutput)
+{
+    // highly compressible, so that a few bytes of input fill the output buffer
+    string body(1024 * 1024, 'x');
+    body += make_rows(100);
+    string compressed = compress(body, 15 + 16);
+
+    for (size_t piece = 1; piece <= 64; piece++) {
+        // reference decoder, whose output buffer never fills up
+        z_stream zs = {};
+        ASSERT_EQ(Z_OK, inflateInit2(&zs, 15 + 16));
+        string expected(body.size(), '\0');
+        zs.next_out = reinterpret_cast<Bytef *>(&expected[0]);
+        zs.avail_out = expected.size();
+
+        std::unique_ptr<Inflater> inflater(Inflater::create("gzip"));
+        string out;
+        for (size_t off = 0; off < compressed.size(); off += piece) {
+            size_t n = std::min(piece, compressed.size() - off);
+            ASSERT_TRUE(drain(inflater.get(), compressed.data() + off, n, out));
+            zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(compressed.data() + off));
+            zs.avail_in = n;
+            inflate(&zs, Z_NO_FLUSH);
+            // everything which can be decoded from the input so far must have been returned
+            ASSERT_EQ(zs.total_out, out.size()) << "offset=" << off << " piece=" << piece;
+        }
+        inflateEnd(&zs);
+        ASSERT_TRUE(inflater->done());
+        ASSERT_EQ(body, out);
+    }
+}
+
+TEST_F(InflateTest, testCorrupt)
+{
+    string compressed = compress(make_rows(100), 15 + 16);
+    compressed[compressed.size() / 2] ^= 0x55;
+    compressed[compressed.size() / 2 + 1] ^= 0x55;
+
+    std::unique_ptr<Inflater> inflater(Inflater::create("gzip"));
+    string out;
+    ASSERT_FALSE(drain(inflater.get(), compressed.data(), compressed.size(), out));
+
+    inflater.reset(Inflater::create("gzip"));
+    string garbage("this is not compressed at all");
+    ASSERT_FALSE(drain(inflater.get(), garbage.data(), garbage.size(), out));
+}
+
+/**
+ * Feeds a compressed, chunked HTTP response (as a query service would send it)
+ * through the HTTP parser in network-sized pieces, and inflates the body as
+ * it arrives.
+ */
+TEST_F(InflateTest, testChunkedResponse)
+{
+    string body = make_rows(20000);
+    string compressed = compress(body, 15 + 16);
+
+    string response = make_chunked_response(compressed);
+
+    lcb_settings *settings = lcb_settings_new();
+    Parser *parser = new Parser(settings);
+    std::unique_ptr<Inflater> inflater;
+    string out;
+    unsigned state = 0;
+
+    for (size_t off = 0; off < response.size() && (state & Parser::S_DONE) == 0;) {
+        const char *buf = response.data() + off;
+        unsigned nbuf = std::min<size_t>(1460, response.size() - off);
+        off += nbuf;
+        while (nbuf && (state & Parser::S_DONE) == 0) {
+            const char *rbody;
+            unsigned nused, nbody;
+            unsigned oldstate = parser->get_cur_response().state;
+            state = parser->parse_ex(buf, nbuf, &nused, &nbody, &rbody);
+            ASSERT_EQ(0, state & Parser::S_ERROR);
+            if ((oldstate ^ state) & Parser::S_HEADER) {
+                inflater.reset(Inflater::create(parser->get_cur_response().get_header_value("Content-Encoding")));
+                ASSERT_TRUE(inflater.get() != nullptr);
+            }
+            if (nbody) {
+                ASSERT_TRUE(drain(inflater.get(), rbody, nbody, out));
+            }
+            buf += nused;
+            nbuf -= nused;
+        }
+    }
+    ASSERT_NE(0, state & Parser::S_DONE);
+    ASSERT_TRUE(inflater->done());
+    ASSERT_EQ(body, out);
+    // the body is never buffered by the parser
+    ASSERT_TRUE(parser->get_cur_response().body.empty());
+
+    RecordProperty("body_bytes", static_cast<int>(body.size()));
+    RecordProperty("wire_bytes", static_cast<int>(response.size()));
+    RecordProperty("inflate_us", static_cast<int>(inflater->elapsed() / 1000));
+
+    delete parser;
+    lcb_settings_unref(settings);
+}
+
+/**
+ * Passes a compressed, chunked response through the parse path of a streaming
+ * lcb::http::Request, which inflates the body before it reaches the callback.
+ */
+TEST_F(InflateTest, testRequestResponse)
+{
+    // large runs of repeated rows inflate to many output buffers per network read
+    string body = make_rows(20000) + string(1024 * 1024, ' ');
+    string response = make_chunked_response(compress(body, 15 + 16));
+
+    HttpRequestWrap hw(true);
+    ASSERT_TRUE(hw.req != nullptr);
+    for (size_t off = 0; off < response.size(); off += 1460) {
+        ASSERT_TRUE(hw.req->is_ongoing());
+        ASSERT_TRUE(hw.receive(response.data() + off, std::min<size_t>(1460, response.size() - off)));
+    }
+    ASSERT_TRUE(hw.result.final);
+    ASSERT_EQ(LCB_SUCCESS, hw.result.rc);
+    ASSERT_EQ(body.size(), hw.result.body.size());
+    ASSERT_EQ(body, hw.result.body);
+    ASSERT_TRUE(hw.req->inflater != nullptr);
+    ASSERT_TRUE(hw.req->inflater->done());
+    ASSERT_GT(hw.result.nchunks, body.size() / Inflater::BUFFER_SIZE);
+
+    // without compression enabled, the body is passed as it was received
+    HttpRequestWrap plain(false);
+    ASSERT_TRUE(plain.receive(response.data(), response.size()));
+    ASSERT_TRUE(plain.result.final);
+    ASSERT_TRUE(plain.req->inflater == nullptr);
+    ASSERT_EQ(compress(body, 15 + 16), plain.result.body);
+}
+#endif
@@ -382,6 +382,114 @@ TEST_F(CollectionUnitTest, testCollectionSet)
     EXPECT_EQ(4, numcallbacks);
 }
 
+extern "C" {
+static void multiCollectionDone(lcb_INSTANCE *, void *cookie, const lcb_STATUS *statuses, size_t nitems)
+{
+    auto *result = static_cast<vector<lcb_STATUS> *>(cookie);
+    result->assign(statuses, statuses + nitems);
+}
+
+static void multiCollectionStoreCallback(lcb_INSTANCE *, lcb_CALLBACK_TYPE, const lcb_RESPSTORE *resp)
+{
+    lcb_STATUS rc = lcb_respstore_status(resp);
+    EXPECT_TRUE(rc == LCB_SUCCESS || rc == LCB_ERR_COLLECTION_NOT_FOUND) << lcb_strerror_short(rc);
+}
+
+static void multiCollectionGetCallback(lcb_INSTANCE *, lcb_CALLBACK_TYPE, const lcb_RESPGET *resp)
+{
+    const char *key, *value;
+    size_t nkey, nvalue;
+    lcb_respget_key(resp, &key, &nkey);
+    lcb_respget_value(resp, &value, &nvalue);
+    EXPECT_EQ(LCB_SUCCESS, lcb_respget_status(resp));
+    EXPECT_EQ(string(key, nkey), string(value, nvalue));
+}
+}
+
+/**
+ * @test
+ * Multi set/get in a collection
+ *
+ * @pre
+ * Create scope, collection. From a new connection, which has to resolve the
+ * collection first, store several keys in one call and get them back in one
+ * call. Then drop the collection, and store them again from a new connection.
+ *
+ * @post
+ *
+ * All keys are stored and read back. Once the collection is dropped, every
+ * key fails with @c LCB_ERR_COLLECTION_NOT_FOUND.
+ */
+TEST_F(CollectionUnitTest, testCollectionMultiSet)
+{
+    SKIP_IF_MOCK();
+    SKIP_IF_CLUSTER_VERSION_IS_LOWER_THAN(MockEnvironment::VERSION_70);
+    HandleWrap hw;
+    lcb_INSTANCE *instance;
+    createConnection(hw, &instance);
+
+    std::string scope(unique_name("sMulti")), collection(unique_name("cMulti"));
+    EXPECT_EQ(LCB_SUCCESS, create_scope(instance, scope));
+    EXPECT_EQ(LCB_SUCCESS, create_collection(instance, scope, collection));
+
+    vector<string> keys;
+    vector<const char *> kptrs;
+    vector<size_t> klens;
+    for (int ii = 0; ii < 8; ii++) {
+        keys.push_back("testMultiKey" + std::to_string(ii));
+    }
+    for (const auto &key : keys) {
+        kptrs.push_back(key.c_str());
+        klens.push_back(key.size());
+    }
+
+    lcb_CMDSTORE *cmd;
+    lcb_cmdstore_create(&cmd, LCB_STORE_UPSERT);
+    lcb_cmdstore_collection(cmd, scope.c_str(), scope.size(), collection.c_str(), collection.size());
+    lcb_CMDGET *cmdget;
+    lcb_cmdget_create(&cmdget);
+    lcb_cmdget_collection(cmdget, scope.c_str(), scope.size(), collection.c_str(), collection.size());
+
+    {
+        HandleWrap hw2;
+        lcb_INSTANCE *instance2;
+        createConnection(hw2, &instance2);
+        (void)lcb_install_callback(instance2, LCB_CALLBACK_STORE, (lcb_RESPCALLBACK)multiCollectionStoreCallback);
+        (void)lcb_install_callback(instance2, LCB_CALLBACK_GET, (lcb_RESPCALLBACK)multiCollectionGetCallback);
+
+        vector<lcb_STATUS> statuses;
+        EXPECT_EQ(LCB_SUCCESS, lcb_store_multi(instance2, &statuses, cmd, kptrs.data(), klens.data(), kptrs.data(),
+                                               klens.data(), keys.size(), multiCollectionDone));
+        lcb_wait(instance2, LCB_WAIT_DEFAULT);
+        EXPECT_EQ(vector<lcb_STATUS>(keys.size(), LCB_SUCCESS), statuses);
+
+        statuses.clear();
+        EXPECT_EQ(LCB_SUCCESS, lcb_get_multi(instance2, &statuses, cmdget, kptrs.data(), klens.data(), keys.size(),
+                                             multiCollectionDone));
+        lcb_wait(instance2, LCB_WAIT_DEFAULT);
+        EXPECT_EQ(vector<lcb_STATUS>(keys.size(), LCB_SUCCESS), statuses);
+    }
+
+    EXPECT_EQ(LCB_SUCCESS, drop_collection(instance, scope, collection));
+    sleep(1); /* sleep for a second to make sure that collection has been dropped */
+
+    {
+        HandleWrap hw2;
+        lcb_INSTANCE *instance2;
+        createConnection(hw2, &instance2);
+        (void)lcb_install_callback(instance2, LCB_CALLBACK_STORE, (lcb_RESPCALLBACK)multiCollectionStoreCallback);
+
+        vector<lcb_STATUS> statuses;
+        EXPECT_EQ(LCB_SUCCESS, lcb_store_multi(instance2, &statuses, cmd, kptrs.data(), klens.data(), kptrs.data(),
+                                               klens.data(), keys.size(), multiCollectionDone));
+        lcb_wait(instance2, LCB_WAIT_DEFAULT);
+        EXPECT_EQ(vector<lcb_STATUS>(keys.size(), LCB_ERR_COLLECTION_NOT_FOUND), statuses);
+    }
+
+    lcb_cmdstore_destroy(cmd);
+    lcb_cmdget_destroy(cmdget);
+}
+
 /**
  * @test
  * Set/get doc to collection that has been dropped
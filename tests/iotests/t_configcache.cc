@@ -17,8 +17,12 @@
 
 #include "config.h"
 #include "iotests.h"
+#include <libcouchbase/vbucket.h>
 
+#include <chrono>
 #include <cstdio>
+#include <fstream>
+#include <iterator>
 
 class ConfigCacheUnitTest : public MockUnitTest
 {
@@ -131,3 +135,48 @@ TEST_F(ConfigCacheUnitTest, testConfigCache)
 
     lcb_createopts_destroy(cropts);
 }
+
+static std::chrono::microseconds timedBootstrap(lcb_CREATEOPTS *cropts, const char *filename, int *is_loaded)
+{
+    lcb_INSTANCE *instance;
+    doLcbCreate(&instance, cropts, MockEnvironment::getInstance());
+    EXPECT_EQ(LCB_SUCCESS, lcb_cntl(instance, LCB_CNTL_SET, LCB_CNTL_CONFIGCACHE, (void *)filename));
+
+    auto begin = std::chrono::steady_clock::now();
+    EXPECT_EQ(LCB_SUCCESS, lcb_connect(instance));
+    EXPECT_EQ(LCB_SUCCESS, lcb_wait(instance, LCB_WAIT_DEFAULT));
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin);
+
+    EXPECT_EQ(LCB_SUCCESS, lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_CONFIG_CACHE_LOADED, is_loaded));
+    lcb_destroy(instance);
+    return elapsed;
+}
+
+TEST_F(ConfigCacheUnitTest, testBinaryCacheWarmStart)
+{
+    lcb_CREATEOPTS *cropts = NULL;
+    char filename[L_tmpnam + 0];
+    ASSERT_TRUE(NULL != tmpnam(filename));
+    MockEnvironment::getInstance()->makeConnectParams(cropts, NULL);
+
+    int is_loaded = 0;
+    auto cold = timedBootstrap(cropts, filename, &is_loaded);
+    ASSERT_EQ(0, is_loaded);
+
+    // The cache must have been written in the binary snapshot format
+    std::ifstream ifs(filename, std::ios::in | std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    ASSERT_NE(0, lcbvb_is_binary(contents.c_str(), contents.size()));
+    lcbvb_CONFIG *vbc = lcbvb_create();
+    ASSERT_EQ(0, lcbvb_load_binary(vbc, contents.c_str(), contents.size()));
+    lcbvb_destroy(vbc);
+
+    auto warm = timedBootstrap(cropts, filename, &is_loaded);
+    ASSERT_NE(0, is_loaded);
+
+    RecordProperty("cold_bootstrap_us", static_cast<int>(cold.count()));
+    RecordProperty("warm_bootstrap_us", static_cast<int>(warm.count()));
+
+    remove(filename);
+    lcb_createopts_destroy(cropts);
+}
@@ -6,6 +6,7 @@
 #include "internal.h"
 #include "bucketconfig/clconfig.h"
 #include <lcbio/iotable.h>
+#include <chrono>
 #include <set>
 
 using namespace lcb::clconfig;
@@ -223,3 +224,49 @@ TEST_F(ConfmonTest, testBootstrapMethods)
     ASSERT_TRUE(instance->confmon->is_refreshing());
     instance->confmon->stop();
 }
+
+TEST_F(ConfmonTest, testBootstrapRace)
+{
+    SKIP_UNLESS_MOCK();
+    HandleWrap hw;
+    lcb_INSTANCE *instance;
+    MockEnvironment *mock = MockEnvironment::getInstance();
+    mock->createConnection(hw, &instance);
+    instance->settings->config_node_timeout = LCB_MS2US(2000);
+    instance->settings->bootstrap_race_width = 3;
+    instance->settings->bootstrap_race_delay = LCB_MS2US(50);
+
+    Confmon *mon = new Confmon(instance->settings, instance->iotable, instance);
+    struct listener2 lsn;
+    lsn.io = instance->iotable;
+    lsn.reset();
+    lsn.expected_events.insert(CLCONFIG_EVENT_GOT_NEW_CONFIG);
+    mon->add_listener(&lsn);
+
+    // Put unreachable (TEST-NET-1) nodes in front of the live ones
+    lcb::Hostlist hl;
+    hl.add("192.0.2.1", 11210);
+    hl.add("192.0.2.2", 11210);
+    std::vector<int> ports = mock->getMcPorts();
+    for (std::vector<int>::const_iterator it = ports.begin(); it != ports.end(); it++) {
+        hl.add("localhost", *it);
+    }
+    instance->settings->randomize_bootstrap_nodes = 0;
+    Provider *cccp = mon->get_provider(CLCONFIG_CCCP);
+    cccp->enable(instance);
+    cccp->configure_nodes(hl);
+
+    mon->prepare();
+    auto begin = std::chrono::steady_clock::now();
+    mon->start();
+    runConfmonTest(lsn.io, mon);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+
+    ASSERT_EQ(1, lsn.call_count);
+    ASSERT_EQ(CLCONFIG_CCCP, lsn.last_source);
+    RecordProperty("time_to_config_ms", static_cast<int>(elapsed.count()));
+    // Sequential bootstrap would wait config_node_timeout for each of the
+    // unreachable nodes first
+    ASSERT_LT(elapsed.count(), 2000);
+    delete mon;
+}
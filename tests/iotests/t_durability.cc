@@ -581,6 +581,48 @@ TEST_F(DurabilityUnitTest, testMulti)
     dmop.assertAllMatch(opts, items_stored, vector<Item>());
 }
 
+/**
+ * @test Durability for many keys, where several keys share a vBucket and
+ * are checked with the same probes
+ */
+TEST_F(DurabilityUnitTest, testMultiSharedVbucket)
+{
+    LCB_TEST_REQUIRE_FEATURE("observe")
+    const unsigned limit = 500;
+
+    vector<Item> items_stored;
+
+    HandleWrap hwrap;
+    lcb_INSTANCE *instance;
+
+    createConnection(hwrap);
+    instance = hwrap.getLcb();
+    lcb_cntl_setu32(instance, LCB_CNTL_DURABILITY_TIMEOUT, LCB_MS2US(10000));
+
+    for (unsigned ii = 0; ii < limit; ii++) {
+        char buf[64];
+        sprintf(buf, "key-shared-vb-%u", ii);
+        string key_stored = buf;
+
+        removeKey(instance, key_stored);
+
+        Item itm_e = Item(key_stored, key_stored, 0);
+
+        KVOperation kvo(&itm_e);
+        kvo.store(instance);
+        items_stored.push_back(kvo.result);
+    }
+
+    lcb_durability_opts_t opts = {0};
+    defaultOptions(instance, opts);
+    opts.version = 1;
+    opts.v.v0.pollopts = LCB_DURABILITY_MODE_SEQNO;
+
+    DurabilityMultiOperation dmop = DurabilityMultiOperation();
+    dmop.run(instance, &opts, items_stored);
+    dmop.assertAllMatch(opts, items_stored, vector<Item>());
+}
+
 struct cb_cookie {
     int is_observe;
     int count;
@@ -1085,3 +1127,60 @@ TEST_F(DurabilityUnitTest, testRemoveWithDurability)
         ASSERT_EQ(LCB_SUCCESS, res.rc);
     }
 }
+
+extern "C" {
+static void multiStoreDurabilityCallback(lcb_INSTANCE *, lcb_CALLBACK_TYPE, const lcb_RESPSTORE *resp)
+{
+    map<string, lcb_STATUS> *statuses;
+    lcb_respstore_cookie(resp, (void **)&statuses);
+    const char *key;
+    size_t nkey;
+    lcb_respstore_key(resp, &key, &nkey);
+    (*statuses)[string(key, nkey)] = lcb_respstore_status(resp);
+}
+}
+
+/**
+ * @test Multi store with synchronous durability
+ * @pre Upsert several keys in one lcb_store_multi() call, requiring majority
+ * durability (sent in the flexible framing extras of each packet)
+ * @post Every key is stored
+ */
+TEST_F(DurabilityUnitTest, testMultiStoreWithDurability)
+{
+    SKIP_IF_MOCK()
+    SKIP_IF_CLUSTER_VERSION_IS_LOWER_THAN(MockEnvironment::VERSION_65)
+
+    HandleWrap hw;
+    lcb_INSTANCE *instance;
+    createConnection(hw, &instance);
+    lcb_install_callback(instance, LCB_CALLBACK_STORE, (lcb_RESPCALLBACK)multiStoreDurabilityCallback);
+
+    vector<string> keys;
+    vector<const char *> kptrs;
+    vector<size_t> klens;
+    for (int ii = 0; ii < 8; ii++) {
+        keys.push_back("multi-store-durability-" + to_string(ii));
+    }
+    for (const auto &key : keys) {
+        kptrs.push_back(key.c_str());
+        klens.push_back(key.size());
+    }
+
+    lcb_CMDSTORE *cmd;
+    lcb_cmdstore_create(&cmd, LCB_STORE_UPSERT);
+    lcb_cmdstore_durability(cmd, LCB_DURABILITYLEVEL_MAJORITY);
+    map<string, lcb_STATUS> statuses;
+    ASSERT_EQ(LCB_SUCCESS, lcb_store_multi(instance, &statuses, cmd, kptrs.data(), klens.data(), kptrs.data(),
+                                           klens.data(), keys.size(), nullptr));
+    lcb_cmdstore_destroy(cmd);
+    lcb_wait(instance, LCB_WAIT_DEFAULT);
+
+    ASSERT_EQ(keys.size(), statuses.size());
+    for (const auto &key : keys) {
+        ASSERT_EQ(LCB_SUCCESS, statuses[key]) << key;
+        Item itm;
+        getKey(instance, key, itm);
+        ASSERT_EQ(key, itm.val);
+    }
+}
@@ -45,6 +45,7 @@ struct ForwardCookie {
     lcb_STATUS err_received;
     bool called;
     bool flushed;
+    unsigned max_items;
 
     ForwardCookie()
     {
@@ -52,6 +53,7 @@ struct ForwardCookie {
         err_received = LCB_SUCCESS;
         called = false;
         flushed = false;
+        max_items = 0;
     }
 };
 
@@ -69,6 +71,9 @@ static void pktfwd_callback(lcb_INSTANCE *, const void *cookie, lcb_STATUS err,
     protocol_binary_response_header *hdr = (protocol_binary_response_header *)resp->header;
     ASSERT_EQ(PROTOCOL_BINARY_RES, hdr->response.magic);
     lcb_U32 blen = ntohl(hdr->response.bodylen);
+    if (resp->nitems > fc->max_items) {
+        fc->max_items = resp->nitems;
+    }
 
     // Gather the packets
     for (unsigned ii = 0; ii < resp->nitems; ii++) {
@@ -133,3 +138,122 @@ TEST_F(ForwardTests, testIncomplete)
     lcb_set_pktflushed_callback(instance, pktflush_callback);
     lcb_set_pktfwd_callback(instance, pktfwd_callback);
 }
+
+/** Forward a packet, and wait for the response */
+static void forward(lcb_INSTANCE *instance, ForwardCookie &fc, int version)
+{
+    lcb_CMDPKTFWD cmd = {0};
+    cmd.version = version;
+    cmd.vb.vtype = LCB_KV_CONTIG;
+    cmd.vb.u_buf.contig.bytes = &fc.orig[0];
+    cmd.vb.u_buf.contig.nbytes = fc.orig.size();
+    lcb_sched_enter(instance);
+    ASSERT_EQ(LCB_SUCCESS, lcb_pktfwd3(instance, &fc, &cmd));
+    lcb_sched_leave(instance);
+    lcb_wait(instance, LCB_WAIT_DEFAULT);
+    ASSERT_TRUE(fc.called);
+    ASSERT_EQ(LCB_SUCCESS, fc.err_received);
+    for (unsigned ii = 0; ii < fc.bkbuf.size(); ++ii) {
+        lcb_backbuf_unref(fc.bkbuf[ii]);
+    }
+}
+
+/** Store a document with a packet */
+static void store(lcb_INSTANCE *instance, const string &key, const string &value)
+{
+    ForwardCookie fc;
+    StorageRequest req(key, value);
+    req.magic(PROTOCOL_BINARY_REQ);
+    req.op(PROTOCOL_BINARY_CMD_SET);
+    req.serialize(fc.orig);
+    forward(instance, fc, 0);
+    protocol_binary_response_header hdr;
+    memcpy(hdr.bytes, &fc.respbuf[0], sizeof(hdr.bytes));
+    ASSERT_EQ(PROTOCOL_BINARY_RESPONSE_SUCCESS, ntohs(hdr.response.status));
+}
+
+TEST_F(ForwardTests, testMultipleBuffers)
+{
+    lcb_INSTANCE *instance;
+    HandleWrap hw;
+    createConnection(hw, &instance);
+    lcb_set_pktflushed_callback(instance, pktflush_callback);
+    lcb_set_pktfwd_callback(instance, pktfwd_callback);
+    // Have the response handled before all of it is received, so that the
+    // beginning and the rest of it end up in different segments of the rope
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl_string(instance, "read_chunk_size", "16384"));
+
+    string key("ForwardMultipleBuffers");
+    string value(4 * 1024 * 1024, 'x');
+    for (size_t ii = 0; ii < value.size(); ii += 4096) {
+        value[ii] = static_cast<char>('a' + ii % 26);
+    }
+    store(instance, key, value);
+
+    for (int version = 0; version < 2; version++) {
+        ForwardCookie fc;
+        GetRequest req(key);
+        req.magic(PROTOCOL_BINARY_REQ);
+        req.op(PROTOCOL_BINARY_CMD_GET);
+        req.serialize(fc.orig);
+        forward(instance, fc, version);
+        if (version == 0) {
+            ASSERT_EQ(1, fc.max_items);
+        } else {
+            ASSERT_GT(fc.max_items, 1);
+        }
+        // header, flags and the value
+        ASSERT_EQ(24 + 4 + value.size(), fc.respbuf.size());
+        protocol_binary_response_header hdr;
+        memcpy(hdr.bytes, &fc.respbuf[0], sizeof(hdr.bytes));
+        ASSERT_EQ(PROTOCOL_BINARY_RESPONSE_SUCCESS, ntohs(hdr.response.status));
+        ASSERT_EQ(4, hdr.response.extlen);
+        ASSERT_EQ(0, ntohs(hdr.response.keylen));
+        ASSERT_TRUE(memcmp(&fc.respbuf[28], value.c_str(), value.size()) == 0);
+    }
+}
+
+/**
+ * Forwards gets of a large document, accepting the response as a single
+ * buffer (version 0) or as it was received (version 1).
+ *
+ * This is a benchmark rather than a test, run it with
+ * --gtest_also_run_disabled_tests --gtest_filter=ForwardTests.*Throughput
+ */
+TEST_F(ForwardTests, DISABLED_testThroughput)
+{
+    lcb_INSTANCE *instance;
+    HandleWrap hw;
+    createConnection(hw, &instance);
+    lcb_set_pktflushed_callback(instance, pktflush_callback);
+    lcb_set_pktfwd_callback(instance, pktfwd_callback);
+
+    const int iterations = 50;
+    string key("ForwardThroughput");
+    string value(512 * 1024, 'x');
+    store(instance, key, value);
+
+    double mbps[2];
+    unsigned max_items = 0;
+    for (int version = 0; version < 2; version++) {
+        hrtime_t begin = gethrtime();
+        for (int ii = 0; ii < iterations; ii++) {
+            ForwardCookie fc;
+            GetRequest req(key);
+            req.magic(PROTOCOL_BINARY_REQ);
+            req.op(PROTOCOL_BINARY_CMD_GET);
+            req.serialize(fc.orig);
+            forward(instance, fc, version);
+            ASSERT_EQ(24 + 4 + value.size(), fc.respbuf.size());
+            if (fc.max_items > max_items) {
+                max_items = fc.max_items;
+            }
+        }
+        hrtime_t elapsed = gethrtime() - begin;
+        mbps[version] = (double)value.size() * iterations / (1024 * 1024) / ((double)elapsed / 1e9);
+    }
+
+    RecordProperty("contiguous_mbps", static_cast<int>(mbps[0]));
+    RecordProperty("multiple_buffers_mbps", static_cast<int>(mbps[1]));
+    RecordProperty("max_buffers", static_cast<int>(max_items));
+}
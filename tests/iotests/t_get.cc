@@ -971,3 +971,286 @@ TEST_F(GetUnitTest, testPessimisticLock)
         ASSERT_EQ(LCB_SUCCESS, res.status);
     }
 }
+
+struct hedge_result {
+    int invoked{0};
+    lcb_STATUS status{LCB_SUCCESS};
+    bool replica{false};
+    std::string value;
+};
+
+extern "C" {
+static void hedge_get_callback(lcb_INSTANCE *, lcb_CALLBACK_TYPE, const lcb_RESPGET *resp)
+{
+    hedge_result *res = nullptr;
+    lcb_respget_cookie(resp, (void **)&res);
+    res->invoked++;
+    res->status = lcb_respget_status(resp);
+    res->replica = lcb_respget_is_replica(resp) != 0;
+    if (res->status == LCB_SUCCESS) {
+        const char *value;
+        size_t nvalue;
+        lcb_respget_value(resp, &value, &nvalue);
+        res->value.assign(value, nvalue);
+    }
+}
+}
+
+/**
+ * @test Hedged get
+ * @pre Store a key, and get it with hedging enabled and a hedge delay short
+ * enough for the replica read to be sent
+ * @post The callback is invoked once, with the value, and the hedge counters
+ * are consistent
+ */
+TEST_F(GetUnitTest, testHedgedGet)
+{
+    SKIP_UNLESS_MOCK()
+    HandleWrap hw;
+    lcb_INSTANCE *instance;
+    createConnection(hw, &instance);
+    if (lcb_get_num_replicas(instance) < 1) {
+        MockEnvironment::printSkipMessage(__FILE__, __LINE__, "needs replicas");
+        return;
+    }
+
+    std::string key("testHedgedGet");
+    storeKey(instance, key, "hedged");
+    // Make sure the replica has the item as well
+    MockMutationCommand mcCmd(MockCommand::CACHE, key);
+    mcCmd.value = "hedged";
+    mcCmd.replicaList.push_back(0);
+    MockEnvironment::getInstance()->sendCommand(mcCmd);
+    MockEnvironment::getInstance()->getResponse();
+
+    lcb_U32 delay = 1;
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl(instance, LCB_CNTL_SET, LCB_CNTL_KV_HEDGE_DELAY, &delay));
+    lcb_install_callback(instance, LCB_CALLBACK_GET, (lcb_RESPCALLBACK)hedge_get_callback);
+
+    lcb_CMDGET *cmd;
+    lcb_cmdget_create(&cmd);
+    lcb_cmdget_key(cmd, key.c_str(), key.size());
+    lcb_cmdget_hedge(cmd, 1);
+    hedge_result res;
+    ASSERT_EQ(LCB_SUCCESS, lcb_get(instance, &res, cmd));
+    lcb_wait(instance, LCB_WAIT_DEFAULT);
+    ASSERT_EQ(1, res.invoked);
+    ASSERT_EQ(LCB_SUCCESS, res.status);
+    ASSERT_EQ("hedged", res.value);
+
+    lcb_KV_HEDGE_STATS stats{};
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_KV_HEDGE_STATS, &stats));
+    ASSERT_LE(stats.issued, 1U);
+    ASSERT_LE(stats.won, stats.issued);
+    ASSERT_EQ(res.replica ? 1U : 0U, stats.won);
+    ASSERT_EQ(1U, stats.delay_us);
+
+    // Hedging only applies to plain gets
+    lcb_cmdget_locktime(cmd, 10);
+    ASSERT_EQ(LCB_ERR_OPTIONS_CONFLICT, lcb_get(instance, &res, cmd));
+    lcb_cmdget_destroy(cmd);
+}
+
+/**
+ * @test Coalesced gets
+ * @pre Enable get coalescing, and schedule several gets for the same key in
+ * one batch, followed by a get which locks the key
+ * @post Only one plain get is sent, and all callbacks receive the value
+ */
+TEST_F(GetUnitTest, testCoalescedGet)
+{
+    HandleWrap hw;
+    lcb_INSTANCE *instance;
+    createConnection(hw, &instance);
+
+    std::string key("testCoalescedGet");
+    storeKey(instance, key, "coalesced");
+
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl_string(instance, "kv_coalesce_gets", "true"));
+    lcb_install_callback(instance, LCB_CALLBACK_GET, (lcb_RESPCALLBACK)hedge_get_callback);
+
+    lcb_CMDGET *cmd;
+    lcb_cmdget_create(&cmd);
+    lcb_cmdget_key(cmd, key.c_str(), key.size());
+    const int ngets = 5;
+    hedge_result res[ngets + 1];
+    lcb_sched_enter(instance);
+    for (int ii = 0; ii < ngets; ii++) {
+        ASSERT_EQ(LCB_SUCCESS, lcb_get(instance, &res[ii], cmd));
+    }
+    lcb_cmdget_locktime(cmd, 10);
+    ASSERT_EQ(LCB_SUCCESS, lcb_get(instance, &res[ngets], cmd));
+    lcb_sched_leave(instance);
+    lcb_wait(instance, LCB_WAIT_DEFAULT);
+    lcb_cmdget_destroy(cmd);
+
+    for (const auto &r : res) {
+        ASSERT_EQ(1, r.invoked);
+        ASSERT_EQ(LCB_SUCCESS, r.status);
+        ASSERT_EQ("coalesced", r.value);
+    }
+
+    lcb_KV_COALESCE_STATS stats{};
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_KV_COALESCE_STATS, &stats));
+    ASSERT_EQ(1U, stats.issued);
+    ASSERT_EQ(ngets - 1, stats.coalesced);
+    ASSERT_EQ(0U, stats.inflight);
+}
+
+/**
+ * @test Coalesced gets and lcb_sched_fail()
+ * @pre Enable get coalescing. Schedule several gets for a key and fail the
+ * batch. Then schedule a get in one batch, and attach a get to it from a
+ * second batch which is failed
+ * @post No callback is invoked for the failed gets, and the get which was
+ * scheduled receives the value
+ */
+TEST_F(GetUnitTest, testCoalescedGetSchedFail)
+{
+    HandleWrap hw;
+    lcb_INSTANCE *instance;
+    createConnection(hw, &instance);
+
+    std::string key("testCoalescedGetSchedFail");
+    storeKey(instance, key, "coalesced");
+
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl_string(instance, "kv_coalesce_gets", "true"));
+    lcb_install_callback(instance, LCB_CALLBACK_GET, (lcb_RESPCALLBACK)hedge_get_callback);
+
+    lcb_CMDGET *cmd;
+    lcb_cmdget_create(&cmd);
+    lcb_cmdget_key(cmd, key.c_str(), key.size());
+
+    hedge_result failed[3];
+    lcb_sched_enter(instance);
+    for (auto &r : failed) {
+        ASSERT_EQ(LCB_SUCCESS, lcb_get(instance, &r, cmd));
+    }
+    lcb_sched_fail(instance);
+
+    lcb_KV_COALESCE_STATS stats{};
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_KV_COALESCE_STATS, &stats));
+    ASSERT_EQ(0U, stats.coalesced);
+    ASSERT_EQ(0U, stats.inflight);
+
+    hedge_result scheduled, detached;
+    lcb_sched_enter(instance);
+    ASSERT_EQ(LCB_SUCCESS, lcb_get(instance, &scheduled, cmd));
+    lcb_sched_leave(instance);
+    lcb_sched_enter(instance);
+    ASSERT_EQ(LCB_SUCCESS, lcb_get(instance, &detached, cmd));
+    lcb_sched_fail(instance);
+    lcb_wait(instance, LCB_WAIT_DEFAULT);
+    lcb_cmdget_destroy(cmd);
+
+    for (const auto &r : failed) {
+        ASSERT_EQ(0, r.invoked);
+    }
+    ASSERT_EQ(0, detached.invoked);
+    ASSERT_EQ(1, scheduled.invoked);
+    ASSERT_EQ(LCB_SUCCESS, scheduled.status);
+    ASSERT_EQ("coalesced", scheduled.value);
+
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_KV_COALESCE_STATS, &stats));
+    ASSERT_EQ(0U, stats.coalesced);
+    ASSERT_EQ(0U, stats.inflight);
+}
+
+struct multi_get_result {
+    std::map<std::string, Item> items;
+    std::vector<lcb_STATUS> statuses;
+    int completed{0};
+};
+
+extern "C" {
+static void multi_get_callback(lcb_INSTANCE *, lcb_CALLBACK_TYPE, const lcb_RESPGET *resp)
+{
+    multi_get_result *res = nullptr;
+    lcb_respget_cookie(resp, (void **)&res);
+    Item itm;
+    itm.assign(resp);
+    EXPECT_EQ(0U, res->items.count(itm.key)) << itm.key;
+    res->items[itm.key] = itm;
+}
+
+static void multi_get_done(lcb_INSTANCE *, void *cookie, const lcb_STATUS *statuses, size_t nitems)
+{
+    auto *res = static_cast<multi_get_result *>(cookie);
+    // invoked once, after the callbacks of all the keys
+    EXPECT_EQ(nitems, res->items.size());
+    res->statuses.assign(statuses, statuses + nitems);
+    res->completed++;
+}
+}
+
+/**
+ * @test Multi get
+ * @pre Store some keys spread over all the nodes, and get them along with a
+ * missing key in one lcb_get_multi() call, then again updating the expiry
+ * @post Each key gets its own callback with its value, and the bulk callback
+ * is invoked once with the status of each key in the order they were passed
+ */
+TEST_F(GetUnitTest, testMultiGet)
+{
+    HandleWrap hw;
+    lcb_INSTANCE *instance;
+    createConnection(hw, &instance);
+    lcb_install_callback(instance, LCB_CALLBACK_GET, (lcb_RESPCALLBACK)multi_get_callback);
+
+    std::vector<std::string> keys;
+    for (int ii = 0; ii < 16; ii++) {
+        keys.push_back("testMultiGet" + std::to_string(ii));
+        storeKey(instance, keys.back(), "value of " + keys.back());
+    }
+    std::string missing("testMultiGetMissing");
+    removeKey(instance, missing);
+    keys.insert(keys.begin() + 5, missing);
+
+    std::vector<const char *> kptrs;
+    std::vector<size_t> klens;
+    for (const auto &key : keys) {
+        kptrs.push_back(key.c_str());
+        klens.push_back(key.size());
+    }
+
+    lcb_CMDGET *cmd;
+    lcb_cmdget_create(&cmd);
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == 1) {
+            // sent as GAT, with extras
+            lcb_cmdget_expiry(cmd, 3600);
+        }
+        multi_get_result res;
+        ASSERT_EQ(LCB_SUCCESS,
+                  lcb_get_multi(instance, &res, cmd, kptrs.data(), klens.data(), keys.size(), multi_get_done));
+        lcb_wait(instance, LCB_WAIT_DEFAULT);
+
+        ASSERT_EQ(1, res.completed);
+        ASSERT_EQ(keys.size(), res.statuses.size());
+        for (size_t ii = 0; ii < keys.size(); ii++) {
+            const Item &itm = res.items[keys[ii]];
+            if (keys[ii] == missing) {
+                ASSERT_EQ(LCB_ERR_DOCUMENT_NOT_FOUND, itm.err);
+                ASSERT_EQ(LCB_ERR_DOCUMENT_NOT_FOUND, res.statuses[ii]);
+            } else {
+                ASSERT_EQ(LCB_SUCCESS, itm.err) << keys[ii];
+                ASSERT_EQ(LCB_SUCCESS, res.statuses[ii]) << keys[ii];
+                ASSERT_EQ("value of " + keys[ii], itm.val);
+                ASSERT_NE(0U, itm.cas);
+            }
+        }
+    }
+
+    // the bulk callback is optional
+    multi_get_result res;
+    ASSERT_EQ(LCB_SUCCESS, lcb_get_multi(instance, &res, cmd, kptrs.data(), klens.data(), keys.size(), nullptr));
+    lcb_wait(instance, LCB_WAIT_DEFAULT);
+    ASSERT_EQ(keys.size(), res.items.size());
+    ASSERT_EQ(0, res.completed);
+
+    // nothing is scheduled if any key is invalid
+    klens[3] = 0;
+    ASSERT_EQ(LCB_ERR_EMPTY_KEY, lcb_get_multi(instance, &res, cmd, kptrs.data(), klens.data(), keys.size(), nullptr));
+    ASSERT_EQ(LCB_ERR_INVALID_ARGUMENT, lcb_get_multi(instance, &res, cmd, kptrs.data(), klens.data(), 0, nullptr));
+    lcb_cmdget_destroy(cmd);
+}
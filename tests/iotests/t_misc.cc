@@ -1005,3 +1005,27 @@ TEST_F(MockUnitTest, testExists)
     lcb_wait(instance, LCB_WAIT_DEFAULT);
     ASSERT_EQ(1, res);
 }
+
+TEST_F(MockUnitTest, testKvPrewarm)
+{
+    HandleWrap hw;
+    lcb_INSTANCE *instance;
+    MockEnvironment::getInstance()->createConnection(hw, &instance);
+
+    int enabled = 1;
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl(instance, LCB_CNTL_SET, LCB_CNTL_KV_PREWARM, &enabled));
+    ASSERT_EQ(LCB_SUCCESS, lcb_connect(instance));
+    lcb_wait(instance, LCB_WAIT_DEFAULT);
+    ASSERT_EQ(LCB_SUCCESS, lcb_get_bootstrap_status(instance));
+
+    // Every data node is connected (or connecting) before any operation
+    for (size_t ii = 0; ii < LCBT_NSERVERS(instance); ++ii) {
+        lcb::Server *server = instance->get_server(ii);
+        if (!server->has_valid_host() || server->get_host().host[0] == '\0') {
+            continue;
+        }
+        ASSERT_TRUE(server->is_connected() || server->connreq != nullptr) << "Server " << ii;
+    }
+
+    storeKey(instance, "prewarmKey", "prewarmValue");
+}
@@ -16,6 +16,7 @@
  */
 #include "config.h"
 #include "iotests.h"
+#include <map>
 
 class MutateUnitTest : public MockUnitTest
 {
@@ -670,3 +671,107 @@ TEST_F(MutateUnitTest, testSetDefault)
     lcb_cmdstore_destroy(cmd);
     lcb_wait(instance, LCB_WAIT_DEFAULT);
 }
+
+struct MultiStoreResult {
+    std::map<std::string, Item> items;
+    std::vector<lcb_STATUS> statuses;
+    int completed{0};
+};
+
+extern "C" {
+static void multiStoreCallback(lcb_INSTANCE *, lcb_CALLBACK_TYPE, const lcb_RESPSTORE *resp)
+{
+    MultiStoreResult *res;
+    lcb_respstore_cookie(resp, (void **)&res);
+    Item itm;
+    itm.assign(resp);
+    EXPECT_EQ(0U, res->items.count(itm.key)) << itm.key;
+    res->items[itm.key] = itm;
+}
+
+static void multiStoreDone(lcb_INSTANCE *, void *cookie, const lcb_STATUS *statuses, size_t nitems)
+{
+    auto *res = static_cast<MultiStoreResult *>(cookie);
+    EXPECT_EQ(nitems, res->items.size());
+    res->statuses.assign(statuses, statuses + nitems);
+    res->completed++;
+}
+}
+
+/**
+ * @test Multi store
+ *
+ * @pre
+ * Upsert keys spread over all the nodes, with values of various sizes, in one
+ * lcb_store_multi() call, then try to insert them again
+ *
+ * @post
+ * Each key gets its own callback, and the bulk callback is invoked once with
+ * the status of each key in order. The documents have the values and flags
+ * which were passed, and inserting fails for each of them.
+ */
+TEST_F(MutateUnitTest, testMultiStore)
+{
+    lcb_INSTANCE *instance;
+    HandleWrap hw;
+    createConnection(hw, &instance);
+    lcb_install_callback(instance, LCB_CALLBACK_STORE, (lcb_RESPCALLBACK)multiStoreCallback);
+
+    std::vector<std::string> keys, values;
+    for (int ii = 0; ii < 16; ii++) {
+        keys.push_back("testMultiStore" + std::to_string(ii));
+        removeKey(instance, keys.back());
+        // the fifth value does not fit in the buffers of the others
+        values.push_back(std::string(ii == 4 ? 100 * 1024 : 10 + ii * 7, 'a' + ii));
+    }
+    values[7].clear();
+
+    std::vector<const char *> kptrs, vptrs;
+    std::vector<size_t> klens, vlens;
+    for (size_t ii = 0; ii < keys.size(); ii++) {
+        kptrs.push_back(keys[ii].c_str());
+        klens.push_back(keys[ii].size());
+        vptrs.push_back(values[ii].c_str());
+        vlens.push_back(values[ii].size());
+    }
+
+    lcb_CMDSTORE *cmd;
+    lcb_cmdstore_create(&cmd, LCB_STORE_UPSERT);
+    lcb_cmdstore_flags(cmd, 0xcafe);
+    MultiStoreResult res;
+    ASSERT_EQ(LCB_SUCCESS, lcb_store_multi(instance, &res, cmd, kptrs.data(), klens.data(), vptrs.data(),
+                                           vlens.data(), keys.size(), multiStoreDone));
+    lcb_cmdstore_destroy(cmd);
+    lcb_wait(instance, LCB_WAIT_DEFAULT);
+
+    ASSERT_EQ(1, res.completed);
+    ASSERT_EQ(keys.size(), res.statuses.size());
+    for (size_t ii = 0; ii < keys.size(); ii++) {
+        ASSERT_EQ(LCB_SUCCESS, res.statuses[ii]) << keys[ii];
+        ASSERT_EQ(LCB_SUCCESS, res.items[keys[ii]].err) << keys[ii];
+        ASSERT_NE(0U, res.items[keys[ii]].cas);
+
+        Item itm;
+        getKey(instance, keys[ii], itm);
+        ASSERT_EQ(values[ii], itm.val) << keys[ii];
+        ASSERT_EQ(0xcafeU, itm.flags);
+        ASSERT_EQ(res.items[keys[ii]].cas, itm.cas);
+    }
+
+    lcb_cmdstore_create(&cmd, LCB_STORE_INSERT);
+    res = MultiStoreResult();
+    ASSERT_EQ(LCB_SUCCESS, lcb_store_multi(instance, &res, cmd, kptrs.data(), klens.data(), vptrs.data(),
+                                           vlens.data(), keys.size(), multiStoreDone));
+    lcb_wait(instance, LCB_WAIT_DEFAULT);
+    ASSERT_EQ(1, res.completed);
+    for (size_t ii = 0; ii < keys.size(); ii++) {
+        ASSERT_EQ(LCB_ERR_DOCUMENT_EXISTS, res.statuses[ii]) << keys[ii];
+        ASSERT_EQ(LCB_ERR_DOCUMENT_EXISTS, res.items[keys[ii]].err) << keys[ii];
+    }
+
+    // durability polling is done per key, it is not supported
+    lcb_cmdstore_durability_observe(cmd, 1, 0);
+    ASSERT_EQ(LCB_ERR_UNSUPPORTED_OPERATION, lcb_store_multi(instance, &res, cmd, kptrs.data(), klens.data(),
+                                                              vptrs.data(), vlens.data(), keys.size(), nullptr));
+    lcb_cmdstore_destroy(cmd);
+}
@@ -327,6 +327,38 @@ TEST_F(QueryUnitTest, testCancellation)
     ASSERT_FALSE(res.called);
 }
 
+TEST_F(QueryUnitTest, testPauseResume)
+{
+    lcb_INSTANCE *instance;
+    HandleWrap hw;
+    if (!createQueryConnection(hw, &instance)) {
+        SKIP_QUERY_TEST();
+    }
+    N1QLResult res;
+    makeCommand("SELECT mockrow");
+    lcb_QUERY_HANDLE *handle = nullptr;
+    lcb_cmdquery_handle(cmd, &handle);
+    lcb_STATUS rc = lcb_query(instance, &res, cmd);
+    ASSERT_EQ(LCB_SUCCESS, rc);
+    ASSERT_TRUE(handle != nullptr);
+    ASSERT_EQ(LCB_SUCCESS, lcb_query_pause(instance, handle));
+
+    // a paused consumer does not receive anything, however long it waits
+    for (int ii = 0; ii < 100; ii++) {
+        lcb_tick_nowait(instance);
+        usleep(LCB_MS2US(1));
+    }
+    ASSERT_FALSE(res.called);
+
+    ASSERT_EQ(LCB_SUCCESS, lcb_query_resume(instance, handle));
+    lcb_wait(instance, LCB_WAIT_DEFAULT);
+    ASSERT_TRUE(res.called);
+    ASSERT_EQ(LCB_SUCCESS, res.rc);
+    ASSERT_EQ(1, res.rows.size());
+
+    ASSERT_EQ(LCB_ERR_INVALID_ARGUMENT, lcb_query_pause(instance, nullptr));
+}
+
 TEST_F(QueryUnitTest, testClusterwide)
 {
     lcb_INSTANCE *instance;
@@ -161,6 +161,80 @@ TEST_F(SnappyUnitTest, testSpec)
     lcb_cmdstore_destroy(scmd);
 }
 
+extern "C" {
+static void multistore_done(lcb_INSTANCE *, void *cookie, const lcb_STATUS *statuses, size_t nitems)
+{
+    std::vector< lcb_STATUS > *result = reinterpret_cast< std::vector< lcb_STATUS > * >(cookie);
+    result->assign(statuses, statuses + nitems);
+}
+static void multistorecb(lcb_INSTANCE *, int, const lcb_RESPBASE *rb)
+{
+    EXPECT_EQ(LCB_SUCCESS, rb->ctx.rc);
+}
+}
+
+TEST_F(SnappyUnitTest, testMultiStore)
+{
+    SKIP_UNLESS_MOCK();
+    HandleWrap hw;
+    lcb_INSTANCE *instance;
+
+    setCompression("passive");
+    createConnection(hw, &instance);
+    lcb_cntl_setu32(instance, LCB_CNTL_COMPRESSION_OPTS, LCB_COMPRESS_INOUT);
+    lcb_install_callback(instance, LCB_CALLBACK_GET, (lcb_RESPCALLBACK)getcb);
+    lcb_install_callback(instance, LCB_CALLBACK_STORE, storecb);
+
+    std::string value("A big black bug bit a big black bear, made the big black bear bleed blood");
+    std::vector< std::string > keys;
+    std::vector< const char * > kptrs, vptrs;
+    std::vector< size_t > klens, vlens;
+    for (int ii = 0; ii < 8; ii++) {
+        keys.push_back("multi-snappy-" + std::to_string(ii));
+    }
+    for (size_t ii = 0; ii < keys.size(); ii++) {
+        kptrs.push_back(keys[ii].c_str());
+        klens.push_back(keys[ii].size());
+        vptrs.push_back(value.c_str());
+        vlens.push_back(value.size());
+    }
+
+    SnappyCookie cookie;
+    lcb_CMDSTORE *scmd;
+    lcb_cmdstore_create(&scmd, LCB_STORE_UPSERT);
+    lcb_cmdstore_key(scmd, keys[0].c_str(), keys[0].size());
+    lcb_cmdstore_value(scmd, value.c_str(), value.size());
+    lcb_store(instance, &cookie, scmd);
+    lcb_wait(instance, LCB_WAIT_DEFAULT);
+    ASSERT_TRUE(cookie.called);
+    ASSERT_EQ(LCB_SUCCESS, cookie.rc);
+
+    /* now we have negotiated snappy feature, the values are compressed when the packets are built */
+    lcb_install_callback(instance, LCB_CALLBACK_STORE, multistorecb);
+    std::vector< lcb_STATUS > statuses;
+    ASSERT_EQ(LCB_SUCCESS, lcb_store_multi(instance, &statuses, scmd, kptrs.data(), klens.data(), vptrs.data(),
+                                           vlens.data(), keys.size(), multistore_done));
+    lcb_wait(instance, LCB_WAIT_DEFAULT);
+    lcb_cmdstore_destroy(scmd);
+    ASSERT_EQ(std::vector< lcb_STATUS >(keys.size(), LCB_SUCCESS), statuses);
+
+    for (size_t ii = 0; ii < keys.size(); ii++) {
+        ASSERT_TRUE(isCompressed(keys[ii])) << keys[ii];
+
+        lcb_CMDGET *gcmd;
+        cookie = SnappyCookie();
+        lcb_cmdget_create(&gcmd);
+        lcb_cmdget_key(gcmd, keys[ii].c_str(), keys[ii].size());
+        lcb_get(instance, &cookie, gcmd);
+        lcb_wait(instance, LCB_WAIT_DEFAULT);
+        lcb_cmdget_destroy(gcmd);
+        ASSERT_TRUE(cookie.called);
+        ASSERT_EQ(LCB_SUCCESS, cookie.rc);
+        ASSERT_EQ(value, cookie.value);
+    }
+    setCompression("off");
+}
+
 TEST_F(SnappyUnitTest, testIOV)
 {
 
@@ -16,6 +16,7 @@
  */
 
 #include "mctest.h"
+#include <vector>
 
 class McAlloc : public ::testing::Test
 {
@@ -281,3 +282,81 @@ TEST_F(McAlloc, testRdataExDtor)
     mcreq_sched_fail(&q);
     ASSERT_EQ(0, ec.remaining);
 }
+
+TEST_F(McAlloc, testVbPipelineRoutes)
+{
+    CQWrap q;
+    ASSERT_TRUE(q.vbpipelines != NULL);
+    ASSERT_EQ(q.config->nvb, q.nvbpipelines);
+    for (unsigned ii = 0; ii < q.nvbpipelines; ii++) {
+        ASSERT_EQ(q.pipelines[lcbvb_vbmaster(q.config, ii)], q.vbpipelines[ii]);
+    }
+
+    PacketWrap pw;
+    pw.setCopyKey("Hello");
+    ASSERT_TRUE(pw.reservePacket(&q));
+    int vbid = lcbvb_k2vb(q.config, "Hello", 5);
+    ASSERT_EQ(q.vbpipelines[vbid], pw.pipeline);
+    mcreq_wipe_packet(pw.pipeline, pw.pkt);
+    mcreq_release_packet(pw.pipeline, pw.pkt);
+
+    // Direct modifications of the vBucket map are picked up when routing
+    int master = q.config->vbuckets[vbid].servers[0];
+    int other = (master + 1) % (int)q.npipelines;
+    q.config->vbuckets[vbid].servers[0] = other;
+    PacketWrap pw2;
+    pw2.setCopyKey("Hello");
+    ASSERT_TRUE(pw2.reservePacket(&q));
+    ASSERT_EQ(q.pipelines[other], pw2.pipeline);
+    mcreq_wipe_packet(pw2.pipeline, pw2.pkt);
+    mcreq_release_packet(pw2.pipeline, pw2.pkt);
+
+    // A vBucket without a master cannot be routed
+    q.config->vbuckets[vbid].servers[0] = -1;
+    PacketWrap pw3;
+    pw3.setCopyKey("Hello");
+    ASSERT_FALSE(pw3.reservePacket(&q));
+    ASSERT_TRUE(q.vbpipelines[vbid] == NULL);
+}
+
+TEST_F(McAlloc, testBatchPackets)
+{
+    CQWrap q;
+    const char *keys[] = {"a", "bb", "ccc", "dddd", "eeeee", "ffffff", "ggggggg", "hhhhhhhh"};
+    const unsigned nkeys = sizeof(keys) / sizeof(keys[0]);
+    std::vector< mc_BATCHITEM > items(nkeys);
+    for (unsigned ii = 0; ii < nkeys; ii++) {
+        memset(&items[ii], 0, sizeof(items[ii]));
+        items[ii].key = keys[ii];
+        items[ii].nkey = strlen(keys[ii]);
+        items[ii].value = "value";
+        items[ii].nvalue = ii % 2 ? 5 : 0;
+    }
+    ASSERT_EQ(LCB_SUCCESS, mcreq_map_batch(&q, &items[0], nkeys, 0));
+    for (unsigned ii = 0; ii < nkeys; ii++) {
+        ASSERT_EQ(lcbvb_k2vb(q.config, keys[ii], items[ii].nkey), items[ii].vbid);
+        ASSERT_EQ(q.vbpipelines[items[ii].vbid], items[ii].pipeline);
+    }
+
+    // Build the packets of all keys on one pipeline, as if they mapped there
+    std::vector< mc_PACKET * > packets(nkeys);
+    mc_PIPELINE *pl = q.pipelines[0];
+    ASSERT_EQ(LCB_SUCCESS, mcreq_batch_packets(pl, &items[0], nkeys, 28, 0, &packets[0]));
+    for (unsigned ii = 0; ii < nkeys; ii++) {
+        mc_PACKET *pkt = packets[ii];
+        ASSERT_EQ(4, pkt->extlen);
+        ASSERT_EQ(28 + items[ii].nkey, pkt->kh_span.size);
+        ASSERT_EQ(0, memcmp(SPAN_BUFFER(&pkt->kh_span) + 28, keys[ii], items[ii].nkey));
+        if (items[ii].nvalue) {
+            ASSERT_NE(0, pkt->flags & MCREQ_F_HASVALUE);
+            ASSERT_EQ(0, memcmp(SPAN_BUFFER(&pkt->u_value.single), "value", 5));
+        } else {
+            ASSERT_EQ(0, pkt->flags & MCREQ_F_HASVALUE);
+        }
+        ASSERT_EQ(packets[0]->opaque + ii, pkt->opaque);
+    }
+    for (unsigned ii = 0; ii < nkeys; ii++) {
+        mcreq_wipe_packet(pl, packets[ii]);
+        mcreq_release_packet(pl, packets[ii]);
+    }
+}
@@ -0,0 +1,177 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+#include <gtest/gtest.h>
+#include "internal.h"
+#include "kvdispatch.h"
+#include "packetutils.h"
+#include "bucketconfig/clconfig.h"
+#include "sllist-inl.h"
+#include "rdb/rope.h"
+#include <string>
+
+/**
+ * Replays responses through mcreq_dispatch_response() against a request
+ * which was scheduled (but never sent) on an instance.
+ */
+class McDispatch : public ::testing::Test
+{
+  protected:
+    lcb_INSTANCE *instance{nullptr};
+    mc_PIPELINE *pipeline{nullptr};
+    mc_PACKET *request{nullptr};
+    rdb_IOROPE ior{};
+    lcb::MemcachedResponse response;
+    bool loaded{false};
+
+    void SetUp() override
+    {
+        lcb_CREATEOPTS *options = nullptr;
+        lcb_createopts_create(&options, LCB_TYPE_BUCKET);
+        ASSERT_EQ(LCB_SUCCESS, lcb_create(&instance, options));
+        lcb_createopts_destroy(options);
+        ASSERT_EQ(LCB_SUCCESS, lcb_cntl_string(instance, "enable_collections", "false"));
+
+        lcbvb_SERVER server{};
+        server.hostname = const_cast<char *>("kv.example.com");
+        server.svc.data = 11210;
+        lcbvb_CONFIG *vbc = lcbvb_create();
+        ASSERT_EQ(0, lcbvb_genconfig_ex(vbc, "default", nullptr, &server, 1, 0, 64));
+        lcb::clconfig::ConfigInfo *info = lcb::clconfig::ConfigInfo::create(vbc, lcb::clconfig::CLCONFIG_PHONY, "");
+        lcb_update_vbconfig(instance, info);
+        info->decref();
+        rdb_init(&ior, rdb_libcalloc_new());
+
+        lcb_CMDGET *cmd;
+        lcb_cmdget_create(&cmd);
+        lcb_cmdget_key(cmd, "key", 3);
+        lcb_sched_enter(instance);
+        ASSERT_EQ(LCB_SUCCESS, lcb_get(instance, nullptr, cmd));
+        lcb_cmdget_destroy(cmd);
+        pipeline = instance->cmdq.pipelines[0];
+        request = SLLIST_ITEM(SLLIST_FIRST(&pipeline->ctxqueued), mc_PACKET, slnode);
+    }
+
+    void TearDown() override
+    {
+        if (loaded) {
+            response.release(&ior);
+        }
+        rdb_cleanup(&ior);
+        lcb_sched_fail(instance);
+        lcb_destroy(instance);
+    }
+
+    /** Load a response with four bytes of extras (flags) and a value */
+    void respond(uint8_t opcode, const std::string &value)
+    {
+        protocol_binary_response_header hdr{};
+        hdr.response.magic = PROTOCOL_BINARY_RES;
+        hdr.response.opcode = opcode;
+        hdr.response.extlen = 4;
+        hdr.response.opaque = request->opaque;
+        hdr.response.bodylen = htonl(static_cast<uint32_t>(4 + value.size()));
+        uint32_t flags = 0;
+        rdb_copywrite(&ior, hdr.bytes, sizeof(hdr.bytes));
+        rdb_copywrite(&ior, &flags, sizeof(flags));
+        rdb_copywrite(&ior, const_cast<char *>(value.c_str()), value.size());
+        unsigned wanted;
+        ASSERT_TRUE(response.load(&ior, &wanted));
+        loaded = true;
+    }
+
+    lcb_KV_OPCODE_STATS stats(uint8_t opcode)
+    {
+        lcb_KV_OPCODE_STATS out{};
+        out.opcode = opcode;
+        EXPECT_EQ(LCB_SUCCESS, lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_KV_OPCODE_STATS, &out));
+        return out;
+    }
+};
+
+static size_t ncallbacks = 0;
+
+static void get_callback(lcb_INSTANCE *, int, const lcb_RESPGET *resp)
+{
+    EXPECT_EQ(LCB_SUCCESS, lcb_respget_status(resp));
+    ncallbacks++;
+}
+
+static size_t ncustom = 0;
+
+static void custom_handler(mc_PIPELINE *, mc_PACKET *, lcb::MemcachedResponse *response, lcb_STATUS)
+{
+    EXPECT_EQ(0xf0, response->opcode());
+    ncustom++;
+}
+
+TEST_F(McDispatch, testCustomHandler)
+{
+    respond(0xf0, "");
+    ASSERT_EQ(-1, mcreq_dispatch_response(pipeline, request, &response, LCB_SUCCESS));
+
+    ncustom = 0;
+    instance->kv_dispatch->set_handler(0xf0, custom_handler);
+    ASSERT_EQ(0, mcreq_dispatch_response(pipeline, request, &response, LCB_SUCCESS));
+    ASSERT_EQ(1, ncustom);
+    ASSERT_EQ(2, stats(0xf0).responses);
+    ASSERT_EQ(0, stats(PROTOCOL_BINARY_CMD_GET).responses);
+
+    instance->kv_dispatch->set_handler(0xf0, nullptr);
+    ASSERT_EQ(-1, mcreq_dispatch_response(pipeline, request, &response, LCB_SUCCESS));
+}
+
+TEST_F(McDispatch, testTimings)
+{
+    lcb_install_callback(instance, LCB_CALLBACK_GET, (lcb_RESPCALLBACK)get_callback);
+    respond(PROTOCOL_BINARY_CMD_GET, "value");
+    ASSERT_EQ(0, mcreq_dispatch_response(pipeline, request, &response, LCB_SUCCESS));
+    ASSERT_EQ(1, stats(PROTOCOL_BINARY_CMD_GET).responses);
+    ASSERT_EQ(nullptr, stats(PROTOCOL_BINARY_CMD_GET).timings);
+
+    lcb_enable_timings(instance);
+    ASSERT_EQ(0, mcreq_dispatch_response(pipeline, request, &response, LCB_SUCCESS));
+    ASSERT_NE(nullptr, stats(PROTOCOL_BINARY_CMD_GET).timings);
+    ASSERT_EQ(nullptr, stats(PROTOCOL_BINARY_CMD_SET).timings);
+    lcb_disable_timings(instance);
+    ASSERT_EQ(nullptr, stats(PROTOCOL_BINARY_CMD_GET).timings);
+    ASSERT_EQ(2, stats(PROTOCOL_BINARY_CMD_GET).responses);
+}
+
+/**
+ * Replays the same get response many times, to measure the cost of looking
+ * up the handler, recording the metrics and building the response (the
+ * callback itself does nothing).
+ */
+TEST_F(McDispatch, testReplay)
+{
+    const size_t iterations = 200000;
+    lcb_install_callback(instance, LCB_CALLBACK_GET, (lcb_RESPCALLBACK)get_callback);
+    respond(PROTOCOL_BINARY_CMD_GET, "{\"name\":\"value\"}");
+
+    ncallbacks = 0;
+    hrtime_t begin = gethrtime();
+    for (size_t ii = 0; ii < iterations; ii++) {
+        mcreq_dispatch_response(pipeline, request, &response, LCB_SUCCESS);
+    }
+    hrtime_t elapsed = gethrtime() - begin;
+    ASSERT_EQ(iterations, ncallbacks);
+    ASSERT_EQ(iterations, stats(PROTOCOL_BINARY_CMD_GET).responses);
+
+    RecordProperty("dispatch_ns", static_cast<int>(elapsed / iterations));
+}
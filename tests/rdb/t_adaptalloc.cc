@@ -0,0 +1,199 @@
+#include "rdbtest.h"
+#include <rdb/adaptalloc.h>
+#include <cstdio>
+
+class AdaptallocTest : public ::testing::Test
+{
+};
+
+TEST_F(AdaptallocTest, testSizer)
+{
+    rdb_SIZER sizer;
+    rdb_sizer_init(&sizer);
+    ASSERT_EQ(RDB_SIZER_RDSIZE_MIN, rdb_sizer_get(&sizer));
+
+    // Small messages do not need more than the smallest read
+    for (unsigned ii = 0; ii < 1000; ii++) {
+        rdb_sizer_add(&sizer, 100);
+    }
+    ASSERT_EQ(RDB_SIZER_RDSIZE_MIN, rdb_sizer_get(&sizer));
+
+    // Once most messages are large, reads grow to cover several of them
+    for (unsigned ii = 0; ii < 1000; ii++) {
+        rdb_sizer_add(&sizer, 20000);
+    }
+    ASSERT_EQ(32768 * RDB_SIZER_READAHEAD, rdb_sizer_get(&sizer));
+
+    // ... but not beyond the maximum
+    for (unsigned ii = 0; ii < 1000; ii++) {
+        rdb_sizer_add(&sizer, 4 * 1024 * 1024);
+    }
+    ASSERT_EQ(RDB_SIZER_RDSIZE_MAX, rdb_sizer_get(&sizer));
+
+    // And they shrink back when the workload changes
+    for (unsigned ii = 0; ii < 4000; ii++) {
+        rdb_sizer_add(&sizer, 100);
+    }
+    ASSERT_EQ(RDB_SIZER_RDSIZE_MIN, rdb_sizer_get(&sizer));
+}
+
+TEST_F(AdaptallocTest, testCache)
+{
+    rdb_SEGCACHE *cache = rdb_segcache_new(16384);
+    RdbAllocator a(rdb_adaptalloc_new(cache));
+    RdbAllocator b(rdb_adaptalloc_new(cache));
+
+    // Segments are rounded up to a power of two
+    rdb_ROPESEG *seg1 = a.alloc(5000);
+    ASSERT_EQ(8192, seg1->nalloc);
+    rdb_ROPESEG *seg2 = a.alloc(8192);
+    rdb_ROPESEG *seg3 = a.alloc(8192);
+    ASSERT_EQ(0, cache->nhits);
+    ASSERT_EQ(3, cache->nmisses);
+
+    a.free(seg1);
+    a.free(seg2);
+    ASSERT_EQ(16384, cache->nbytes);
+    // The cache is full
+    a.free(seg3);
+    ASSERT_EQ(16384, cache->nbytes);
+    ASSERT_EQ(1, cache->nevicted);
+
+    // Segments are shared between the allocators of the cache
+    rdb_ROPESEG *seg4 = b.alloc(8000);
+    ASSERT_TRUE(seg4 == seg1 || seg4 == seg2);
+    ASSERT_EQ(1, cache->nhits);
+    ASSERT_EQ(8192, cache->nbytes);
+    b.free(seg4);
+
+    // Segments too large for any class are never cached
+    rdb_ROPESEG *huge = a.alloc(8 * 1024 * 1024);
+    ASSERT_EQ(8 * 1024 * 1024, huge->nalloc);
+    a.free(huge);
+    ASSERT_EQ(16384, cache->nbytes);
+
+    rdb_segcache_set_limit(cache, 8192);
+    ASSERT_EQ(8192, rdb_segcache_get_limit(cache));
+    ASSERT_EQ(8192, cache->nbytes);
+    rdb_segcache_dump(cache, stdout);
+
+    a.release();
+    b.release();
+    rdb_segcache_unref(cache);
+}
+
+TEST_F(AdaptallocTest, testExpect)
+{
+    rdb_SEGCACHE *cache = rdb_segcache_new(1024 * 1024);
+    IORope ior(rdb_adaptalloc_new(cache));
+    rdb_segcache_unref(cache);
+
+    std::string msg(100000, '*');
+    ior.rdsize = 4096;
+    ior.feed(msg.substr(0, 4096));
+    ASSERT_EQ(4096, ior.usedSize());
+
+    rdb_expect(&ior, msg.size());
+    ASSERT_EQ(msg.size() - 4096, ior.rdsize);
+    ior.feed(msg.substr(4096));
+    ASSERT_EQ(msg.size(), rdb_get_contigsize(&ior));
+
+    unsigned long nconsolidated = ior.nconsolidated;
+    rdb_consolidate(&ior, msg.size());
+    // the rest of the message was read behind its beginning
+    ASSERT_EQ(nconsolidated, ior.nconsolidated);
+    ASSERT_EQ(msg, ior.stlstr(msg.size()));
+}
+
+/** Returns the size of the next message of a mixed workload */
+static unsigned next_msgsize(unsigned ii)
+{
+    // one in sixteen values is large
+    return 24 + ((ii * 2654435761u) % 16 == 0 ? 256 * 1024 + ii % 1000 : 100 + ii % 400);
+}
+
+struct ReadStats {
+    unsigned long nreads;
+    unsigned long nconsolidated;
+};
+
+/**
+ * Reads a stream of messages (a 24 byte header with the body length at offset
+ * 8, as in the memcached protocol) which the network delivers in chunks of at
+ * most `netchunk` bytes, consolidating each message as the server does.
+ */
+static ReadStats read_stream(rdb_ALLOCATOR *allocator, unsigned nmsgs, unsigned netchunk, bool adaptive)
+{
+    std::string stream;
+    for (unsigned ii = 0; ii < nmsgs; ii++) {
+        unsigned msgsize = next_msgsize(ii);
+        std::string msg(msgsize, static_cast< char >('a' + ii % 26));
+        for (unsigned jj = 0; jj < 4; jj++) {
+            msg[8 + jj] = static_cast< char >((msgsize - 24) >> (24 - 8 * jj));
+        }
+        stream += msg;
+    }
+
+    IORope ior(allocator);
+    ior.rdsize = 32768;
+    rdb_SIZER sizer;
+    rdb_sizer_init(&sizer);
+
+    size_t pos = 0;
+    unsigned nread = 0;
+    while (nread < nmsgs) {
+        nb_IOV iov[32];
+        unsigned niov = rdb_rdstart(&ior, iov, 32);
+        size_t avail = std::min(stream.size() - pos, (size_t)netchunk);
+        unsigned nr = 0;
+        for (unsigned ii = 0; ii < niov && nr < avail; ii++) {
+            unsigned to_copy = std::min(avail - nr, (size_t)iov[ii].iov_len);
+            memcpy(iov[ii].iov_base, stream.data() + pos + nr, to_copy);
+            nr += to_copy;
+        }
+        rdb_rdend(&ior, nr);
+        pos += nr;
+
+        while (ior.usedSize() >= 24) {
+            const unsigned char *hdr = (const unsigned char *)rdb_get_consolidated(&ior, 24);
+            unsigned msgsize = 24 + (hdr[8] << 24 | hdr[9] << 16 | hdr[10] << 8 | hdr[11]);
+            if (ior.usedSize() < msgsize) {
+                if (adaptive) {
+                    rdb_expect(&ior, msgsize);
+                }
+                break;
+            }
+            EXPECT_EQ('a' + nread % 26, rdb_get_consolidated(&ior, msgsize)[msgsize - 1]);
+            rdb_consumed(&ior, msgsize);
+            nread++;
+            if (adaptive) {
+                rdb_sizer_add(&sizer, msgsize);
+                ior.rdsize = rdb_sizer_get(&sizer);
+            }
+        }
+    }
+
+    ReadStats stats;
+    stats.nreads = ior.nreads;
+    stats.nconsolidated = ior.nconsolidated;
+    return stats;
+}
+
+TEST_F(AdaptallocTest, testReadBenchmark)
+{
+    const unsigned nmsgs = 20000;
+    const unsigned netchunk = 65536;
+
+    ReadStats fixed = read_stream(rdb_bigalloc_new(), nmsgs, netchunk, false);
+    rdb_SEGCACHE *cache = rdb_segcache_new(4 * 1024 * 1024);
+    ReadStats adaptive = read_stream(rdb_adaptalloc_new(cache), nmsgs, netchunk, true);
+    rdb_segcache_unref(cache);
+
+    ASSERT_LE(adaptive.nreads, fixed.nreads);
+    ASSERT_LT(adaptive.nconsolidated, fixed.nconsolidated);
+
+    RecordProperty("fixed_reads", static_cast< int >(fixed.nreads));
+    RecordProperty("fixed_bytes_consolidated", static_cast< int >(fixed.nconsolidated));
+    RecordProperty("adaptive_reads", static_cast< int >(adaptive.nreads));
+    RecordProperty("adaptive_bytes_consolidated", static_cast< int >(adaptive.nconsolidated));
+}
@@ -160,3 +160,58 @@ TEST_F(SockMgrTest, testMaxIdle)
         delete otherSocks[ii];
     }
 }
+
+TEST_F(SockMgrTest, testWarmup)
+{
+    lcb_host_t host = {0};
+    loop->populateHost(&host);
+    loop->sockpool->get_service_options(LCBIO_SERVICE_N1QL).minidle = 2;
+    loop->sockpool->warmup(host, LCB_MS2US(1000), LCBIO_SERVICE_N1QL);
+    ASSERT_EQ(2, loop->sockpool->get_stats().created);
+    // Already enough connections
+    loop->sockpool->warmup(host, LCB_MS2US(1000), LCBIO_SERVICE_N1QL);
+    ASSERT_EQ(2, loop->sockpool->get_stats().created);
+
+    ESocket *sock1 = new ESocket();
+    loop->connectPooled(sock1);
+    ESocket *sock2 = new ESocket();
+    loop->connectPooled(sock2);
+    ASSERT_TRUE(sock1->sock != NULL);
+    ASSERT_TRUE(sock2->sock != NULL);
+    ASSERT_NE(sock1->sock, sock2->sock);
+
+    // Both requests were served by the connections opened in advance
+    const lcb::io::Pool::Stats &stats = loop->sockpool->get_stats();
+    ASSERT_EQ(2, stats.requests);
+    ASSERT_EQ(2, stats.created);
+    ASSERT_EQ(0, stats.failed);
+    delete sock1;
+    delete sock2;
+}
+
+TEST_F(SockMgrTest, testMaxHost)
+{
+    loop->sockpool->get_service_options(LCBIO_SERVICE_UNSPEC).maxhost = 1;
+
+    ESocket *sock1 = new ESocket();
+    loop->connectPooled(sock1);
+    ASSERT_TRUE(sock1->sock != NULL);
+    lcbio_SOCKET *rawsock = sock1->sock;
+
+    // The only connection allowed is in use
+    ESocket *sock2 = new ESocket();
+    loop->connectPooled(sock2, NULL, 50);
+    ASSERT_TRUE(sock2->sock == NULL);
+    ASSERT_EQ(1, loop->sockpool->get_stats().created);
+    ASSERT_EQ(1, loop->sockpool->get_stats().failed);
+    ASSERT_LE(LCB_MS2US(50) * 1000, loop->sockpool->get_stats().wait_max);
+    delete sock2;
+
+    delete sock1;
+    ESocket *sock3 = new ESocket();
+    loop->connectPooled(sock3);
+    ASSERT_EQ(rawsock, sock3->sock);
+    ASSERT_EQ(1, loop->sockpool->get_stats().created);
+    ASSERT_EQ(1, loop->sockpool->get_stats().reused);
+    delete sock3;
+}
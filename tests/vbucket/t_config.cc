@@ -176,6 +176,121 @@ TEST_F(ConfigTest, testAltMap)
     lcbvb_destroy(cfg);
 }
 
+TEST_F(ConfigTest, testFlatRoutes)
+{
+    lcbvb_CONFIG *cfg = lcbvb_create();
+    lcbvb_genconfig(cfg, 4, 2, 64);
+    ASSERT_TRUE(cfg->vbroutes != NULL);
+    ASSERT_EQ(0, (uintptr_t)cfg->vbroutes % 64) << "Routing table is cache line aligned";
+
+    for (unsigned ii = 0; ii < cfg->nvb; ii++) {
+        const int16_t *route = cfg->vbroutes + ii * LCBVB_ROUTE_STRIDE;
+        ASSERT_EQ(cfg->vbuckets[ii].servers[0], route[0]);
+        ASSERT_EQ(cfg->vbuckets[ii].servers[1], route[1]);
+        ASSERT_EQ(cfg->vbuckets[ii].servers[2], route[2]);
+        ASSERT_EQ(-1, route[3]);
+    }
+
+    // Remapping must be reflected in the flattened table
+    lcbvb_genffmap(cfg);
+    int master = lcbvb_vbmaster(cfg, 0);
+    int altix = lcbvb_nmv_remap(cfg, 0, master);
+    ASSERT_NE(master, altix);
+    ASSERT_EQ(altix, cfg->vbroutes[0]);
+    ASSERT_EQ(altix, lcbvb_vbmaster(cfg, 0));
+
+    // The vBucket map is authoritative, the flattened copy follows an explicit update
+    cfg->vbuckets[1].servers[0] = -1;
+    ASSERT_EQ(-1, lcbvb_vbmaster(cfg, 1));
+    ASSERT_NE(-1, cfg->vbroutes[LCBVB_ROUTE_STRIDE]);
+    ASSERT_EQ(0, lcbvb_update_routes(cfg));
+    ASSERT_EQ(-1, cfg->vbroutes[LCBVB_ROUTE_STRIDE]);
+    lcbvb_destroy(cfg);
+}
+
+TEST_F(ConfigTest, testBinarySnapshot)
+{
+    lcbvb_CONFIG *cfg = lcbvb_create();
+    lcbvb_genconfig(cfg, 4, 2, 64);
+    lcbvb_genffmap(cfg);
+    cfg->revid = 42;
+
+    char *snapshot = NULL;
+    size_t nsnapshot = 0;
+    ASSERT_EQ(0, lcbvb_save_binary(cfg, &snapshot, &nsnapshot));
+    ASSERT_NE(0, lcbvb_is_binary(snapshot, nsnapshot));
+
+    lcbvb_CONFIG *loaded = lcbvb_create();
+    ASSERT_EQ(0, lcbvb_load_binary(loaded, snapshot, nsnapshot)) << lcbvb_get_error(loaded);
+    ASSERT_EQ(42, lcbvb_get_revision(loaded));
+    ASSERT_EQ(cfg->nsrv, loaded->nsrv);
+    ASSERT_EQ(cfg->nvb, loaded->nvb);
+    ASSERT_EQ(cfg->nrepl, loaded->nrepl);
+    ASSERT_STREQ(cfg->bname, loaded->bname);
+    ASSERT_TRUE(loaded->ffvbuckets != NULL);
+    ASSERT_TRUE(loaded->vbroutes != NULL);
+    for (unsigned ii = 0; ii < cfg->nsrv; ii++) {
+        ASSERT_STREQ(cfg->servers[ii].authority, loaded->servers[ii].authority);
+        ASSERT_EQ(cfg->servers[ii].svc.mgmt, loaded->servers[ii].svc.mgmt);
+        ASSERT_EQ(cfg->servers[ii].nvbs, loaded->servers[ii].nvbs);
+    }
+    for (unsigned ii = 0; ii < cfg->nvb; ii++) {
+        ASSERT_EQ(lcbvb_vbmaster(cfg, ii), lcbvb_vbmaster(loaded, ii));
+        ASSERT_EQ(lcbvb_vbreplica(cfg, ii, 0), lcbvb_vbreplica(loaded, ii, 0));
+        ASSERT_EQ(cfg->ffvbuckets[ii].servers[0], loaded->ffvbuckets[ii].servers[0]);
+    }
+    lcbvb_destroy(loaded);
+
+    // Truncated and corrupted snapshots must be rejected
+    loaded = lcbvb_create();
+    ASSERT_NE(0, lcbvb_load_binary(loaded, snapshot, nsnapshot - 1));
+    lcbvb_destroy(loaded);
+
+    snapshot[nsnapshot - 1] ^= 0xff;
+    loaded = lcbvb_create();
+    ASSERT_NE(0, lcbvb_load_binary(loaded, snapshot, nsnapshot));
+    lcbvb_destroy(loaded);
+
+    free(snapshot);
+    lcbvb_destroy(cfg);
+}
+
+TEST_F(ConfigTest, testBinarySnapshotKetama)
+{
+    string txt = getConfigFile("memd_ketama_config.json");
+    lcbvb_CONFIG *cfg = lcbvb_parse_json(txt.c_str());
+    ASSERT_TRUE(cfg != NULL);
+    ASSERT_EQ(LCBVB_DIST_KETAMA, cfg->dtype);
+    lcbvb_replace_host(cfg, "192.168.1.104");
+
+    char *snapshot = NULL;
+    size_t nsnapshot = 0;
+    ASSERT_EQ(0, lcbvb_save_binary(cfg, &snapshot, &nsnapshot));
+
+    lcbvb_CONFIG *loaded = lcbvb_create();
+    ASSERT_EQ(0, lcbvb_load_binary(loaded, snapshot, nsnapshot)) << lcbvb_get_error(loaded);
+    ASSERT_EQ(LCBVB_DIST_KETAMA, loaded->dtype);
+    ASSERT_EQ(cfg->ncontinuum, loaded->ncontinuum);
+    for (unsigned ii = 0; ii < cfg->ncontinuum; ii++) {
+        ASSERT_EQ(cfg->continuum[ii].point, loaded->continuum[ii].point);
+        ASSERT_EQ(cfg->continuum[ii].index, loaded->continuum[ii].index);
+    }
+
+    int srvix, vbid;
+    lcbvb_map_key(cfg, "foo", 3, &vbid, &srvix);
+    int loaded_srvix;
+    lcbvb_map_key(loaded, "foo", 3, &vbid, &loaded_srvix);
+    ASSERT_EQ(srvix, loaded_srvix);
+    ASSERT_STREQ(cfg->servers[srvix].authority, loaded->servers[loaded_srvix].authority);
+
+    // JSON input is not mistaken for a snapshot
+    ASSERT_EQ(0, lcbvb_is_binary(txt.c_str(), txt.size()));
+
+    free(snapshot);
+    lcbvb_destroy(loaded);
+    lcbvb_destroy(cfg);
+}
+
 TEST_F(ConfigTest, testGetReplicaNode)
 {
     lcbvb_CONFIG *cfg = lcbvb_create();
@@ -22,6 +22,8 @@
 #include <iostream>
 #include <queue>
 #include <list>
+#include <map>
+#include <tuple>
 #include <cstring>
 #include <cstdio>
 #include <cstdlib>
@@ -103,7 +105,8 @@ class Configuration
           o_startAt("start-at"), o_rateLimit("rate-limit"), o_userdocs("docs"), o_writeJson("json"),
           o_templatePairs("template"), o_subdoc("subdoc"), o_noop("noop"), o_sdPathCount("pathcount"),
           o_populateOnly("populate-only"), o_exptime("expiry"), o_collection("collection"), o_durability("durability"),
-          o_persist("persist-to"), o_replicate("replicate-to"), o_lock("lock")
+          o_persist("persist-to"), o_replicate("replicate-to"), o_lock("lock"),
+          o_multi("multi")
     {
         o_multiSize.setDefault(100).abbrev('B').description("Number of operations to batch");
         o_numItems.setDefault(1000).abbrev('I').description("Number of items to operate on");
@@ -137,6 +140,7 @@ class Configuration
         o_replicate.description("Wait until item is replicated to this number of nodes (-1 for all replicas)")
             .setDefault(0);
         o_lock.description("Lock keys for updates for given time (will not lock when set to zero)").setDefault(0);
+        o_multi.description("Schedule the gets and stores of each batch with lcb_get_multi/lcb_store_multi");
         params.getTimings().description("Enable command timings (second time to dump timings automatically)");
     }
 
@@ -278,6 +282,7 @@ class Configuration
         parser.addOption(o_persist);
         parser.addOption(o_replicate);
         parser.addOption(o_lock);
+        parser.addOption(o_multi);
         params.addToParser(parser);
         depr.addOptions(parser);
     }
@@ -319,6 +324,10 @@ class Configuration
     {
         return o_noop.result();
     }
+    bool useMulti()
+    {
+        return o_multi.result();
+    }
     bool useCollections()
     {
         return o_collection.passed();
@@ -397,6 +406,7 @@ class Configuration
     IntOption o_replicate;
 
     IntOption o_lock;
+    BoolOption o_multi;
     DeprecatedOptions depr;
 } config;
 
@@ -736,8 +746,12 @@ class ThreadContext
         bool hasItems = false;
 
         lcb_sched_enter(instance);
-        for (size_t ii = 0; ii < config.opsPerCycle; ++ii) {
-            hasItems = scheduleNextOperation();
+        if (config.useMulti()) {
+            hasItems = scheduleNextBatch();
+        } else {
+            for (size_t ii = 0; ii < config.opsPerCycle; ++ii) {
+                hasItems = scheduleNextOperation();
+            }
         }
         if (hasItems) {
             error = LCB_SUCCESS;
@@ -792,11 +806,103 @@ class ThreadContext
         }
     }
 
+    /** Keys (and values) of one lcb_get_multi()/lcb_store_multi() call */
+    struct BulkGroup {
+        vector<string> keys;
+        vector<string> values;
+    };
+
+    /**
+     * Schedule the operations of a batch, issuing a single bulk call for the
+     * plain gets and stores of each collection
+     */
+    bool scheduleNextBatch()
+    {
+        map<tuple<int, string, string>, BulkGroup> groups;
+        bool hasItems = false;
+
+        for (size_t ii = 0; ii < config.opsPerCycle; ++ii) {
+            NextOp opinfo;
+            gen->setNextOp(opinfo);
+            bool locked = opinfo.m_mode == NextOp::STORE && !gen->inPopulation() && config.lockTime > 0;
+            bool observe = opinfo.m_mode == NextOp::STORE && (config.persistTo > 0 || config.replicateTo > 0);
+            if ((opinfo.m_mode != NextOp::GET && opinfo.m_mode != NextOp::STORE) || locked || observe) {
+                hasItems = scheduleOperation(opinfo);
+                continue;
+            }
+            BulkGroup &group = groups[make_tuple(opinfo.m_mode, opinfo.m_scope, opinfo.m_collection)];
+            group.keys.push_back(opinfo.m_key);
+            if (opinfo.m_mode == NextOp::STORE) {
+                /* the fragments are only valid until the next operation is generated */
+                string value;
+                for (const auto &frag : opinfo.m_valuefrags) {
+                    value.append(static_cast<const char *>(frag.iov_base), frag.iov_len);
+                }
+                group.values.push_back(value);
+            }
+        }
+
+        unsigned exptime = config.getExptime();
+        for (const auto &entry : groups) {
+            const string &scope = get<1>(entry.first);
+            const string &collection = get<2>(entry.first);
+            const BulkGroup &group = entry.second;
+            vector<const char *> keys, values;
+            vector<size_t> keys_len, values_len;
+            for (const auto &key : group.keys) {
+                keys.push_back(key.c_str());
+                keys_len.push_back(key.size());
+            }
+            for (const auto &value : group.values) {
+                values.push_back(value.c_str());
+                values_len.push_back(value.size());
+            }
+
+            if (get<0>(entry.first) == NextOp::GET) {
+                lcb_CMDGET *gcmd;
+                lcb_cmdget_create(&gcmd);
+                if (config.useCollections() && (!collection.empty() || !scope.empty())) {
+                    lcb_cmdget_collection(gcmd, scope.c_str(), scope.size(), collection.c_str(), collection.size());
+                }
+                lcb_cmdget_expiry(gcmd, exptime);
+                error = lcb_get_multi(instance, this, gcmd, keys.data(), keys_len.data(), keys.size(), nullptr);
+                lcb_cmdget_destroy(gcmd);
+            } else {
+                lcb_CMDSTORE *scmd;
+                lcb_cmdstore_create(&scmd, LCB_STORE_UPSERT);
+                lcb_cmdstore_expiry(scmd, exptime);
+                if (config.writeJson()) {
+                    lcb_cmdstore_datatype(scmd, LCB_VALUE_F_JSON);
+                }
+                if (config.useCollections() && (!collection.empty() || !scope.empty())) {
+                    lcb_cmdstore_collection(scmd, scope.c_str(), scope.size(), collection.c_str(), collection.size());
+                }
+                if (config.durabilityLevel != LCB_DURABILITYLEVEL_NONE) {
+                    lcb_cmdstore_durability(scmd, config.durabilityLevel);
+                }
+                error = lcb_store_multi(instance, nullptr, scmd, keys.data(), keys_len.data(), values.data(),
+                                        values_len.data(), keys.size(), nullptr);
+                lcb_cmdstore_destroy(scmd);
+            }
+            if (error != LCB_SUCCESS) {
+                log("Failed to schedule operations: %s", lcb_strerror_long(error));
+            } else {
+                hasItems = true;
+            }
+        }
+        return hasItems;
+    }
+
     bool scheduleNextOperation()
     {
         NextOp opinfo;
-        unsigned exptime = config.getExptime();
         gen->setNextOp(opinfo);
+        return scheduleOperation(opinfo);
+    }
+
+    bool scheduleOperation(NextOp &opinfo)
+    {
+        unsigned exptime = config.getExptime();
 
         switch (opinfo.m_mode) {
             case NextOp::STORE: {
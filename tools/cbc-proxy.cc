@@ -82,7 +82,7 @@ class Configuration
 
     void processOptions() {}
 
-    void fillCropts(lcb_CREATEOPTS *opts)
+    void fillCropts(lcb_CREATEOPTS *&opts)
     {
         m_params.fillCropts(opts);
     }
@@ -228,17 +228,49 @@ static void dump_bytes(const struct client *cl, const char *msg, const void *ptr
     lcb_log(LOGARGS(INFO), CL_LOGFMT "%s", CL_LOGID(cl), ss.str().c_str());
 }
 
+/**
+ * A packet forwarded from the client's input buffer. The packet stays in #pkt
+ * until the library has both flushed it and received its response.
+ */
+struct request {
+    struct client *cl;
+    struct evbuffer *pkt;
+    int refcnt;
+};
+
+static void request_unref(struct request *req)
+{
+    if (--req->refcnt == 0) {
+        evbuffer_free(req->pkt);
+        delete req;
+    }
+}
+
+static void backbuf_cleanup(const void *, size_t, void *buf)
+{
+    lcb_backbuf_unref((lcb_BACKBUF)buf);
+}
+
 static void pktfwd_callback(lcb_INSTANCE *, const void *cookie, lcb_STATUS err, lcb_PKTFWDRESP *resp)
 {
     good_or_die(err, "Failed to forward a packet");
 
-    auto *cl = (struct client *)cookie;
-    struct evbuffer *output = bufferevent_get_output(cl->bev);
+    auto *req = (struct request *)cookie;
+    struct evbuffer *output = bufferevent_get_output(req->cl->bev);
+    /* hand the response buffers over to the output buffer, which writes them
+     * to the socket and releases them, so that the response is not copied */
     for (unsigned ii = 0; ii < resp->nitems; ii++) {
-        dump_bytes(cl, "response", resp->iovs[ii].iov_base, resp->iovs[ii].iov_len);
-        evbuffer_expand(output, resp->iovs[ii].iov_len);
-        evbuffer_add(output, resp->iovs[ii].iov_base, resp->iovs[ii].iov_len);
+        dump_bytes(req->cl, "response", resp->iovs[ii].iov_base, resp->iovs[ii].iov_len);
+        lcb_backbuf_ref(resp->bufs[ii]);
+        evbuffer_add_reference(output, resp->iovs[ii].iov_base, resp->iovs[ii].iov_len, backbuf_cleanup,
+                               resp->bufs[ii]);
     }
+    request_unref(req);
+}
+
+static void pktflushed_callback(lcb_INSTANCE *, const void *cookie)
+{
+    request_unref((struct request *)cookie);
 }
 
 extern "C" {
@@ -326,17 +358,65 @@ static void fts_callback(lcb_INSTANCE *, int, const lcb_RESPSEARCH *resp)
 }
 }
 
-static void conn_readcb(struct bufferevent *bev, void *cookie)
+/**
+ * Run a N1QL or FTS query for a STAT packet with the key `n1ql <statement>` or
+ * `fts <payload>`.
+ * @return false if the packet is not a query, and should be forwarded
+ */
+static bool dispatch_query(struct client *cl, const char *key, lcb_U16 keylen)
 {
-    auto *cl = (client *)cookie;
-    struct evbuffer *input;
-    size_t len;
+    if (keylen < 5) {
+        return false;
+    }
+    lcb_STATUS rc;
+    if (memcmp(key, "n1ql ", 5) == 0) {
+        lcb_CMDQUERY *cmd;
+        lcb_cmdquery_create(&cmd);
+
+        rc = lcb_cmdquery_statement(cmd, key + 5, keylen - 5);
+        if (rc != LCB_SUCCESS) {
+            lcb_cmdquery_destroy(cmd);
+            lcb_log(LOGARGS(INFO), CL_LOGFMT "failed to set query for N1QL", CL_LOGID(cl));
+            return false;
+        }
+        lcb_cmdquery_callback(cmd, n1ql_callback);
+        cl->cnt = 0;
+        rc = lcb_query(instance, cl, cmd);
+        lcb_cmdquery_destroy(cmd);
+        if (rc != LCB_SUCCESS) {
+            lcb_log(LOGARGS(INFO), CL_LOGFMT "failed to schedule N1QL command", CL_LOGID(cl));
+            return false;
+        }
+        return true;
+    } else if (memcmp(key, "fts ", 4) == 0) {
+        lcb_CMDSEARCH *cmd;
+        lcb_cmdsearch_create(&cmd);
+        lcb_cmdsearch_payload(cmd, key + 4, keylen - 4);
+        lcb_cmdsearch_callback(cmd, fts_callback);
+        rc = lcb_search(instance, cl, cmd);
+        lcb_cmdsearch_destroy(cmd);
+        cl->cnt = 0;
+        if (rc != LCB_SUCCESS) {
+            lcb_log(LOGARGS(INFO), CL_LOGFMT "failed to schedule FTS command", CL_LOGID(cl));
+            return false;
+        }
+        return true;
+    }
+    return false;
+}
 
-    input = bufferevent_get_input(bev);
-    len = evbuffer_get_length(input);
+#define PROXY_MAXIOV 16
+
+/**
+ * Forward the next packet in the client's input buffer
+ * @return false if the packet has not been received entirely
+ */
+static bool forward_packet(struct client *cl, struct evbuffer *input)
+{
+    size_t len = evbuffer_get_length(input);
     if (len < 24) {
         lcb_log(LOGARGS(DEBUG), CL_LOGFMT "not enough data for header", CL_LOGID(cl));
-        return;
+        return false;
     }
 
     protocol_binary_request_header header;
@@ -344,69 +424,69 @@ static void conn_readcb(struct bufferevent *bev, void *cookie)
     lcb_U32 bodylen = ntohl(header.request.bodylen);
 
     size_t pktlen = sizeof(header) + bodylen;
-    len = evbuffer_get_length(input);
     if (len < pktlen) {
         lcb_log(LOGARGS(DEBUG), CL_LOGFMT "not enough data for packet", CL_LOGID(cl));
-        return;
+        return false;
     }
-    void *pkt = malloc(pktlen);
-    if (pkt == nullptr) {
-        lcb_log(LOGARGS(ERROR), CL_LOGFMT "unable allocate buffer for the packet", CL_LOGID(cl));
-        return;
+
+    /* Move the packet into its own buffer. Whole chains are moved rather than
+     * copied, so only the part sharing a chain with the next packet is. */
+    struct evbuffer *pkt = evbuffer_new();
+    if (pkt == nullptr || evbuffer_remove_buffer(input, pkt, pktlen) != (int)pktlen) {
+        die("Failed to read packet from the client");
     }
-    evbuffer_remove(input, pkt, pktlen);
+    /* The header and key are needed in one piece, the value is not */
+    lcb_U16 keylen = ntohs(header.request.keylen);
+    size_t hdrlen = sizeof(header) + header.request.extlen + keylen;
+    const char *hdrbuf = (const char *)evbuffer_pullup(pkt, hdrlen);
 
-    lcb_sched_enter(instance);
-    dump_bytes(cl, "request", pkt, pktlen);
     if (header.request.opcode == PROTOCOL_BINARY_CMD_STAT) {
-        lcb_U8 extlen = ntohs(header.request.extlen);
-        lcb_U16 keylen = ntohs(header.request.keylen);
-        if (keylen < 5) {
-            goto FWD;
+        dump_bytes(cl, "request", evbuffer_pullup(pkt, -1), pktlen);
+        if (dispatch_query(cl, hdrbuf + sizeof(header) + header.request.extlen, keylen)) {
+            evbuffer_free(pkt);
+            return true;
         }
-        char *key = (char *)pkt + sizeof(header) + extlen;
-        lcb_STATUS rc;
-        if (memcmp(key, "n1ql ", 5) == 0) {
-            lcb_CMDQUERY *cmd;
-            lcb_cmdquery_create(&cmd);
-
-            rc = lcb_cmdquery_statement(cmd, key + 5, keylen - 5);
-            if (rc != LCB_SUCCESS) {
-                lcb_log(LOGARGS(INFO), CL_LOGFMT "failed to set query for N1QL", CL_LOGID(cl));
-                goto FWD;
-            }
-            lcb_cmdquery_callback(cmd, n1ql_callback);
-            cl->cnt = 0;
-            rc = lcb_query(instance, cl, cmd);
-            lcb_cmdquery_destroy(cmd);
-            if (rc != LCB_SUCCESS) {
-                lcb_log(LOGARGS(INFO), CL_LOGFMT "failed to schedule N1QL command", CL_LOGID(cl));
-                goto FWD;
-            }
-            goto DONE;
-        } else if (memcmp(key, "fts ", 4) == 0) {
-            lcb_CMDSEARCH *cmd;
-            lcb_cmdsearch_create(&cmd);
-            lcb_cmdsearch_payload(cmd, key + 4, keylen - 4);
-            lcb_cmdsearch_callback(cmd, fts_callback);
-            rc = lcb_search(instance, cl, cmd);
-            lcb_cmdsearch_destroy(cmd);
-            cl->cnt = 0;
-            if (rc != LCB_SUCCESS) {
-                lcb_log(LOGARGS(INFO), CL_LOGFMT "failed to schedule FTS command", CL_LOGID(cl));
-                goto FWD;
-            }
-            goto DONE;
+    }
+
+    struct evbuffer_iovec vecs[PROXY_MAXIOV];
+    lcb_IOV iovs[PROXY_MAXIOV];
+    int nvecs = evbuffer_peek(pkt, -1, nullptr, vecs, PROXY_MAXIOV);
+    if (nvecs > PROXY_MAXIOV) {
+        evbuffer_pullup(pkt, -1);
+        nvecs = evbuffer_peek(pkt, -1, nullptr, vecs, 1);
+    }
+    for (int ii = 0; ii < nvecs; ii++) {
+        iovs[ii].iov_base = vecs[ii].iov_base;
+        iovs[ii].iov_len = vecs[ii].iov_len;
+        if (header.request.opcode != PROTOCOL_BINARY_CMD_STAT) {
+            dump_bytes(cl, "request", vecs[ii].iov_base, vecs[ii].iov_len);
         }
     }
-FWD : {
+
+    /* released once the packet is flushed, and once the response arrives */
+    auto *req = new request();
+    req->cl = cl;
+    req->pkt = pkt;
+    req->refcnt = 2;
+
     lcb_CMDPKTFWD cmd = {0};
-    cmd.vb.vtype = LCB_KV_COPY;
-    cmd.vb.u_buf.contig.bytes = pkt;
-    cmd.vb.u_buf.contig.nbytes = pktlen;
-    good_or_die(lcb_pktfwd3(instance, cl, &cmd), "Failed to forward packet");
+    cmd.version = 1;
+    cmd.vb.vtype = LCB_KV_IOV;
+    cmd.vb.u_buf.multi.iov = iovs;
+    cmd.vb.u_buf.multi.niov = nvecs;
+    cmd.vb.u_buf.multi.total_length = pktlen;
+    good_or_die(lcb_pktfwd3(instance, req, &cmd), "Failed to forward packet");
+    return true;
 }
-DONE:
+
+static void conn_readcb(struct bufferevent *bev, void *cookie)
+{
+    auto *cl = (client *)cookie;
+    struct evbuffer *input = bufferevent_get_input(bev);
+
+    lcb_sched_enter(instance);
+    while (forward_packet(cl, input)) {
+    }
     lcb_sched_leave(instance);
 }
 
@@ -526,6 +606,7 @@ static void real_main(int argc, char **argv)
     lcb_cntl(instance, LCB_CNTL_SET, LCB_CNTL_CLIENT_STRING, app_client_string);
     lcb_set_bootstrap_callback(instance, bootstrap_callback);
     lcb_set_pktfwd_callback(instance, pktfwd_callback);
+    lcb_set_pktflushed_callback(instance, pktflushed_callback);
     lcb_install_callback(instance, LCB_CALLBACK_DIAG, diag_callback);
 
     good_or_die(lcb_connect(instance), "Failed to connect to cluster");